@@ -0,0 +1,54 @@
+#ifndef BINARY_H
+#define BINARY_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "argo.h"
+
+/*
+ * Binary snapshot of a parsed value, so that a document that is used over
+ * and over can be reloaded without parsing its text again.  A snapshot is
+ * a header, followed by one node per value in preorder (the root first,
+ * and each array or object followed by its elements or members), followed
+ * by the characters of all of the strings, names and number texts.
+ * Nodes refer to each other by index and to characters by offset, never
+ * by address, so that the snapshot can be mapped anywhere; the characters
+ * are stored as ARGO_CHARs, so that the strings of a loaded value can
+ * point straight into the mapping.  Numbers are in the byte order of the
+ * machine that saved the snapshot, which is recorded in the header.
+ */
+#define ARGO_BIN_MAGIC "ARGOBIN"
+#define ARGO_BIN_VERSION 1
+#define ARGO_BIN_BYTE_ORDER 0x01020304
+#define ARGO_BIN_NONE ((uint32_t) -1)
+
+typedef struct argo_bin_header {
+    char magic[8];                     // ARGO_BIN_MAGIC, NUL terminated.
+    uint32_t byte_order;               // ARGO_BIN_BYTE_ORDER, as stored by the saver.
+    uint32_t version;
+    uint64_t node_count;
+    uint64_t char_count;               // Size of the string area, in ARGO_CHARs.
+} ARGO_BIN_HEADER;
+
+typedef struct argo_bin_node {
+    uint8_t type;                      // ARGO_VALUE_TYPE of the value.
+    uint8_t valid_string;              // Validity flags of a number.
+    uint8_t valid_int;
+    uint8_t valid_float;
+    uint32_t next;                     // Next element or member, or ARGO_BIN_NONE.
+    uint32_t first;                    // First element or member, or ARGO_BIN_NONE;
+                                       // for a basic value, the ARGO_BASIC itself.
+    uint32_t name_length;              // Member name, if the value is a member.
+    uint64_t name_offset;
+    uint64_t text_offset;              // Content of a string, or text of a number.
+    uint64_t text_length;
+    int64_t int_value;                 // Value of a number.
+    double float_value;
+} ARGO_BIN_NODE;
+
+int argo_save_binary(ARGO_VALUE *v, FILE *f);
+
+ARGO_VALUE *argo_load_binary(FILE *f);
+
+#endif
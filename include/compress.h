@@ -0,0 +1,29 @@
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <stdio.h>
+
+#include "source.h"
+
+/*
+ * Compressed input and output.  Input that starts with the magic bytes of
+ * gzip or zstd is decompressed as it is read, one buffer at a time, so the
+ * whole decompressed document is never held in memory; output is compressed
+ * when --compress is given.  Support for each format depends on the library
+ * being found when argo is built (ARGO_HAVE_ZLIB, ARGO_HAVE_ZSTD); without
+ * it, such input or output is refused with a message.
+ */
+#define ARGO_COMPRESS_NONE 0
+#define ARGO_COMPRESS_GZIP 1
+#define ARGO_COMPRESS_ZSTD 2
+#define ARGO_COMPRESS_UNKNOWN (-1)      // Cannot tell without reading the input.
+
+#define ARGO_COMPRESS_BUFFER_SIZE (128 * 1024)
+
+int argo_compress_detect(FILE *in);
+
+ARGO_SOURCE *argo_decompress_open(ARGO_SOURCE *source, int *format);
+
+FILE *argo_compress_open(FILE *out, int format, int close_out);
+
+#endif
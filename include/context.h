@@ -0,0 +1,67 @@
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include <stdio.h>
+
+#include "argo.h"
+
+/*
+ * Parser/writer state that used to live in the globals of global.h.
+ * Every thread that reads or writes Argo values does so through its own
+ * context, so that several documents can be processed concurrently.
+ * The main thread starts out with a context whose arena is the static
+ * argo_value_storage array; worker threads create their own.
+ */
+typedef struct argo_context {
+    ARGO_VALUE *value_storage;         // Arena from which values are allocated.
+    int num_values;                    // Total number of slots in the arena.
+    int next_value;                    // Index of the next unused slot.
+    int lines_read;                    // Position in the input (for error messages):
+    int chars_read;                    // lines and characters on the line up to "mark".
+    long mark;                         // Offset in the input of that position,
+    int newline;                       // (nonzero if a newline just before it is counted on its line)
+    const char *text;                  // and the input from there on, if it is held
+    size_t text_length;                // in memory, with how much of it is.
+    int indent_level;                  // Current indent level while pretty printing.
+    char *indent;                      // A newline followed by spaces, for pretty printing,
+    int indent_size;                   // and its length.
+    char *mapping;                     // Snapshot that loaded values point into, if any,
+    size_t mapping_size;               // and its size.
+    struct argo_dedup *dedup;          // Content interned so far, if deduplicating.
+    FILE *errors;                      // Stream for error messages, or NULL for stderr.
+} ARGO_CONTEXT;
+
+/*
+ * Context used by the calling thread.
+ */
+extern __thread ARGO_CONTEXT *argo_ctx;
+
+/*
+ * Stream to which the calling thread reports what is wrong with the
+ * document it is reading or writing: stderr, unless its context has been
+ * given a stream of its own.
+ */
+#define argo_err (argo_ctx != NULL && argo_ctx->errors != NULL ? argo_ctx->errors : stderr)
+
+ARGO_CONTEXT *argo_context_create(int num_values);
+
+void argo_context_destroy(ARGO_CONTEXT *ctx);
+
+void argo_context_reset(ARGO_CONTEXT *ctx);
+
+ARGO_VALUE *argo_alloc_value(void);
+
+/*
+ * Readers only advance through their input; the line and column that error
+ * messages report are worked out from the offset reached when there is an
+ * error, by counting the newlines in the text read up to there.
+ */
+void argo_context_input(ARGO_CONTEXT *ctx, const char *text, size_t length, int line, int column);
+
+void argo_position(FILE *f);
+
+void argo_position_advance(ARGO_CONTEXT *ctx, size_t length);
+
+void argo_position_scan(const char *text, size_t length, int *line, int *column);
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "argo.h"
+#include "context.h"
+
+/*
+ * Hash-consing of values as they are parsed, selected with --dedup.
+ * Each value is looked up, once it is complete, among those seen before;
+ * if an equal one is found, then the new value shares its content instead
+ * of keeping its own: a string its characters, a number its text, and an
+ * array or object its list of elements or members, in which case the
+ * slots of the elements or members just parsed are given back to the
+ * arena.  Member names are shared in the same way.
+ *
+ * Only the content is shared, never the value itself, as a value carries
+ * its own name and list links; so the result is a DAG in which every
+ * list is reached from one or more values, and which is written out as
+ * if it were the tree it was parsed from.  Shared content must not be
+ * modified.  Since the elements and members of a value are interned before
+ * it, values are equal exactly when their own fields and those of their
+ * elements or members are the same, pointers included.
+ */
+
+/*
+ * Flags recording which strings of a value are borrowed from another.
+ */
+#define ARGO_SHARED_NAME 0x1
+#define ARGO_SHARED_CONTENT 0x2
+
+/*
+ * What an entry of the table interns: a member name, the content of a
+ * string, the text of a number, or the list of an array or object.
+ */
+#define ARGO_DEDUP_NAME 1
+#define ARGO_DEDUP_STRING 2
+#define ARGO_DEDUP_NUMBER 3
+#define ARGO_DEDUP_LIST 4
+
+typedef struct argo_dedup_entry {
+    uint64_t hash;
+    int slot;                          // Slot of the value that owns the content.
+    int kind;                          // ARGO_DEDUP_*, or 0 if the entry is free.
+} ARGO_DEDUP_ENTRY;
+
+typedef struct argo_dedup {
+    ARGO_DEDUP_ENTRY *entries;         // Open-addressed table of interned content.
+    size_t size;                       // Number of entries, a power of two,
+    size_t used;                       // and how many of them are in use.
+    unsigned char *shared;             // ARGO_SHARED_* flags of each slot.
+    long values_saved;                 // Slots given back to the arena.
+    long strings_saved;                // Strings, names and number texts shared.
+    long bytes_saved;                  // Memory not used thanks to sharing.
+} ARGO_DEDUP;
+
+int argo_dedup_enable(ARGO_CONTEXT *ctx);
+
+void argo_dedup_clear(ARGO_DEDUP *d);
+
+void argo_dedup_destroy(ARGO_DEDUP *d);
+
+ARGO_VALUE *argo_dedup_value(ARGO_VALUE *v);
+
+int argo_dedup_report(ARGO_CONTEXT *ctx, FILE *out);
+
+/*
+ * Intern a value just parsed, if the context deduplicates.
+ */
+#define argo_dedup_done(v) (argo_ctx->dedup != NULL ? argo_dedup_value(v) : (v))
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef ENCODE_H
+#define ENCODE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "argo.h"
+
+/*
+ * Binary encodings of Argo values, for consumers that would otherwise
+ * parse the canonical JSON output again: CBOR (RFC 8949) and MessagePack.
+ * Values can be read from either encoding as well, into the same trees
+ * that argo_read_value builds from JSON.
+ * Both are written in their preferred (shortest) form: integers, lengths
+ * and counts take the fewest bytes that hold them, and a floating-point
+ * number takes the narrowest width that represents it exactly.
+ *
+ * Strings are encoded in UTF-8, with every character taken as a code
+ * point, as in the -u mode, which --cbor and --msgpack imply so that the
+ * input is decoded into code points.  A string with a lone surrogate,
+ * which UTF-8 cannot represent, is an error, rather than being changed.
+ */
+
+/*
+ * Initial bytes of CBOR major types and simple values.
+ */
+#define ARGO_CBOR_UINT 0x00
+#define ARGO_CBOR_NEGINT 0x20
+#define ARGO_CBOR_TEXT 0x60
+#define ARGO_CBOR_ARRAY 0x80
+#define ARGO_CBOR_MAP 0xA0
+#define ARGO_CBOR_FALSE 0xF4
+#define ARGO_CBOR_TRUE 0xF5
+#define ARGO_CBOR_NULL 0xF6
+#define ARGO_CBOR_FLOAT16 0xF9
+#define ARGO_CBOR_FLOAT32 0xFA
+#define ARGO_CBOR_FLOAT64 0xFB
+
+/*
+ * MessagePack format bytes.
+ */
+#define ARGO_MSGPACK_FIXMAP 0x80
+#define ARGO_MSGPACK_FIXARRAY 0x90
+#define ARGO_MSGPACK_FIXSTR 0xA0
+#define ARGO_MSGPACK_NIL 0xC0
+#define ARGO_MSGPACK_FALSE 0xC2
+#define ARGO_MSGPACK_TRUE 0xC3
+#define ARGO_MSGPACK_FLOAT32 0xCA
+#define ARGO_MSGPACK_FLOAT64 0xCB
+#define ARGO_MSGPACK_UINT8 0xCC
+#define ARGO_MSGPACK_UINT16 0xCD
+#define ARGO_MSGPACK_UINT32 0xCE
+#define ARGO_MSGPACK_UINT64 0xCF
+#define ARGO_MSGPACK_INT8 0xD0
+#define ARGO_MSGPACK_INT16 0xD1
+#define ARGO_MSGPACK_INT32 0xD2
+#define ARGO_MSGPACK_INT64 0xD3
+#define ARGO_MSGPACK_STR8 0xD9
+#define ARGO_MSGPACK_STR16 0xDA
+#define ARGO_MSGPACK_STR32 0xDB
+#define ARGO_MSGPACK_ARRAY16 0xDC
+#define ARGO_MSGPACK_ARRAY32 0xDD
+#define ARGO_MSGPACK_MAP16 0xDE
+#define ARGO_MSGPACK_MAP32 0xDF
+
+int argo_write_cbor(ARGO_VALUE *v, FILE *f);
+
+int argo_write_msgpack(ARGO_VALUE *v, FILE *f);
+
+ARGO_VALUE *argo_read_cbor(FILE *f);
+
+ARGO_VALUE *argo_read_msgpack(FILE *f);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef FILES_H
+#define FILES_H
+
+#include <stdio.h>
+
+/*
+ * Suffix of the files to which canonical output is written with -w.
+ */
+#define ARGO_CANON_SUFFIX ".canon"
+
+/*
+ * Ways of reading files, selected with --io.  By default, they are loaded
+ * with io_uring where the kernel supports it: up to ARGO_LOAD_FILES at a
+ * time are opened, looked up and read ahead of the workers by batches of
+ * requests, so that a single thread keeps many reads in flight and the
+ * workers only parse.  Otherwise, or with --io sync, each worker reads the
+ * files it parses itself.
+ */
+#define ARGO_IO_AUTO 0
+#define ARGO_IO_SYNC 1
+#define ARGO_IO_URING 2
+
+#define ARGO_LOAD_FILES 64
+#define ARGO_LOAD_ENTRIES 256
+#define ARGO_LOAD_BUFFER_SIZE (64 * 1024)   // For files whose size is not known.
+
+int argo_files_run(char **files, int num_files, FILE *out);
+
+#endif
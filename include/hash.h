@@ -0,0 +1,68 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Content hashes of output, selected with -H: xxHash64, which is fast
+ * enough to keep up with the writers, and SHA-256, which is the same as
+ * that of sha256sum on the output.  They are computed incrementally as the
+ * bytes are written to a hash sink, which is an ordinary stream, so that
+ * any writer can be used without the output being kept anywhere.
+ */
+
+/*
+ * Algorithms that may be selected, as a bit set.
+ */
+#define ARGO_HASH_XXH64 0x1
+#define ARGO_HASH_SHA256 0x2
+
+#define ARGO_XXH64_SIZE 8
+#define ARGO_SHA256_SIZE 32
+
+typedef struct argo_xxh64 {
+    uint64_t acc[4];                   // Accumulators of the 32-byte stripes.
+    uint64_t seed;
+    uint64_t total;                    // Number of bytes hashed so far.
+    unsigned char buf[32];             // Bytes of the stripe not yet complete.
+    size_t buf_length;
+} ARGO_XXH64;
+
+typedef struct argo_sha256 {
+    uint32_t state[8];
+    uint64_t total;                    // Number of bytes hashed so far.
+    unsigned char buf[64];             // Bytes of the block not yet complete.
+    size_t buf_length;
+} ARGO_SHA256;
+
+typedef struct argo_hash {
+    int algorithms;                    // Bit set of ARGO_HASH_*.
+    ARGO_XXH64 xxh64;
+    ARGO_SHA256 sha256;
+} ARGO_HASH;
+
+void argo_xxh64_init(ARGO_XXH64 *h, uint64_t seed);
+
+void argo_xxh64_update(ARGO_XXH64 *h, const void *data, size_t length);
+
+uint64_t argo_xxh64_final(ARGO_XXH64 *h);
+
+uint64_t argo_xxh64(const void *data, size_t length, uint64_t seed);
+
+void argo_sha256_init(ARGO_SHA256 *h);
+
+void argo_sha256_update(ARGO_SHA256 *h, const void *data, size_t length);
+
+void argo_sha256_final(ARGO_SHA256 *h, unsigned char *digest);
+
+void argo_hash_init(ARGO_HASH *h, int algorithms);
+
+void argo_hash_update(ARGO_HASH *h, const void *data, size_t length);
+
+int argo_hash_print(ARGO_HASH *h, FILE *out);
+
+FILE *argo_hash_open(int algorithms, FILE *out);
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef HEAD_H
+#define HEAD_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * Preview of a large input, selected with --head and --sample: only some
+ * elements of the top-level array, or records with -n, are output.  Each
+ * one is parsed, written and forgotten before the next one is read, and
+ * the elements that are not output are skipped without being parsed, so
+ * memory does not grow with the input.  With --head, nothing more is read
+ * once enough elements have been output.
+ */
+typedef struct argo_head {
+    long remaining;                    // Elements still to output, or -1 for no limit.
+    uint64_t threshold;                // An element is kept if its draw is below this,
+    uint64_t state;                    // which comes from this generator.
+} ARGO_HEAD;
+
+void argo_head_init(ARGO_HEAD *h, long count, double rate, uint64_t seed);
+
+int argo_head_keep(ARGO_HEAD *h);
+
+int argo_head_run(FILE *in, FILE *out);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef JCS_H
+#define JCS_H
+
+#include <stdio.h>
+
+#include "argo.h"
+
+/*
+ * JSON Canonicalization Scheme (RFC 8785), selected with -C.  Unlike the
+ * canonical form of -c, which keeps members in input order, it sorts the
+ * members of every object by the UTF-16 code units of their names, so that
+ * documents that differ only in member order are written as the same bytes.
+ * Numbers are written as ECMAScript would write the IEEE 754 double they
+ * denote, strings are written in UTF-8 with only the escapes JSON requires,
+ * and there is no whitespace.  Duplicate member names and lone surrogates
+ * cannot be canonicalized.
+ */
+
+/*
+ * Longest ECMAScript form of a double: a sign, 17 digits, a decimal
+ * point, and either up to 5 leading zeros or an exponent.
+ */
+#define ARGO_JCS_NUMBER_MAX 32
+
+int argo_jcs_number(double x, char *out);
+
+int argo_jcs_sort(ARGO_VALUE *v);
+
+int argo_write_jcs(ARGO_VALUE *v, FILE *f);
+
+#endif
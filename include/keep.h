@@ -0,0 +1,30 @@
+#ifndef KEEP_H
+#define KEEP_H
+
+#include <stdio.h>
+
+#include "argo.h"
+
+/*
+ * Projection given with --keep, as a tree of the paths to be kept.
+ * A node describes what to keep of one value: either all of it, or
+ * the listed members if it is an object and/or the projection of
+ * each element if it is an array.
+ */
+typedef struct argo_keep {
+    char *name;                        // Member name, if the node is a member of its parent.
+    int all;                           // Nonzero if the whole value is kept.
+    struct argo_keep *members;         // Members to keep if the value is an object.
+    struct argo_keep *elements;        // What to keep of each element if it is an array.
+    struct argo_keep *next;            // Next member of the parent.
+} ARGO_KEEP;
+
+ARGO_KEEP *argo_keep_parse(char *spec);
+
+void argo_keep_free(ARGO_KEEP *k);
+
+ARGO_VALUE *argo_keep_read_value(FILE *f, ARGO_KEEP *k);
+
+int argo_keep_run(FILE *in, FILE *out, char *spec);
+
+#endif
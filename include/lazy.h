@@ -0,0 +1,81 @@
+#ifndef LAZY_H
+#define LAZY_H
+
+#include <stddef.h>
+
+#include "argo.h"
+
+/*
+ * A document that is parsed on demand.  Opening it only builds a structural
+ * index: the offsets of the brackets and braces outside of strings, each
+ * paired with its partner.  Navigating the document uses the index to step
+ * over nested arrays and objects without looking inside them, and ARGO_VALUE
+ * nodes are only built for the values that are actually asked for.
+ * The text is not copied; it must outlive the document.
+ */
+typedef struct argo_lazy_doc {
+    char *text;
+    size_t length;
+    size_t *structural;                // Offsets of [ { ] } outside strings.
+    int *match;                        // Index of the partner of each of them.
+    int count;
+    struct argo_lazy_memo *memo;       // Values built so far, by offset.
+    int memo_size;
+    int memo_used;
+    size_t position_offset;            // Last offset whose line and column were
+    int position_line;                 // computed, so that the next computation
+    int position_column;               // can usually resume from there.
+} ARGO_LAZY_DOC;
+
+struct argo_lazy_memo {
+    size_t offset;
+    ARGO_VALUE *value;
+};
+
+#define ARGO_LAZY_NO_NAME ((size_t) -1)
+
+/*
+ * A handle on one value of a lazy document.  Handles are plain structures
+ * that may be copied freely; obtaining one allocates nothing.
+ */
+typedef struct argo_lazy {
+    ARGO_LAZY_DOC *doc;
+    size_t offset;                     // First character of the value.
+    size_t length;                     // Length of its text.
+    int index;                         // Structural index of an array or object, else -1.
+    size_t name_offset;                // Opening quote of its member name, if any.
+} ARGO_LAZY;
+
+/*
+ * Position of an iteration over the elements or members of a lazy
+ * array or object.
+ */
+typedef struct argo_lazy_iter {
+    ARGO_LAZY_DOC *doc;
+    size_t pos;                        // Where the next element or member begins.
+    int next_struct;                   // Structural index of the next nested container.
+    int is_object;
+    int done;
+} ARGO_LAZY_ITER;
+
+ARGO_LAZY_DOC *argo_lazy_open(char *text, size_t length);
+
+void argo_lazy_close(ARGO_LAZY_DOC *doc);
+
+int argo_lazy_root(ARGO_LAZY_DOC *doc, ARGO_LAZY *root);
+
+ARGO_VALUE_TYPE argo_lazy_type(ARGO_LAZY *v);
+
+int argo_lazy_iterate(ARGO_LAZY *v, ARGO_LAZY_ITER *it);
+
+int argo_lazy_next(ARGO_LAZY_ITER *it, ARGO_LAZY *item);
+
+int argo_lazy_get(ARGO_LAZY *obj, char *name, ARGO_LAZY *member);
+
+int argo_lazy_at(ARGO_LAZY *arr, int i, ARGO_LAZY *element);
+
+int argo_lazy_name_is(ARGO_LAZY *member, char *name);
+
+ARGO_VALUE *argo_lazy_value(ARGO_LAZY *v);
+
+#endif
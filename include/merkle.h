@@ -0,0 +1,38 @@
+#ifndef MERKLE_H
+#define MERKLE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "argo.h"
+
+/*
+ * Merkle hashes of Argo values: the hash of an array or object is made
+ * from the hashes of its elements or members, so that two values whose
+ * hashes are equal can be taken to be equal without looking inside them.
+ * Members are combined without regard to their order, as objects with the
+ * same members in another order are the same object.  Scalars are hashed
+ * by what their canonical output depends on, so that, for instance, 1.5
+ * and 1.50 hash alike.
+ *
+ * The hashes are kept beside the arena rather than in the values: one per
+ * slot, indexed by the position of the value in the arena of the context
+ * that it was allocated from.
+ */
+typedef struct argo_merkle {
+    ARGO_VALUE *base;                  // Arena of the hashed values.
+    uint64_t *hashes;                  // Hash of the value in each slot.
+    int count;                         // Number of slots hashed.
+} ARGO_MERKLE;
+
+#define argo_merkle_hash(m, v) ((m)->hashes[(v) - (m)->base])
+
+int argo_merkle_build(ARGO_MERKLE *m, ARGO_VALUE *v);
+
+void argo_merkle_free(ARGO_MERKLE *m);
+
+int argo_diff(ARGO_VALUE *a, ARGO_MERKLE *ma, ARGO_VALUE *b, ARGO_MERKLE *mb, FILE *out);
+
+int argo_diff_run(char *file_a, char *file_b, FILE *out);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef NDJSON_H
+#define NDJSON_H
+
+#include <stdio.h>
+
+/*
+ * Size of the chunks into which newline-delimited input is split
+ * before being handed to the workers.
+ */
+#define ARGO_BATCH_SIZE (1 << 20)
+
+int argo_ndjson_run(FILE *in, FILE *out);
+
+#endif
@@ -0,0 +1,214 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+/*
+ * Options beyond those defined in global.h.  They are encoded in the
+ * otherwise unused bits of global_options by validargs; option arguments
+ * that do not fit there are stored in the variables declared below.
+ *   If -n is specified, then the NDJSON_OPTION bit is set.
+ *   If -s is specified, then the STATISTICS_OPTION bit is set.
+ *   If -j is specified without -n, then the PARALLEL_OPTION bit is set.
+ *   If -q is specified, then the QUERY_OPTION bit is set, and so is
+ *   CANONICALIZE_OPTION, as the addressed value is output in canonical form.
+ *   If --keep is specified, then the KEEP_OPTION bit is set, and so is
+ *   CANONICALIZE_OPTION.
+ *   If -u is specified, then the UTF8_OPTION bit is set; it is only
+ *   permissible when there is canonical output, a snapshot or a diff.
+ *   If -b is specified, then the SAVE_BINARY_OPTION bit is set; it is
+ *   only permissible together with -u.
+ *   If -B is specified, then the LOAD_BINARY_OPTION bit is set; it is
+ *   only permissible together with -c, -p and -u.
+ *   If --cbor or --msgpack is specified, then the CBOR_OPTION or MSGPACK_OPTION
+ *   bit is set, and so is UTF8_OPTION, and the canonical output is written
+ *   in that format instead of JSON; only one of them may be given, and only
+ *   when there is canonical output, without -p or -n.
+ *   If --from-cbor or --from-msgpack is specified, then the FROM_CBOR_OPTION or
+ *   FROM_MSGPACK_OPTION bit is set, and the input is read in that format
+ *   instead of JSON; only one of them may be given, together with -v or -c
+ *   and none of -n, -j, -s, -q, --keep, -b or -B.
+ *   If -C is specified, then the JCS_OPTION bit is set, and so are
+ *   CANONICALIZE_OPTION and UTF8_OPTION; it takes the place of -c, and
+ *   cannot be combined with -p, --cbor or --msgpack.
+ *   If -H is specified, then the HASH_OPTION bit is set, and the hashes of
+ *   the canonical output are printed instead of the output itself (one line
+ *   per record with -n); it needs canonical output, and may be followed by the name
+ *   of the one hash to print.
+ *   If --diff is specified, then the DIFF_OPTION bit is set, and the two
+ *   files that follow it are compared; it may only be combined with -u.
+ *   If --pipeline is specified, then argo_pipeline is set (there is no bit
+ *   left for it); it needs -v, canonical output or -b, and cannot be
+ *   combined with -n, -B, --diff, --serve, --load or files.
+ *   If --io is specified, it must be followed by "sync" or "uring", which
+ *   is stored in argo_io_mode; it needs files.
+ *   If --compress is specified, it must be followed by "gzip" or "zstd",
+ *   which is stored in argo_compress_format, and standard output is
+ *   compressed in that format; it needs canonical output or -b, and cannot
+ *   be combined with -H, -w, --diff, --serve or --load.  Compressed input
+ *   is recognized without any option.
+ *   If --head or --sample is specified, it must be followed by the number
+ *   of elements to output (stored in argo_head_count) or the fraction of
+ *   them to output at random (stored in argo_sample_rate), and only those
+ *   elements of the top-level array, or records with -n, are read and
+ *   output; they need -c, go with -p, -u, -C and -n, and cannot be combined
+ *   with any other option that changes the output or with -j.
+ *   The -s option is only permissible together with -n, -j, --dedup,
+ *   --serve or files.
+ */
+#define NDJSON_OPTION (0x08000000)
+#define STATISTICS_OPTION (0x04000000)
+#define PARALLEL_OPTION (0x02000000)
+#define QUERY_OPTION (0x01000000)
+#define KEEP_OPTION (0x00800000)
+#define UTF8_OPTION (0x00400000)
+#define SAVE_BINARY_OPTION (0x00200000)
+#define LOAD_BINARY_OPTION (0x00100000)
+#define CBOR_OPTION (0x00080000)
+#define MSGPACK_OPTION (0x00040000)
+#define FROM_CBOR_OPTION (0x00020000)
+#define FROM_MSGPACK_OPTION (0x00010000)
+#define JCS_OPTION (0x00008000)
+#define HASH_OPTION (0x00004000)
+#define DIFF_OPTION (0x00002000)
+#define DEDUP_OPTION (0x00001000)
+#define FILES_OPTION (0x00000800)
+#define CANON_FILES_OPTION (0x00000400)
+#define SERVE_OPTION (0x00000200)
+#define LOAD_OPTION (0x00000100)
+
+#define INDENT_MASK (0x000000FF)
+
+/*
+ * Help for the options above, which USAGE in argo.h does not describe;
+ * it is printed after USAGE, in the same layout.
+ */
+#define ARGO_MORE_USAGE \
+"Other options:\n" \
+"   -n       NDJSON: the input is one JSON value per line, each validated or\n" \
+"            canonicalized on its own; output is in the order of the input.\n" \
+"   -j N     Threads: with -n, parse records on N worker threads (0 for one\n" \
+"            per CPU); without -n, parse the elements of a top-level array\n" \
+"            on them.\n" \
+"   -s       Statistics: report the time taken and the throughput on standard\n" \
+"            error; needs -n, -j, --dedup, --serve or files.\n" \
+"   -q PTR   Query: output, in canonical form, only the value at the JSON\n" \
+"            Pointer PTR, skipping the rest of the document.  To pretty-print\n" \
+"            it, also give -c followed right by -p, as in -q PTR -c -p 2.\n" \
+"   --keep SPEC\n" \
+"            Projection: output the document with only the paths listed in\n" \
+"            SPEC, such as a.b,c,d.e[*].f, skipping the rest.  A path is made\n" \
+"            of member names, with [*] for every element of an array; array\n" \
+"            indexes are not allowed.  A value that a path cannot go into,\n" \
+"            such as a number where it expects an object, is kept whole.\n" \
+"   -u       UTF-8: input and output are UTF-8, and characters beyond ASCII\n" \
+"            are output as they are instead of as escape sequences.\n" \
+"   -b       Snapshot: write the document to standard output as a binary\n" \
+"            snapshot instead of JSON; goes only with -u.\n" \
+"   -B       Read a binary snapshot, as written by -b, instead of JSON; goes\n" \
+"            only with -c, -p and -u.\n" \
+"   --cbor   Write the canonical output in CBOR instead of JSON; implies -u.\n" \
+"   --msgpack\n" \
+"            Write the canonical output in MessagePack instead of JSON;\n" \
+"            implies -u.\n" \
+"   --from-cbor\n" \
+"            Read the input in CBOR instead of JSON; needs -v or -c.\n" \
+"   --from-msgpack\n" \
+"            Read the input in MessagePack instead of JSON; needs -v or -c.\n" \
+"   -C       Canonicalize in the form of RFC 8785 (JCS), with members sorted\n" \
+"            by name; takes the place of -c and implies -u.\n" \
+"   -H [xxh64|sha256]\n" \
+"            Hash: print the hashes of the canonical output instead of the\n" \
+"            output itself, one line per record with -n.\n" \
+"   --diff A B\n" \
+"            Print a JSON Patch (RFC 6902) that turns the document in file A\n" \
+"            into that in file B; either may be a snapshot.\n" \
+"   --dedup  Share equal strings and subtrees between the values read.\n" \
+"   FILE...  Validate or canonicalize each file named, on the threads of -j;\n" \
+"            @LIST stands for the files named in LIST, one per line.\n" \
+"   -w       With files, write the output of each one to FILE.canon instead\n" \
+"            of standard output.\n" \
+"   --serve PATH\n" \
+"            Serve requests to validate, canonicalize or pretty-print\n" \
+"            documents on the Unix socket PATH, on the threads of -j.\n" \
+"   --load PATH N\n" \
+"            Send the document on standard input to the server at PATH N\n" \
+"            times, with -v, -c or -p, and report the latencies.\n" \
+"   --pipeline\n" \
+"            Read standard input ahead and write standard output on threads\n" \
+"            of their own, overlapping them with parsing.\n" \
+"   --io sync|uring\n" \
+"            With files, read them on the workers or ahead of them with\n" \
+"            io_uring (the default, where the kernel supports it).\n" \
+"   --compress gzip|zstd\n" \
+"            Compress standard output; gzip and zstd input is recognized and\n" \
+"            decompressed without any option.\n" \
+"   --head N Output only the first N elements of the top-level array, or\n" \
+"            records with -n, and read no further; needs -c.\n" \
+"   --sample F\n" \
+"            Output each element, or record with -n, with probability F;\n" \
+"            needs -c.\n"
+
+/*
+ * Number of worker threads requested with -j (zero means one per CPU).
+ * Defaults to one.
+ */
+extern int argo_num_threads;
+
+/*
+ * JSON Pointer given with -q.
+ */
+extern char *argo_query_path;
+
+/*
+ * Projection given with --keep.
+ */
+extern char *argo_keep_spec;
+
+/*
+ * Hashes selected with -H, as a bit set of ARGO_HASH_* (see hash.h).
+ * Defaults to both xxHash64 and SHA-256.
+ */
+extern int argo_hash_algorithms;
+
+/*
+ * Files given with --diff.
+ */
+extern char *argo_diff_files[2];
+
+/*
+ * Files given after the flags, and how many there are.
+ */
+extern char **argo_files;
+extern int argo_num_files;
+
+/*
+ * Socket given with --serve or --load, and the number of requests that
+ * --load is to send.
+ */
+extern char *argo_socket_path;
+extern long argo_load_requests;
+
+/*
+ * Nonzero if --pipeline was given: standard input is read ahead, and
+ * standard output written, by threads of their own (see ring.h).
+ */
+extern int argo_pipeline;
+
+/*
+ * How files are read, as selected with --io: one of ARGO_IO_* (see files.h).
+ */
+extern int argo_io_mode;
+
+/*
+ * Format in which standard output is compressed, as selected with
+ * --compress: one of ARGO_COMPRESS_* (see compress.h).
+ */
+extern int argo_compress_format;
+
+/*
+ * Number of elements to output with --head (zero without it), and the
+ * fraction of elements to output with --sample (zero without it).
+ */
+extern long argo_head_count;
+extern double argo_sample_rate;
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stdio.h>
+
+#include "argo.h"
+#include "pool.h"
+
+/*
+ * The top-level array is cut into about eight slices per worker, but
+ * no slice is made smaller than ARGO_MIN_SLICE bytes of text.
+ */
+#define ARGO_MIN_SLICE (1 << 16)
+#define ARGO_MAX_SLICES(workers) (8 * (workers) + 2)
+
+ARGO_VALUE *argo_parallel_read_array(ARGO_POOL *pool, char *buf, size_t length);
+
+int argo_parallel_run(FILE *in, FILE *out);
+
+#endif
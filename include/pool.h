@@ -0,0 +1,78 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <pthread.h>
+
+#include "context.h"
+
+/*
+ * A unit of work for the pool.  Jobs are usually embedded as the first
+ * member of a larger structure that holds their input and output.
+ * The "run" function is called on a worker thread whose argo_ctx points
+ * to that worker's private context; it returns zero on success.
+ * A detached job is not taken back: its "finish" function is called on
+ * the worker instead, as soon as "run" has returned, and the pool does
+ * not touch the job after that.
+ */
+typedef struct argo_job {
+    struct argo_job *next;             // Next job in submission order.
+    int (*run)(struct argo_job *);     // Work to be done.
+    void (*finish)(struct argo_job *); // Called after run, for a detached job.
+    int status;                        // Return value of run.
+    int done;                          // Nonzero once run has returned.
+} ARGO_JOB;
+
+/*
+ * A worker thread and the context it parses into.
+ */
+typedef struct argo_worker {
+    struct argo_pool *pool;
+    pthread_t thread;
+    ARGO_CONTEXT *ctx;
+} ARGO_WORKER;
+
+/*
+ * A fixed set of worker threads, each with its own context.  Jobs are run
+ * in any order, but argo_pool_next hands them back in the order in which
+ * they were submitted, so that results can be emitted deterministically.
+ * At most "max_jobs" jobs may be submitted and not yet taken back.
+ * Detached jobs are run after those, in submission order, and are not
+ * counted against "max_jobs".
+ */
+typedef struct argo_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t work;               // Signalled when a job becomes runnable.
+    pthread_cond_t finished;           // Signalled when a job completes.
+    pthread_cond_t space;              // Signalled when a job is taken back.
+    ARGO_JOB *head;                    // Oldest job not yet taken back.
+    ARGO_JOB *pending;                 // Oldest job not yet started.
+    ARGO_JOB *tail;                    // Most recently submitted job.
+    ARGO_JOB *detached;                // Oldest detached job not yet started,
+    ARGO_JOB *detached_tail;           // and the most recently submitted one.
+    int in_flight;                     // Jobs submitted and not yet taken back.
+    int max_jobs;
+    int closed;                        // No more jobs will be submitted.
+    int aborted;                       // Outstanding jobs are to be abandoned.
+    int num_workers;
+    ARGO_WORKER *workers;
+} ARGO_POOL;
+
+int argo_num_cpus(void);
+
+ARGO_POOL *argo_pool_create(int num_workers, int max_jobs, int num_values);
+
+int argo_pool_submit(ARGO_POOL *pool, ARGO_JOB *job);
+
+int argo_pool_submit_detached(ARGO_POOL *pool, ARGO_JOB *job);
+
+void argo_pool_close(ARGO_POOL *pool);
+
+void argo_pool_abort(ARGO_POOL *pool);
+
+void argo_pool_wait(ARGO_POOL *pool);
+
+ARGO_JOB *argo_pool_next(ARGO_POOL *pool);
+
+void argo_pool_destroy(ARGO_POOL *pool);
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef PUSH_H
+#define PUSH_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "argo.h"
+#include "context.h"
+#include "utils.h"
+
+/*
+ * Lexical states of the push parser: what the next input byte belongs to.
+ */
+typedef enum {
+    ARGO_LEX_BETWEEN,                  // Whitespace between tokens.
+    ARGO_LEX_STRING,                   // Inside a string literal.
+    ARGO_LEX_ESCAPE,                   // After a backslash in a string.
+    ARGO_LEX_UNICODE,                  // Inside the hex digits of a \u escape.
+    ARGO_LEX_NUMBER,                   // Inside a number.
+    ARGO_LEX_LITERAL                   // Inside true, false or null.
+} ARGO_LEX_STATE;
+
+/*
+ * States of the number recognizer, named after the last part seen.
+ */
+typedef enum {
+    ARGO_NUM_SIGN, ARGO_NUM_ZERO, ARGO_NUM_INT, ARGO_NUM_FRAC_START, ARGO_NUM_FRAC,
+    ARGO_NUM_EXP_START, ARGO_NUM_EXP_SIGN, ARGO_NUM_EXP
+} ARGO_NUM_STATE;
+
+/*
+ * What an open array or object expects next.
+ */
+typedef enum {
+    ARGO_FRAME_FIRST,                  // First element or member, or the closing bracket.
+    ARGO_FRAME_VALUE,                  // A value (after a comma, or after a colon).
+    ARGO_FRAME_NEXT,                   // A comma or the closing bracket.
+    ARGO_FRAME_NAME,                   // A member name (after a comma).
+    ARGO_FRAME_COLON                   // The colon after a member name.
+} ARGO_FRAME_STATE;
+
+typedef struct argo_frame {
+    ARGO_VALUE *head;                  // Sentinel of the list being built.
+    int is_object;
+    ARGO_FRAME_STATE state;
+    ARGO_STRING name;                  // Name of the member being read.
+} ARGO_FRAME;
+
+/*
+ * State of a push parser.  Unlike argo_read_value, which pulls characters
+ * from a stream, a push parser is handed the input in fragments of any
+ * size and keeps all of its state here between calls, so that a token may
+ * be split across fragments anywhere.  Values are allocated from the
+ * context that was current when the parser was created.
+ */
+typedef struct argo_push {
+    ARGO_CONTEXT *ctx;
+    ARGO_LEX_STATE lex;
+    ARGO_FRAME *frames;                // Stack of open arrays and objects.
+    int depth;
+    int max_depth;
+    ARGO_VALUE *root;                  // Top-level value, once started.
+    int done;                          // Nonzero once the top-level value is complete.
+    int failed;                        // Nonzero once an error has been reported.
+    ARGO_STRING *string;               // String being read (a value or a member name).
+    ARGO_VALUE *value;                 // Number or literal being read.
+    ARGO_NUM_STATE num;
+    char *literal;                     // Token of the literal being read,
+    int literal_pos;                   // and how much of it has been matched.
+    int ucode;                         // Code point of a \u escape so far,
+    int udigits;                       // and the number of hex digits seen.
+    int high;                          // Nonzero right after a high surrogate escape.
+    ARGO_UTF8 utf8;                    // UTF-8 sequence being read, in the -u mode.
+    int lines_read;                    // Position of the input, for error messages,
+    int chars_read;                    // as of the start of "chunk".
+    const char *chunk;                 // Rest of the fragment being fed,
+    const char *next;                  // and the character being read from it.
+} ARGO_PUSH;
+
+ARGO_PUSH *argo_push_create(void);
+
+int argo_feed(ARGO_PUSH *p, const char *buf, size_t len);
+
+ARGO_VALUE *argo_finish(ARGO_PUSH *p);
+
+void argo_push_destroy(ARGO_PUSH *p);
+
+#endif
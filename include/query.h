@@ -0,0 +1,12 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <stdio.h>
+
+#include "argo.h"
+
+ARGO_VALUE *argo_query_value(FILE *f, char *path);
+
+int argo_query_run(FILE *in, FILE *out, char *path);
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef RING_H
+#define RING_H
+
+#include <stdio.h>
+
+#include "source.h"
+
+/*
+ * Pipelined input and output, selected with --pipeline.  A ring of large
+ * buffers sits between the thread that parses or writes and a dedicated
+ * thread that does the I/O: on input, a reader thread fills the buffers
+ * from a source while the parser consumes them through an ordinary FILE;
+ * on output, what is written to a FILE fills the buffers, which a writer
+ * thread drains to the real output stream.  Reading and writing thereby
+ * overlap with parsing and formatting, which hides the latency of slow
+ * storage as long as the ring does not run dry.
+ */
+#define ARGO_RING_BUFFERS 4
+#define ARGO_RING_BUFFER_SIZE (1 << 20)
+
+FILE *argo_ring_open_source(ARGO_SOURCE *source);
+
+FILE *argo_ring_open_input(FILE *in);
+
+FILE *argo_ring_open_output(FILE *out, int close_out);
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef SERVE_H
+#define SERVE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * A long-lived server, started with --serve, that reads documents from
+ * clients over a Unix domain socket and sends back what -v, -c or -p would
+ * have output for them, so that neither the process nor its arenas have
+ * to be set up again for every document.
+ *
+ * Every request and every response is a frame: a header of
+ * ARGO_SERVE_HEADER_SIZE bytes followed by a payload.  The header of a
+ * request holds the operation, the indent for ARGO_SERVE_PRETTY, two zero
+ * bytes and the length of the document that follows, as four bytes, most
+ * significant first.  The header of a response holds its status, three
+ * zero bytes and the length of the output that follows (an error message
+ * unless the status is ARGO_SERVE_OK: for an invalid document, what the
+ * parser found wrong with it, as it would have been printed on stderr).
+ * Requests on one connection may be pipelined; they are answered in the
+ * order in which they were sent.
+ */
+#define ARGO_SERVE_HEADER_SIZE 8
+#define ARGO_SERVE_MAX_PAYLOAD (64 << 20)
+
+/*
+ * Operations.
+ */
+#define ARGO_SERVE_VALIDATE 'v'
+#define ARGO_SERVE_CANONICALIZE 'c'
+#define ARGO_SERVE_PRETTY 'p'
+#define ARGO_SERVE_STATS 's'            // Latency metrics of the server, as JSON.
+
+/*
+ * Statuses.
+ */
+#define ARGO_SERVE_OK 0
+#define ARGO_SERVE_INVALID 1            // The document is not valid JSON.
+#define ARGO_SERVE_BAD_REQUEST 2        // The request itself is malformed.
+
+/*
+ * Requests of a connection that may be outstanding at once; reading from
+ * the connection stops until some of them have been answered.
+ */
+#define ARGO_SERVE_MAX_PENDING 64
+
+/*
+ * Histogram of latencies, in nanoseconds, with ARGO_LATENCY_SUB buckets of
+ * equal width between successive powers of two, so that any percentile is
+ * known to within 1/ARGO_LATENCY_SUB of its value.
+ */
+#define ARGO_LATENCY_SUB 16
+#define ARGO_LATENCY_BUCKETS (64 * ARGO_LATENCY_SUB)
+
+typedef struct argo_latency {
+    long counts[ARGO_LATENCY_BUCKETS];
+    long total;                        // Number of latencies recorded,
+    long max;                          // the largest of them
+    double sum;                        // and their sum.
+} ARGO_LATENCY;
+
+void argo_latency_add(ARGO_LATENCY *l, long ns);
+
+void argo_latency_merge(ARGO_LATENCY *l, ARGO_LATENCY *other);
+
+long argo_latency_percentile(ARGO_LATENCY *l, double p);
+
+int argo_serve_run(char *path);
+
+int argo_load_run(char *path, long requests, FILE *in, FILE *out);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stdio.h>
+#include <sys/types.h>
+
+/*
+ * Where a document comes from: standard input, a file, or a buffer that
+ * has already been filled by some other means, such as a batch of reads
+ * done with io_uring.  The parser reads a FILE, so a source is turned
+ * into one with argo_source_stream, or with argo_ring_open_source to have
+ * it read ahead by a thread of its own.
+ *
+ * Sources are usually embedded as the first member of a larger structure
+ * that holds their state.  "read" may return fewer bytes than asked for,
+ * so that input arriving slowly is not held back; "close" releases the
+ * source once it is no longer needed.
+ */
+typedef struct argo_source {
+    ssize_t (*read)(struct argo_source *, char *, size_t);  // Zero at EOF, -1 on error.
+    void (*close)(struct argo_source *);
+    size_t size;                       // Size of the input, if known in advance.
+} ARGO_SOURCE;
+
+ARGO_SOURCE *argo_source_open(FILE *in);
+
+ARGO_SOURCE *argo_source_path(char *path);
+
+ARGO_SOURCE *argo_source_memory(char *data, size_t length);
+
+FILE *argo_source_stream(ARGO_SOURCE *source);
+
+#endif
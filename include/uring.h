@@ -0,0 +1,62 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stdint.h>
+
+/*
+ * A minimal io_uring, driven through the system calls themselves so as
+ * not to depend on liburing: a submission queue of requests and a
+ * completion queue of their results, both shared with the kernel, so that
+ * many reads can be in flight while a single thread waits for whichever
+ * completes first.  ARGO_HAVE_URING is defined only if the kernel headers
+ * know of io_uring; even then, argo_uring_init fails if the kernel does
+ * not support it or it has been disabled, and callers must then fall back
+ * on ordinary system calls.
+ */
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define ARGO_HAVE_URING 1
+#endif
+#endif
+#endif
+
+#ifdef ARGO_HAVE_URING
+
+typedef struct argo_uring {
+    int fd;
+    unsigned entries;                  // Size of the submission queue.
+    unsigned *sq_head;                 // Shared with the kernel.
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned sq_next;                  // Tail including requests not yet submitted.
+    struct io_uring_sqe *sqes;
+    unsigned *cq_head;                 // Shared with the kernel.
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+    void *sq_map;                      // Mappings, to be undone by argo_uring_exit.
+    size_t sq_map_size;
+    void *cq_map;
+    size_t cq_map_size;
+    size_t sqes_map_size;
+} ARGO_URING;
+
+int argo_uring_init(ARGO_URING *u, unsigned entries);
+
+struct io_uring_sqe *argo_uring_sqe(ARGO_URING *u, uint64_t user_data);
+
+int argo_uring_submit(ARGO_URING *u, unsigned wait);
+
+struct io_uring_cqe *argo_uring_cqe(ARGO_URING *u);
+
+void argo_uring_seen(ARGO_URING *u);
+
+void argo_uring_exit(ARGO_URING *u);
+
+#endif
+
+#endif
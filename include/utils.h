@@ -7,7 +7,37 @@ int is_digit_string(char *str);
 
 int string_to_int(char *str);
 
+double string_to_fraction(char *str);
+
+char *argo_read_file(FILE *f, size_t *length);
+
+/*
+ * State of the decoding of a UTF-8 sequence in a string, which in the
+ * -u mode is read as a single code point rather than byte by byte.
+ */
+typedef struct argo_utf8 {
+    ARGO_CHAR code;                    // Bits of the code point so far.
+    int left;                          // Continuation bytes still expected.
+    ARGO_CHAR min;                     // Smallest code point of this length.
+} ARGO_UTF8;
+
+#define argo_is_high_surrogate(c) ((c) >= 0xD800 && (c) <= 0xDBFF)
+#define argo_is_low_surrogate(c) ((c) >= 0xDC00 && (c) <= 0xDFFF)
+
+/*
+ * Value of the "valid_string" field of a number whose text is exactly what
+ * argo_write_number would produce from its value, so that the text can be
+ * written out as it is.  This holds for an integer literal other than -0,
+ * short enough that its value cannot have overflowed a long.
+ */
+#define ARGO_CANONICAL_TEXT 2
+#define ARGO_CANONICAL_DIGITS 18
+
 // read functions
+int argo_utf8_step(ARGO_UTF8 *d, ARGO_CHAR c);
+
+int argo_append_escape(ARGO_STRING *s, ARGO_CHAR ucode, int after_high);
+
 #define argo_maybe_basic(c) ((c) == 't' || (c) == 'f' || (c) == 'n')
 
 int argo_read_array(ARGO_ARRAY *a, FILE *f);
@@ -16,17 +46,38 @@ int argo_read_object(ARGO_OBJECT *o, FILE *f);
 
 int argo_read_basic(ARGO_BASIC *b, FILE *f);
 
+/*
+ * Levels of nesting that argo_skip_value keeps track of; deeper input
+ * is refused, as a value read in full could not nest much deeper within
+ * the NUM_ARGO_VALUES values of the arena.
+ */
+#define ARGO_SKIP_MAX_DEPTH (1 << 16)
+
+int argo_skip_value(FILE *f);
+
+void argo_number_convert(ARGO_NUMBER *n);
+
+char argo_number_text_kind(ARGO_STRING *sv, int neg_flag, int frac_or_exp);
+
 // write functions
+size_t argo_plain_run(ARGO_CHAR *str, size_t len, char *out, ARGO_CHAR max);
+
+int argo_escape_char(ARGO_CHAR c, char *out);
+
+int argo_utf8_char(ARGO_CHAR c, char *out);
+
 int write_hex_to_file(int num, FILE *f);
 
 int write_long_to_file(long num, FILE *f);
 
+int argo_write_number_text(ARGO_STRING *sv, FILE *f);
+
 int write_double_to_file(double num, FILE *f);
 
 int argo_write_basic(char *str, FILE *f);
 
-int argo_write_array(ARGO_ARRAY *a, FILE *f);
+int argo_write_scalar(ARGO_VALUE *v, FILE *f);
 
-int argo_write_object(ARGO_OBJECT *o, FILE *f);
+int argo_grow_indent(int len);
 
 #endif
\ No newline at end of file
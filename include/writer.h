@@ -0,0 +1,178 @@
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <stdio.h>
+
+#include "argo.h"
+#include "global.h"
+#include "utils.h"
+#include "context.h"
+#include "options.h"
+
+/*
+ * A writer outputs a value, and everything inside it, as canonical JSON.
+ * Several writers are instantiated from the template below, each for a
+ * particular output format, and one of them is selected once, before any
+ * output is produced, so that the format is not examined again for every
+ * value written.
+ */
+typedef int (*ARGO_WRITER)(ARGO_VALUE *v, FILE *f);
+
+/*
+ * Writer used by argo_write_value.  Until argo_select_writer is called,
+ * it is the one that follows global_options at run time.
+ */
+extern ARGO_WRITER argo_writer;
+
+ARGO_WRITER argo_select_writer(int indent);
+
+/*
+ * Start a new line of pretty-printed output, indented to the current
+ * indent level, with a single write from the indent buffer of the
+ * calling thread's context.
+ */
+static inline int argo_write_newline(FILE *f, int indent){
+    ARGO_CONTEXT *ctx = argo_ctx;
+    int len = 1 + indent * ctx->indent_level;
+
+    if(len > ctx->indent_size && argo_grow_indent(len)){
+        return -1;
+    }
+    if(fwrite(ctx->indent, 1, len, f) != (size_t) len){
+        fprintf(argo_err, "Error EOF\n");
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Template of a writer: VALUE, ARRAY and OBJECT are the names of the
+ * functions to be defined, and INDENT is the number of spaces per indent
+ * level, zero for minified output.  When INDENT is a constant, the tests
+ * on it are resolved at compile time.
+ *
+ * In pretty-printed output, an array or object starts a new line after
+ * its opening bracket and after each element or member.  The indent level
+ * drops back before the line that holds the closing bracket (for an empty
+ * array or object, it never rises).
+ */
+#define ARGO_DEFINE_WRITER(VALUE, ARRAY, OBJECT, INDENT) \
+int ARRAY(ARGO_ARRAY *a, FILE *f); \
+int OBJECT(ARGO_OBJECT *o, FILE *f); \
+\
+int VALUE(ARGO_VALUE *v, FILE *f){ \
+    if(v->type == ARGO_OBJECT_TYPE){ \
+        if(OBJECT(&v->content.object, f)){ \
+            fprintf(argo_err, "Error in write object\n"); \
+            return -1; \
+        } \
+        return 0; \
+    } \
+    if(v->type == ARGO_ARRAY_TYPE){ \
+        if(ARRAY(&v->content.array, f)){ \
+            fprintf(argo_err, "Error in write array\n"); \
+            return -1; \
+        } \
+        return 0; \
+    } \
+    return argo_write_scalar(v, f); \
+} \
+\
+int ARRAY(ARGO_ARRAY *a, FILE *f){ \
+    const int indent = (INDENT); \
+    ARGO_VALUE *head = a->element_list; \
+    ARGO_VALUE *list_ptr; \
+\
+    if(fputc(ARGO_LBRACK, f) == EOF){ \
+        fprintf(argo_err, "Error EOF\n"); \
+        return -1; \
+    } \
+    if(indent){ \
+        if(head->next != head){ \
+            argo_ctx->indent_level++; \
+        } \
+        if(argo_write_newline(f, indent)){ \
+            return -1; \
+        } \
+    } \
+    for(list_ptr = head->next; list_ptr != head; list_ptr = list_ptr->next){ \
+        if(VALUE(list_ptr, f)){ \
+            return -1; \
+        } \
+        if(list_ptr->next != head){ \
+            if(fputc(ARGO_COMMA, f) == EOF){ \
+                fprintf(argo_err, "Error EOF\n"); \
+                return -1; \
+            } \
+        } \
+        else if(indent){ \
+            argo_ctx->indent_level--; \
+        } \
+        if(indent && argo_write_newline(f, indent)){ \
+            return -1; \
+        } \
+    } \
+    if(fputc(ARGO_RBRACK, f) == EOF){ \
+        fprintf(argo_err, "Error EOF\n"); \
+        return -1; \
+    } \
+    return 0; \
+} \
+\
+int OBJECT(ARGO_OBJECT *o, FILE *f){ \
+    const int indent = (INDENT); \
+    ARGO_VALUE *head = o->member_list; \
+    ARGO_VALUE *list_ptr; \
+\
+    if(fputc(ARGO_LBRACE, f) == EOF){ \
+        fprintf(argo_err, "Error EOF\n"); \
+        return -1; \
+    } \
+    if(indent){ \
+        if(head->next != head){ \
+            argo_ctx->indent_level++; \
+        } \
+        if(argo_write_newline(f, indent)){ \
+            return -1; \
+        } \
+    } \
+    for(list_ptr = head->next; list_ptr != head; list_ptr = list_ptr->next){ \
+        if(argo_write_string(&(list_ptr->name), f)){ \
+            return -1; \
+        } \
+        if(fputc(ARGO_COLON, f) == EOF || (indent && fputc(ARGO_SPACE, f) == EOF)){ \
+            fprintf(argo_err, "Error EOF\n"); \
+            return -1; \
+        } \
+        if(VALUE(list_ptr, f)){ \
+            return -1; \
+        } \
+        if(list_ptr->next != head){ \
+            if(fputc(ARGO_COMMA, f) == EOF){ \
+                fprintf(argo_err, "Error EOF\n"); \
+                return -1; \
+            } \
+        } \
+        else if(indent){ \
+            argo_ctx->indent_level--; \
+        } \
+        if(indent && argo_write_newline(f, indent)){ \
+            return -1; \
+        } \
+    } \
+    if(fputc(ARGO_RBRACE, f) == EOF){ \
+        fprintf(argo_err, "Error EOF\n"); \
+        return -1; \
+    } \
+    return 0; \
+}
+
+int argo_write_minified(ARGO_VALUE *v, FILE *f);
+int argo_write_array(ARGO_ARRAY *a, FILE *f);
+int argo_write_object(ARGO_OBJECT *o, FILE *f);
+
+int argo_write_pretty2(ARGO_VALUE *v, FILE *f);
+int argo_write_pretty4(ARGO_VALUE *v, FILE *f);
+int argo_write_pretty(ARGO_VALUE *v, FILE *f);
+
+#endif
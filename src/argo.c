@@ -5,6 +5,12 @@
 #include "global.h"
 #include "debug.h"
 #include "utils.h"
+#include "context.h"
+#include "options.h"
+#include "writer.h"
+#include "dedup.h"
+
+#define ARGO_STRING_CHUNK 1024
 
 /**
  * @brief  Read JSON input from a specified input stream, parse it,
@@ -17,7 +23,9 @@
  * information on the JSON syntax standard and how parsing can be
  * accomplished.  As discussed in the assignment handout, the returned
  * pointer must be to one of the elements of the argo_value_storage
- * array that is defined in the const.h header file.
+ * array that is defined in the const.h header file; more generally, it
+ * is taken from the arena of the calling thread's context, which for
+ * the main thread is argo_value_storage.
  * In case of an error (these include failure of the input to conform
  * to the JSON standard, premature EOF on the input stream, as well as
  * other I/O errors), a one-line error message is output to standard error
@@ -29,121 +37,113 @@
  */
 ARGO_VALUE *argo_read_value(FILE *f) {
 
-    if(argo_next_value >= NUM_ARGO_VALUES){
-        fprintf(stderr,"[%d, %d] Number of ARGO Value Exceeds Limit. \n", argo_lines_read, argo_chars_read);
+    // allocate space, reporting where the input has got to if there is none left
+    if(argo_ctx->next_value >= argo_ctx->num_values){
+        argo_position(f);
+    }
+    ARGO_VALUE *av = argo_alloc_value();
+    if(av == NULL){
         return NULL;
     }
 
-    // allocate space
-    ARGO_VALUE *av = argo_value_storage + argo_next_value;
-    argo_next_value++;
-
-    av->type = ARGO_NO_TYPE;
-    av->next = NULL;
-    av->prev = NULL;
-    av->name.capacity = 0;
-    av->name.length = 0;
-    av->name.content = NULL;
-
     int c;
     c = fgetc(f);
-    argo_chars_read++;
 
     while(c != EOF){
         if(argo_is_whitespace(c)){
-            if(c == ARGO_LF){
-                argo_lines_read++;
-                argo_chars_read = 0;
-            }
             c = fgetc(f);
-            argo_chars_read++;
             continue;
         }
         else if(c == ARGO_QUOTE){
             av->type = ARGO_STRING_TYPE;
             if(ungetc(c,f) == EOF){
-                fprintf(stderr,"[%d, %d] Fail to unget. \n", argo_lines_read, argo_chars_read);
+                argo_position(f);
+                fprintf(argo_err,"[%d, %d] Fail to unget. \n", argo_ctx->lines_read, argo_ctx->chars_read);
                 return NULL;
             }
-            argo_chars_read--;
             if(argo_read_string(&(av->content.string), f)){
-                fprintf(stderr,"[%d, %d] Invalid string. \n", argo_lines_read, argo_chars_read);
+                argo_position(f);
+                fprintf(argo_err,"[%d, %d] Invalid string. \n", argo_ctx->lines_read, argo_ctx->chars_read);
                 return NULL;
             }
             else{
-                return av;
+                return argo_dedup_done(av);
             }
         }
         else if(c == ARGO_MINUS || argo_is_digit(c)){
             av->type = ARGO_NUMBER_TYPE;
             if(ungetc(c,f) == EOF){
-                fprintf(stderr,"[%d, %d] Fail to unget. \n", argo_lines_read, argo_chars_read);
+                argo_position(f);
+                fprintf(argo_err,"[%d, %d] Fail to unget. \n", argo_ctx->lines_read, argo_ctx->chars_read);
                 return NULL;
             }
-            argo_chars_read--;
             if(argo_read_number(&(av->content.number), f)){
-                fprintf(stderr,"[%d, %d] Invalid number. \n", argo_lines_read, argo_chars_read);
+                argo_position(f);
+                fprintf(argo_err,"[%d, %d] Invalid number. \n", argo_ctx->lines_read, argo_ctx->chars_read);
                 return NULL;
             }
             else{
-                return av;
+                return argo_dedup_done(av);
             }
         }
         else if(argo_maybe_basic(c)){
             av->type = ARGO_BASIC_TYPE;
             if(ungetc(c,f) == EOF){
-                fprintf(stderr,"[%d, %d] Fail to unget. \n", argo_lines_read, argo_chars_read);
+                argo_position(f);
+                fprintf(argo_err,"[%d, %d] Fail to unget. \n", argo_ctx->lines_read, argo_ctx->chars_read);
                 return NULL;
             }
-            argo_chars_read--;
             if(argo_read_basic(&(av->content.basic), f)){
-                fprintf(stderr,"[%d, %d] Invalid basic. \n", argo_lines_read, argo_chars_read);
+                argo_position(f);
+                fprintf(argo_err,"[%d, %d] Invalid basic. \n", argo_ctx->lines_read, argo_ctx->chars_read);
                 return NULL;
             }
             else{
-                return av;
+                return argo_dedup_done(av);
             }
         }
         else if(c == ARGO_LBRACK){
             av->type = ARGO_ARRAY_TYPE;
             if(ungetc(c,f) == EOF){
-                fprintf(stderr,"[%d, %d] Fail to unget. \n", argo_lines_read, argo_chars_read);
+                argo_position(f);
+                fprintf(argo_err,"[%d, %d] Fail to unget. \n", argo_ctx->lines_read, argo_ctx->chars_read);
                 return NULL;
             }
-            argo_chars_read--;
             if(argo_read_array(&(av->content.array), f)){
-                fprintf(stderr,"[%d, %d] Invalid array. \n", argo_lines_read, argo_chars_read);
+                argo_position(f);
+                fprintf(argo_err,"[%d, %d] Invalid array. \n", argo_ctx->lines_read, argo_ctx->chars_read);
                 return NULL;
             }
             else{
-                return av;
+                return argo_dedup_done(av);
             }
         }
         else if(c == ARGO_LBRACE){
             av->type = ARGO_OBJECT_TYPE;
             if(ungetc(c,f) == EOF){
-                fprintf(stderr,"[%d, %d] Fail to unget. \n", argo_lines_read, argo_chars_read);
+                argo_position(f);
+                fprintf(argo_err,"[%d, %d] Fail to unget. \n", argo_ctx->lines_read, argo_ctx->chars_read);
                 return NULL;
             }
-            argo_chars_read--;
             if(argo_read_object(&(av->content.object), f)){
-                fprintf(stderr,"[%d, %d] Invalid object. \n", argo_lines_read, argo_chars_read);
+                argo_position(f);
+                fprintf(argo_err,"[%d, %d] Invalid object. \n", argo_ctx->lines_read, argo_ctx->chars_read);
                 return NULL;
             }
             else{
-                return av;
+                return argo_dedup_done(av);
             }
         }
         else{
-            fprintf(stderr, "[%d, %d] Invalid Token (%d)\n", argo_lines_read, argo_chars_read, c);
+            argo_position(f);
+            fprintf(argo_err, "[%d, %d] Invalid Token (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
             return NULL;
         }
 
         c = fgetc(f);
-        argo_chars_read++;
     }
 
-    fprintf(stderr, "JSON Value not found\n");
+    fprintf(argo_err, "JSON Value not found\n");
     return NULL;
 }
 
@@ -157,6 +157,10 @@ ARGO_VALUE *argo_read_value(FILE *f) {
  * literal, according to the JSON syntax standard.  If the input can be
  * successfully parsed, then a pointer to a data structure representing
  * the corresponding value is returned.
+ * A surrogate pair written as two \u escapes is read as the single code
+ * point it encodes.  Other bytes are read as characters of their own,
+ * except in the -u mode, where the input is UTF-8 and each multi-byte
+ * sequence is read as one character.
  * In case of an error (these include failure of the input to conform
  * to the JSON standard, premature EOF on the input stream, as well as
  * other I/O errors), a one-line error message is output to standard error
@@ -169,17 +173,22 @@ ARGO_VALUE *argo_read_value(FILE *f) {
 int argo_read_string(ARGO_STRING *s, FILE *f) {
 
     ARGO_CHAR c = fgetc(f);
-    argo_chars_read++;
     if( c != ARGO_QUOTE){
-        fprintf(stderr,"[%d, %d] Invalid string\n", argo_lines_read, argo_chars_read);
+        argo_position(f);
+        fprintf(argo_err,"[%d, %d] Invalid string\n", argo_ctx->lines_read, argo_ctx->chars_read);
         return-1;
     }
 
     int k;
     int ucode;
+    int high = 0;       // nonzero right after a high surrogate written as \u escape
+    int after_high;
+    int utf8 = global_options & UTF8_OPTION;
+    ARGO_UTF8 d;
     c = fgetc(f);
-    argo_chars_read++;
     while(c != EOF){
+        after_high = high;
+        high = 0;
 
         // end of string
         if(c == ARGO_QUOTE){
@@ -188,14 +197,14 @@ int argo_read_string(ARGO_STRING *s, FILE *f) {
 
         // control characters
         else if(argo_is_control(c)){
-            fprintf(stderr, "[%d, %d] Illegal character (%d) in string\n", argo_lines_read, argo_chars_read, c);
+            argo_position(f);
+            fprintf(argo_err, "[%d, %d] Illegal character (%d) in string\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
             return -1;
         }
 
         // \ is read
         else if(c == ARGO_BSLASH){
             c = fgetc(f);
-            argo_chars_read++;
             if(c == ARGO_QUOTE){
                 if(argo_append_char(s, ARGO_QUOTE)){
                     return -1;
@@ -248,7 +257,6 @@ int argo_read_string(ARGO_STRING *s, FILE *f) {
                 ucode = 0;
                 for(k=0; k<4; k++){
                     c = fgetc(f);
-                    argo_chars_read++;
                     if(argo_is_hex(c)){
                         ucode = ucode * 16;
                         if(argo_is_digit(c)){
@@ -262,30 +270,49 @@ int argo_read_string(ARGO_STRING *s, FILE *f) {
                         }
                     }
                     else{
-                        fprintf(stderr, "[%d, %d] Illegal escape (\\%d) in string\n", argo_lines_read, argo_chars_read, c);
+                        argo_position(f);
+                        fprintf(argo_err, "[%d, %d] Illegal escape (\\%d) in string\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
                         return -1;
                     }
                 }
-                if(argo_append_char(s, ucode)){
+                if(argo_append_escape(s, ucode, after_high)){
                     return -1;
                 }
+                high = argo_is_high_surrogate(ucode);
             }
 
             else{
-                fprintf(stderr, "[%d, %d] Illegal escape (\\%d) in string\n", argo_lines_read, argo_chars_read, c);
+                argo_position(f);
+                fprintf(argo_err, "[%d, %d] Illegal escape (\\%d) in string\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
                 return -1;
             }
 
         }
 
+        // in the -u mode, a multi-byte UTF-8 sequence is a single character
+        else if(utf8 && c >= 0x80){
+            d.left = 0;
+            while((k = argo_utf8_step(&d, c)) == 0){
+                c = fgetc(f);
+            }
+            if(k < 0){
+                argo_position(f);
+                fprintf(argo_err, "[%d, %d] Invalid UTF-8 (%d) in string\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
+                return -1;
+            }
+            if(argo_append_char(s, d.code)){
+                return -1;
+            }
+        }
+
         else if(argo_append_char(s, c)){
             return -1;
         }
 
         c = fgetc(f);
-        argo_chars_read++;
     }
-    fprintf(stderr, "[%d, %d] Expect \" in string but seen (%d)\n", argo_lines_read, argo_chars_read, c);
+    argo_position(f);
+    fprintf(argo_err, "[%d, %d] Expect \" in string but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
     return -1;
 }
 
@@ -321,26 +348,23 @@ int argo_read_number(ARGO_NUMBER *n, FILE *f) {
     sv->content=NULL;
 
     ARGO_CHAR c = fgetc(f);
-    argo_chars_read++;
-    int neg_flag = 0;
     int dec_flag = 0;
     int exp_flag = 0;
-    int exp_neg = 0;
 
     if( !(argo_is_digit(c) || c==ARGO_MINUS)){
-        fprintf(stderr, "[%d, %d] Invalid number char (%d)\n", argo_lines_read, argo_chars_read, c);
+        argo_position(f);
+        fprintf(argo_err, "[%d, %d] Invalid number char (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
         return-1;
     }
 
     if(c == ARGO_MINUS){
-        neg_flag = 1;
         if(argo_append_char(sv, ARGO_MINUS)){
             return -1;
         }
         c = fgetc(f);
-        argo_chars_read++;
         if(!argo_is_digit(c)){
-            fprintf(stderr, "[%d, %d] Invalid number char (%d)\n", argo_lines_read, argo_chars_read, c);
+            argo_position(f);
+            fprintf(argo_err, "[%d, %d] Invalid number char (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
             return-1;
         }
     }
@@ -350,65 +374,37 @@ int argo_read_number(ARGO_NUMBER *n, FILE *f) {
             return -1;
         }
         c = fgetc(f);
-        argo_chars_read++;
         if(c == ARGO_PERIOD && (!dec_flag)){
             if(argo_append_char(sv, ARGO_PERIOD)){
                 return -1;
             }
             c = fgetc(f);
-            argo_chars_read++;
             if(!argo_is_digit(c)){
-                fprintf(stderr, "[%d, %d] Digit expected in number but seen (%d)\n", argo_lines_read, argo_chars_read, c);
+                argo_position(f);
+                fprintf(argo_err, "[%d, %d] Digit expected in number but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
                 return -1;
             }
-            if(ungetc(c, f)==EOF){
-                fprintf(stderr,"[%d, %d] Fail to unget. \n", argo_lines_read, argo_chars_read);
-                return -1;
-            }
-            argo_chars_read--;
+            // c is the first fraction digit; the loop below starts with it
             dec_flag = 1;
         }
         else{
-            if(ungetc(c, f)==EOF){
-                fprintf(stderr,"[%d, %d] Fail to unget. \n", argo_lines_read, argo_chars_read);
+            if(c != EOF && ungetc(c, f)==EOF){
+                argo_position(f);
+                fprintf(argo_err,"[%d, %d] Fail to unget. \n", argo_ctx->lines_read, argo_ctx->chars_read);
                 return -1;
             }
-            n->int_value = 0;
-            n->float_value = neg_flag? -0.0 : 0.0;
-            n->valid_string = 1;
-            n->valid_int = 1;
-            n->valid_float = 1;
+            argo_number_convert(n);
             return 0;
         }
     }
 
-    double frac_num = 0;
-    long int_sum = 0;
-    double float_sum = 0;
-    int exp_sum = 0;
-    int k = 0;
-
-
+    // the text is only checked and collected here; its values are
+    // computed from it once it is complete
     while(c != EOF){
         if(argo_is_digit(c)){
             if(argo_append_char(sv, c)){
                 return -1;
             }
-            if(exp_flag){
-                exp_sum = (exp_sum*10)+(c-ARGO_DIGIT0);
-            }
-            else if(dec_flag){
-                frac_num = c-ARGO_DIGIT0;
-                for(k=0; k<dec_flag; k++){
-                    frac_num = frac_num/10.0;
-                }
-                float_sum = float_sum+frac_num;
-                dec_flag++;
-            }
-            else{
-                int_sum = (int_sum*10) + (c-ARGO_DIGIT0);
-                float_sum = (float_sum*10) + (c-ARGO_DIGIT0);
-            }
         }
 
         else if( c == ARGO_PERIOD && (!dec_flag)){
@@ -416,17 +412,16 @@ int argo_read_number(ARGO_NUMBER *n, FILE *f) {
                 return -1;
             }
             c = fgetc(f);
-            argo_chars_read++;
             if(!argo_is_digit(c)){
-                fprintf(stderr, "[%d, %d] Digit expected in number but seen (%d)\n", argo_lines_read, argo_chars_read, c);
+                argo_position(f);
+                fprintf(argo_err, "[%d, %d] Digit expected in number but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
                 return -1;
             }
             if(ungetc(c, f)==EOF){
-                fprintf(stderr,"[%d, %d] Fail to unget. \n", argo_lines_read, argo_chars_read);
+                argo_position(f);
+                fprintf(argo_err,"[%d, %d] Fail to unget. \n", argo_ctx->lines_read, argo_ctx->chars_read);
                 return -1;
             }
-            argo_chars_read--;
-            int_sum = 0;
             dec_flag = 1;
         }
 
@@ -435,9 +430,9 @@ int argo_read_number(ARGO_NUMBER *n, FILE *f) {
                 return -1;
             }
             c = fgetc(f);
-            argo_chars_read++;
             if(!(argo_is_digit(c) || c == ARGO_PLUS || c == ARGO_MINUS)){
-                fprintf(stderr, "[%d, %d] Digit expected in number but seen (%d)\n", argo_lines_read, argo_chars_read, c);
+                argo_position(f);
+                fprintf(argo_err, "[%d, %d] Digit expected in number but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
                 return -1;
             }
             if(c == ARGO_PLUS){
@@ -445,81 +440,43 @@ int argo_read_number(ARGO_NUMBER *n, FILE *f) {
                     return -1;
                 }
                 c = fgetc(f);
-                argo_chars_read++;
             }
             else if(c == ARGO_MINUS){
                 if(argo_append_char(sv, ARGO_MINUS)){
                     return -1;
                 }
-                exp_neg = 1;
                 c = fgetc(f);
-                argo_chars_read++;
             }
             if(argo_is_digit(c)){
                 if(ungetc(c, f)==EOF){
-                    fprintf(stderr,"[%d, %d] Fail to unget. \n", argo_lines_read, argo_chars_read);
+                    argo_position(f);
+                    fprintf(argo_err,"[%d, %d] Fail to unget. \n", argo_ctx->lines_read, argo_ctx->chars_read);
                     return -1;
                 }
-                argo_chars_read--;
             }
             else{
-                fprintf(stderr, "[%d, %d] Digit expected in number but seen (%d)\n", argo_lines_read, argo_chars_read, c);
+                argo_position(f);
+                fprintf(argo_err, "[%d, %d] Digit expected in number but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
                 return -1;
             }
-            int_sum = 0;
             exp_flag = 1;
         }
 
         else{
             if(ungetc(c, f)==EOF){
-                fprintf(stderr,"[%d, %d] Fail to unget. \n", argo_lines_read, argo_chars_read);
+                argo_position(f);
+                fprintf(argo_err,"[%d, %d] Fail to unget. \n", argo_ctx->lines_read, argo_ctx->chars_read);
                 return -1;
             }
-            argo_chars_read--;
             break;
         }
 
 
         c = fgetc(f);
-        argo_chars_read++;
-
-    }
-
-    if(neg_flag){
-        int_sum = -int_sum;
-        float_sum = -float_sum;
-    }
-
-    if(exp_flag){
-        for(k=0; k<exp_sum; k++){
-            if(exp_neg){
-                float_sum = float_sum/10.0;
-            }
-            else{
-                float_sum = float_sum*10.0;
-            }
-        }
-    }
 
-    char vals, vali, valf;
-
-    if(exp_flag||dec_flag){
-        vals = 1;
-        vali = 0;
-        valf = 1;
-    }
-    else{
-        vals = 1;
-        vali = 1;
-        valf = 1;
     }
 
-    n->int_value = int_sum;
-    n->float_value = float_sum;
-    n->valid_string = vals;
-    n->valid_int = vali;
-    n->valid_float = valf;
-
+    argo_number_convert(n);
     return 0;
 }
 
@@ -538,68 +495,15 @@ int argo_read_number(ARGO_NUMBER *n, FILE *f) {
  */
 int argo_write_value(ARGO_VALUE *v, FILE *f) {
 
-    int p = global_options & 0x000000FF;
-
-    if(v->type == ARGO_BASIC_TYPE){
-        if((v->content).basic == ARGO_NULL){
-            if(argo_write_basic(ARGO_NULL_TOKEN, f)){
-                fprintf(stderr, "Error in write basic\n");
-                return -1;
-            }
-        }
-        if((v->content).basic == ARGO_TRUE){
-            if(argo_write_basic(ARGO_TRUE_TOKEN, f)){
-                fprintf(stderr, "Error in write basic\n");
-                return -1;
-            }
-        }
-        if((v->content).basic == ARGO_FALSE){
-            if(argo_write_basic(ARGO_FALSE_TOKEN, f)){
-                fprintf(stderr, "Error in write basic\n");
-                return -1;
-            }
-        }
-    }
-
-    if(v->type == ARGO_NUMBER_TYPE){
-        if(argo_write_number(&((v->content).number), f)){
-            fprintf(stderr, "Error in write number\n");
-            return -1;
-        }
-    }
-
-    if(v->type == ARGO_STRING_TYPE){
-        if(argo_write_string(&((v->content).string), f)){
-            fprintf(stderr, "Error in write string\n");
-            return -1;
-        }
-    }
-
-    if(v->type == ARGO_OBJECT_TYPE){
-        if(argo_write_object(&((v->content).object), f)){
-            fprintf(stderr, "Error in write object\n");
-            return -1;
-        }
-    }
-
-    if(v->type == ARGO_ARRAY_TYPE){
-        if(argo_write_array(&((v->content).array), f)){
-            fprintf(stderr, "Error in write array\n");
-            return -1;
-        }
-    }
-
-    if(v->type == ARGO_NO_TYPE){
-        fprintf(stderr, "Error no type to write\n");
+    // the format was chosen when the writer was selected, and is not
+    // examined again for every value inside
+    if(argo_writer(v, f)){
         return -1;
     }
-
-    if(p){
-        if(indent_level == 0){
-            if(fputc(ARGO_LF, f) == EOF){
-                fprintf(stderr, "Error EOF\n");
-                return -1;
-            }
+    if((global_options & INDENT_MASK) && argo_ctx->indent_level == 0){
+        if(fputc(ARGO_LF, f) == EOF){
+            fprintf(argo_err, "Error EOF\n");
+            return -1;
         }
     }
 
@@ -617,9 +521,11 @@ int argo_write_value(ARGO_VALUE *v, FILE *f) {
  * Unicode code points and the output is a JSON string literal,
  * represented using only 8-bit bytes.  Therefore, any Unicode code
  * with a value greater than or equal to U+00FF cannot appear directly
- * in the output and must be represented by an escape sequence.
+ * in the output and must be represented by an escape sequence (a pair
+ * of them, for a code point beyond U+FFFF).
  * There are other requirements on the use of escape sequences;
- * see the assignment handout for details.
+ * see the assignment handout for details.  In the -u mode, code points
+ * beyond ASCII are instead written directly, encoded in UTF-8.
  *
  * @param v  Data structure representing a string (a sequence of
  * Unicode code points).
@@ -630,7 +536,7 @@ int argo_write_value(ARGO_VALUE *v, FILE *f) {
 int argo_write_string(ARGO_STRING *s, FILE *f) {
 
     if( s==NULL || f==NULL ){
-        fprintf(stderr, "Invalid argument(s) for write string\n");
+        fprintf(argo_err, "Invalid argument(s) for write string\n");
         return -1;
     }
 
@@ -639,143 +545,49 @@ int argo_write_string(ARGO_STRING *s, FILE *f) {
     ARGO_CHAR *str = s->content;
 
     if(len > cap){
-        fprintf(stderr, "Invalid argument(s) for write string\n");
-        return -1;
-    }
-
-    if(fputc(ARGO_QUOTE, f) == EOF){
-        fprintf(stderr, "Error EOF\n");
+        fprintf(argo_err, "Invalid argument(s) for write string\n");
         return -1;
     }
 
-    size_t i;
-    ARGO_CHAR c;
-    for(i = 0; i < len; i++, str++){
-        c = *str;
-        if(argo_is_control(c)){
-            // '\b'
-            if(c == ARGO_BS){
-                if(fputc(ARGO_BSLASH, f) == EOF){
-                    fprintf(stderr, "Error EOF\n");
-                    return -1;
-                }
-                if(fputc(ARGO_B, f) == EOF){
-                    fprintf(stderr, "Error EOF\n");
-                    return -1;
-                }
-            }
-            // '\t'
-            else if(c == ARGO_HT){
-                if(fputc(ARGO_BSLASH, f) == EOF){
-                    fprintf(stderr, "Error EOF\n");
-                    return -1;
-                }
-                if(fputc(ARGO_T, f) == EOF){
-                    fprintf(stderr, "Error EOF\n");
-                    return -1;
-                }
-            }
-            // '\n'
-            else if(c == ARGO_LF){
-                if(fputc(ARGO_BSLASH, f) == EOF){
-                    fprintf(stderr, "Error EOF\n");
-                    return -1;
-                }
-                if(fputc(ARGO_N, f) == EOF){
-                    fprintf(stderr, "Error EOF\n");
-                    return -1;
-                }
-            }
-            // '\f'
-            else if(c == ARGO_FF){
-                if(fputc(ARGO_BSLASH, f) == EOF){
-                    fprintf(stderr, "Error EOF\n");
-                    return -1;
-                }
-                if(fputc(ARGO_F, f) == EOF){
-                    fprintf(stderr, "Error EOF\n");
-                    return -1;
-                }
-            }
-            // '\r'
-            else if(c == ARGO_CR){
-                if(fputc(ARGO_BSLASH, f) == EOF){
-                    fprintf(stderr, "Error EOF\n");
-                    return -1;
-                }
-                if(fputc(ARGO_R, f) == EOF){
-                    fprintf(stderr, "Error EOF\n");
-                    return -1;
-                }
-            }
-            // "\u"
-            else{
-                if(fputc(ARGO_BSLASH, f) == EOF){
-                    fprintf(stderr, "Error EOF\n");
-                    return -1;
-                }
-                if(fputc(ARGO_U, f) == EOF){
-                    fprintf(stderr, "Error EOF\n");
-                    return -1;
-                }
-
-                // "xxxx hex num"
-                if(write_hex_to_file(c, f)){
-                    return -1;
-                }
-            }
-
-        }
-        else if(c > 0x001f && c <= 0x00ff){
-            if(c == ARGO_BSLASH){
-                if(fputc(ARGO_BSLASH, f) == EOF){
-                    fprintf(stderr, "Error EOF\n");
-                    return -1;
-                }
-                if(fputc(ARGO_BSLASH, f) == EOF){
-                    fprintf(stderr, "Error EOF\n");
-                    return -1;
-                }
-            }
-            else if(c == ARGO_QUOTE){
-                if(fputc(ARGO_BSLASH, f) == EOF){
-                    fprintf(stderr, "Error EOF\n");
-                    return -1;
-                }
-                if(fputc(ARGO_QUOTE, f) == EOF){
-                    fprintf(stderr, "Error EOF\n");
-                    return -1;
-                }
-            }
-            else{
-                if(fputc(c, f) == EOF){
-                    fprintf(stderr, "Error EOF\n");
-                    return -1;
-                }
-            }
-        }
-        else if(c > 0x00ff && c <= 0xffff){
-            if(fputc(ARGO_BSLASH, f) == EOF){
-                fprintf(stderr, "Error EOF\n");
-                return -1;
-            }
-            if(fputc(ARGO_U, f) == EOF){
-                fprintf(stderr, "Error EOF\n");
+    // the output is assembled in chunks: runs of characters that need no
+    // escaping are converted in bulk, and the others are replaced by their
+    // escape sequences, for which there is always room past the chunk
+    char buf[ARGO_STRING_CHUNK + 12];
+    size_t used = 0;
+    size_t i = 0;
+    size_t run;
+    int n;
+    int utf8 = global_options & UTF8_OPTION;
+
+    buf[used++] = ARGO_QUOTE;
+    while(i < len){
+        run = len - i;
+        if(run > ARGO_STRING_CHUNK - used){
+            run = ARGO_STRING_CHUNK - used;
+        }
+        run = argo_plain_run(str + i, run, buf + used, utf8 ? 0x7f : 0xff);
+        used += run;
+        i += run;
+        if(i < len && used < ARGO_STRING_CHUNK){
+            n = utf8 ? argo_utf8_char(str[i], buf + used) : argo_escape_char(str[i], buf + used);
+            if(n < 0){
+                fprintf(argo_err, "Invalid char in write string\n");
                 return -1;
             }
-
-            // "xxxx hex num"
-            if(write_hex_to_file(c, f)){
+            used += n;
+            i++;
+        }
+        if(used >= ARGO_STRING_CHUNK){
+            if(fwrite(buf, 1, used, f) != used){
+                fprintf(argo_err, "Error EOF\n");
                 return -1;
             }
-        }
-        else{
-            fprintf(stderr, "Invalid char in write string\n");
-            return -1;
+            used = 0;
         }
     }
-    if(fputc(ARGO_QUOTE, f) == EOF){
-        fprintf(stderr, "Error EOF\n");
+    buf[used++] = ARGO_QUOTE;
+    if(fwrite(buf, 1, used, f) != used){
+        fprintf(argo_err, "Error EOF\n");
         return -1;
     }
 
@@ -803,7 +615,7 @@ int argo_write_string(ARGO_STRING *s, FILE *f) {
 int argo_write_number(ARGO_NUMBER *n, FILE *f) {
 
     if( n==NULL || f==NULL ){
-        fprintf(stderr, "Invalid argument(s) for write number\n");
+        fprintf(argo_err, "Invalid argument(s) for write number\n");
         return -1;
     }
 
@@ -811,7 +623,14 @@ int argo_write_number(ARGO_NUMBER *n, FILE *f) {
     long iv = n->int_value;
     double fv = n->float_value;
 
-    if(n->valid_int != 0){
+    // the text was found to be canonical when it was read
+    if(n->valid_string == ARGO_CANONICAL_TEXT){
+        if(argo_write_number_text(&n->string_value, f)){
+            return -1;
+        }
+    }
+
+    else if(n->valid_int != 0){
         if(write_long_to_file(iv, f)){
             return -1;
         }
@@ -824,7 +643,7 @@ int argo_write_number(ARGO_NUMBER *n, FILE *f) {
     }
 
     else{
-        fprintf(stderr, "Invalid argument(s) for write number\n");
+        fprintf(argo_err, "Invalid argument(s) for write number\n");
         return -1;
     }
 
@@ -0,0 +1,382 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "utils.h"
+#include "context.h"
+#include "binary.h"
+
+/*
+ * Snapshot being built by argo_save_binary: the nodes and characters
+ * written so far, in arrays that grow by doubling.
+ */
+typedef struct argo_bin_build {
+	ARGO_BIN_NODE *nodes;
+	size_t node_count;
+	size_t node_capacity;
+	ARGO_CHAR *chars;
+	size_t char_count;
+	size_t char_capacity;
+} ARGO_BIN_BUILD;
+
+/*
+ * Append the content of a string to the string area, storing its offset
+ * in *offset.
+ */
+static int argo_bin_add_chars(ARGO_BIN_BUILD *b, ARGO_STRING *s, uint64_t *offset){
+	size_t i;
+
+	if(b->char_count + s->length > b->char_capacity){
+		size_t capacity = b->char_capacity ? b->char_capacity : 1024;
+		while(capacity < b->char_count + s->length){
+			capacity *= 2;
+		}
+		ARGO_CHAR *chars = realloc(b->chars, capacity * sizeof(ARGO_CHAR));
+		if(chars == NULL){
+			fprintf(stderr, "Failed to allocate snapshot\n");
+			return -1;
+		}
+		b->chars = chars;
+		b->char_capacity = capacity;
+	}
+	for(i = 0; i < s->length; i++){
+		b->chars[b->char_count + i] = s->content[i];
+	}
+	*offset = b->char_count;
+	b->char_count += s->length;
+	return 0;
+}
+
+/*
+ * Append the node of a value, then those of its elements or members.
+ * Nodes are referred to by index, as the array may move as it grows.
+ * Returns the index of the node of the value, or -1 on error.
+ */
+static long argo_bin_add_value(ARGO_BIN_BUILD *b, ARGO_VALUE *v){
+	ARGO_BIN_NODE *n;
+	ARGO_VALUE *head, *list_ptr;
+	long index, child, last = -1;
+
+	if(b->node_count == b->node_capacity){
+		size_t capacity = b->node_capacity ? 2 * b->node_capacity : 256;
+		ARGO_BIN_NODE *nodes = NULL;
+		if(capacity < ARGO_BIN_NONE){
+			nodes = realloc(b->nodes, capacity * sizeof(ARGO_BIN_NODE));
+		}
+		if(nodes == NULL){
+			fprintf(stderr, "Failed to allocate snapshot\n");
+			return -1;
+		}
+		b->nodes = nodes;
+		b->node_capacity = capacity;
+	}
+	index = b->node_count++;
+	n = &b->nodes[index];
+	*n = (ARGO_BIN_NODE){0};
+	n->type = v->type;
+	n->next = ARGO_BIN_NONE;
+	n->first = ARGO_BIN_NONE;
+	n->name_length = v->name.length;
+	if(argo_bin_add_chars(b, &v->name, &n->name_offset)){
+		return -1;
+	}
+
+	switch(v->type){
+	case ARGO_BASIC_TYPE:
+		n->first = v->content.basic;
+		return index;
+	case ARGO_NUMBER_TYPE:
+		n->valid_string = v->content.number.valid_string;
+		n->valid_int = v->content.number.valid_int;
+		n->valid_float = v->content.number.valid_float;
+		n->int_value = v->content.number.int_value;
+		n->float_value = v->content.number.float_value;
+		n->text_length = v->content.number.string_value.length;
+		if(argo_bin_add_chars(b, &v->content.number.string_value, &n->text_offset)){
+			return -1;
+		}
+		return index;
+	case ARGO_STRING_TYPE:
+		n->text_length = v->content.string.length;
+		if(argo_bin_add_chars(b, &v->content.string, &n->text_offset)){
+			return -1;
+		}
+		return index;
+	case ARGO_ARRAY_TYPE:
+		head = v->content.array.element_list;
+		break;
+	case ARGO_OBJECT_TYPE:
+		head = v->content.object.member_list;
+		break;
+	default:
+		fprintf(stderr, "Invalid value type (%d) in snapshot\n", v->type);
+		return -1;
+	}
+
+	for(list_ptr = head->next; list_ptr != head; list_ptr = list_ptr->next){
+		child = argo_bin_add_value(b, list_ptr);
+		if(child < 0){
+			return -1;
+		}
+		if(last < 0){
+			b->nodes[index].first = child;
+		}
+		else{
+			b->nodes[last].next = child;
+		}
+		last = child;
+	}
+	return index;
+}
+
+/**
+ * @brief  Save a value, and everything inside it, as a binary snapshot.
+ * @details  The snapshot can be loaded again with argo_load_binary,
+ * on a machine of the same byte order, without parsing.
+ *
+ * @param v  The value to save.
+ * @param f  Output stream to which the snapshot is to be written.
+ * @return  Zero if the operation is completely successful,
+ * nonzero if there is any error.
+ */
+int argo_save_binary(ARGO_VALUE *v, FILE *f){
+	ARGO_BIN_BUILD b = {0};
+	ARGO_BIN_HEADER h = {ARGO_BIN_MAGIC, ARGO_BIN_BYTE_ORDER, ARGO_BIN_VERSION, 0, 0};
+	int ret = -1;
+
+	if(v == NULL || f == NULL){
+		fprintf(stderr, "Invalid argument(s) for save binary\n");
+		return -1;
+	}
+	if(argo_bin_add_value(&b, v) < 0){
+		goto done;
+	}
+	h.node_count = b.node_count;
+	h.char_count = b.char_count;
+	if(fwrite(&h, sizeof(h), 1, f) != 1
+	   || fwrite(b.nodes, sizeof(ARGO_BIN_NODE), b.node_count, f) != b.node_count
+	   || fwrite(b.chars, sizeof(ARGO_CHAR), b.char_count, f) != b.char_count){
+		fprintf(stderr, "Error writing snapshot\n");
+		goto done;
+	}
+	ret = 0;
+
+done:
+	free(b.nodes);
+	free(b.chars);
+	return ret;
+}
+
+/*
+ * Point a string at len characters of the string area of a snapshot,
+ * after checking that they are inside it.
+ */
+static int argo_bin_string(ARGO_STRING *s, ARGO_CHAR *chars, uint64_t char_count,
+                           uint64_t offset, uint64_t len){
+	if(len > char_count || offset > char_count - len){
+		fprintf(stderr, "Invalid string in snapshot\n");
+		return -1;
+	}
+	s->capacity = len;
+	s->length = len;
+	s->content = len ? chars + offset : NULL;
+	return 0;
+}
+
+/*
+ * Work out again whether the text of a number loaded from a snapshot is
+ * canonical, rather than trusting the flag that was saved with it: a
+ * damaged snapshot could otherwise have text of any length or content
+ * written out as it is.  Anything other than a plain integer literal is
+ * taken as not canonical.
+ */
+static char argo_bin_number_kind(ARGO_STRING *sv){
+	size_t i, neg = sv->length > 0 && sv->content[0] == ARGO_MINUS;
+	int other = sv->length == neg;
+
+	if(sv->length > neg + 1 && sv->content[neg] == ARGO_DIGIT0){
+		other = 1;
+	}
+	for(i = neg; i < sv->length; i++){
+		if(!argo_is_digit(sv->content[i])){
+			other = 1;
+		}
+	}
+	return argo_number_text_kind(sv, neg, other);
+}
+
+/*
+ * Build the value of node i of a snapshot, and those inside it.
+ * Every reference must be to a later node, as in preorder, so that
+ * a damaged snapshot cannot send the loader around in circles.
+ */
+static ARGO_VALUE *argo_bin_value(ARGO_BIN_NODE *nodes, uint64_t node_count,
+                                  ARGO_CHAR *chars, uint64_t char_count, uint64_t i){
+	ARGO_BIN_NODE *n = &nodes[i];
+	ARGO_VALUE *v, *head, *child;
+	uint64_t c;
+
+	v = argo_alloc_value();
+	if(v == NULL){
+		return NULL;
+	}
+	if(argo_bin_string(&v->name, chars, char_count, n->name_offset, n->name_length)){
+		return NULL;
+	}
+
+	switch(n->type){
+	case ARGO_BASIC_TYPE:
+		if(n->first > ARGO_FALSE){
+			fprintf(stderr, "Invalid basic value in snapshot\n");
+			return NULL;
+		}
+		v->type = ARGO_BASIC_TYPE;
+		v->content.basic = n->first;
+		return v;
+	case ARGO_NUMBER_TYPE:
+		if(n->valid_string > ARGO_CANONICAL_TEXT){
+			fprintf(stderr, "Invalid number in snapshot\n");
+			return NULL;
+		}
+		v->type = ARGO_NUMBER_TYPE;
+		v->content.number.valid_string = n->valid_string;
+		v->content.number.valid_int = n->valid_int;
+		v->content.number.valid_float = n->valid_float;
+		v->content.number.int_value = n->int_value;
+		v->content.number.float_value = n->float_value;
+		if(argo_bin_string(&v->content.number.string_value, chars, char_count,
+		                   n->text_offset, n->text_length)){
+			return NULL;
+		}
+		if(n->valid_string == ARGO_CANONICAL_TEXT){
+			v->content.number.valid_string = argo_bin_number_kind(&v->content.number.string_value);
+		}
+		return v;
+	case ARGO_STRING_TYPE:
+		v->type = ARGO_STRING_TYPE;
+		if(argo_bin_string(&v->content.string, chars, char_count,
+		                   n->text_offset, n->text_length)){
+			return NULL;
+		}
+		return v;
+	case ARGO_ARRAY_TYPE:
+	case ARGO_OBJECT_TYPE:
+		break;
+	default:
+		fprintf(stderr, "Invalid value type (%d) in snapshot\n", n->type);
+		return NULL;
+	}
+
+	head = argo_alloc_value();
+	if(head == NULL){
+		return NULL;
+	}
+	head->next = head;
+	head->prev = head;
+	v->type = n->type;
+	if(n->type == ARGO_ARRAY_TYPE){
+		v->content.array.element_list = head;
+	}
+	else{
+		v->content.object.member_list = head;
+	}
+
+	for(c = n->first; c != ARGO_BIN_NONE; c = nodes[c].next){
+		if(c <= i || c >= node_count){
+			fprintf(stderr, "Invalid node reference in snapshot\n");
+			return NULL;
+		}
+		child = argo_bin_value(nodes, node_count, chars, char_count, c);
+		if(child == NULL){
+			return NULL;
+		}
+		child->prev = head->prev;
+		child->next = head;
+		head->prev->next = child;
+		head->prev = child;
+		i = c;
+	}
+	return v;
+}
+
+/**
+ * @brief  Load a value saved by argo_save_binary.
+ * @details  The snapshot is mapped into memory, and the values are built
+ * straight from its nodes, in the current context, without any parsing.
+ * Strings are not copied: they point into the mapping, which stays in
+ * place until the context is reset.  A context holds at most one
+ * snapshot at a time.
+ *
+ * @param f  Stream open on the snapshot, which must be a regular file.
+ * @return  The loaded value, or NULL if there is any error.
+ */
+ARGO_VALUE *argo_load_binary(FILE *f){
+	ARGO_CONTEXT *ctx = argo_ctx;
+	struct stat st;
+	ARGO_BIN_HEADER *h;
+	ARGO_BIN_NODE *nodes;
+	ARGO_CHAR *chars;
+	size_t size, i;
+	char *map;
+
+	if(f == NULL){
+		fprintf(stderr, "Invalid argument(s) for load binary\n");
+		return NULL;
+	}
+	if(ctx->mapping != NULL){
+		fprintf(stderr, "A snapshot is already loaded\n");
+		return NULL;
+	}
+	if(fstat(fileno(f), &st) || !S_ISREG(st.st_mode)){
+		fprintf(stderr, "Snapshot must be a regular file\n");
+		return NULL;
+	}
+	size = st.st_size;
+	if(size < sizeof(ARGO_BIN_HEADER)){
+		fprintf(stderr, "Invalid snapshot\n");
+		return NULL;
+	}
+	map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+	if(map == MAP_FAILED){
+		fprintf(stderr, "Failed to map snapshot\n");
+		return NULL;
+	}
+
+	h = (ARGO_BIN_HEADER *) map;
+	for(i = 0; i < sizeof(ARGO_BIN_MAGIC); i++){
+		if(h->magic[i] != ARGO_BIN_MAGIC[i]){
+			break;
+		}
+	}
+	if(i < sizeof(ARGO_BIN_MAGIC) || h->version != ARGO_BIN_VERSION){
+		fprintf(stderr, "Invalid snapshot\n");
+		goto fail;
+	}
+	if(h->byte_order != ARGO_BIN_BYTE_ORDER){
+		fprintf(stderr, "Snapshot was saved with a different byte order\n");
+		goto fail;
+	}
+	size -= sizeof(ARGO_BIN_HEADER);
+	if(h->node_count == 0 || h->node_count > size / sizeof(ARGO_BIN_NODE)
+	   || h->char_count != (size - h->node_count * sizeof(ARGO_BIN_NODE)) / sizeof(ARGO_CHAR)){
+		fprintf(stderr, "Invalid snapshot\n");
+		goto fail;
+	}
+	nodes = (ARGO_BIN_NODE *) (h + 1);
+	chars = (ARGO_CHAR *) (nodes + h->node_count);
+
+	// from here on, values point into the mapping, so it is left in place
+	// even on error, until the context is reset
+	ctx->mapping = map;
+	ctx->mapping_size = st.st_size;
+	return argo_bin_value(nodes, h->node_count, chars, h->char_count, 0);
+
+fail:
+	munmap(map, st.st_size);
+	return NULL;
+}
@@ -0,0 +1,476 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdio_ext.h>
+#include <limits.h>
+#include <unistd.h>
+#ifdef ARGO_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef ARGO_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "compress.h"
+
+static const unsigned char argo_gzip_magic[] = {0x1f, 0x8b};
+static const unsigned char argo_zstd_magic[] = {0x28, 0xb5, 0x2f, 0xfd};
+
+/*
+ * Source decompressing another one.  The first bytes of the other source
+ * are read in advance to recognize its format; if it is not compressed,
+ * they are handed out first, and the rest is read straight through.
+ */
+typedef struct argo_decompress_source {
+	ARGO_SOURCE source;                // Must be first.
+	ARGO_SOURCE *inner;
+	int format;
+	char *in;                          // Input not yet decompressed
+	size_t start;                      // is in[start] to in[end - 1].
+	size_t end;
+	int eof;                           // Nothing more to read from the inner source.
+	int in_frame;                      // In the middle of a gzip member or zstd frame.
+#ifdef ARGO_HAVE_ZLIB
+	z_stream z;
+#endif
+#ifdef ARGO_HAVE_ZSTD
+	ZSTD_DStream *zd;
+#endif
+} ARGO_DECOMPRESS_SOURCE;
+
+/*
+ * Read more input from the inner source once all of it has been used.
+ */
+static int argo_decompress_fill(ARGO_DECOMPRESS_SOURCE *ds){
+	ssize_t n;
+
+	if(ds->start < ds->end || ds->eof){
+		return 0;
+	}
+	n = ds->inner->read(ds->inner, ds->in, ARGO_COMPRESS_BUFFER_SIZE);
+	if(n < 0){
+		return -1;
+	}
+	ds->eof = n == 0;
+	ds->start = 0;
+	ds->end = n;
+	return 0;
+}
+
+static ssize_t argo_decompress_read(ARGO_SOURCE *source, char *buf, size_t size){
+	ARGO_DECOMPRESS_SOURCE *ds = (ARGO_DECOMPRESS_SOURCE *) source;
+	size_t n = 0;
+	size_t i;
+
+	if(size > INT_MAX){
+		size = INT_MAX;
+	}
+	if(ds->format == ARGO_COMPRESS_NONE){
+		// what was read in advance, then the rest without copying it twice
+		if(ds->start == ds->end){
+			return ds->eof ? 0 : ds->inner->read(ds->inner, buf, size);
+		}
+		n = ds->end - ds->start;
+		if(n > size){
+			n = size;
+		}
+		for(i = 0; i < n; i++){
+			buf[i] = ds->in[ds->start + i];
+		}
+		ds->start += n;
+		return n;
+	}
+	while(1){
+		if(argo_decompress_fill(ds)){
+			return -1;
+		}
+		if(ds->start == ds->end){
+			if(ds->in_frame){
+				fprintf(stderr, "Compressed input is truncated\n");
+				return -1;
+			}
+			return 0;
+		}
+#ifdef ARGO_HAVE_ZLIB
+		if(ds->format == ARGO_COMPRESS_GZIP){
+			int ret;
+
+			ds->z.next_in = (unsigned char *) ds->in + ds->start;
+			ds->z.avail_in = ds->end - ds->start;
+			ds->z.next_out = (unsigned char *) buf;
+			ds->z.avail_out = size;
+			ret = inflate(&ds->z, Z_NO_FLUSH);
+			ds->start = ds->end - ds->z.avail_in;
+			n = size - ds->z.avail_out;
+			if(ret == Z_STREAM_END){
+				// another member may follow, as in the output of cat a.gz b.gz
+				inflateReset(&ds->z);
+				ds->in_frame = 0;
+			}
+			else if(ret == Z_OK || ret == Z_BUF_ERROR){
+				ds->in_frame = 1;
+			}
+			else{
+				fprintf(stderr, "Invalid compressed input\n");
+				return -1;
+			}
+		}
+#endif
+#ifdef ARGO_HAVE_ZSTD
+		if(ds->format == ARGO_COMPRESS_ZSTD){
+			ZSTD_inBuffer zin = {ds->in, ds->end, ds->start};
+			ZSTD_outBuffer zout = {buf, size, 0};
+			size_t ret = ZSTD_decompressStream(ds->zd, &zout, &zin);
+
+			if(ZSTD_isError(ret)){
+				fprintf(stderr, "Invalid compressed input\n");
+				return -1;
+			}
+			ds->start = zin.pos;
+			ds->in_frame = ret != 0;
+			n = zout.pos;
+		}
+#endif
+		if(n > 0){
+			return n;
+		}
+	}
+}
+
+static void argo_decompress_close(ARGO_SOURCE *source){
+	ARGO_DECOMPRESS_SOURCE *ds = (ARGO_DECOMPRESS_SOURCE *) source;
+
+#ifdef ARGO_HAVE_ZLIB
+	if(ds->format == ARGO_COMPRESS_GZIP){
+		inflateEnd(&ds->z);
+	}
+#endif
+#ifdef ARGO_HAVE_ZSTD
+	if(ds->format == ARGO_COMPRESS_ZSTD){
+		ZSTD_freeDStream(ds->zd);
+	}
+#endif
+	ds->inner->close(ds->inner);
+	free(ds->in);
+	free(ds);
+}
+
+static int argo_compress_format_of(const char *data, size_t n){
+	size_t i;
+
+	for(i = 0; i < n && i < sizeof(argo_gzip_magic) && (unsigned char) data[i] == argo_gzip_magic[i]; i++)
+		;
+	if(i == sizeof(argo_gzip_magic)){
+		return ARGO_COMPRESS_GZIP;
+	}
+	for(i = 0; i < n && i < sizeof(argo_zstd_magic) && (unsigned char) data[i] == argo_zstd_magic[i]; i++)
+		;
+	if(i == sizeof(argo_zstd_magic)){
+		return ARGO_COMPRESS_ZSTD;
+	}
+	return ARGO_COMPRESS_NONE;
+}
+
+/**
+ * @brief  Find out whether the input of a stream is compressed, without
+ * reading it.
+ * @details  That is only possible if the stream is a file that can be read
+ * at any position.  Nothing must have been read from the stream yet.
+ *
+ * @param in  The input stream.
+ * @return  ARGO_COMPRESS_NONE, ARGO_COMPRESS_GZIP or ARGO_COMPRESS_ZSTD, or
+ * ARGO_COMPRESS_UNKNOWN if the input cannot be looked at in advance, as with
+ * a pipe.
+ */
+int argo_compress_detect(FILE *in){
+	char magic[sizeof(argo_zstd_magic)];
+	int fd = fileno(in);
+	off_t offset;
+	ssize_t n;
+
+	if(fd < 0 || (offset = lseek(fd, 0, SEEK_CUR)) < 0){
+		return ARGO_COMPRESS_UNKNOWN;
+	}
+	n = pread(fd, magic, sizeof(magic), offset);
+	if(n < 0){
+		return ARGO_COMPRESS_UNKNOWN;
+	}
+	return argo_compress_format_of(magic, n);
+}
+
+/**
+ * @brief  Make a source that decompresses another one, if it is compressed.
+ * @details  The format is recognized by the magic bytes at the start of the
+ * input: gzip (one or more members) or zstd (one or more frames).  Input in
+ * neither format is passed through unchanged.
+ *
+ * @param source  The source, which is closed with the one returned (or
+ * right away, if there is any error).
+ * @param format  Set to ARGO_COMPRESS_NONE, ARGO_COMPRESS_GZIP or
+ * ARGO_COMPRESS_ZSTD, if not NULL.
+ * @return  The source, or NULL if there is any error, including input in a
+ * format that this build cannot decompress.
+ */
+ARGO_SOURCE *argo_decompress_open(ARGO_SOURCE *source, int *format){
+	ARGO_DECOMPRESS_SOURCE *ds;
+	ssize_t n;
+
+	if(source == NULL){
+		return NULL;
+	}
+	ds = calloc(1, sizeof(ARGO_DECOMPRESS_SOURCE));
+	if(ds == NULL || (ds->in = malloc(ARGO_COMPRESS_BUFFER_SIZE)) == NULL){
+		fprintf(stderr, "Failed to allocate input source\n");
+		free(ds);
+		source->close(source);
+		return NULL;
+	}
+	ds->source.read = argo_decompress_read;
+	ds->source.close = argo_decompress_close;
+	ds->inner = source;
+
+	// input may trickle in through a pipe, so wait for enough of it
+	while(ds->end < sizeof(argo_zstd_magic)){
+		n = source->read(source, ds->in + ds->end, ARGO_COMPRESS_BUFFER_SIZE - ds->end);
+		if(n < 0){
+			fprintf(stderr, "Error reading input\n");
+			argo_decompress_close(&ds->source);
+			return NULL;
+		}
+		if(n == 0){
+			ds->eof = 1;
+			break;
+		}
+		ds->end += n;
+	}
+
+	ds->format = argo_compress_format_of(ds->in, ds->end);
+	if(ds->format == ARGO_COMPRESS_GZIP){
+#ifdef ARGO_HAVE_ZLIB
+		if(inflateInit2(&ds->z, 16 + MAX_WBITS) != Z_OK){
+			fprintf(stderr, "Failed to set up decompression\n");
+			ds->format = ARGO_COMPRESS_NONE;
+			argo_decompress_close(&ds->source);
+			return NULL;
+		}
+#else
+		fprintf(stderr, "Input is compressed with gzip, which this build does not support\n");
+		argo_decompress_close(&ds->source);
+		return NULL;
+#endif
+	}
+	else if(ds->format == ARGO_COMPRESS_ZSTD){
+#ifdef ARGO_HAVE_ZSTD
+		ds->zd = ZSTD_createDStream();
+		if(ds->zd == NULL){
+			fprintf(stderr, "Failed to set up decompression\n");
+			ds->format = ARGO_COMPRESS_NONE;
+			argo_decompress_close(&ds->source);
+			return NULL;
+		}
+#else
+		fprintf(stderr, "Input is compressed with zstd, which this build does not support\n");
+		argo_decompress_close(&ds->source);
+		return NULL;
+#endif
+	}
+	// the size of the output is only known in advance if there is no compression
+	ds->source.size = ds->format == ARGO_COMPRESS_NONE ? source->size : 0;
+	if(format != NULL){
+		*format = ds->format;
+	}
+	return &ds->source;
+}
+
+/*
+ * State of a stream compressing what is written to it into another one.
+ */
+typedef struct argo_compressor {
+	FILE *out;
+	int close_out;                     // Nonzero if "out" is closed with the stream.
+	int format;
+	int error;                         // Writing "out" has failed.
+	char *buf;                         // Compressed output, before it is written.
+#ifdef ARGO_HAVE_ZLIB
+	z_stream z;
+#endif
+#ifdef ARGO_HAVE_ZSTD
+	ZSTD_CStream *zc;
+#endif
+} ARGO_COMPRESSOR;
+
+static int argo_compress_flush(ARGO_COMPRESSOR *c, size_t n){
+	if(n > 0 && !c->error && fwrite(c->buf, 1, n, c->out) != n){
+		fprintf(stderr, "Error writing output\n");
+		c->error = 1;
+	}
+	return c->error ? -1 : 0;
+}
+
+/*
+ * Compress some data, writing out the output buffer each time it fills,
+ * or, if "finish" is nonzero, end the compressed stream.
+ */
+static int argo_compress_run(ARGO_COMPRESSOR *c, const char *data, size_t size, int finish){
+#ifdef ARGO_HAVE_ZLIB
+	if(c->format == ARGO_COMPRESS_GZIP){
+		int ret;
+
+		c->z.next_in = (unsigned char *) data;
+		c->z.avail_in = size;
+		do{
+			c->z.next_out = (unsigned char *) c->buf;
+			c->z.avail_out = ARGO_COMPRESS_BUFFER_SIZE;
+			ret = deflate(&c->z, finish ? Z_FINISH : Z_NO_FLUSH);
+			if(ret == Z_STREAM_ERROR){
+				fprintf(stderr, "Failed to compress output\n");
+				return -1;
+			}
+			if(argo_compress_flush(c, ARGO_COMPRESS_BUFFER_SIZE - c->z.avail_out)){
+				return -1;
+			}
+		} while(c->z.avail_out == 0 || (finish && ret != Z_STREAM_END));
+		return 0;
+	}
+#endif
+#ifdef ARGO_HAVE_ZSTD
+	if(c->format == ARGO_COMPRESS_ZSTD){
+		ZSTD_inBuffer zin = {data, size, 0};
+		ZSTD_outBuffer zout;
+		size_t ret;
+
+		do{
+			zout = (ZSTD_outBuffer) {c->buf, ARGO_COMPRESS_BUFFER_SIZE, 0};
+			ret = ZSTD_compressStream2(c->zc, &zout, &zin, finish ? ZSTD_e_end : ZSTD_e_continue);
+			if(ZSTD_isError(ret)){
+				fprintf(stderr, "Failed to compress output\n");
+				return -1;
+			}
+			if(argo_compress_flush(c, zout.pos)){
+				return -1;
+			}
+		} while(finish ? ret != 0 : zin.pos < zin.size);
+		return 0;
+	}
+#endif
+	return -1;
+}
+
+static ssize_t argo_compress_write(void *cookie, const char *buf, size_t size){
+	ARGO_COMPRESSOR *c = cookie;
+	size_t done = 0;
+	size_t n;
+
+	// zlib counts in unsigned int
+	while(done < size){
+		n = size - done;
+		if(n > UINT_MAX){
+			n = UINT_MAX;
+		}
+		if(argo_compress_run(c, buf + done, n, 0)){
+			return -1;
+		}
+		done += n;
+	}
+	return size;
+}
+
+static void argo_compress_free(ARGO_COMPRESSOR *c){
+#ifdef ARGO_HAVE_ZLIB
+	if(c->format == ARGO_COMPRESS_GZIP){
+		deflateEnd(&c->z);
+	}
+#endif
+#ifdef ARGO_HAVE_ZSTD
+	if(c->format == ARGO_COMPRESS_ZSTD){
+		ZSTD_freeCStream(c->zc);
+	}
+#endif
+	free(c->buf);
+	free(c);
+}
+
+static int argo_compress_close(void *cookie){
+	ARGO_COMPRESSOR *c = cookie;
+	int status = argo_compress_run(c, NULL, 0, 1);
+
+	if(c->close_out ? fclose(c->out) == EOF : fflush(c->out) == EOF){
+		status = -1;
+	}
+	argo_compress_free(c);
+	return status ? EOF : 0;
+}
+
+/**
+ * @brief  Open a stream whose output is compressed into another stream.
+ * @details  The stream must be used by one thread at a time, so that it can
+ * do without locking; it is normally put under the ring of a writer thread,
+ * which then does the compressing.  Closing it ends the compressed stream,
+ * then flushes "out", or closes it if "close_out" is nonzero; fclose fails
+ * if any of that fails.
+ *
+ * @param out  The output stream.
+ * @param format  ARGO_COMPRESS_GZIP or ARGO_COMPRESS_ZSTD.
+ * @param close_out  Nonzero if "out" is to be closed with the stream.
+ * @return  The stream, or NULL if there is any error, including a format
+ * that this build cannot compress.
+ */
+FILE *argo_compress_open(FILE *out, int format, int close_out){
+	cookie_io_functions_t io = {NULL, argo_compress_write, NULL, argo_compress_close};
+	ARGO_COMPRESSOR *c;
+	FILE *f;
+
+	if(out == NULL){
+		return NULL;
+	}
+	c = calloc(1, sizeof(ARGO_COMPRESSOR));
+	if(c == NULL || (c->buf = malloc(ARGO_COMPRESS_BUFFER_SIZE)) == NULL){
+		fprintf(stderr, "Failed to allocate output buffer\n");
+		free(c);
+		return NULL;
+	}
+	c->out = out;
+	c->close_out = close_out;
+	switch(format){
+#ifdef ARGO_HAVE_ZLIB
+	case ARGO_COMPRESS_GZIP:
+		if(deflateInit2(&c->z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8,
+		                Z_DEFAULT_STRATEGY) != Z_OK){
+			fprintf(stderr, "Failed to set up compression\n");
+			free(c->buf);
+			free(c);
+			return NULL;
+		}
+		break;
+#endif
+#ifdef ARGO_HAVE_ZSTD
+	case ARGO_COMPRESS_ZSTD:
+		c->zc = ZSTD_createCStream();
+		if(c->zc == NULL){
+			fprintf(stderr, "Failed to set up compression\n");
+			free(c->buf);
+			free(c);
+			return NULL;
+		}
+		break;
+#endif
+	default:
+		fprintf(stderr, "This build does not support %s compression\n",
+		        format == ARGO_COMPRESS_GZIP ? "gzip" : "zstd");
+		free(c->buf);
+		free(c);
+		return NULL;
+	}
+	c->format = format;
+	f = fopencookie(c, "w", io);
+	if(f == NULL){
+		fprintf(stderr, "Failed to open output\n");
+		argo_compress_free(c);
+		return NULL;
+	}
+	__fsetlocking(f, FSETLOCKING_BYCALLER);
+	return f;
+}
@@ -0,0 +1,310 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "context.h"
+#include "dedup.h"
+
+static ARGO_CONTEXT argo_main_context = {
+    argo_value_storage, NUM_ARGO_VALUES, 0, 0, 0, 0, 0, NULL, 0, 0, NULL, 0, NULL, 0, NULL, NULL
+};
+
+__thread ARGO_CONTEXT *argo_ctx = &argo_main_context;
+
+/**
+ * @brief  Create a context with a private arena of a specified size.
+ * @details  The arena is zero-filled, so its pages are only faulted in
+ * as values are actually allocated from it.
+ *
+ * @param num_values  Number of value slots in the arena.
+ * @return  The new context, or NULL if memory could not be allocated.
+ */
+ARGO_CONTEXT *argo_context_create(int num_values){
+	ARGO_CONTEXT *ctx = calloc(1, sizeof(ARGO_CONTEXT));
+	if(ctx == NULL){
+		fprintf(stderr, "Failed to allocate context\n");
+		return NULL;
+	}
+	ctx->value_storage = calloc(num_values, sizeof(ARGO_VALUE));
+	if(ctx->value_storage == NULL){
+		fprintf(stderr, "Failed to allocate space for %d values\n", num_values);
+		free(ctx);
+		return NULL;
+	}
+	ctx->num_values = num_values;
+	return ctx;
+}
+
+void argo_context_destroy(ARGO_CONTEXT *ctx){
+	if(ctx == NULL){
+		return;
+	}
+	argo_context_reset(ctx);
+	free(ctx->indent);
+	ctx->indent = NULL;
+	ctx->indent_size = 0;
+	argo_dedup_destroy(ctx->dedup);
+	ctx->dedup = NULL;
+	if(ctx != &argo_main_context){
+		free(ctx->value_storage);
+		free(ctx);
+	}
+}
+
+/*
+ * Free string contents, unless they belong to the snapshot of the context.
+ */
+static void argo_context_free(ARGO_CONTEXT *ctx, ARGO_CHAR *content){
+	char *p = (char *) content;
+	if(ctx->mapping != NULL && p >= ctx->mapping && p < ctx->mapping + ctx->mapping_size){
+		return;
+	}
+	free(content);
+}
+
+/**
+ * @brief  Release every value allocated from a context.
+ * @details  String contents owned by the values are freed and the used
+ * slots are cleared, so that the arena can be reused for the next document.
+ * A snapshot loaded into the context is unmapped.
+ * The position counters are left alone; they describe the input, not the
+ * values.
+ */
+void argo_context_reset(ARGO_CONTEXT *ctx){
+	ARGO_VALUE *v = ctx->value_storage;
+	ARGO_VALUE *end = v + ctx->next_value;
+	unsigned char *shared = ctx->dedup != NULL ? ctx->dedup->shared : NULL;
+	int flags;
+	for(; v < end; v++){
+		flags = shared != NULL ? shared[v - ctx->value_storage] : 0;
+		if(!(flags & ARGO_SHARED_NAME)){
+			argo_context_free(ctx, v->name.content);
+		}
+		if(flags & ARGO_SHARED_CONTENT){
+			;
+		}
+		else if(v->type == ARGO_STRING_TYPE){
+			argo_context_free(ctx, v->content.string.content);
+		}
+		else if(v->type == ARGO_NUMBER_TYPE){
+			argo_context_free(ctx, v->content.number.string_value.content);
+		}
+		if(flags){
+			shared[v - ctx->value_storage] = 0;
+		}
+		*v = (ARGO_VALUE){0};
+	}
+	if(ctx->dedup != NULL){
+		argo_dedup_clear(ctx->dedup);
+	}
+	if(ctx->mapping != NULL){
+		munmap(ctx->mapping, ctx->mapping_size);
+		ctx->mapping = NULL;
+		ctx->mapping_size = 0;
+	}
+	ctx->next_value = 0;
+	ctx->indent_level = 0;
+}
+
+/**
+ * @brief  Take the next unused value from the arena of the current context.
+ * @details  The name of the returned value is empty and it is not linked
+ * into any list.
+ *
+ * @return  The new value, or NULL if the arena is exhausted.
+ */
+ARGO_VALUE *argo_alloc_value(void){
+	ARGO_CONTEXT *ctx = argo_ctx;
+	if(ctx->next_value >= ctx->num_values){
+		fprintf(argo_err,"[%d, %d] Number of ARGO Value Exceeds Limit. \n", ctx->lines_read, ctx->chars_read);
+		return NULL;
+	}
+
+	ARGO_VALUE *av = ctx->value_storage + ctx->next_value;
+	ctx->next_value++;
+
+	av->type = ARGO_NO_TYPE;
+	av->next = NULL;
+	av->prev = NULL;
+	av->name.capacity = 0;
+	av->name.length = 0;
+	av->name.content = NULL;
+	return av;
+}
+
+/**
+ * @brief  Start reading a new input with a context.
+ * @details  The position reported in error messages is counted from the
+ * given line and column, which is where the input starts.
+ *
+ * @param ctx  The context.
+ * @param text  The text of the input, if it is held in memory, otherwise NULL.
+ * @param length  The length of the text.
+ * @param line  Line of the input at which the text starts.
+ * @param column  Column of that line at which the text starts.
+ */
+void argo_context_input(ARGO_CONTEXT *ctx, const char *text, size_t length, int line, int column){
+	ctx->lines_read = line;
+	ctx->chars_read = column;
+	ctx->mark = 0;
+	ctx->newline = 0;
+	ctx->text = text;
+	ctx->text_length = text != NULL ? length : 0;
+}
+
+#define ARGO_ONES (0x0101010101010101ULL)
+#define ARGO_LOW7 (0x7F7F7F7F7F7F7F7FULL)
+
+/**
+ * @brief  Advance a position over some text.
+ * @details  Newlines are looked for eight bytes at a time: after XOR with
+ * a word of newlines, a newline is a zero byte, whose high bit is the only
+ * one left set by the expression below.
+ *
+ * @param text  The text.
+ * @param length  Its length.
+ * @param line  Line at which the text starts, advanced to where it ends.
+ * @param column  Column at which the text starts, advanced to where it ends.
+ */
+void argo_position_scan(const char *text, size_t length, int *line, int *column){
+	const unsigned char *s = (const unsigned char *) text;
+	const unsigned char *end = s + length;
+	const unsigned char *after = NULL;      // just after the last newline
+	uint64_t w;
+	int lines = 0;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	for(; end - s >= 8; s += 8){
+		__builtin_memcpy(&w, s, 8);
+		w ^= ARGO_ONES * ARGO_LF;
+		w = ~(((w & ARGO_LOW7) + ARGO_LOW7) | w | ARGO_LOW7);
+		if(w){
+			lines += __builtin_popcountll(w);
+			after = s + (63 - __builtin_clzll(w)) / 8 + 1;
+		}
+	}
+#endif
+	for(; s < end; s++){
+		if(*s == ARGO_LF){
+			lines++;
+			after = s + 1;
+		}
+	}
+	*line += lines;
+	if(after != NULL){
+		*column = end - after;
+	}
+	else{
+		*column += length;
+	}
+}
+
+/*
+ * Start a new line if the position is at a newline that was counted as the
+ * last character of its line.
+ */
+static void argo_position_start(ARGO_CONTEXT *ctx){
+	if(ctx->newline){
+		ctx->lines_read++;
+		ctx->chars_read = 0;
+		ctx->newline = 0;
+	}
+}
+
+/*
+ * Advance the position over the last character read, which is counted on
+ * its line even if it is a newline, so that a newline read where it is not
+ * allowed is reported at the end of the line it ends, not at the start of
+ * the next one.
+ */
+static void argo_position_last(ARGO_CONTEXT *ctx, int c){
+	argo_position_start(ctx);
+	ctx->chars_read++;
+	ctx->newline = (c == ARGO_LF);
+	ctx->mark++;
+}
+
+/**
+ * @brief  Advance the position of a context over text held in memory.
+ *
+ * @param ctx  The context.
+ * @param length  Number of bytes of its text to advance over; no more than
+ * its text_length.
+ */
+void argo_position_advance(ARGO_CONTEXT *ctx, size_t length){
+	if(length == 0){
+		return;
+	}
+	argo_position_start(ctx);
+	argo_position_scan(ctx->text, length, &ctx->lines_read, &ctx->chars_read);
+	ctx->text += length;
+	ctx->text_length -= length;
+	ctx->mark += length;
+}
+
+/**
+ * @brief  Bring the position of the calling thread's context up to where
+ * a stream has been read, so that an error can be reported there.
+ * @details  The position is that of the last character read, or once the
+ * end of the input has been reached, the one just after all of it, as
+ * where it is read a character at a time.  The text read since the position was last brought up to date is scanned where the
+ * context holds it in memory, and otherwise read again from the file, if
+ * the stream reads one.  What cannot be had either way is taken to be on
+ * the same line.  A stream that cannot tell how far it has been read
+ * leaves the position as it is.
+ *
+ * @param f  The stream.
+ */
+void argo_position(FILE *f){
+	ARGO_CONTEXT *ctx = argo_ctx;
+	long offset = ftell(f);
+	char buf[4096];
+	ssize_t n;
+	int fd;
+
+	if(offset <= ctx->mark){
+		return;
+	}
+	if(ctx->text != NULL){
+		if(offset - ctx->mark <= (long) ctx->text_length){
+			if(feof(f)){
+				argo_position_advance(ctx, offset - ctx->mark);
+				argo_position_start(ctx);
+				return;
+			}
+			argo_position_advance(ctx, offset - ctx->mark - 1);
+			argo_position_last(ctx, *ctx->text);
+			ctx->text++;
+			ctx->text_length--;
+			return;
+		}
+		argo_position_advance(ctx, ctx->text_length);
+	}
+	else if((fd = fileno(f)) >= 0){
+		while(ctx->mark < offset){
+			n = offset - ctx->mark < (long) sizeof(buf) ? offset - ctx->mark : (long) sizeof(buf);
+			n = pread(fd, buf, n, ctx->mark);
+			if(n <= 0){
+				break;
+			}
+			if(ctx->mark + n == offset && !feof(f)){
+				argo_position_start(ctx);
+				argo_position_scan(buf, n - 1, &ctx->lines_read, &ctx->chars_read);
+				ctx->mark += n - 1;
+				argo_position_last(ctx, buf[n - 1]);
+				return;
+			}
+			argo_position_start(ctx);
+			argo_position_scan(buf, n, &ctx->lines_read, &ctx->chars_read);
+			ctx->mark += n;
+		}
+	}
+	argo_position_start(ctx);
+	ctx->chars_read += offset - ctx->mark;
+	ctx->mark = offset;
+}
@@ -0,0 +1,378 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "context.h"
+#include "hash.h"
+#include "dedup.h"
+
+#define ARGO_DEDUP_INITIAL_SIZE 1024
+
+/**
+ * @brief  Make the current parser of a context deduplicate what it reads.
+ * @details  The table of interned content starts small and grows as the
+ * values are read; the flags of the slots are allocated for the whole
+ * arena, one byte each.  Enabling deduplication twice has no effect.
+ *
+ * @param ctx  The context to deduplicate values in.
+ * @return  0 if successful, -1 if memory could not be allocated.
+ */
+int argo_dedup_enable(ARGO_CONTEXT *ctx){
+	ARGO_DEDUP *d;
+
+	if(ctx->dedup != NULL){
+		return 0;
+	}
+	d = calloc(1, sizeof(ARGO_DEDUP));
+	if(d == NULL){
+		fprintf(stderr, "Failed to allocate deduplication table\n");
+		return -1;
+	}
+	d->entries = calloc(ARGO_DEDUP_INITIAL_SIZE, sizeof(ARGO_DEDUP_ENTRY));
+	d->shared = calloc(ctx->num_values, 1);
+	if(d->entries == NULL || d->shared == NULL){
+		fprintf(stderr, "Failed to allocate deduplication table\n");
+		argo_dedup_destroy(d);
+		return -1;
+	}
+	d->size = ARGO_DEDUP_INITIAL_SIZE;
+	ctx->dedup = d;
+	return 0;
+}
+
+/**
+ * @brief  Forget everything interned, as when the values are released.
+ * @details  The flags of the slots are expected to have been cleared
+ * along with the slots themselves; the counts of what was saved are kept.
+ */
+void argo_dedup_clear(ARGO_DEDUP *d){
+	size_t i;
+
+	for(i = 0; i < d->size; i++){
+		d->entries[i].kind = 0;
+	}
+	d->used = 0;
+}
+
+void argo_dedup_destroy(ARGO_DEDUP *d){
+	if(d == NULL){
+		return;
+	}
+	free(d->entries);
+	free(d->shared);
+	free(d);
+}
+
+/*
+ * The string that an entry for a name or a string interns.
+ */
+static ARGO_STRING *argo_dedup_string(ARGO_DEDUP_ENTRY *e){
+	ARGO_VALUE *v = argo_ctx->value_storage + e->slot;
+	return e->kind == ARGO_DEDUP_NAME ? &v->name : &v->content.string;
+}
+
+static int argo_dedup_same_string(ARGO_STRING *a, ARGO_STRING *b){
+	int i;
+
+	if(a->length != b->length){
+		return 0;
+	}
+	for(i = 0; i < a->length; i++){
+		if(a->content[i] != b->content[i]){
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static int argo_dedup_same_number(ARGO_NUMBER *a, ARGO_NUMBER *b){
+	union { double d; uint64_t u; } x, y;
+
+	x.d = a->float_value;
+	y.d = b->float_value;
+	return a->valid_string == b->valid_string && a->valid_int == b->valid_int
+		&& a->valid_float == b->valid_float && a->int_value == b->int_value
+		&& x.u == y.u && argo_dedup_same_string(&a->string_value, &b->string_value);
+}
+
+/*
+ * The words that an element or member contributes to the hash of its list,
+ * and which must all be the same for two lists to be equal.  Whatever is
+ * inside the element or member has already been interned, so it is
+ * represented by the address of its content.
+ */
+static void argo_dedup_words(ARGO_VALUE *v, uint64_t *words){
+	words[0] = v->type;
+	words[1] = (uintptr_t) v->name.content;
+	words[2] = v->name.length;
+	switch(v->type){
+	case ARGO_BASIC_TYPE:
+		words[3] = v->content.basic;
+		break;
+	case ARGO_NUMBER_TYPE:
+		words[3] = (uintptr_t) v->content.number.string_value.content;
+		break;
+	case ARGO_STRING_TYPE:
+		words[3] = (uintptr_t) v->content.string.content;
+		break;
+	case ARGO_ARRAY_TYPE:
+		words[3] = (uintptr_t) v->content.array.element_list;
+		break;
+	case ARGO_OBJECT_TYPE:
+		words[3] = (uintptr_t) v->content.object.member_list;
+		break;
+	default:
+		words[3] = 0;
+		break;
+	}
+}
+
+static uint64_t argo_dedup_hash_list(ARGO_VALUE *head){
+	ARGO_XXH64 x;
+	ARGO_VALUE *p;
+	uint64_t words[4];
+
+	argo_xxh64_init(&x, ARGO_DEDUP_LIST);
+	for(p = head->next; p != head; p = p->next){
+		argo_dedup_words(p, words);
+		argo_xxh64_update(&x, words, sizeof(words));
+	}
+	return argo_xxh64_final(&x);
+}
+
+static int argo_dedup_same_list(ARGO_VALUE *a, ARGO_VALUE *b){
+	ARGO_VALUE *p, *q;
+	uint64_t x[4], y[4];
+	int i;
+
+	for(p = a->next, q = b->next; p != a && q != b; p = p->next, q = q->next){
+		argo_dedup_words(p, x);
+		argo_dedup_words(q, y);
+		for(i = 0; i < 4; i++){
+			if(x[i] != y[i]){
+				return 0;
+			}
+		}
+	}
+	return p == a && q == b;
+}
+
+/*
+ * The list of the array or object in a slot.
+ */
+static ARGO_VALUE *argo_dedup_list(ARGO_VALUE *v){
+	return v->type == ARGO_ARRAY_TYPE ? v->content.array.element_list : v->content.object.member_list;
+}
+
+/*
+ * Whether an entry interns the same thing as the one being looked up.
+ * Names and strings are interchangeable, as both are just characters.
+ */
+static int argo_dedup_match(ARGO_DEDUP_ENTRY *e, int kind, void *key){
+	ARGO_VALUE *v = argo_ctx->value_storage + e->slot;
+
+	switch(kind){
+	case ARGO_DEDUP_NAME:
+	case ARGO_DEDUP_STRING:
+		return (e->kind == ARGO_DEDUP_NAME || e->kind == ARGO_DEDUP_STRING)
+			&& argo_dedup_same_string(argo_dedup_string(e), key);
+	case ARGO_DEDUP_NUMBER:
+		return e->kind == kind && argo_dedup_same_number(&v->content.number, key);
+	default:
+		return e->kind == kind && v->type == ((ARGO_VALUE *) key)->type
+			&& argo_dedup_same_list(argo_dedup_list(v), argo_dedup_list(key));
+	}
+}
+
+static int argo_dedup_grow(ARGO_DEDUP *d){
+	ARGO_DEDUP_ENTRY *entries = calloc(d->size * 2, sizeof(ARGO_DEDUP_ENTRY));
+	size_t mask = d->size * 2 - 1;
+	size_t i, j;
+
+	if(entries == NULL){
+		fprintf(stderr, "Failed to grow deduplication table\n");
+		return -1;
+	}
+	for(i = 0; i < d->size; i++){
+		if(d->entries[i].kind == 0){
+			continue;
+		}
+		for(j = d->entries[i].hash & mask; entries[j].kind != 0; j = (j + 1) & mask);
+		entries[j] = d->entries[i];
+	}
+	free(d->entries);
+	d->entries = entries;
+	d->size *= 2;
+	return 0;
+}
+
+/*
+ * Find the entry interning the same thing as key, or else add one for the
+ * slot given.  NULL is returned if there was none and the table could not
+ * grow.
+ */
+static ARGO_DEDUP_ENTRY *argo_dedup_intern(ARGO_DEDUP *d, uint64_t hash, int kind, void *key, int slot){
+	ARGO_DEDUP_ENTRY *e;
+	size_t mask, i;
+
+	if(2 * (d->used + 1) > d->size && argo_dedup_grow(d)){
+		return NULL;
+	}
+	mask = d->size - 1;
+	for(i = hash & mask; d->entries[i].kind != 0; i = (i + 1) & mask){
+		e = &d->entries[i];
+		if(e->hash == hash && argo_dedup_match(e, kind, key)){
+			return e;
+		}
+	}
+	e = &d->entries[i];
+	e->hash = hash;
+	e->kind = kind;
+	e->slot = slot;
+	d->used++;
+	return e;
+}
+
+/*
+ * Make the string s of the value in a slot share the content of an equal
+ * one interned before, if there is such a string.
+ */
+static int argo_dedup_share(ARGO_DEDUP *d, ARGO_STRING *s, int kind, int slot, int flag){
+	uint64_t hash;
+	ARGO_DEDUP_ENTRY *e;
+	ARGO_STRING *t;
+
+	if(s->content == NULL || (d->shared[slot] & flag)){
+		return 0;
+	}
+	hash = argo_xxh64(s->content, s->length * sizeof(ARGO_CHAR), kind == ARGO_DEDUP_NUMBER);
+	e = argo_dedup_intern(d, hash, kind, kind == ARGO_DEDUP_NUMBER
+		? (void *) &argo_ctx->value_storage[slot].content.number : (void *) s, slot);
+	if(e == NULL){
+		return -1;
+	}
+	if(e->slot == slot && e->kind == kind){
+		return 0;
+	}
+	t = kind == ARGO_DEDUP_NUMBER ? &argo_ctx->value_storage[e->slot].content.number.string_value
+		: argo_dedup_string(e);
+	d->bytes_saved += s->capacity * sizeof(ARGO_CHAR);
+	d->strings_saved++;
+	free(s->content);
+	*s = *t;
+	d->shared[slot] |= flag;
+	return 0;
+}
+
+/*
+ * Give back the slots from first on, which hold nothing but what was
+ * just found to be a copy of content interned before.
+ */
+static void argo_dedup_release(ARGO_DEDUP *d, int first){
+	ARGO_CONTEXT *ctx = argo_ctx;
+	ARGO_VALUE *v;
+	int i;
+
+	for(i = first; i < ctx->next_value; i++){
+		v = ctx->value_storage + i;
+		if(!(d->shared[i] & ARGO_SHARED_NAME)){
+			free(v->name.content);
+		}
+		if(!(d->shared[i] & ARGO_SHARED_CONTENT)){
+			if(v->type == ARGO_STRING_TYPE){
+				free(v->content.string.content);
+			}
+			else if(v->type == ARGO_NUMBER_TYPE){
+				free(v->content.number.string_value.content);
+			}
+		}
+		d->shared[i] = 0;
+		*v = (ARGO_VALUE){0};
+	}
+	d->values_saved += ctx->next_value - first;
+	d->bytes_saved += (ctx->next_value - first) * sizeof(ARGO_VALUE);
+	ctx->next_value = first;
+}
+
+/**
+ * @brief  Intern a value that has just been parsed.
+ * @details  The value must be the last one allocated from the current
+ * context, apart from those inside it, and the values inside it must have
+ * been interned already.  A string or number then shares the characters
+ * of an equal one read before, if there is any, and an array or object its
+ * list of elements or members, the slots of its own list being given back
+ * to the arena.  The names of the members of an object are interned
+ * first, as they are only set once each member has been read.
+ *
+ * @param v  The value that has just been parsed.
+ * @return  The value, or NULL if the table could not grow.
+ */
+ARGO_VALUE *argo_dedup_value(ARGO_VALUE *v){
+	ARGO_DEDUP *d = argo_ctx->dedup;
+	int slot = v - argo_ctx->value_storage;
+	ARGO_VALUE *head, *p;
+	ARGO_DEDUP_ENTRY *e;
+
+	switch(v->type){
+	case ARGO_STRING_TYPE:
+		if(argo_dedup_share(d, &v->content.string, ARGO_DEDUP_STRING, slot, ARGO_SHARED_CONTENT)){
+			return NULL;
+		}
+		break;
+	case ARGO_NUMBER_TYPE:
+		if(argo_dedup_share(d, &v->content.number.string_value, ARGO_DEDUP_NUMBER, slot, ARGO_SHARED_CONTENT)){
+			return NULL;
+		}
+		break;
+	case ARGO_ARRAY_TYPE:
+	case ARGO_OBJECT_TYPE:
+		head = argo_dedup_list(v);
+		if(v->type == ARGO_OBJECT_TYPE){
+			for(p = head->next; p != head; p = p->next){
+				if(argo_dedup_share(d, &p->name, ARGO_DEDUP_NAME, p - argo_ctx->value_storage, ARGO_SHARED_NAME)){
+					return NULL;
+				}
+			}
+		}
+		e = argo_dedup_intern(d, argo_dedup_hash_list(head), ARGO_DEDUP_LIST, v, slot);
+		if(e == NULL){
+			return NULL;
+		}
+		if(e->slot != slot){
+			argo_dedup_release(d, slot + 1);
+			if(v->type == ARGO_ARRAY_TYPE){
+				v->content.array.element_list = argo_dedup_list(argo_ctx->value_storage + e->slot);
+			}
+			else{
+				v->content.object.member_list = argo_dedup_list(argo_ctx->value_storage + e->slot);
+			}
+		}
+		break;
+	default:
+		break;
+	}
+	return v;
+}
+
+/**
+ * @brief  Output what deduplication has saved in a context, on one line.
+ *
+ * @param ctx  The context whose values were deduplicated.
+ * @param out  The stream to which the line is written.
+ * @return  0 if successful, -1 if the context does not deduplicate.
+ */
+int argo_dedup_report(ARGO_CONTEXT *ctx, FILE *out){
+	ARGO_DEDUP *d = ctx->dedup;
+	long total;
+
+	if(d == NULL){
+		return -1;
+	}
+	total = ctx->next_value + d->values_saved;
+	fprintf(out, "Dedup: %d of %ld value slots kept (%ld shared), %ld strings shared, %ld bytes saved\n",
+		ctx->next_value, total, d->values_saved, d->strings_saved, d->bytes_saved);
+	return 0;
+}
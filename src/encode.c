@@ -0,0 +1,986 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "utils.h"
+#include "context.h"
+#include "options.h"
+#include "encode.h"
+
+#define ARGO_ENCODE_CHUNK 1024
+
+/*
+ * Write out an encoded item.  Most items are a few bytes long, for which
+ * the locking done by fwrite would cost more than the copying.
+ */
+static int argo_encode_out(unsigned char *buf, size_t n, FILE *f){
+	size_t i;
+
+	if(n > 16){
+		if(fwrite(buf, 1, n, f) != n){
+			fprintf(stderr, "Error EOF\n");
+			return -1;
+		}
+		return 0;
+	}
+	for(i = 0; i < n; i++){
+		if(putc_unlocked(buf[i], f) == EOF){
+			fprintf(stderr, "Error EOF\n");
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Store the n low bytes of x at out, most significant first.
+ */
+static int argo_encode_be(unsigned char *out, uint64_t x, int n){
+	int i;
+	for(i = n - 1; i >= 0; i--){
+		out[i] = x & 0xFF;
+		x >>= 8;
+	}
+	return n;
+}
+
+/*
+ * Find the narrowest IEEE 754 format that holds a number exactly:
+ * 2 for half precision (stored in *half), 4 for single precision
+ * (stored in *single), or 8 for double precision.
+ */
+static int argo_encode_float_width(double d, uint16_t *half, float *single){
+	union { float f; uint32_t u; } b;
+	uint32_t sign, mant;
+	int exp, shift;
+
+	b.f = (float) d;
+	if((double) b.f != d){
+		return 8;
+	}
+	*single = b.f;
+	sign = (b.u >> 16) & 0x8000;
+	exp = (int) ((b.u >> 23) & 0xFF) - 127;
+	mant = b.u & 0x7FFFFF;
+	if((b.u & 0x7FFFFFFF) == 0){
+		*half = sign;
+		return 2;
+	}
+	if(exp >= -14 && exp <= 15){
+		// normal in half precision, if the low mantissa bits are not needed
+		if(mant & 0x1FFF){
+			return 4;
+		}
+		*half = sign | ((exp + 15) << 10) | (mant >> 13);
+		return 2;
+	}
+	if(exp >= -24 && exp < -14){
+		// subnormal in half precision: a multiple of 2^-24
+		shift = -(exp + 1);
+		mant |= 0x800000;
+		if(mant & ((1u << shift) - 1)){
+			return 4;
+		}
+		*half = sign | (mant >> shift);
+		return 2;
+	}
+	return 4;
+}
+
+/*
+ * Encode a code point in UTF-8.  Returns the length of the encoding, at
+ * most four bytes; the code point must be one that UTF-8 can represent.
+ */
+static int argo_encode_char(ARGO_CHAR c, unsigned char *out){
+	if(c < 0x80){
+		out[0] = c;
+		return 1;
+	}
+	if(c < 0x800){
+		out[0] = 0xC0 | (c >> 6);
+		out[1] = 0x80 | (c & 0x3F);
+		return 2;
+	}
+	if(c < 0x10000){
+		out[0] = 0xE0 | (c >> 12);
+		out[1] = 0x80 | ((c >> 6) & 0x3F);
+		out[2] = 0x80 | (c & 0x3F);
+		return 3;
+	}
+	out[0] = 0xF0 | (c >> 18);
+	out[1] = 0x80 | ((c >> 12) & 0x3F);
+	out[2] = 0x80 | ((c >> 6) & 0x3F);
+	out[3] = 0x80 | (c & 0x3F);
+	return 4;
+}
+
+/*
+ * Number of bytes of the UTF-8 encoding of a string, which both formats
+ * need before the string itself.  Fails on a character that UTF-8 cannot
+ * represent, such as a lone surrogate, rather than change the text.
+ */
+static int argo_encode_text_length(ARGO_STRING *s, size_t *length){
+	unsigned char tmp[4];
+	size_t n = 0;
+	size_t i;
+	ARGO_CHAR c;
+
+	for(i = 0; i < s->length; i++){
+		c = s->content[i];
+		if(argo_is_high_surrogate(c) || argo_is_low_surrogate(c) || c > 0x10FFFF){
+			fprintf(stderr, "Character (0x%x) cannot be encoded in UTF-8\n", c);
+			return -1;
+		}
+		n += argo_encode_char(c, tmp);
+	}
+	*length = n;
+	return 0;
+}
+
+static int argo_encode_text(ARGO_STRING *s, FILE *f){
+	unsigned char buf[ARGO_ENCODE_CHUNK + 4];
+	size_t used = 0;
+	size_t i;
+
+	for(i = 0; i < s->length; i++){
+		used += argo_encode_char(s->content[i], buf + used);
+		if(used >= ARGO_ENCODE_CHUNK){
+			if(argo_encode_out(buf, used, f)){
+				return -1;
+			}
+			used = 0;
+		}
+	}
+	return argo_encode_out(buf, used, f);
+}
+
+/*
+ * Number of elements or members in the list with the given sentinel.
+ */
+static size_t argo_encode_count(ARGO_VALUE *head){
+	ARGO_VALUE *list_ptr;
+	size_t n = 0;
+
+	for(list_ptr = head->next; list_ptr != head; list_ptr = list_ptr->next){
+		n++;
+	}
+	return n;
+}
+
+/*
+ * Write the initial bytes of a CBOR data item: its major type and its
+ * argument, in the fewest bytes that hold it.
+ */
+static int argo_cbor_head(unsigned char major, uint64_t n, FILE *f){
+	unsigned char buf[9];
+	int len;
+
+	if(n < 24){
+		buf[0] = major | n;
+		len = 1;
+	}
+	else if(n <= 0xFF){
+		buf[0] = major | 24;
+		len = 1 + argo_encode_be(buf + 1, n, 1);
+	}
+	else if(n <= 0xFFFF){
+		buf[0] = major | 25;
+		len = 1 + argo_encode_be(buf + 1, n, 2);
+	}
+	else if(n <= 0xFFFFFFFF){
+		buf[0] = major | 26;
+		len = 1 + argo_encode_be(buf + 1, n, 4);
+	}
+	else{
+		buf[0] = major | 27;
+		len = 1 + argo_encode_be(buf + 1, n, 8);
+	}
+	return argo_encode_out(buf, len, f);
+}
+
+static int argo_cbor_text(ARGO_STRING *s, FILE *f){
+	size_t length;
+
+	if(argo_encode_text_length(s, &length) || argo_cbor_head(ARGO_CBOR_TEXT, length, f)){
+		return -1;
+	}
+	return argo_encode_text(s, f);
+}
+
+static int argo_cbor_number(ARGO_NUMBER *n, FILE *f){
+	unsigned char buf[9];
+	union { double d; uint64_t u; } b;
+	uint16_t half;
+	union { float f; uint32_t u; } single;
+
+	if(n->valid_int){
+		if(n->int_value >= 0){
+			return argo_cbor_head(ARGO_CBOR_UINT, n->int_value, f);
+		}
+		// -1 - n, computed so as not to overflow for the smallest long
+		return argo_cbor_head(ARGO_CBOR_NEGINT, -(n->int_value + 1), f);
+	}
+	if(!n->valid_float){
+		fprintf(stderr, "Invalid argument(s) for write number\n");
+		return -1;
+	}
+	switch(argo_encode_float_width(n->float_value, &half, &single.f)){
+	case 2:
+		buf[0] = ARGO_CBOR_FLOAT16;
+		return argo_encode_out(buf, 1 + argo_encode_be(buf + 1, half, 2), f);
+	case 4:
+		buf[0] = ARGO_CBOR_FLOAT32;
+		return argo_encode_out(buf, 1 + argo_encode_be(buf + 1, single.u, 4), f);
+	default:
+		b.d = n->float_value;
+		buf[0] = ARGO_CBOR_FLOAT64;
+		return argo_encode_out(buf, 1 + argo_encode_be(buf + 1, b.u, 8), f);
+	}
+}
+
+/**
+ * @brief  Write a value, and everything inside it, in CBOR (RFC 8949).
+ * @details  Arrays and objects are written with definite lengths, and
+ * every item in its preferred serialization, as described in encode.h.
+ * Numbers with a valid integer representation are written as integers,
+ * and others as floating-point numbers.
+ *
+ * @param v  The value to write.
+ * @param f  Output stream.
+ * @return  Zero if the operation is completely successful,
+ * nonzero if there is any error.
+ */
+int argo_write_cbor(ARGO_VALUE *v, FILE *f){
+	ARGO_VALUE *head, *list_ptr;
+	unsigned char b;
+
+	if(v == NULL || f == NULL){
+		fprintf(stderr, "Invalid argument(s) for write cbor\n");
+		return -1;
+	}
+	switch(v->type){
+	case ARGO_BASIC_TYPE:
+		b = v->content.basic == ARGO_TRUE ? ARGO_CBOR_TRUE
+		  : v->content.basic == ARGO_FALSE ? ARGO_CBOR_FALSE : ARGO_CBOR_NULL;
+		return argo_encode_out(&b, 1, f);
+	case ARGO_NUMBER_TYPE:
+		return argo_cbor_number(&v->content.number, f);
+	case ARGO_STRING_TYPE:
+		return argo_cbor_text(&v->content.string, f);
+	case ARGO_ARRAY_TYPE:
+		head = v->content.array.element_list;
+		if(argo_cbor_head(ARGO_CBOR_ARRAY, argo_encode_count(head), f)){
+			return -1;
+		}
+		for(list_ptr = head->next; list_ptr != head; list_ptr = list_ptr->next){
+			if(argo_write_cbor(list_ptr, f)){
+				return -1;
+			}
+		}
+		return 0;
+	case ARGO_OBJECT_TYPE:
+		head = v->content.object.member_list;
+		if(argo_cbor_head(ARGO_CBOR_MAP, argo_encode_count(head), f)){
+			return -1;
+		}
+		for(list_ptr = head->next; list_ptr != head; list_ptr = list_ptr->next){
+			if(argo_cbor_text(&list_ptr->name, f) || argo_write_cbor(list_ptr, f)){
+				return -1;
+			}
+		}
+		return 0;
+	default:
+		fprintf(stderr, "Invalid value type (%d) in write cbor\n", v->type);
+		return -1;
+	}
+}
+
+/*
+ * Write the format byte and length of a MessagePack string, array or map:
+ * the fix format if n is below fix_limit, else the narrowest of the
+ * 8-bit (if the type has one), 16-bit and 32-bit formats.
+ */
+static int argo_msgpack_head(size_t n, unsigned char fix, size_t fix_limit, unsigned char code8,
+                             unsigned char code16, unsigned char code32, FILE *f){
+	unsigned char buf[5];
+	int len;
+
+	if(n < fix_limit){
+		buf[0] = fix | n;
+		len = 1;
+	}
+	else if(code8 && n <= 0xFF){
+		buf[0] = code8;
+		len = 1 + argo_encode_be(buf + 1, n, 1);
+	}
+	else if(n <= 0xFFFF){
+		buf[0] = code16;
+		len = 1 + argo_encode_be(buf + 1, n, 2);
+	}
+	else if(n <= 0xFFFFFFFF){
+		buf[0] = code32;
+		len = 1 + argo_encode_be(buf + 1, n, 4);
+	}
+	else{
+		fprintf(stderr, "Too long for MessagePack (%lu)\n", (unsigned long) n);
+		return -1;
+	}
+	return argo_encode_out(buf, len, f);
+}
+
+static int argo_msgpack_text(ARGO_STRING *s, FILE *f){
+	size_t length;
+
+	if(argo_encode_text_length(s, &length)
+	   || argo_msgpack_head(length, ARGO_MSGPACK_FIXSTR, 32, ARGO_MSGPACK_STR8,
+	                        ARGO_MSGPACK_STR16, ARGO_MSGPACK_STR32, f)){
+		return -1;
+	}
+	return argo_encode_text(s, f);
+}
+
+static int argo_msgpack_number(ARGO_NUMBER *n, FILE *f){
+	unsigned char buf[9];
+	union { double d; uint64_t u; } b;
+	uint16_t half;
+	union { float f; uint32_t u; } single;
+	long iv = n->int_value;
+	int len;
+
+	if(n->valid_int){
+		if(iv >= 0){
+			if(iv < 0x80){
+				buf[0] = iv;
+				len = 1;
+			}
+			else if(iv <= 0xFF){
+				buf[0] = ARGO_MSGPACK_UINT8;
+				len = 1 + argo_encode_be(buf + 1, iv, 1);
+			}
+			else if(iv <= 0xFFFF){
+				buf[0] = ARGO_MSGPACK_UINT16;
+				len = 1 + argo_encode_be(buf + 1, iv, 2);
+			}
+			else if(iv <= 0xFFFFFFFF){
+				buf[0] = ARGO_MSGPACK_UINT32;
+				len = 1 + argo_encode_be(buf + 1, iv, 4);
+			}
+			else{
+				buf[0] = ARGO_MSGPACK_UINT64;
+				len = 1 + argo_encode_be(buf + 1, iv, 8);
+			}
+		}
+		else if(iv >= -32){
+			// negative fixint
+			buf[0] = iv & 0xFF;
+			len = 1;
+		}
+		else if(iv >= INT8_MIN){
+			buf[0] = ARGO_MSGPACK_INT8;
+			len = 1 + argo_encode_be(buf + 1, iv, 1);
+		}
+		else if(iv >= INT16_MIN){
+			buf[0] = ARGO_MSGPACK_INT16;
+			len = 1 + argo_encode_be(buf + 1, iv, 2);
+		}
+		else if(iv >= INT32_MIN){
+			buf[0] = ARGO_MSGPACK_INT32;
+			len = 1 + argo_encode_be(buf + 1, iv, 4);
+		}
+		else{
+			buf[0] = ARGO_MSGPACK_INT64;
+			len = 1 + argo_encode_be(buf + 1, iv, 8);
+		}
+		return argo_encode_out(buf, len, f);
+	}
+	if(!n->valid_float){
+		fprintf(stderr, "Invalid argument(s) for write number\n");
+		return -1;
+	}
+	// MessagePack has no half precision
+	if(argo_encode_float_width(n->float_value, &half, &single.f) < 8){
+		buf[0] = ARGO_MSGPACK_FLOAT32;
+		return argo_encode_out(buf, 1 + argo_encode_be(buf + 1, single.u, 4), f);
+	}
+	b.d = n->float_value;
+	buf[0] = ARGO_MSGPACK_FLOAT64;
+	return argo_encode_out(buf, 1 + argo_encode_be(buf + 1, b.u, 8), f);
+}
+
+/**
+ * @brief  Write a value, and everything inside it, in MessagePack.
+ * @details  Every item is written in its shortest format, as described
+ * in encode.h.  Numbers with a valid integer representation are written
+ * as integers, and others as floating-point numbers.
+ *
+ * @param v  The value to write.
+ * @param f  Output stream.
+ * @return  Zero if the operation is completely successful,
+ * nonzero if there is any error.
+ */
+int argo_write_msgpack(ARGO_VALUE *v, FILE *f){
+	ARGO_VALUE *head, *list_ptr;
+	unsigned char b;
+
+	if(v == NULL || f == NULL){
+		fprintf(stderr, "Invalid argument(s) for write msgpack\n");
+		return -1;
+	}
+	switch(v->type){
+	case ARGO_BASIC_TYPE:
+		b = v->content.basic == ARGO_TRUE ? ARGO_MSGPACK_TRUE
+		  : v->content.basic == ARGO_FALSE ? ARGO_MSGPACK_FALSE : ARGO_MSGPACK_NIL;
+		return argo_encode_out(&b, 1, f);
+	case ARGO_NUMBER_TYPE:
+		return argo_msgpack_number(&v->content.number, f);
+	case ARGO_STRING_TYPE:
+		return argo_msgpack_text(&v->content.string, f);
+	case ARGO_ARRAY_TYPE:
+		head = v->content.array.element_list;
+		if(argo_msgpack_head(argo_encode_count(head), ARGO_MSGPACK_FIXARRAY, 16, 0,
+		                     ARGO_MSGPACK_ARRAY16, ARGO_MSGPACK_ARRAY32, f)){
+			return -1;
+		}
+		for(list_ptr = head->next; list_ptr != head; list_ptr = list_ptr->next){
+			if(argo_write_msgpack(list_ptr, f)){
+				return -1;
+			}
+		}
+		return 0;
+	case ARGO_OBJECT_TYPE:
+		head = v->content.object.member_list;
+		if(argo_msgpack_head(argo_encode_count(head), ARGO_MSGPACK_FIXMAP, 16, 0,
+		                     ARGO_MSGPACK_MAP16, ARGO_MSGPACK_MAP32, f)){
+			return -1;
+		}
+		for(list_ptr = head->next; list_ptr != head; list_ptr = list_ptr->next){
+			if(argo_msgpack_text(&list_ptr->name, f) || argo_write_msgpack(list_ptr, f)){
+				return -1;
+			}
+		}
+		return 0;
+	default:
+		fprintf(stderr, "Invalid value type (%d) in write msgpack\n", v->type);
+		return -1;
+	}
+}
+
+/*
+ * State of the decoding of a CBOR or MessagePack item from a stream.
+ */
+typedef struct argo_decoder {
+	FILE *f;
+	long offset;                       // Bytes read so far, for error messages.
+	int utf8;                          // Nonzero in the -u mode.
+} ARGO_DECODER;
+
+static int argo_decode_byte(ARGO_DECODER *d){
+	int c = getc_unlocked(d->f);
+	if(c == EOF){
+		fprintf(stderr, "[%ld] Unexpected end of input\n", d->offset);
+		return -1;
+	}
+	d->offset++;
+	return c;
+}
+
+/*
+ * Read an n-byte big-endian unsigned integer.
+ */
+static int argo_decode_be(ARGO_DECODER *d, int n, uint64_t *x){
+	int c;
+
+	*x = 0;
+	while(n-- > 0){
+		c = argo_decode_byte(d);
+		if(c < 0){
+			return -1;
+		}
+		*x = (*x << 8) | c;
+	}
+	return 0;
+}
+
+/*
+ * Append len bytes of UTF-8 text to a string, keeping them as raw bytes,
+ * as argo_read_string does, except in the -u mode, where each sequence
+ * is decoded into a single character.
+ */
+static int argo_decode_text(ARGO_DECODER *d, ARGO_STRING *s, uint64_t len){
+	ARGO_UTF8 u;
+	int c, k;
+
+	while(len-- > 0){
+		c = argo_decode_byte(d);
+		if(c < 0){
+			return -1;
+		}
+		if(d->utf8 && c >= 0x80){
+			u.left = 0;
+			while((k = argo_utf8_step(&u, c)) == 0){
+				if(len == 0){
+					k = -1;
+					break;
+				}
+				len--;
+				c = argo_decode_byte(d);
+				if(c < 0){
+					return -1;
+				}
+			}
+			if(k < 0){
+				fprintf(stderr, "[%ld] Invalid UTF-8 (%d) in string\n", d->offset, c);
+				return -1;
+			}
+			c = u.code;
+		}
+		if(argo_append_char(s, c)){
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Fill in a number from an integer, with all three representations,
+ * as argo_read_number would have for its decimal text.
+ */
+static int argo_decode_integer(ARGO_NUMBER *n, long value){
+	char digits[24];
+	unsigned long mag = value < 0 ? -(unsigned long) value : (unsigned long) value;
+	int i = sizeof(digits);
+
+	do{
+		digits[--i] = ARGO_DIGIT0 + mag % 10;
+		mag /= 10;
+	} while(mag);
+	if(value < 0){
+		digits[--i] = ARGO_MINUS;
+	}
+	for(; i < sizeof(digits); i++){
+		if(argo_append_char(&n->string_value, digits[i])){
+			return -1;
+		}
+	}
+	n->int_value = value;
+	n->float_value = value;
+	n->valid_string = argo_number_text_kind(&n->string_value, value < 0, 0);
+	n->valid_int = 1;
+	n->valid_float = 1;
+	return 0;
+}
+
+/*
+ * Fill in a number from a floating-point value, which has no text.
+ * Infinities and NaNs cannot be written in JSON.
+ */
+static int argo_decode_float(ARGO_DECODER *d, ARGO_NUMBER *n, double x){
+	if(x != x || x - x != 0){
+		fprintf(stderr, "[%ld] Number cannot be represented in JSON\n", d->offset);
+		return -1;
+	}
+	n->float_value = x;
+	n->valid_string = 0;
+	n->valid_int = 0;
+	n->valid_float = 1;
+	return 0;
+}
+
+/*
+ * Decode a single or double precision number from its bits.
+ */
+static double argo_decode_single(uint64_t bits){
+	union { float f; uint32_t u; } b;
+	b.u = bits;
+	return b.f;
+}
+
+static double argo_decode_double(uint64_t bits){
+	union { double d; uint64_t u; } b;
+	b.u = bits;
+	return b.d;
+}
+
+/*
+ * Decode a half precision number, by widening it to single precision.
+ */
+static double argo_decode_half(uint64_t bits){
+	uint32_t sign = (bits & 0x8000) << 16;
+	uint32_t exp = (bits >> 10) & 0x1F;
+	uint32_t mant = bits & 0x3FF;
+	double x;
+
+	if(exp == 0){
+		// subnormal: a multiple of 2^-24
+		x = mant / 16777216.0;
+		return sign ? -x : x;
+	}
+	if(exp == 0x1F){
+		return argo_decode_single(sign | 0x7F800000 | (mant << 13));
+	}
+	return argo_decode_single(sign | ((exp - 15 + 127) << 23) | (mant << 13));
+}
+
+/*
+ * Link a value at the end of the list with the given sentinel.
+ */
+static void argo_decode_link(ARGO_VALUE *head, ARGO_VALUE *v){
+	v->prev = head->prev;
+	v->next = head;
+	head->prev->next = v;
+	head->prev = v;
+}
+
+/*
+ * Read the argument of a CBOR data item, given the low five bits of its
+ * initial byte.  Returns 1 for the indefinite length, 0 otherwise, and -1
+ * on error.
+ */
+static int argo_cbor_argument(ARGO_DECODER *d, int ai, uint64_t *arg){
+	if(ai < 24){
+		*arg = ai;
+		return 0;
+	}
+	if(ai <= 27){
+		return argo_decode_be(d, 1 << (ai - 24), arg);
+	}
+	if(ai == 31){
+		return 1;
+	}
+	fprintf(stderr, "[%ld] Invalid CBOR argument (%d)\n", d->offset, ai);
+	return -1;
+}
+
+/*
+ * Read a CBOR text string, given its initial byte, into s.
+ * An indefinite-length string is a sequence of definite-length chunks.
+ */
+static int argo_cbor_read_text(ARGO_DECODER *d, int c, ARGO_STRING *s){
+	uint64_t len;
+	int ind;
+
+	if((c >> 5) != (ARGO_CBOR_TEXT >> 5)){
+		fprintf(stderr, "[%ld] Expect CBOR text string but seen (%d)\n", d->offset, c);
+		return -1;
+	}
+	ind = argo_cbor_argument(d, c & 0x1F, &len);
+	if(ind <= 0){
+		return ind < 0 ? -1 : argo_decode_text(d, s, len);
+	}
+	while((c = argo_decode_byte(d)) != 0xFF){
+		if(c < 0){
+			return -1;
+		}
+		if((c >> 5) != (ARGO_CBOR_TEXT >> 5) || argo_cbor_argument(d, c & 0x1F, &len) != 0){
+			fprintf(stderr, "[%ld] Invalid chunk (%d) in CBOR text string\n", d->offset, c);
+			return -1;
+		}
+		if(argo_decode_text(d, s, len)){
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Decode the CBOR data item with initial byte c into a new value.
+ * Tags are skipped, as JSON has no use for them.
+ */
+static ARGO_VALUE *argo_decode_cbor(ARGO_DECODER *d, int c){
+	ARGO_VALUE *v, *head, *item;
+	ARGO_STRING name;
+	uint64_t arg, i;
+	int major, ind;
+
+	while((c >> 5) == 6){
+		if(argo_cbor_argument(d, c & 0x1F, &arg) != 0 || (c = argo_decode_byte(d)) < 0){
+			return NULL;
+		}
+	}
+	major = c >> 5;
+	v = argo_alloc_value();
+	if(v == NULL){
+		return NULL;
+	}
+
+	switch(major){
+	case ARGO_CBOR_UINT >> 5:
+	case ARGO_CBOR_NEGINT >> 5:
+		if(argo_cbor_argument(d, c & 0x1F, &arg) != 0){
+			return NULL;
+		}
+		v->type = ARGO_NUMBER_TYPE;
+		if(arg > LONG_MAX){
+			// too large for a long, so only a floating-point value
+			if(argo_decode_float(d, &v->content.number, major ? -1.0 - (double) arg : (double) arg)){
+				return NULL;
+			}
+		}
+		else if(argo_decode_integer(&v->content.number, major ? -1 - (long) arg : (long) arg)){
+			return NULL;
+		}
+		return v;
+	case ARGO_CBOR_TEXT >> 5:
+		v->type = ARGO_STRING_TYPE;
+		return argo_cbor_read_text(d, c, &v->content.string) ? NULL : v;
+	case ARGO_CBOR_ARRAY >> 5:
+	case ARGO_CBOR_MAP >> 5:
+		ind = argo_cbor_argument(d, c & 0x1F, &arg);
+		head = argo_alloc_value();
+		if(ind < 0 || head == NULL){
+			return NULL;
+		}
+		head->next = head;
+		head->prev = head;
+		if(major == ARGO_CBOR_ARRAY >> 5){
+			v->type = ARGO_ARRAY_TYPE;
+			v->content.array.element_list = head;
+		}
+		else{
+			v->type = ARGO_OBJECT_TYPE;
+			v->content.object.member_list = head;
+		}
+		for(i = 0; ind || i < arg; i++){
+			c = argo_decode_byte(d);
+			if(c < 0){
+				return NULL;
+			}
+			if(ind && c == 0xFF){
+				break;
+			}
+			name = (ARGO_STRING){0};
+			if(v->type == ARGO_OBJECT_TYPE){
+				if(argo_cbor_read_text(d, c, &name) || (c = argo_decode_byte(d)) < 0){
+					free(name.content);
+					return NULL;
+				}
+			}
+			item = argo_decode_cbor(d, c);
+			if(item == NULL){
+				free(name.content);
+				return NULL;
+			}
+			item->name = name;
+			argo_decode_link(head, item);
+		}
+		return v;
+	case 7:
+		switch(c){
+		case ARGO_CBOR_FALSE:
+			v->type = ARGO_BASIC_TYPE;
+			v->content.basic = ARGO_FALSE;
+			return v;
+		case ARGO_CBOR_TRUE:
+			v->type = ARGO_BASIC_TYPE;
+			v->content.basic = ARGO_TRUE;
+			return v;
+		case ARGO_CBOR_NULL:
+		case ARGO_CBOR_NULL + 1:
+			// undefined has no counterpart in JSON but null
+			v->type = ARGO_BASIC_TYPE;
+			v->content.basic = ARGO_NULL;
+			return v;
+		case ARGO_CBOR_FLOAT16:
+		case ARGO_CBOR_FLOAT32:
+		case ARGO_CBOR_FLOAT64:
+			if(argo_cbor_argument(d, c & 0x1F, &arg)){
+				return NULL;
+			}
+			v->type = ARGO_NUMBER_TYPE;
+			if(argo_decode_float(d, &v->content.number,
+			                     c == ARGO_CBOR_FLOAT16 ? argo_decode_half(arg)
+			                     : c == ARGO_CBOR_FLOAT32 ? argo_decode_single(arg)
+			                     : argo_decode_double(arg))){
+				return NULL;
+			}
+			return v;
+		}
+		break;
+	}
+	fprintf(stderr, "[%ld] Unsupported CBOR item (%d)\n", d->offset, c);
+	return NULL;
+}
+
+/**
+ * @brief  Read a value in CBOR (RFC 8949) from an input stream.
+ * @details  The value is built in the current context, as by
+ * argo_read_value, and strings are read as described in encode.h.
+ * Arrays, maps and text strings may have definite or indefinite lengths,
+ * and tags are ignored.  Map keys must be text strings.  Byte strings,
+ * simple values other than false, true, null and undefined (read as null),
+ * and floating-point infinities and NaNs have no counterpart in JSON,
+ * and are rejected.
+ *
+ * @param f  Input stream from which CBOR is to be read.
+ * @return  A valid pointer if the operation is completely successful,
+ * NULL if there is any error.
+ */
+ARGO_VALUE *argo_read_cbor(FILE *f){
+	ARGO_DECODER d = {f, 0, global_options & UTF8_OPTION};
+	int c = argo_decode_byte(&d);
+
+	if(c < 0){
+		return NULL;
+	}
+	return argo_decode_cbor(&d, c);
+}
+
+/*
+ * Read the length of a MessagePack string with format byte c.
+ * Returns -1 if c is not the format of a string.
+ */
+static int argo_msgpack_str_length(ARGO_DECODER *d, int c, uint64_t *len){
+	if(c >= ARGO_MSGPACK_FIXSTR && c < ARGO_MSGPACK_FIXSTR + 32){
+		*len = c & 0x1F;
+		return 0;
+	}
+	if(c >= ARGO_MSGPACK_STR8 && c <= ARGO_MSGPACK_STR32){
+		return argo_decode_be(d, 1 << (c - ARGO_MSGPACK_STR8), len);
+	}
+	fprintf(stderr, "[%ld] Expect MessagePack string but seen (%d)\n", d->offset, c);
+	return -1;
+}
+
+/*
+ * Decode the MessagePack object with format byte c into a new value.
+ */
+static ARGO_VALUE *argo_decode_msgpack(ARGO_DECODER *d, int c){
+	ARGO_VALUE *v, *head, *item;
+	ARGO_STRING name;
+	uint64_t arg, i;
+
+	v = argo_alloc_value();
+	if(v == NULL){
+		return NULL;
+	}
+
+	// integers
+	if(c < 0x80 || c >= 0xE0){
+		v->type = ARGO_NUMBER_TYPE;
+		return argo_decode_integer(&v->content.number, c < 0x80 ? c : c - 0x100) ? NULL : v;
+	}
+	if(c >= ARGO_MSGPACK_UINT8 && c <= ARGO_MSGPACK_INT64){
+		int n = 1 << ((c - ARGO_MSGPACK_UINT8) & 3);
+		if(argo_decode_be(d, n, &arg)){
+			return NULL;
+		}
+		v->type = ARGO_NUMBER_TYPE;
+		if(c >= ARGO_MSGPACK_INT8){
+			// sign-extend from n bytes
+			if(n < 8 && (arg >> (8 * n - 1))){
+				arg |= ~(uint64_t) 0 << (8 * n);
+			}
+			return argo_decode_integer(&v->content.number, (long) arg) ? NULL : v;
+		}
+		if(arg > LONG_MAX){
+			return argo_decode_float(d, &v->content.number, (double) arg) ? NULL : v;
+		}
+		return argo_decode_integer(&v->content.number, (long) arg) ? NULL : v;
+	}
+
+	switch(c){
+	case ARGO_MSGPACK_NIL:
+		v->type = ARGO_BASIC_TYPE;
+		v->content.basic = ARGO_NULL;
+		return v;
+	case ARGO_MSGPACK_FALSE:
+		v->type = ARGO_BASIC_TYPE;
+		v->content.basic = ARGO_FALSE;
+		return v;
+	case ARGO_MSGPACK_TRUE:
+		v->type = ARGO_BASIC_TYPE;
+		v->content.basic = ARGO_TRUE;
+		return v;
+	case ARGO_MSGPACK_FLOAT32:
+	case ARGO_MSGPACK_FLOAT64:
+		if(argo_decode_be(d, c == ARGO_MSGPACK_FLOAT32 ? 4 : 8, &arg)){
+			return NULL;
+		}
+		v->type = ARGO_NUMBER_TYPE;
+		if(argo_decode_float(d, &v->content.number, c == ARGO_MSGPACK_FLOAT32 ? argo_decode_single(arg)
+		                                                                      : argo_decode_double(arg))){
+			return NULL;
+		}
+		return v;
+	}
+
+	// strings
+	if((c >= ARGO_MSGPACK_FIXSTR && c < ARGO_MSGPACK_FIXSTR + 32) || (c >= ARGO_MSGPACK_STR8 && c <= ARGO_MSGPACK_STR32)){
+		if(argo_msgpack_str_length(d, c, &arg)){
+			return NULL;
+		}
+		v->type = ARGO_STRING_TYPE;
+		return argo_decode_text(d, &v->content.string, arg) ? NULL : v;
+	}
+
+	// arrays and maps
+	if(c < ARGO_MSGPACK_FIXSTR){
+		arg = c & 0x0F;
+	}
+	else if(c >= ARGO_MSGPACK_ARRAY16 && c <= ARGO_MSGPACK_MAP32){
+		if(argo_decode_be(d, (c - ARGO_MSGPACK_ARRAY16) & 1 ? 4 : 2, &arg)){
+			return NULL;
+		}
+	}
+	else{
+		fprintf(stderr, "[%ld] Unsupported MessagePack format (%d)\n", d->offset, c);
+		return NULL;
+	}
+	head = argo_alloc_value();
+	if(head == NULL){
+		return NULL;
+	}
+	head->next = head;
+	head->prev = head;
+	if(c < ARGO_MSGPACK_FIXMAP + 16 || c >= ARGO_MSGPACK_MAP16){
+		v->type = ARGO_OBJECT_TYPE;
+		v->content.object.member_list = head;
+	}
+	else{
+		v->type = ARGO_ARRAY_TYPE;
+		v->content.array.element_list = head;
+	}
+	for(i = 0; i < arg; i++){
+		name = (ARGO_STRING){0};
+		if(v->type == ARGO_OBJECT_TYPE){
+			uint64_t len;
+			if((c = argo_decode_byte(d)) < 0 || argo_msgpack_str_length(d, c, &len)
+			   || argo_decode_text(d, &name, len)){
+				free(name.content);
+				return NULL;
+			}
+		}
+		if((c = argo_decode_byte(d)) < 0 || (item = argo_decode_msgpack(d, c)) == NULL){
+			free(name.content);
+			return NULL;
+		}
+		item->name = name;
+		argo_decode_link(head, item);
+	}
+	return v;
+}
+
+/**
+ * @brief  Read a value in MessagePack from an input stream.
+ * @details  The value is built in the current context, as by
+ * argo_read_value, and strings are read as described in encode.h.
+ * Map keys must be strings.  The bin and ext families, and floating-point
+ * infinities and NaNs, have no counterpart in JSON and are rejected.
+ *
+ * @param f  Input stream from which MessagePack is to be read.
+ * @return  A valid pointer if the operation is completely successful,
+ * NULL if there is any error.
+ */
+ARGO_VALUE *argo_read_msgpack(FILE *f){
+	ARGO_DECODER d = {f, 0, global_options & UTF8_OPTION};
+	int c = argo_decode_byte(&d);
+
+	if(c < 0){
+		return NULL;
+	}
+	return argo_decode_msgpack(&d, c);
+}
@@ -0,0 +1,589 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "context.h"
+#include "options.h"
+#include "pool.h"
+#include "source.h"
+#include "uring.h"
+#include "compress.h"
+#include "files.h"
+
+/*
+ * One file to be validated or canonicalized, together with the canonical
+ * output produced for it when that goes to standard output.  The worker
+ * reads the file itself, unless it has already been loaded by io_uring.
+ */
+typedef struct argo_file_job {
+    ARGO_JOB job;                      // Must be first.
+    char *path;
+    int own_path;                      // Nonzero if path was read from a list.
+    char *output;                      // Output, if canonicalizing to standard output.
+    size_t output_length;
+    size_t input_length;               // Size of the file.
+    ARGO_SOURCE *source;               // Contents of the file, once loaded.
+    int failed;                        // Nonzero if the file could not be loaded.
+#ifdef ARGO_HAVE_URING
+    struct argo_file_job *load_next;   // Next file being loaded, in order of the names.
+    int loaded;                        // Nonzero once the file has been read or has failed.
+    int ops;                           // Requests in flight for the file.
+    int fd;                            // Descriptor, once opened.
+    struct statx stx;                  // Size, once known.
+    char *data;                        // What has been read so far,
+    size_t length;                     // how much that is,
+    size_t capacity;                   // and the size of the buffer.
+#endif
+} ARGO_FILE_JOB;
+
+typedef struct argo_files {
+    ARGO_POOL *pool;
+    FILE *out;
+    int in_flight;                     // Jobs submitted and not yet taken back.
+    long files;
+    long failed;
+    size_t bytes_read;
+    int status;                        // Nonzero once output could not be written.
+#ifdef ARGO_HAVE_URING
+    ARGO_URING *uring;                 // Loads files ahead of the workers, if available.
+    ARGO_FILE_JOB *loading;            // Oldest file being loaded,
+    ARGO_FILE_JOB *loading_tail;       // and the newest.
+    int num_loading;
+    int closing;                       // Files being closed.
+#endif
+} ARGO_FILES;
+
+/*
+ * Write the value just read from a file where its output goes: to the
+ * file with ARGO_CANON_SUFFIX appended to its name with -w, or else to the
+ * buffer of the job, followed by a newline unless pretty printing (which
+ * ends with one), so that the outputs of successive files can be told apart.
+ */
+static int argo_files_write(ARGO_FILE_JOB *fj, ARGO_VALUE *v){
+	FILE *out;
+	char *path;
+	int n;
+
+	if(global_options & CANON_FILES_OPTION){
+		n = snprintf(NULL, 0, "%s%s", fj->path, ARGO_CANON_SUFFIX);
+		path = malloc(n + 1);
+		if(path == NULL){
+			fprintf(stderr, "Failed to allocate file name\n");
+			return -1;
+		}
+		snprintf(path, n + 1, "%s%s", fj->path, ARGO_CANON_SUFFIX);
+		out = fopen(path, "w");
+		if(out == NULL){
+			fprintf(stderr, "%s: Cannot open for writing\n", path);
+			free(path);
+			return -1;
+		}
+		free(path);
+		if(argo_write_value(v, out)){
+			fclose(out);
+			return -1;
+		}
+		if(fclose(out)){
+			fprintf(stderr, "%s%s: Error writing\n", fj->path, ARGO_CANON_SUFFIX);
+			return -1;
+		}
+		return 0;
+	}
+
+	out = open_memstream(&fj->output, &fj->output_length);
+	if(out == NULL){
+		fprintf(stderr, "Failed to open output buffer\n");
+		return -1;
+	}
+	if(argo_write_value(v, out) || (!(global_options & INDENT_MASK) && fputc(ARGO_LF, out) == EOF)){
+		fclose(out);
+		free(fj->output);
+		fj->output = NULL;
+		fj->output_length = 0;
+		return -1;
+	}
+	fclose(out);
+	return 0;
+}
+
+/*
+ * Job run on a worker: parse one file into the worker's own context, which
+ * is reset afterwards so that its arena is reused for the next file.
+ * The file is read from its source, which the worker opens itself unless
+ * the file has already been loaded, and decompressed if need be.
+ */
+static int argo_files_run_file(ARGO_JOB *job){
+	ARGO_FILE_JOB *fj = (ARGO_FILE_JOB *) job;
+	ARGO_CONTEXT *ctx = argo_ctx;
+	ARGO_SOURCE *source = fj->source;
+	ARGO_VALUE *v;
+	FILE *in;
+	int status = 0;
+
+	fj->source = NULL;
+	if(fj->failed){
+		return -1;
+	}
+	if(source == NULL && (source = argo_source_path(fj->path)) == NULL){
+		return -1;
+	}
+	fj->input_length = source->size;
+	in = argo_source_stream(argo_decompress_open(source, NULL));
+	if(in == NULL){
+		return -1;
+	}
+	argo_context_input(ctx, NULL, 0, 0, 0);
+	v = argo_read_value(in);
+	if(v == NULL){
+		fprintf(stderr, "%s: Invalid document\n", fj->path);
+		status = -1;
+	}
+	else if(global_options & CANONICALIZE_OPTION){
+		status = argo_files_write(fj, v);
+	}
+	argo_context_reset(ctx);
+	fclose(in);
+	return status;
+}
+
+/*
+ * Free a job and whatever it still holds.
+ */
+static void argo_files_discard(ARGO_FILE_JOB *fj){
+	free(fj->output);
+	if(fj->source != NULL){
+		fj->source->close(fj->source);
+	}
+#ifdef ARGO_HAVE_URING
+	free(fj->data);
+#endif
+	if(fj->own_path){
+		free(fj->path);
+	}
+	free(fj);
+}
+
+/*
+ * Take back the oldest job, once it is done, and output what it produced.
+ */
+static int argo_files_take(ARGO_FILES *fs){
+	ARGO_FILE_JOB *fj = (ARGO_FILE_JOB *) argo_pool_next(fs->pool);
+
+	if(fj == NULL){
+		return -1;
+	}
+	fs->in_flight--;
+	fs->files++;
+	fs->bytes_read += fj->input_length;
+	if(fj->job.status){
+		fs->failed++;
+	}
+	else if(fj->output_length && !fs->status
+	        && fwrite(fj->output, 1, fj->output_length, fs->out) != fj->output_length){
+		fprintf(stderr, "Error EOF\n");
+		fs->status = -1;
+	}
+	argo_files_discard(fj);
+	return 0;
+}
+
+/*
+ * Hand a file to the workers, first taking back the oldest job if as many
+ * are outstanding as the pool allows, so that the calling thread never
+ * blocks while holding output that could be written.
+ */
+static int argo_files_queue(ARGO_FILES *fs, ARGO_FILE_JOB *fj){
+	if(fs->in_flight >= fs->pool->max_jobs && argo_files_take(fs)){
+		argo_files_discard(fj);
+		return -1;
+	}
+	if(argo_pool_submit(fs->pool, &fj->job)){
+		argo_files_discard(fj);
+		return -1;
+	}
+	fs->in_flight++;
+	return 0;
+}
+
+#ifdef ARGO_HAVE_URING
+
+/*
+ * What a request of the loader does, in the low bits of its user data,
+ * the rest of which is the address of the job (or zero for a close).
+ */
+#define ARGO_LOAD_OPEN 0
+#define ARGO_LOAD_STATX 1
+#define ARGO_LOAD_READ 2
+#define ARGO_LOAD_CLOSE 3
+#define ARGO_LOAD_MASK 3
+
+static struct io_uring_sqe *argo_files_sqe(ARGO_FILES *fs, ARGO_FILE_JOB *fj, int op){
+	struct io_uring_sqe *sqe;
+
+	// a full queue is made room in by handing its requests to the kernel
+	while((sqe = argo_uring_sqe(fs->uring, (uintptr_t) fj | op)) == NULL){
+		if(argo_uring_submit(fs->uring, 0)){
+			return NULL;
+		}
+	}
+	if(fj != NULL){
+		fj->ops++;
+	}
+	else{
+		fs->closing++;
+	}
+	return sqe;
+}
+
+static int argo_files_read_more(ARGO_FILES *fs, ARGO_FILE_JOB *fj){
+	struct io_uring_sqe *sqe;
+	char *next;
+
+	if(fj->length == fj->capacity){
+		fj->capacity = fj->capacity ? 2 * fj->capacity : ARGO_LOAD_BUFFER_SIZE;
+		next = realloc(fj->data, fj->capacity);
+		if(next == NULL){
+			fprintf(stderr, "Failed to allocate input buffer\n");
+			return -1;
+		}
+		fj->data = next;
+	}
+	sqe = argo_files_sqe(fs, fj, ARGO_LOAD_READ);
+	if(sqe == NULL){
+		return -1;
+	}
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = fj->fd;
+	sqe->addr = (uintptr_t) (fj->data + fj->length);
+	sqe->len = fj->capacity - fj->length;
+	sqe->off = fj->length;
+	return 0;
+}
+
+/*
+ * The file has been read, or has failed: close it without waiting, and
+ * make its contents the source of the job.
+ */
+static void argo_files_loaded(ARGO_FILES *fs, ARGO_FILE_JOB *fj){
+	struct io_uring_sqe *sqe;
+
+	if(fj->fd >= 0){
+		sqe = argo_files_sqe(fs, NULL, ARGO_LOAD_CLOSE);
+		if(sqe != NULL){
+			sqe->opcode = IORING_OP_CLOSE;
+			sqe->fd = fj->fd;
+		}
+		fj->fd = -1;
+	}
+	if(!fj->failed){
+		fj->source = argo_source_memory(fj->data, fj->length);
+		fj->failed = fj->source == NULL;
+	}
+	else{
+		free(fj->data);
+	}
+	fj->data = NULL;
+	fj->loaded = 1;
+}
+
+/*
+ * Handle the completion of a request.  A file is opened and its size
+ * looked up at the same time; it is then read into a buffer one byte
+ * larger than that, so that a single read normally gets all of it and
+ * reaching its end is seen without asking for more.
+ */
+static void argo_files_complete(ARGO_FILES *fs, struct io_uring_cqe *cqe){
+	ARGO_FILE_JOB *fj = (ARGO_FILE_JOB *) (uintptr_t) (cqe->user_data & ~(uint64_t) ARGO_LOAD_MASK);
+	int op = cqe->user_data & ARGO_LOAD_MASK;
+	int res = cqe->res;
+
+	if(fj == NULL){
+		fs->closing--;
+		return;
+	}
+	fj->ops--;
+	switch(op){
+	case ARGO_LOAD_OPEN:
+		if(res < 0){
+			fprintf(stderr, "%s: Cannot open for reading\n", fj->path);
+			fj->failed = 1;
+		}
+		else{
+			fj->fd = res;
+		}
+		break;
+	case ARGO_LOAD_STATX:
+		if(res == 0 && !fj->failed && fj->stx.stx_size + 1 > ARGO_LOAD_BUFFER_SIZE){
+			fj->capacity = fj->stx.stx_size + 1;
+		}
+		break;
+	case ARGO_LOAD_READ:
+		if(res < 0){
+			fprintf(stderr, "%s: Error reading\n", fj->path);
+			fj->failed = 1;
+		}
+		else if(res == 0){
+			argo_files_loaded(fs, fj);
+			return;
+		}
+		else{
+			fj->length += res;
+			if(fj->length < fj->capacity && fj->length == fj->stx.stx_size){
+				argo_files_loaded(fs, fj);
+				return;
+			}
+			if(argo_files_read_more(fs, fj)){
+				fj->failed = 1;
+			}
+		}
+		break;
+	}
+	if(fj->ops > 0 || fj->loaded){
+		return;
+	}
+	if(fj->failed){
+		argo_files_loaded(fs, fj);
+	}
+	else if(op != ARGO_LOAD_READ){
+		// opened and looked up: start reading
+		fj->data = malloc(fj->capacity ? fj->capacity : ARGO_LOAD_BUFFER_SIZE);
+		if(fj->data == NULL){
+			fprintf(stderr, "Failed to allocate input buffer\n");
+			fj->failed = 1;
+			argo_files_loaded(fs, fj);
+			return;
+		}
+		if(fj->capacity == 0){
+			fj->capacity = ARGO_LOAD_BUFFER_SIZE;
+		}
+		if(argo_files_read_more(fs, fj)){
+			fj->failed = 1;
+			argo_files_loaded(fs, fj);
+		}
+	}
+}
+
+/*
+ * Submit pending requests, wait for "wait" completions, handle all those
+ * available, and hand the files loaded to the workers in order of their
+ * names.
+ */
+static int argo_files_reap(ARGO_FILES *fs, unsigned wait){
+	struct io_uring_cqe *cqe;
+	ARGO_FILE_JOB *fj;
+
+	if(argo_uring_submit(fs->uring, wait)){
+		return -1;
+	}
+	while((cqe = argo_uring_cqe(fs->uring)) != NULL){
+		argo_files_complete(fs, cqe);
+		argo_uring_seen(fs->uring);
+	}
+	while(fs->loading != NULL && fs->loading->loaded){
+		fj = fs->loading;
+		fs->loading = fj->load_next;
+		if(fs->loading == NULL){
+			fs->loading_tail = NULL;
+		}
+		fs->num_loading--;
+		if(argo_files_queue(fs, fj)){
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Start loading a file with io_uring: open it and look up its size.
+ */
+static int argo_files_load(ARGO_FILES *fs, ARGO_FILE_JOB *fj){
+	struct io_uring_sqe *sqe;
+
+	while(fs->num_loading >= ARGO_LOAD_FILES){
+		if(argo_files_reap(fs, 1)){
+			argo_files_discard(fj);
+			return -1;
+		}
+	}
+	fj->fd = -1;
+	if(fs->loading_tail != NULL){
+		fs->loading_tail->load_next = fj;
+	}
+	else{
+		fs->loading = fj;
+	}
+	fs->loading_tail = fj;
+	fs->num_loading++;
+
+	sqe = argo_files_sqe(fs, fj, ARGO_LOAD_OPEN);
+	if(sqe == NULL){
+		return -1;
+	}
+	sqe->opcode = IORING_OP_OPENAT;
+	sqe->fd = AT_FDCWD;
+	sqe->addr = (uintptr_t) fj->path;
+	sqe->open_flags = O_RDONLY | O_CLOEXEC;
+	sqe = argo_files_sqe(fs, fj, ARGO_LOAD_STATX);
+	if(sqe == NULL){
+		return -1;
+	}
+	sqe->opcode = IORING_OP_STATX;
+	sqe->fd = AT_FDCWD;
+	sqe->addr = (uintptr_t) fj->path;
+	sqe->len = STATX_SIZE;
+	sqe->off = (uintptr_t) &fj->stx;
+	return 0;
+}
+
+#endif
+
+/*
+ * Process a file: with io_uring, start loading it, to be handed to the
+ * workers once read; otherwise hand it to them right away.
+ */
+static int argo_files_submit(ARGO_FILES *fs, char *path, int own_path){
+	ARGO_FILE_JOB *fj = calloc(1, sizeof(ARGO_FILE_JOB));
+
+	if(fj == NULL){
+		fprintf(stderr, "Failed to allocate job\n");
+		return -1;
+	}
+	fj->job.run = argo_files_run_file;
+	fj->path = path;
+	fj->own_path = own_path;
+#ifdef ARGO_HAVE_URING
+	if(fs->uring != NULL){
+		return argo_files_load(fs, fj);
+	}
+#endif
+	return argo_files_queue(fs, fj);
+}
+
+/*
+ * Submit the files named in a list, one per line.  Blank lines are skipped,
+ * as are the carriage returns of lines ending with CR LF.
+ */
+static int argo_files_submit_list(ARGO_FILES *fs, char *list){
+	FILE *f = fopen(list, "r");
+	char *line = NULL;
+	size_t cap = 0;
+	ssize_t n;
+
+	if(f == NULL){
+		fprintf(stderr, "%s: Cannot open list of files\n", list);
+		return -1;
+	}
+	while((n = getline(&line, &cap, f)) > 0){
+		while(n > 0 && (line[n-1] == ARGO_LF || line[n-1] == ARGO_CR)){
+			line[--n] = '\0';
+		}
+		if(n == 0){
+			continue;
+		}
+		if(argo_files_submit(fs, line, 1)){
+			free(line);
+			fclose(f);
+			return -1;
+		}
+		line = NULL;
+		cap = 0;
+	}
+	free(line);
+	fclose(f);
+	return 0;
+}
+
+/**
+ * @brief  Validate or canonicalize many files in one process.
+ * @details  The files are parsed by a pool of worker threads (argo_num_threads
+ * of them), each into its own context, whose arena is reused from one file
+ * to the next.  Unless argo_io_mode says otherwise, they are loaded ahead of
+ * the workers with io_uring, if the kernel supports it.  A name beginning with '@' is that of a file listing the files
+ * to process, one per line.  The canonical output of each file is written to
+ * "out" in the order of the names, each followed by a newline, or, with -w,
+ * to a file of the same name with ARGO_CANON_SUFFIX appended.  A file that is
+ * invalid or cannot be read is reported on standard error and produces no
+ * output, but does not stop the others from being processed.
+ *
+ * @param files  Names of the files, or of lists of files.
+ * @param num_files  Number of names.
+ * @param out  Output stream to which canonical output is to be written.
+ * @return  Zero if every file was processed successfully, nonzero otherwise.
+ */
+int argo_files_run(char **files, int num_files, FILE *out){
+	int threads = argo_num_threads ? argo_num_threads : argo_num_cpus();
+	ARGO_FILES fs = { 0 };
+	struct timespec start, end;
+	int status = 0;
+	int i;
+#ifdef ARGO_HAVE_URING
+	ARGO_URING uring;
+#endif
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	fs.out = out;
+#ifdef ARGO_HAVE_URING
+	if(argo_io_mode != ARGO_IO_SYNC && argo_uring_init(&uring, ARGO_LOAD_ENTRIES) == 0){
+		fs.uring = &uring;
+	}
+#endif
+	if(argo_io_mode == ARGO_IO_URING
+#ifdef ARGO_HAVE_URING
+	   && fs.uring == NULL
+#endif
+	   ){
+		fprintf(stderr, "io_uring is not available\n");
+		return -1;
+	}
+	fs.pool = argo_pool_create(threads, 4 * threads, NUM_ARGO_VALUES);
+	if(fs.pool == NULL){
+#ifdef ARGO_HAVE_URING
+		if(fs.uring != NULL){
+			argo_uring_exit(fs.uring);
+		}
+#endif
+		return -1;
+	}
+	for(i = 0; i < num_files && status == 0; i++){
+		if(files[i][0] == '@'){
+			status = argo_files_submit_list(&fs, files[i] + 1);
+		}
+		else{
+			status = argo_files_submit(&fs, files[i], 0);
+		}
+	}
+#ifdef ARGO_HAVE_URING
+	if(fs.uring != NULL){
+		// files still being loaded are left to the kernel if anything failed
+		while((fs.loading != NULL || fs.closing > 0) && status == 0){
+			status = argo_files_reap(&fs, 1);
+		}
+		argo_uring_exit(fs.uring);
+	}
+#endif
+	argo_pool_close(fs.pool);
+	while(fs.in_flight > 0 && argo_files_take(&fs) == 0)
+		;
+	argo_pool_destroy(fs.pool);
+	if(fs.status == 0 && fflush(out) == EOF){
+		fprintf(stderr, "Error EOF\n");
+		fs.status = -1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	if(global_options & STATISTICS_OPTION){
+		double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+		double mb = fs.bytes_read / 1e6;
+		fprintf(stderr, "%ld files (%ld failed), %.1f MB in %.3f s with %d threads (%.0f files/s, %.1f MB/s)\n",
+			fs.files, fs.failed, mb, secs, threads, fs.files / secs, mb / secs);
+	}
+	return status || fs.status || fs.failed ? -1 : 0;
+}
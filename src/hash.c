@@ -0,0 +1,451 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "hash.h"
+
+#define ARGO_XXH_PRIME1 0x9E3779B185EBCA87ULL
+#define ARGO_XXH_PRIME2 0xC2B2AE3D27D4EB4FULL
+#define ARGO_XXH_PRIME3 0x165667B19E3779F9ULL
+#define ARGO_XXH_PRIME4 0x85EBCA77C2B2AE63ULL
+#define ARGO_XXH_PRIME5 0x27D4EB2F165667C5ULL
+
+#define argo_rotl64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+#define argo_rotr32(x, r) (((x) >> (r)) | ((x) << (32 - (r))))
+
+/*
+ * Little-endian loads, which compile to single loads where unaligned
+ * access is allowed.
+ */
+static inline uint64_t argo_load64(const unsigned char *p){
+	return (uint64_t) p[0] | (uint64_t) p[1] << 8 | (uint64_t) p[2] << 16 | (uint64_t) p[3] << 24
+	       | (uint64_t) p[4] << 32 | (uint64_t) p[5] << 40 | (uint64_t) p[6] << 48 | (uint64_t) p[7] << 56;
+}
+
+static inline uint32_t argo_load32(const unsigned char *p){
+	return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static inline uint64_t argo_xxh64_round(uint64_t acc, uint64_t input){
+	acc += input * ARGO_XXH_PRIME2;
+	acc = argo_rotl64(acc, 31);
+	return acc * ARGO_XXH_PRIME1;
+}
+
+static inline uint64_t argo_xxh64_merge(uint64_t acc, uint64_t value){
+	acc ^= argo_xxh64_round(0, value);
+	return acc * ARGO_XXH_PRIME1 + ARGO_XXH_PRIME4;
+}
+
+/*
+ * Consume whole 32-byte stripes, returning the number of bytes consumed.
+ */
+static size_t argo_xxh64_stripes(ARGO_XXH64 *h, const unsigned char *p, size_t length){
+	uint64_t v1 = h->acc[0], v2 = h->acc[1], v3 = h->acc[2], v4 = h->acc[3];
+	size_t i;
+
+	for(i = 0; i + 32 <= length; i += 32){
+		v1 = argo_xxh64_round(v1, argo_load64(p + i));
+		v2 = argo_xxh64_round(v2, argo_load64(p + i + 8));
+		v3 = argo_xxh64_round(v3, argo_load64(p + i + 16));
+		v4 = argo_xxh64_round(v4, argo_load64(p + i + 24));
+	}
+	h->acc[0] = v1;
+	h->acc[1] = v2;
+	h->acc[2] = v3;
+	h->acc[3] = v4;
+	return i;
+}
+
+/**
+ * @brief  Start an xxHash64 computation.
+ *
+ * @param h  The hash state to initialize.
+ * @param seed  The seed, which is zero for the standard hash.
+ */
+void argo_xxh64_init(ARGO_XXH64 *h, uint64_t seed){
+	h->acc[0] = seed + ARGO_XXH_PRIME1 + ARGO_XXH_PRIME2;
+	h->acc[1] = seed + ARGO_XXH_PRIME2;
+	h->acc[2] = seed;
+	h->acc[3] = seed - ARGO_XXH_PRIME1;
+	h->seed = seed;
+	h->total = 0;
+	h->buf_length = 0;
+}
+
+/**
+ * @brief  Add bytes to an xxHash64 computation.
+ *
+ * @param h  The hash state.
+ * @param data  The bytes to add.
+ * @param length  The number of bytes.
+ */
+void argo_xxh64_update(ARGO_XXH64 *h, const void *data, size_t length){
+	const unsigned char *p = data;
+	size_t n;
+
+	h->total += length;
+	if(h->buf_length > 0){
+		while(h->buf_length < 32 && length > 0){
+			h->buf[h->buf_length++] = *p++;
+			length--;
+		}
+		if(h->buf_length < 32){
+			return;
+		}
+		argo_xxh64_stripes(h, h->buf, 32);
+		h->buf_length = 0;
+	}
+	n = argo_xxh64_stripes(h, p, length);
+	for(; n < length; n++){
+		h->buf[h->buf_length++] = p[n];
+	}
+}
+
+/*
+ * Combine the accumulators of a computation with the last n bytes,
+ * fewer than a stripe, that were not consumed by them.
+ */
+static uint64_t argo_xxh64_finish(ARGO_XXH64 *h, const unsigned char *p, size_t n){
+	uint64_t acc;
+
+	if(h->total >= 32){
+		acc = argo_rotl64(h->acc[0], 1) + argo_rotl64(h->acc[1], 7)
+		      + argo_rotl64(h->acc[2], 12) + argo_rotl64(h->acc[3], 18);
+		acc = argo_xxh64_merge(acc, h->acc[0]);
+		acc = argo_xxh64_merge(acc, h->acc[1]);
+		acc = argo_xxh64_merge(acc, h->acc[2]);
+		acc = argo_xxh64_merge(acc, h->acc[3]);
+	}
+	else{
+		acc = h->seed + ARGO_XXH_PRIME5;
+	}
+	acc += h->total;
+
+	for(; n >= 8; n -= 8, p += 8){
+		acc ^= argo_xxh64_round(0, argo_load64(p));
+		acc = argo_rotl64(acc, 27) * ARGO_XXH_PRIME1 + ARGO_XXH_PRIME4;
+	}
+	if(n >= 4){
+		acc ^= (uint64_t) argo_load32(p) * ARGO_XXH_PRIME1;
+		acc = argo_rotl64(acc, 23) * ARGO_XXH_PRIME2 + ARGO_XXH_PRIME3;
+		n -= 4;
+		p += 4;
+	}
+	for(; n > 0; n--, p++){
+		acc ^= *p * ARGO_XXH_PRIME5;
+		acc = argo_rotl64(acc, 11) * ARGO_XXH_PRIME1;
+	}
+
+	acc ^= acc >> 33;
+	acc *= ARGO_XXH_PRIME2;
+	acc ^= acc >> 29;
+	acc *= ARGO_XXH_PRIME3;
+	acc ^= acc >> 32;
+	return acc;
+}
+
+/**
+ * @brief  Finish an xxHash64 computation.
+ * @details  The state is left as it is, so more bytes may still be added.
+ *
+ * @param h  The hash state.
+ * @return  The hash of the bytes added so far.
+ */
+uint64_t argo_xxh64_final(ARGO_XXH64 *h){
+	return argo_xxh64_finish(h, h->buf, h->buf_length);
+}
+
+/**
+ * @brief  Compute the xxHash64 of a block of bytes in one call.
+ * @details  This is the same as argo_xxh64_init, argo_xxh64_update and
+ * argo_xxh64_final, without copying a short block into the state first.
+ *
+ * @param data  The bytes to hash.
+ * @param length  The number of bytes.
+ * @param seed  The seed, which is zero for the standard hash.
+ * @return  The hash of the bytes.
+ */
+uint64_t argo_xxh64(const void *data, size_t length, uint64_t seed){
+	ARGO_XXH64 h;
+	size_t n;
+
+	argo_xxh64_init(&h, seed);
+	h.total = length;
+	n = length >= 32 ? argo_xxh64_stripes(&h, data, length) : 0;
+	return argo_xxh64_finish(&h, (const unsigned char *) data + n, length - n);
+}
+
+static const uint32_t argo_sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/*
+ * Consume whole 64-byte blocks, returning the number of bytes consumed.
+ */
+static size_t argo_sha256_blocks(ARGO_SHA256 *h, const unsigned char *p, size_t length){
+	uint32_t w[64];
+	uint32_t a, b, c, d, e, f, g, k, t1, t2;
+	size_t n;
+	int i;
+
+	for(n = 0; n + 64 <= length; n += 64, p += 64){
+		for(i = 0; i < 16; i++){
+			w[i] = (uint32_t) p[4 * i] << 24 | (uint32_t) p[4 * i + 1] << 16
+			       | (uint32_t) p[4 * i + 2] << 8 | (uint32_t) p[4 * i + 3];
+		}
+		for(i = 16; i < 64; i++){
+			uint32_t s0 = argo_rotr32(w[i - 15], 7) ^ argo_rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+			uint32_t s1 = argo_rotr32(w[i - 2], 17) ^ argo_rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+			w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+		}
+		a = h->state[0];
+		b = h->state[1];
+		c = h->state[2];
+		d = h->state[3];
+		e = h->state[4];
+		f = h->state[5];
+		g = h->state[6];
+		k = h->state[7];
+		for(i = 0; i < 64; i++){
+			t1 = k + (argo_rotr32(e, 6) ^ argo_rotr32(e, 11) ^ argo_rotr32(e, 25))
+			     + ((e & f) ^ (~e & g)) + argo_sha256_k[i] + w[i];
+			t2 = (argo_rotr32(a, 2) ^ argo_rotr32(a, 13) ^ argo_rotr32(a, 22))
+			     + ((a & b) ^ (a & c) ^ (b & c));
+			k = g;
+			g = f;
+			f = e;
+			e = d + t1;
+			d = c;
+			c = b;
+			b = a;
+			a = t1 + t2;
+		}
+		h->state[0] += a;
+		h->state[1] += b;
+		h->state[2] += c;
+		h->state[3] += d;
+		h->state[4] += e;
+		h->state[5] += f;
+		h->state[6] += g;
+		h->state[7] += k;
+	}
+	return n;
+}
+
+/**
+ * @brief  Start a SHA-256 computation.
+ *
+ * @param h  The hash state to initialize.
+ */
+void argo_sha256_init(ARGO_SHA256 *h){
+	h->state[0] = 0x6a09e667;
+	h->state[1] = 0xbb67ae85;
+	h->state[2] = 0x3c6ef372;
+	h->state[3] = 0xa54ff53a;
+	h->state[4] = 0x510e527f;
+	h->state[5] = 0x9b05688c;
+	h->state[6] = 0x1f83d9ab;
+	h->state[7] = 0x5be0cd19;
+	h->total = 0;
+	h->buf_length = 0;
+}
+
+/**
+ * @brief  Add bytes to a SHA-256 computation.
+ *
+ * @param h  The hash state.
+ * @param data  The bytes to add.
+ * @param length  The number of bytes.
+ */
+void argo_sha256_update(ARGO_SHA256 *h, const void *data, size_t length){
+	const unsigned char *p = data;
+	size_t n;
+
+	h->total += length;
+	if(h->buf_length > 0){
+		while(h->buf_length < 64 && length > 0){
+			h->buf[h->buf_length++] = *p++;
+			length--;
+		}
+		if(h->buf_length < 64){
+			return;
+		}
+		argo_sha256_blocks(h, h->buf, 64);
+		h->buf_length = 0;
+	}
+	n = argo_sha256_blocks(h, p, length);
+	for(; n < length; n++){
+		h->buf[h->buf_length++] = p[n];
+	}
+}
+
+/**
+ * @brief  Finish a SHA-256 computation.
+ * @details  The padding is added to the state, so no more bytes may be
+ * added until it is initialized again.
+ *
+ * @param h  The hash state.
+ * @param digest  Where to store the ARGO_SHA256_SIZE bytes of the hash.
+ */
+void argo_sha256_final(ARGO_SHA256 *h, unsigned char *digest){
+	uint64_t bits = h->total * 8;
+	unsigned char pad[72];
+	size_t n = 0;
+	int i;
+
+	pad[n++] = 0x80;
+	while((h->buf_length + n) % 64 != 56){
+		pad[n++] = 0;
+	}
+	for(i = 7; i >= 0; i--){
+		pad[n++] = bits >> (8 * i);
+	}
+	argo_sha256_update(h, pad, n);
+	for(i = 0; i < 8; i++){
+		digest[4 * i] = h->state[i] >> 24;
+		digest[4 * i + 1] = h->state[i] >> 16;
+		digest[4 * i + 2] = h->state[i] >> 8;
+		digest[4 * i + 3] = h->state[i];
+	}
+}
+
+/**
+ * @brief  Start the computation of the selected hashes.
+ *
+ * @param h  The hash state to initialize.
+ * @param algorithms  Bit set of ARGO_HASH_XXH64 and ARGO_HASH_SHA256.
+ */
+void argo_hash_init(ARGO_HASH *h, int algorithms){
+	h->algorithms = algorithms;
+	if(algorithms & ARGO_HASH_XXH64){
+		argo_xxh64_init(&h->xxh64, 0);
+	}
+	if(algorithms & ARGO_HASH_SHA256){
+		argo_sha256_init(&h->sha256);
+	}
+}
+
+/**
+ * @brief  Add bytes to each of the selected hashes.
+ *
+ * @param h  The hash state.
+ * @param data  The bytes to add.
+ * @param length  The number of bytes.
+ */
+void argo_hash_update(ARGO_HASH *h, const void *data, size_t length){
+	if(h->algorithms & ARGO_HASH_XXH64){
+		argo_xxh64_update(&h->xxh64, data, length);
+	}
+	if(h->algorithms & ARGO_HASH_SHA256){
+		argo_sha256_update(&h->sha256, data, length);
+	}
+}
+
+/**
+ * @brief  Finish the selected hashes and print them on a line.
+ * @details  Each hash is printed in hexadecimal, xxHash64 first, separated
+ * by a space.  The xxHash64 value is printed most significant digit first,
+ * as xxhsum prints it.
+ *
+ * @param h  The hash state, which must be initialized again before reuse.
+ * @param out  Output stream.
+ * @return  Zero if the operation is completely successful,
+ * nonzero if there is any error.
+ */
+int argo_hash_print(ARGO_HASH *h, FILE *out){
+	static const char hex[] = "0123456789abcdef";
+	unsigned char digest[ARGO_SHA256_SIZE];
+	char line[2 * (ARGO_XXH64_SIZE + ARGO_SHA256_SIZE) + 2];
+	size_t len = 0;
+	uint64_t x;
+	int i;
+
+	if(h->algorithms & ARGO_HASH_XXH64){
+		x = argo_xxh64_final(&h->xxh64);
+		for(i = 2 * ARGO_XXH64_SIZE - 1; i >= 0; i--){
+			line[len++] = hex[(x >> (4 * i)) & 0xF];
+		}
+	}
+	if(h->algorithms & ARGO_HASH_SHA256){
+		argo_sha256_final(&h->sha256, digest);
+		if(len > 0){
+			line[len++] = ' ';
+		}
+		for(i = 0; i < ARGO_SHA256_SIZE; i++){
+			line[len++] = hex[digest[i] >> 4];
+			line[len++] = hex[digest[i] & 0xF];
+		}
+	}
+	line[len++] = ARGO_LF;
+	if(fwrite(line, 1, len, out) != len){
+		fprintf(stderr, "Error EOF\n");
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * State of a hash sink: the hashes of what has been written to it,
+ * and where to print them when it is closed.
+ */
+typedef struct argo_hash_sink {
+	ARGO_HASH hash;
+	FILE *out;
+} ARGO_HASH_SINK;
+
+static ssize_t argo_hash_sink_write(void *cookie, const char *buf, size_t size){
+	ARGO_HASH_SINK *sink = cookie;
+	argo_hash_update(&sink->hash, buf, size);
+	return size;
+}
+
+static int argo_hash_sink_close(void *cookie){
+	ARGO_HASH_SINK *sink = cookie;
+	int ret = argo_hash_print(&sink->hash, sink->out);
+	free(sink);
+	return ret;
+}
+
+/**
+ * @brief  Open a stream that hashes whatever is written to it.
+ * @details  The bytes are added to the hashes as the stream buffer is
+ * flushed, and are not kept anywhere else, so the memory used does not
+ * depend on the amount written.  When the stream is closed, the hashes
+ * are printed to "out", as by argo_hash_print, and fclose fails if they
+ * cannot be.
+ *
+ * @param algorithms  Bit set of ARGO_HASH_XXH64 and ARGO_HASH_SHA256.
+ * @param out  Output stream for the hashes.
+ * @return  The stream, or NULL if there is any error.
+ */
+FILE *argo_hash_open(int algorithms, FILE *out){
+	cookie_io_functions_t io = {NULL, argo_hash_sink_write, NULL, argo_hash_sink_close};
+	ARGO_HASH_SINK *sink = malloc(sizeof(ARGO_HASH_SINK));
+	FILE *f;
+
+	if(sink == NULL){
+		fprintf(stderr, "Failed to allocate hash\n");
+		return NULL;
+	}
+	argo_hash_init(&sink->hash, algorithms);
+	sink->out = out;
+	f = fopencookie(sink, "w", io);
+	if(f == NULL){
+		fprintf(stderr, "Failed to open hash\n");
+		free(sink);
+		return NULL;
+	}
+	return f;
+}
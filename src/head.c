@@ -0,0 +1,265 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "utils.h"
+#include "context.h"
+#include "options.h"
+#include "writer.h"
+#include "head.h"
+
+/*
+ * Draws are 53 bits, so that a rate converts to a threshold exactly.
+ */
+#define ARGO_HEAD_DRAW_BITS 53
+
+static ARGO_CHAR argo_head_skip_whitespace(FILE *f){
+	ARGO_CHAR c;
+	do{
+		c = fgetc(f);
+	} while(argo_is_whitespace(c));
+	return c;
+}
+
+static int argo_head_unget(ARGO_CHAR c, FILE *f){
+	if(ungetc(c, f) == EOF){
+		argo_position(f);
+		fprintf(stderr, "[%d, %d] Fail to unget. \n", argo_ctx->lines_read, argo_ctx->chars_read);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Next number of the generator (SplitMix64).
+ */
+static uint64_t argo_head_next(ARGO_HEAD *h){
+	uint64_t z = (h->state += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+/**
+ * @brief  Set up the selection of elements.
+ *
+ * @param h  The selection.
+ * @param count  Number of elements to output at most, or zero for no limit.
+ * @param rate  Probability that an element is output, or zero to output
+ * every element.
+ * @param seed  Seed of the random draws.
+ */
+void argo_head_init(ARGO_HEAD *h, long count, double rate, uint64_t seed){
+	h->remaining = count > 0 ? count : -1;
+	if(rate <= 0 || rate >= 1){
+		h->threshold = (uint64_t) 1 << ARGO_HEAD_DRAW_BITS;
+	}
+	else{
+		h->threshold = rate * ((uint64_t) 1 << ARGO_HEAD_DRAW_BITS);
+	}
+	h->state = seed;
+}
+
+/**
+ * @brief  Decide whether the next element is output.
+ *
+ * @return  Nonzero if it is, zero if it is to be skipped, or if enough
+ * elements have been output already, in which case h->remaining is zero.
+ */
+int argo_head_keep(ARGO_HEAD *h){
+	if(h->remaining == 0){
+		return 0;
+	}
+	if(h->threshold < (uint64_t) 1 << ARGO_HEAD_DRAW_BITS
+	   && argo_head_next(h) >> (64 - ARGO_HEAD_DRAW_BITS) >= h->threshold){
+		return 0;
+	}
+	if(h->remaining > 0){
+		h->remaining--;
+	}
+	return 1;
+}
+
+/*
+ * Write one element of the output array in canonical form, preceded by
+ * what separates it from the previous one.  The value is then forgotten,
+ * which also resets the indent level, so it is restored.
+ */
+static int argo_head_write_element(ARGO_VALUE *v, FILE *out, int first){
+	ARGO_CONTEXT *ctx = argo_ctx;
+	int indent = global_options & INDENT_MASK;
+	int status;
+
+	if(!first && fputc(ARGO_COMMA, out) == EOF){
+		fprintf(stderr, "Error EOF\n");
+		return -1;
+	}
+	ctx->indent_level = 1;
+	if(indent && argo_write_newline(out, indent)){
+		return -1;
+	}
+	status = argo_writer(v, out);
+	argo_context_reset(ctx);
+	return status;
+}
+
+/*
+ * Output the selected elements of the top-level array as an array, in the
+ * same form as argo_write_value would give it.
+ */
+static int argo_head_array(ARGO_HEAD *h, FILE *in, FILE *out){
+	ARGO_CONTEXT *ctx = argo_ctx;
+	int indent = global_options & INDENT_MASK;
+	long written = 0;
+	ARGO_VALUE *v;
+	ARGO_CHAR c;
+
+	c = argo_head_skip_whitespace(in);
+	if(c != ARGO_LBRACK){
+		argo_position(in);
+		fprintf(stderr, "[%d, %d] Expect top-level array but seen (%d)\n", ctx->lines_read, ctx->chars_read, c);
+		return -1;
+	}
+	if(fputc(ARGO_LBRACK, out) == EOF){
+		fprintf(stderr, "Error EOF\n");
+		return -1;
+	}
+	c = argo_head_skip_whitespace(in);
+	if(c != ARGO_RBRACK){
+		if(argo_head_unget(c, in)){
+			return -1;
+		}
+		while(h->remaining != 0){
+			if(argo_head_keep(h)){
+				v = argo_read_value(in);
+				if(v == NULL || argo_head_write_element(v, out, written == 0)){
+					return -1;
+				}
+				written++;
+				// with --head, stop before reading any further
+				if(h->remaining == 0){
+					break;
+				}
+			}
+			else if(argo_skip_value(in)){
+				return -1;
+			}
+			c = argo_head_skip_whitespace(in);
+			if(c == ARGO_RBRACK){
+				break;
+			}
+			if(c != ARGO_COMMA){
+				argo_position(in);
+				fprintf(stderr, "[%d, %d] Expect , in array but seen (%d)\n", ctx->lines_read, ctx->chars_read, c);
+				return -1;
+			}
+		}
+	}
+	ctx->indent_level = 0;
+	if(indent && argo_write_newline(out, indent)){
+		return -1;
+	}
+	if(fputc(ARGO_RBRACK, out) == EOF || (indent && fputc(ARGO_LF, out) == EOF)){
+		fprintf(stderr, "Error EOF\n");
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Output the selected records of newline-delimited input, one per line,
+ * as argo_ndjson_run would.
+ */
+static int argo_head_records(ARGO_HEAD *h, FILE *in, FILE *out){
+	ARGO_CONTEXT *ctx = argo_ctx;
+	ARGO_VALUE *v;
+	ARGO_CHAR c;
+	int line;
+
+	while(h->remaining != 0){
+		c = argo_head_skip_whitespace(in);
+		if(c == EOF){
+			return 0;
+		}
+		// the line of the record is that of its first character
+		argo_position(in);
+		line = ctx->lines_read;
+		if(argo_head_unget(c, in)){
+			return -1;
+		}
+		if(argo_head_keep(h)){
+			v = argo_read_value(in);
+			if(v == NULL){
+				return -1;
+			}
+			argo_position(in);
+			if(ctx->lines_read != line){
+				fprintf(stderr, "[%d, %d] Record spans more than one line\n", ctx->lines_read, ctx->chars_read);
+				return -1;
+			}
+			if(argo_write_value(v, out)){
+				return -1;
+			}
+			if(!(global_options & INDENT_MASK) && fputc(ARGO_LF, out) == EOF){
+				fprintf(stderr, "Error EOF\n");
+				return -1;
+			}
+			argo_context_reset(ctx);
+		}
+		else{
+			if(argo_skip_value(in)){
+				return -1;
+			}
+			argo_position(in);
+			if(ctx->lines_read != line){
+				fprintf(stderr, "[%d, %d] Record spans more than one line\n", ctx->lines_read, ctx->chars_read);
+				return -1;
+			}
+		}
+		// with --head, the rest of the last line is not read
+		if(h->remaining == 0){
+			return 0;
+		}
+		do{
+			c = fgetc(in);
+		} while(c != ARGO_LF && c != EOF && argo_is_whitespace(c));
+		if(c != ARGO_LF && c != EOF){
+			argo_position(in);
+			fprintf(stderr, "[%d, %d] Expect newline after record but seen (%d)\n", ctx->lines_read, ctx->chars_read, c);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief  Output some elements of the top-level array, or some records
+ * with -n, in canonical form.
+ * @details  With --head N (argo_head_count), the first N are output and
+ * nothing after them is read; with --sample RATE (argo_sample_rate), each
+ * one is output with that probability; with both, the first N of those
+ * drawn.  Only the elements output are parsed, one at a time, and the
+ * input after the last one read is not checked.
+ *
+ * @param in  Input stream from which JSON is to be read.
+ * @param out  Output stream to which canonical JSON is to be written.
+ * @return  Zero if the operation is completely successful,
+ * nonzero if there is any error.
+ */
+int argo_head_run(FILE *in, FILE *out){
+	struct timespec now;
+	ARGO_HEAD h;
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	argo_head_init(&h, argo_head_count, argo_sample_rate,
+	               (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec + ((uint64_t) getpid() << 32));
+	if(global_options & NDJSON_OPTION){
+		return argo_head_records(&h, in, out);
+	}
+	return argo_head_array(&h, in, out);
+}
@@ -0,0 +1,365 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <float.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "utils.h"
+#include "context.h"
+#include "jcs.h"
+
+/**
+ * @brief  Write a number in the form ECMAScript's Number.prototype.toString
+ * gives it, as RFC 8785 requires.
+ * @details  The digits are the shortest that convert back to the same
+ * double, and the nearest to it if several are that short: fixed notation
+ * is used from 1e-6 up to 1e21, and exponent notation beyond.
+ * Negative zero is written as 0.
+ *
+ * @param x  The number, which must be finite.
+ * @param out  Where to store the text, which takes at most
+ * ARGO_JCS_NUMBER_MAX bytes, not null-terminated.
+ * @return  The length of the text.
+ */
+int argo_jcs_number(double x, char *out){
+	char buf[40];
+	char digits[20];
+	int k = 0, n, e, p, i;
+	int len = 0;
+	char *s;
+
+	if(x == 0){
+		out[0] = ARGO_DIGIT0;
+		return 1;
+	}
+
+	// the shortest digits that round-trip: any of up to 15 digits would
+	// show up, padded with zeros, as the 15-digit rounding of x, except for
+	// subnormal numbers, which have fewer digits of precision
+	p = (x < DBL_MIN && -x < DBL_MIN) ? 1 : 15;
+	for(; p < 17; p++){
+		snprintf(buf, sizeof(buf), "%.*e", p - 1, x);
+		if(strtod(buf, NULL) == x){
+			break;
+		}
+	}
+	if(p == 17){
+		snprintf(buf, sizeof(buf), "%.*e", p - 1, x);
+	}
+
+	s = buf;
+	if(*s == ARGO_MINUS){
+		out[len++] = ARGO_MINUS;
+		s++;
+	}
+	for(; *s != 'e'; s++){
+		if(*s != ARGO_PERIOD){
+			digits[k++] = *s;
+		}
+	}
+	e = strtol(s + 1, NULL, 10);
+	while(k > 1 && digits[k - 1] == ARGO_DIGIT0){
+		k--;
+	}
+
+	// the value is 0.d1d2...dk times 10^n
+	n = e + 1;
+	if(k <= n && n <= 21){
+		for(i = 0; i < k; i++){
+			out[len++] = digits[i];
+		}
+		for(; i < n; i++){
+			out[len++] = ARGO_DIGIT0;
+		}
+	}
+	else if(0 < n && n <= 21){
+		for(i = 0; i < k; i++){
+			if(i == n){
+				out[len++] = ARGO_PERIOD;
+			}
+			out[len++] = digits[i];
+		}
+	}
+	else if(-6 < n && n <= 0){
+		out[len++] = ARGO_DIGIT0;
+		out[len++] = ARGO_PERIOD;
+		for(i = n; i < 0; i++){
+			out[len++] = ARGO_DIGIT0;
+		}
+		for(i = 0; i < k; i++){
+			out[len++] = digits[i];
+		}
+	}
+	else{
+		out[len++] = digits[0];
+		if(k > 1){
+			out[len++] = ARGO_PERIOD;
+			for(i = 1; i < k; i++){
+				out[len++] = digits[i];
+			}
+		}
+		len += snprintf(out + len, ARGO_JCS_NUMBER_MAX - len, "e%+d", n - 1);
+	}
+	return len;
+}
+
+/*
+ * Find the double that a number denotes.  Its text, when there is one,
+ * is converted again, as float_value is only an approximation of it.
+ */
+static int argo_jcs_double(ARGO_NUMBER *n, double *x){
+	ARGO_STRING *sv = &n->string_value;
+	char small[64];
+	char *text = small;
+	size_t i;
+
+	if(n->valid_string && sv->length > 0){
+		if(sv->length >= sizeof(small)){
+			text = malloc(sv->length + 1);
+			if(text == NULL){
+				fprintf(stderr, "Failed to allocate number\n");
+				return -1;
+			}
+		}
+		for(i = 0; i < sv->length; i++){
+			text[i] = sv->content[i];
+		}
+		text[i] = '\0';
+		*x = strtod(text, NULL);
+		if(text != small){
+			free(text);
+		}
+	}
+	else if(n->valid_int){
+		*x = n->int_value;
+	}
+	else if(n->valid_float){
+		*x = n->float_value;
+	}
+	else{
+		fprintf(stderr, "Invalid argument(s) for write number\n");
+		return -1;
+	}
+	if(*x - *x != 0){
+		fprintf(stderr, "Number is out of the range of JCS\n");
+		return -1;
+	}
+	return 0;
+}
+
+static int argo_jcs_write_number(ARGO_NUMBER *n, FILE *f){
+	ARGO_STRING *sv = &n->string_value;
+	char out[ARGO_JCS_NUMBER_MAX];
+	double x;
+	int len;
+
+	// an integer of up to 15 digits is exact as a double, and ECMAScript
+	// writes it as it is; canonical text has no leading zeros or -0
+	if(n->valid_string == ARGO_CANONICAL_TEXT && sv->length - (sv->content[0] == ARGO_MINUS) <= 15){
+		return argo_write_number_text(sv, f);
+	}
+	if(argo_jcs_double(n, &x)){
+		return -1;
+	}
+	len = argo_jcs_number(x, out);
+	if(fwrite(out, 1, len, f) != (size_t) len){
+		fprintf(stderr, "Error EOF\n");
+		return -1;
+	}
+	return 0;
+}
+
+static int argo_jcs_write_string(ARGO_STRING *s, FILE *f){
+	size_t i;
+
+	for(i = 0; i < s->length; i++){
+		if(argo_is_high_surrogate(s->content[i]) || argo_is_low_surrogate(s->content[i])){
+			fprintf(stderr, "Lone surrogate (%d) cannot be canonicalized\n", s->content[i]);
+			return -1;
+		}
+	}
+	return argo_write_string(s, f);
+}
+
+/*
+ * First UTF-16 code unit of a character.
+ */
+#define argo_utf16_lead(c) ((c) < 0x10000 ? (c) : 0xD800 + (((c) - 0x10000) >> 10))
+
+/*
+ * Order member names by their UTF-16 code units.  Characters beyond
+ * U+FFFF take two units, led by a high surrogate, and so come before
+ * characters from U+E000 to U+FFFF, unlike in code point order.
+ */
+static int argo_jcs_compare(const void *a, const void *b){
+	ARGO_STRING *s = &(*(ARGO_VALUE **) a)->name;
+	ARGO_STRING *t = &(*(ARGO_VALUE **) b)->name;
+	size_t n = s->length < t->length ? s->length : t->length;
+	ARGO_CHAR c, d;
+	size_t i;
+
+	for(i = 0; i < n; i++){
+		c = s->content[i];
+		d = t->content[i];
+		if(c != d){
+			if(argo_utf16_lead(c) != argo_utf16_lead(d)){
+				return argo_utf16_lead(c) < argo_utf16_lead(d) ? -1 : 1;
+			}
+			return c < d ? -1 : 1;
+		}
+	}
+	return (s->length > t->length) - (s->length < t->length);
+}
+
+/*
+ * Members of the object being sorted, gathered from its list so that it
+ * can be sorted as an array.  The array is reused from object to object.
+ */
+typedef struct argo_jcs_scratch {
+	ARGO_VALUE **members;
+	size_t capacity;
+} ARGO_JCS_SCRATCH;
+
+static int argo_jcs_sort_value(ARGO_VALUE *v, ARGO_JCS_SCRATCH *sc){
+	ARGO_VALUE *head, *list_ptr;
+	size_t n = 0, i;
+
+	if(v->type == ARGO_ARRAY_TYPE){
+		head = v->content.array.element_list;
+		for(list_ptr = head->next; list_ptr != head; list_ptr = list_ptr->next){
+			if(argo_jcs_sort_value(list_ptr, sc)){
+				return -1;
+			}
+		}
+		return 0;
+	}
+	if(v->type != ARGO_OBJECT_TYPE){
+		return 0;
+	}
+
+	head = v->content.object.member_list;
+	for(list_ptr = head->next; list_ptr != head; list_ptr = list_ptr->next){
+		if(n == sc->capacity){
+			size_t capacity = sc->capacity ? 2 * sc->capacity : 64;
+			ARGO_VALUE **members = realloc(sc->members, capacity * sizeof(ARGO_VALUE *));
+			if(members == NULL){
+				fprintf(stderr, "Failed to allocate members\n");
+				return -1;
+			}
+			sc->members = members;
+			sc->capacity = capacity;
+		}
+		sc->members[n++] = list_ptr;
+	}
+	if(n > 1){
+		qsort(sc->members, n, sizeof(ARGO_VALUE *), argo_jcs_compare);
+	}
+
+	// relink the list in sorted order, which equal names would leave ambiguous
+	head->next = head;
+	head->prev = head;
+	for(i = 0; i < n; i++){
+		if(i > 0 && argo_jcs_compare(&sc->members[i - 1], &sc->members[i]) == 0){
+			fprintf(stderr, "Duplicate member name cannot be canonicalized\n");
+			return -1;
+		}
+		list_ptr = sc->members[i];
+		list_ptr->prev = head->prev;
+		list_ptr->next = head;
+		head->prev->next = list_ptr;
+		head->prev = list_ptr;
+	}
+
+	for(list_ptr = head->next; list_ptr != head; list_ptr = list_ptr->next){
+		if(argo_jcs_sort_value(list_ptr, sc)){
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief  Sort the members of every object in a value by their names,
+ * in the order of RFC 8785.
+ * @details  The members of each object are gathered into an array, which
+ * is sorted and then relinked into the member list in its new order.
+ *
+ * @param v  The value, whose objects are reordered in place.
+ * @return  Zero if the operation is completely successful, nonzero if
+ * there is any error, including an object with duplicate member names.
+ */
+int argo_jcs_sort(ARGO_VALUE *v){
+	ARGO_JCS_SCRATCH sc = {NULL, 0};
+	int ret = argo_jcs_sort_value(v, &sc);
+	free(sc.members);
+	return ret;
+}
+
+static int argo_jcs_write_value(ARGO_VALUE *v, FILE *f){
+	ARGO_VALUE *head, *list_ptr;
+	int is_object;
+
+	switch(v->type){
+	case ARGO_NUMBER_TYPE:
+		return argo_jcs_write_number(&v->content.number, f);
+	case ARGO_STRING_TYPE:
+		return argo_jcs_write_string(&v->content.string, f);
+	case ARGO_ARRAY_TYPE:
+	case ARGO_OBJECT_TYPE:
+		break;
+	default:
+		return argo_write_scalar(v, f);
+	}
+
+	is_object = v->type == ARGO_OBJECT_TYPE;
+	head = is_object ? v->content.object.member_list : v->content.array.element_list;
+	if(fputc(is_object ? ARGO_LBRACE : ARGO_LBRACK, f) == EOF){
+		fprintf(stderr, "Error EOF\n");
+		return -1;
+	}
+	for(list_ptr = head->next; list_ptr != head; list_ptr = list_ptr->next){
+		if(list_ptr != head->next && fputc(ARGO_COMMA, f) == EOF){
+			fprintf(stderr, "Error EOF\n");
+			return -1;
+		}
+		if(is_object){
+			if(argo_jcs_write_string(&list_ptr->name, f)){
+				return -1;
+			}
+			if(fputc(ARGO_COLON, f) == EOF){
+				fprintf(stderr, "Error EOF\n");
+				return -1;
+			}
+		}
+		if(argo_jcs_write_value(list_ptr, f)){
+			return -1;
+		}
+	}
+	if(fputc(is_object ? ARGO_RBRACE : ARGO_RBRACK, f) == EOF){
+		fprintf(stderr, "Error EOF\n");
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief  Write a value, and everything inside it, in the form of RFC 8785.
+ * @details  The members of its objects are sorted first, in place.
+ * Strings are written as in the -u mode, which -C implies.
+ *
+ * @param v  The value to write.
+ * @param f  Output stream.
+ * @return  Zero if the operation is completely successful,
+ * nonzero if there is any error.
+ */
+int argo_write_jcs(ARGO_VALUE *v, FILE *f){
+	if(v == NULL || f == NULL){
+		fprintf(stderr, "Invalid argument(s) for write jcs\n");
+		return -1;
+	}
+	if(argo_jcs_sort(v)){
+		return -1;
+	}
+	return argo_jcs_write_value(v, f);
+}
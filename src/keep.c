@@ -0,0 +1,391 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "utils.h"
+#include "context.h"
+#include "options.h"
+#include "keep.h"
+
+static ARGO_KEEP *argo_keep_node(char *name){
+	ARGO_KEEP *k = calloc(1, sizeof(ARGO_KEEP));
+	if(k == NULL){
+		fprintf(stderr, "Failed to allocate projection\n");
+		return NULL;
+	}
+	k->name = name;
+	return k;
+}
+
+/*
+ * Find the member of a projection node with the given name (the len
+ * characters at name), adding it if there is none yet.
+ */
+static ARGO_KEEP *argo_keep_member(ARGO_KEEP *k, char *name, int len){
+	ARGO_KEEP *m;
+	char *s;
+	int i;
+
+	for(m = k->members; m != NULL; m = m->next){
+		for(i = 0; i < len && m->name[i] == name[i]; i++)
+			;
+		if(i == len && m->name[len] == '\0'){
+			return m;
+		}
+	}
+	s = malloc(len + 1);
+	if(s == NULL){
+		fprintf(stderr, "Failed to allocate projection\n");
+		return NULL;
+	}
+	for(i = 0; i < len; i++){
+		s[i] = name[i];
+	}
+	s[len] = '\0';
+	m = argo_keep_node(s);
+	if(m == NULL){
+		free(s);
+		return NULL;
+	}
+	m->next = k->members;
+	k->members = m;
+	return m;
+}
+
+/**
+ * @brief  Parse a projection specification.
+ * @details  The specification is a comma-separated list of paths.  A path
+ * is a sequence of member names separated by periods, each of which may
+ * be followed by [*] to select every element of an array (a path may also
+ * begin with [*] if the document is an array).  The value at the end of
+ * each path is kept in its entirety; the values leading to it are kept
+ * with only the members and elements that lead to a kept value.
+ *
+ * @param spec  The specification, such as "a.b,c,d.e[*].f".
+ * @return  The root of the projection tree if the operation is completely
+ * successful, NULL if the specification is malformed or there is any error.
+ */
+ARGO_KEEP *argo_keep_parse(char *spec){
+	ARGO_KEEP *root = argo_keep_node(NULL);
+	ARGO_KEEP *k;
+	char *s = spec;
+	int len;
+
+	if(root == NULL){
+		return NULL;
+	}
+	while(1){
+		k = root;
+		while(1){
+			if(*s == ARGO_LBRACK){
+				if(s[1] != '*' || s[2] != ARGO_RBRACK){
+					goto bad;
+				}
+				s += 3;
+				if(k->elements == NULL && (k->elements = argo_keep_node(NULL)) == NULL){
+					goto fail;
+				}
+				k = k->elements;
+			}
+			else{
+				for(len = 0; s[len] && s[len] != ARGO_PERIOD && s[len] != ARGO_LBRACK && s[len] != ARGO_COMMA; len++)
+					;
+				if(len == 0){
+					goto bad;
+				}
+				if((k = argo_keep_member(k, s, len)) == NULL){
+					goto fail;
+				}
+				s += len;
+			}
+			if(*s == ARGO_PERIOD){
+				// a period must be followed by a member name
+				s++;
+				if(*s == '\0' || *s == ARGO_PERIOD || *s == ARGO_LBRACK || *s == ARGO_COMMA){
+					goto bad;
+				}
+			}
+			else if(*s != ARGO_LBRACK){
+				break;
+			}
+		}
+		if(*s != '\0' && *s != ARGO_COMMA){
+			goto bad;
+		}
+		k->all = 1;
+		if(*s == '\0'){
+			return root;
+		}
+		s++;
+	}
+
+ bad:
+	fprintf(stderr, "Invalid projection: %s\n", spec);
+ fail:
+	argo_keep_free(root);
+	return NULL;
+}
+
+/**
+ * @brief  Free a projection tree.
+ *
+ * @param k  The root of the tree.
+ */
+void argo_keep_free(ARGO_KEEP *k){
+	ARGO_KEEP *next;
+
+	while(k != NULL){
+		next = k->next;
+		argo_keep_free(k->members);
+		argo_keep_free(k->elements);
+		free(k->name);
+		free(k);
+		k = next;
+	}
+}
+
+static ARGO_CHAR argo_keep_skip_whitespace(FILE *f){
+	ARGO_CHAR c;
+	do{
+		c = fgetc(f);
+	} while(argo_is_whitespace(c));
+	return c;
+}
+
+static int argo_keep_unget(ARGO_CHAR c, FILE *f){
+	if(ungetc(c, f) == EOF){
+		argo_position(f);
+		fprintf(stderr, "[%d, %d] Fail to unget. \n", argo_ctx->lines_read, argo_ctx->chars_read);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Find the member of a projection node whose name is that of a member
+ * read from the input.  Each character is compared with a single byte,
+ * except in the -u mode, where characters beyond ASCII are compared
+ * with their UTF-8 encoding.
+ */
+static ARGO_KEEP *argo_keep_find(ARGO_KEEP *k, ARGO_STRING *name){
+	int utf8 = global_options & UTF8_OPTION;
+	char bytes[12];
+	ARGO_KEEP *m;
+	char *t;
+	size_t i;
+	int j, n;
+
+	for(m = k->members; m != NULL; m = m->next){
+		t = m->name;
+		for(i = 0; i < name->length; i++){
+			if(utf8 && name->content[i] >= 0x80){
+				n = argo_utf8_char(name->content[i], bytes);
+			}
+			else{
+				bytes[0] = name->content[i];
+				n = 1;
+			}
+			for(j = 0; j < n && *t == bytes[j]; j++, t++)
+				;
+			if(j < n){
+				break;
+			}
+		}
+		if(i == name->length && *t == '\0'){
+			return m;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Link a value at the end of a list of members or elements.
+ */
+static void argo_keep_append(ARGO_VALUE *head, ARGO_VALUE *v){
+	v->prev = head->prev;
+	v->next = head;
+	head->prev->next = v;
+	head->prev = v;
+}
+
+static ARGO_VALUE *argo_keep_container(ARGO_VALUE_TYPE type){
+	ARGO_VALUE *av = argo_alloc_value();
+	ARGO_VALUE *head;
+
+	if(av == NULL || (head = argo_alloc_value()) == NULL){
+		return NULL;
+	}
+	head->next = head;
+	head->prev = head;
+	av->type = type;
+	if(type == ARGO_OBJECT_TYPE){
+		av->content.object.member_list = head;
+	}
+	else{
+		av->content.array.element_list = head;
+	}
+	return av;
+}
+
+/*
+ * Read the next value of the input, keeping only what the projection
+ * node selects.  A value that the node does not look into, because it
+ * is not an object with members to keep or an array with elements to
+ * keep, is kept as it is.  The name is a scratch string that member
+ * names are read into; a kept member takes it over.
+ */
+static int argo_keep_read(FILE *f, ARGO_KEEP *k, ARGO_STRING *name, ARGO_VALUE **out){
+	ARGO_VALUE *av, *v;
+	ARGO_STRING member;
+	ARGO_KEEP *m;
+	ARGO_CHAR c;
+
+	*out = NULL;
+	if(k->all){
+		return (*out = argo_read_value(f)) == NULL ? -1 : 0;
+	}
+	c = argo_keep_skip_whitespace(f);
+	if(c == ARGO_LBRACE && k->members != NULL){
+		if((av = argo_keep_container(ARGO_OBJECT_TYPE)) == NULL){
+			return -1;
+		}
+		c = argo_keep_skip_whitespace(f);
+		while(c != ARGO_RBRACE){
+			if(c != ARGO_QUOTE){
+				argo_position(f);
+				fprintf(stderr, "[%d, %d] Expect member name but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
+				return -1;
+			}
+			if(argo_keep_unget(c, f)){
+				return -1;
+			}
+			name->length = 0;
+			if(argo_read_string(name, f)){
+				return -1;
+			}
+			c = argo_keep_skip_whitespace(f);
+			if(c != ARGO_COLON){
+				argo_position(f);
+				fprintf(stderr, "[%d, %d] Expect : in object but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
+				return -1;
+			}
+			m = argo_keep_find(k, name);
+			if(m == NULL){
+				if(argo_skip_value(f)){
+					return -1;
+				}
+			}
+			else{
+				// the member takes the name over before the scratch string is reused inside it
+				member = *name;
+				name->capacity = 0;
+				name->length = 0;
+				name->content = NULL;
+				if(argo_keep_read(f, m, name, &v)){
+					free(member.content);
+					return -1;
+				}
+				v->name = member;
+				argo_keep_append(av->content.object.member_list, v);
+			}
+			c = argo_keep_skip_whitespace(f);
+			if(c == ARGO_COMMA){
+				c = argo_keep_skip_whitespace(f);
+			}
+			else if(c != ARGO_RBRACE){
+				argo_position(f);
+				fprintf(stderr, "[%d, %d] Expect , in object but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
+				return -1;
+			}
+		}
+		*out = av;
+		return 0;
+	}
+	if(c == ARGO_LBRACK && k->elements != NULL){
+		if((av = argo_keep_container(ARGO_ARRAY_TYPE)) == NULL){
+			return -1;
+		}
+		c = argo_keep_skip_whitespace(f);
+		if(c == ARGO_RBRACK){
+			*out = av;
+			return 0;
+		}
+		if(argo_keep_unget(c, f)){
+			return -1;
+		}
+		while(1){
+			if(argo_keep_read(f, k->elements, name, &v)){
+				return -1;
+			}
+			argo_keep_append(av->content.array.element_list, v);
+			c = argo_keep_skip_whitespace(f);
+			if(c == ARGO_RBRACK){
+				break;
+			}
+			if(c != ARGO_COMMA){
+				argo_position(f);
+				fprintf(stderr, "[%d, %d] Expect , in array but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
+				return -1;
+			}
+		}
+		*out = av;
+		return 0;
+	}
+	// not a container the projection looks into
+	if(c != EOF && argo_keep_unget(c, f)){
+		return -1;
+	}
+	return (*out = argo_read_value(f)) == NULL ? -1 : 0;
+}
+
+/**
+ * @brief  Read a document, keeping only what a projection selects.
+ * @details  Members and elements that are not selected are skipped with
+ * argo_skip_value, so that no values are allocated for them and their
+ * strings are not decoded.  Of an object, only the selected members are
+ * kept, in their original order.  A value on a path that is not an object
+ * (or, for [*], an array) is kept as it is, at any depth, since there is
+ * nothing in it for the rest of the path to select.
+ *
+ * @param f  Input stream from which JSON is to be read.
+ * @param k  Root of the projection tree.
+ * @return  A valid pointer if the operation is completely successful,
+ * NULL if there is any error.
+ */
+ARGO_VALUE *argo_keep_read_value(FILE *f, ARGO_KEEP *k){
+	ARGO_STRING name = {0, 0, NULL};
+	ARGO_VALUE *v;
+
+	if(argo_keep_read(f, k, &name, &v)){
+		v = NULL;
+	}
+	free(name.content);
+	return v;
+}
+
+/**
+ * @brief  Output a document, keeping only what a projection selects,
+ * in canonical form.
+ *
+ * @param in  Input stream from which JSON is to be read.
+ * @param out  Output stream to which canonical JSON is to be written.
+ * @param spec  The projection specification.
+ * @return  Zero if the operation is completely successful,
+ * nonzero if there is any error.
+ */
+int argo_keep_run(FILE *in, FILE *out, char *spec){
+	ARGO_KEEP *k = argo_keep_parse(spec);
+	ARGO_VALUE *v;
+
+	if(k == NULL){
+		return -1;
+	}
+	v = argo_keep_read_value(in, k);
+	argo_keep_free(k);
+	if(v == NULL){
+		return -1;
+	}
+	return argo_write_value(v, out);
+}
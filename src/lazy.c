@@ -0,0 +1,561 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "utils.h"
+#include "context.h"
+#include "lazy.h"
+
+#define ARGO_LAZY_MIN_INDEX 64
+#define ARGO_LAZY_MIN_MEMO 64
+
+/*
+ * Compute the line and column of an offset of the document, in the form
+ * reported in error messages, resuming from the last position
+ * computed when that one lies before it.
+ */
+static void argo_lazy_position(ARGO_LAZY_DOC *doc, size_t offset, int *line, int *column){
+	size_t i = 0;
+	int l = 0;
+	int col = 0;
+
+	if(doc->position_offset <= offset){
+		i = doc->position_offset;
+		l = doc->position_line;
+		col = doc->position_column;
+	}
+	argo_position_scan(doc->text + i, offset - i, &l, &col);
+	doc->position_offset = offset;
+	doc->position_line = l;
+	doc->position_column = col;
+	*line = l;
+	*column = col;
+}
+
+static void argo_lazy_error(ARGO_LAZY_DOC *doc, size_t offset, char *msg){
+	int line, column;
+	argo_lazy_position(doc, offset, &line, &column);
+	fprintf(stderr, "[%d, %d] %s\n", line, column + 1, msg);
+}
+
+static size_t argo_lazy_skip_whitespace(ARGO_LAZY_DOC *doc, size_t i){
+	while(i < doc->length && argo_is_whitespace(doc->text[i])){
+		i++;
+	}
+	return i;
+}
+
+/*
+ * Return the offset just past the end of the string or other scalar
+ * beginning at offset i.  The scalar itself is not checked.
+ */
+static size_t argo_lazy_skip_scalar(ARGO_LAZY_DOC *doc, size_t i){
+	char c;
+
+	if(doc->text[i] == ARGO_QUOTE){
+		for(i++; i < doc->length; i++){
+			c = doc->text[i];
+			if(c == ARGO_BSLASH){
+				i++;
+			}
+			else if(c == ARGO_QUOTE){
+				return i + 1;
+			}
+		}
+		return doc->length;
+	}
+	while(i < doc->length){
+		c = doc->text[i];
+		if(argo_is_whitespace(c) || c == ARGO_COMMA || c == ARGO_COLON
+		   || c == ARGO_RBRACK || c == ARGO_RBRACE){
+			break;
+		}
+		i++;
+	}
+	return i;
+}
+
+/*
+ * Fill in a handle for the value beginning at offset i, whose structural
+ * index is *next_struct if it is an array or object.  On return,
+ * *next_struct is the index of the first container after the value.
+ */
+static int argo_lazy_handle(ARGO_LAZY_DOC *doc, size_t i, int *next_struct, ARGO_LAZY *v){
+	char c;
+
+	if(i >= doc->length){
+		argo_lazy_error(doc, i, "Expect value but seen EOF");
+		return -1;
+	}
+	c = doc->text[i];
+	v->doc = doc;
+	v->offset = i;
+	v->name_offset = ARGO_LAZY_NO_NAME;
+	if(c == ARGO_LBRACK || c == ARGO_LBRACE){
+		v->index = *next_struct;
+		*next_struct = doc->match[v->index] + 1;
+		v->length = doc->structural[doc->match[v->index]] + 1 - i;
+	}
+	else if(c == ARGO_RBRACK || c == ARGO_RBRACE || c == ARGO_COMMA || c == ARGO_COLON){
+		argo_lazy_error(doc, i, "Expect value");
+		return -1;
+	}
+	else{
+		v->index = -1;
+		v->length = argo_lazy_skip_scalar(doc, i) - i;
+	}
+	return 0;
+}
+
+/**
+ * @brief  Open a document held in memory for lazy access.
+ * @details  The text is scanned once to build the structural index, which
+ * only tracks strings and the nesting of arrays and objects; the values
+ * themselves are not checked until they are materialized with
+ * argo_lazy_value, which reports errors just as argo_read_value does.
+ *
+ * @param text  Text of the document, which must remain valid and unchanged
+ * until the document is closed.
+ * @param length  Length of the text.
+ * @return  A valid pointer if the operation is completely successful,
+ * NULL if the brackets and braces of the document do not match or there
+ * is any other error.
+ */
+ARGO_LAZY_DOC *argo_lazy_open(char *text, size_t length){
+	ARGO_LAZY_DOC *doc = calloc(1, sizeof(ARGO_LAZY_DOC));
+	int *stack = NULL;
+	int size = 0;
+	int depth = 0;
+	int in_string = 0;
+	int j;
+	size_t i;
+	char c;
+
+	if(doc == NULL){
+		fprintf(stderr, "Failed to allocate lazy document\n");
+		return NULL;
+	}
+	doc->text = text;
+	doc->length = length;
+
+	for(i = 0; i < length; i++){
+		c = text[i];
+		if(in_string){
+			if(c == ARGO_BSLASH){
+				i++;
+			}
+			else if(c == ARGO_QUOTE){
+				in_string = 0;
+			}
+			continue;
+		}
+		if(c == ARGO_QUOTE){
+			in_string = 1;
+			continue;
+		}
+		if(c != ARGO_LBRACK && c != ARGO_LBRACE && c != ARGO_RBRACK && c != ARGO_RBRACE){
+			continue;
+		}
+		if(doc->count == size){
+			size = size ? 2 * size : ARGO_LAZY_MIN_INDEX;
+			size_t *s = realloc(doc->structural, size * sizeof(size_t));
+			int *m = s ? realloc(doc->match, size * sizeof(int)) : NULL;
+			int *st = m ? realloc(stack, size * sizeof(int)) : NULL;
+			if(s) doc->structural = s;
+			if(m) doc->match = m;
+			if(st == NULL){
+				fprintf(stderr, "Failed to allocate structural index\n");
+				goto fail;
+			}
+			stack = st;
+		}
+		doc->structural[doc->count] = i;
+		if(c == ARGO_LBRACK || c == ARGO_LBRACE){
+			stack[depth++] = doc->count;
+		}
+		else{
+			if(depth == 0){
+				argo_lazy_error(doc, i, "Unmatched closing bracket");
+				goto fail;
+			}
+			j = stack[--depth];
+			if((text[doc->structural[j]] == ARGO_LBRACK) != (c == ARGO_RBRACK)){
+				argo_lazy_error(doc, i, "Mismatched closing bracket");
+				goto fail;
+			}
+			doc->match[j] = doc->count;
+			doc->match[doc->count] = j;
+		}
+		doc->count++;
+	}
+	if(in_string){
+		argo_lazy_error(doc, length, "Unterminated string");
+		goto fail;
+	}
+	if(depth){
+		argo_lazy_error(doc, length, "Unclosed array or object");
+		goto fail;
+	}
+	free(stack);
+	return doc;
+
+ fail:
+	free(stack);
+	argo_lazy_close(doc);
+	return NULL;
+}
+
+/**
+ * @brief  Release the index of a lazy document.
+ * @details  The values that were materialized from it remain valid, as they
+ * belong to the context from which they were allocated.
+ *
+ * @param doc  The document to be closed.
+ */
+void argo_lazy_close(ARGO_LAZY_DOC *doc){
+	if(doc == NULL){
+		return;
+	}
+	free(doc->structural);
+	free(doc->match);
+	free(doc->memo);
+	free(doc);
+}
+
+/**
+ * @brief  Get a handle on the top-level value of a lazy document.
+ *
+ * @param doc  The document.
+ * @param root  Handle to be filled in.
+ * @return  Zero if the operation is completely successful,
+ * nonzero if there is any error.
+ */
+int argo_lazy_root(ARGO_LAZY_DOC *doc, ARGO_LAZY *root){
+	int next_struct = 0;
+	size_t i = argo_lazy_skip_whitespace(doc, 0);
+
+	if(argo_lazy_handle(doc, i, &next_struct, root)){
+		return -1;
+	}
+	i = argo_lazy_skip_whitespace(doc, i + root->length);
+	if(i < doc->length){
+		argo_lazy_error(doc, i, "Unexpected data after value");
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief  Determine the type of a value from its first character,
+ * without materializing it.
+ *
+ * @param v  Handle on the value.
+ * @return  The type the value has if it is well-formed.
+ */
+ARGO_VALUE_TYPE argo_lazy_type(ARGO_LAZY *v){
+	char c = v->doc->text[v->offset];
+
+	if(c == ARGO_LBRACE){
+		return ARGO_OBJECT_TYPE;
+	}
+	if(c == ARGO_LBRACK){
+		return ARGO_ARRAY_TYPE;
+	}
+	if(c == ARGO_QUOTE){
+		return ARGO_STRING_TYPE;
+	}
+	if(argo_maybe_basic(c)){
+		return ARGO_BASIC_TYPE;
+	}
+	return ARGO_NUMBER_TYPE;
+}
+
+/**
+ * @brief  Start iterating over the elements of an array or the members of
+ * an object.
+ *
+ * @param v  Handle on the array or object.
+ * @param it  Iterator to be initialized.
+ * @return  Zero if the operation is completely successful,
+ * nonzero if the value is not an array or object.
+ */
+int argo_lazy_iterate(ARGO_LAZY *v, ARGO_LAZY_ITER *it){
+	if(v->index < 0){
+		argo_lazy_error(v->doc, v->offset, "Expect array or object");
+		return -1;
+	}
+	it->doc = v->doc;
+	it->pos = argo_lazy_skip_whitespace(v->doc, v->offset + 1);
+	it->next_struct = v->index + 1;
+	it->is_object = v->doc->text[v->offset] == ARGO_LBRACE;
+	// the closing bracket is the next structural character exactly when the container is empty
+	it->done = it->next_struct == v->doc->match[v->index]
+		&& it->pos == v->doc->structural[it->next_struct];
+	return 0;
+}
+
+/**
+ * @brief  Advance an iteration by one element or member.
+ * @details  Nested arrays and objects are stepped over using the structural
+ * index, without looking at their contents.  For members of an object, the
+ * handle also records where the member name is, which may be checked with
+ * argo_lazy_name_is and becomes the name of the materialized value.
+ *
+ * @param it  The iteration.
+ * @param item  Handle to be filled in with the next element or member.
+ * @return  One if an element or member was found, zero at the end of the
+ * array or object, and -1 if there is any error.
+ */
+int argo_lazy_next(ARGO_LAZY_ITER *it, ARGO_LAZY *item){
+	ARGO_LAZY_DOC *doc = it->doc;
+	size_t i = it->pos;
+	size_t name = ARGO_LAZY_NO_NAME;
+	char c;
+
+	if(it->done){
+		return 0;
+	}
+	if(it->is_object){
+		if(i >= doc->length || doc->text[i] != ARGO_QUOTE){
+			argo_lazy_error(doc, i, "Expect member name");
+			return -1;
+		}
+		name = i;
+		i = argo_lazy_skip_whitespace(doc, argo_lazy_skip_scalar(doc, i));
+		if(i >= doc->length || doc->text[i] != ARGO_COLON){
+			argo_lazy_error(doc, i, "Expect : in object");
+			return -1;
+		}
+		i = argo_lazy_skip_whitespace(doc, i + 1);
+	}
+	if(argo_lazy_handle(doc, i, &it->next_struct, item)){
+		return -1;
+	}
+	item->name_offset = name;
+
+	i = argo_lazy_skip_whitespace(doc, i + item->length);
+	c = i < doc->length ? doc->text[i] : 0;
+	if(c == ARGO_COMMA){
+		it->pos = argo_lazy_skip_whitespace(doc, i + 1);
+	}
+	else if(c == (it->is_object ? ARGO_RBRACE : ARGO_RBRACK)){
+		it->done = 1;
+	}
+	else{
+		argo_lazy_error(doc, i, "Expect , or closing bracket");
+		return -1;
+	}
+	return 1;
+}
+
+/**
+ * @brief  Check whether the name of a member is the given string.
+ * @details  Escape sequences in the name are decoded as they are compared;
+ * a character is compared with a single byte of the given string.
+ *
+ * @param member  Handle on a member, obtained by iterating over an object.
+ * @param name  The name to compare with.
+ * @return  Nonzero if the names are equal, zero otherwise.
+ */
+int argo_lazy_name_is(ARGO_LAZY *member, char *name){
+	ARGO_LAZY_DOC *doc = member->doc;
+	size_t i = member->name_offset;
+	int k, digit;
+	ARGO_CHAR c;
+
+	if(i == ARGO_LAZY_NO_NAME){
+		return 0;
+	}
+	for(i++; i < doc->length && doc->text[i] != ARGO_QUOTE; i++, name++){
+		c = (unsigned char) doc->text[i];
+		if(c == ARGO_BSLASH && i + 1 < doc->length){
+			c = doc->text[++i];
+			switch(c){
+			case ARGO_B: c = ARGO_BS; break;
+			case ARGO_F: c = ARGO_FF; break;
+			case ARGO_N: c = ARGO_LF; break;
+			case ARGO_R: c = ARGO_CR; break;
+			case ARGO_T: c = ARGO_HT; break;
+			case ARGO_U:
+				if(i + 4 >= doc->length){
+					return 0;
+				}
+				c = 0;
+				for(k = 0; k < 4; k++){
+					digit = doc->text[++i];
+					if(argo_is_digit(digit)){
+						digit -= '0';
+					}
+					else if(argo_is_hex(digit)){
+						digit = (digit | 0x20) - 'a' + 10;
+					}
+					else{
+						return 0;
+					}
+					c = c * 16 + digit;
+				}
+				break;
+			}
+		}
+		if(*name == '\0' || c != (unsigned char) *name){
+			return 0;
+		}
+	}
+	return *name == '\0';
+}
+
+/**
+ * @brief  Find a member of an object by name.
+ * @details  If the object has several members with the name, the first of
+ * them is found.
+ *
+ * @param obj  Handle on the object.
+ * @param name  Name of the member.
+ * @param member  Handle to be filled in with the member.
+ * @return  Zero if the member was found, one if the object has no such
+ * member, and -1 if there is any error.
+ */
+int argo_lazy_get(ARGO_LAZY *obj, char *name, ARGO_LAZY *member){
+	ARGO_LAZY_ITER it;
+	int found;
+
+	if(argo_lazy_type(obj) != ARGO_OBJECT_TYPE){
+		argo_lazy_error(obj->doc, obj->offset, "Expect object");
+		return -1;
+	}
+	argo_lazy_iterate(obj, &it);
+	while((found = argo_lazy_next(&it, member)) > 0){
+		if(argo_lazy_name_is(member, name)){
+			return 0;
+		}
+	}
+	return found ? -1 : 1;
+}
+
+/**
+ * @brief  Find an element of an array by position.
+ *
+ * @param arr  Handle on the array.
+ * @param i  Position of the element, starting from zero.
+ * @param element  Handle to be filled in with the element.
+ * @return  Zero if the element was found, one if the array has no more
+ * than i elements, and -1 if there is any error.
+ */
+int argo_lazy_at(ARGO_LAZY *arr, int i, ARGO_LAZY *element){
+	ARGO_LAZY_ITER it;
+	int found;
+
+	if(argo_lazy_type(arr) != ARGO_ARRAY_TYPE){
+		argo_lazy_error(arr->doc, arr->offset, "Expect array");
+		return -1;
+	}
+	argo_lazy_iterate(arr, &it);
+	while((found = argo_lazy_next(&it, element)) > 0){
+		if(i-- == 0){
+			return 0;
+		}
+	}
+	return found ? -1 : 1;
+}
+
+/*
+ * Memo of materialized values: an open-addressing table keyed by offset.
+ */
+static ARGO_VALUE **argo_lazy_memo_slot(ARGO_LAZY_DOC *doc, size_t offset){
+	int k;
+	struct argo_lazy_memo *old = doc->memo;
+	int old_size = doc->memo_size;
+
+	if(2 * (doc->memo_used + 1) > doc->memo_size){
+		int size = old_size ? 2 * old_size : ARGO_LAZY_MIN_MEMO;
+		doc->memo = calloc(size, sizeof(struct argo_lazy_memo));
+		if(doc->memo == NULL){
+			fprintf(stderr, "Failed to allocate lazy memo\n");
+			doc->memo = old;
+			return NULL;
+		}
+		doc->memo_size = size;
+		for(k = 0; k < old_size; k++){
+			if(old[k].value){
+				*argo_lazy_memo_slot(doc, old[k].offset) = old[k].value;
+			}
+		}
+		free(old);
+	}
+	k = (offset * 0x9E3779B1u) & (doc->memo_size - 1);
+	while(doc->memo[k].value && doc->memo[k].offset != offset){
+		k = (k + 1) & (doc->memo_size - 1);
+	}
+	doc->memo[k].offset = offset;
+	return &doc->memo[k].value;
+}
+
+/*
+ * Open a stream on part of the text of a lazy document, and set the
+ * position of the calling thread's context to where that part begins,
+ * so that errors are reported at their position in the whole document.
+ */
+static FILE *argo_lazy_stream(ARGO_LAZY_DOC *doc, size_t offset, size_t length){
+	FILE *f = fmemopen(doc->text + offset, length, "r");
+	int line, column;
+	if(f == NULL){
+		fprintf(stderr, "Failed to open value for reading\n");
+		return NULL;
+	}
+	argo_lazy_position(doc, offset, &line, &column);
+	argo_context_input(argo_ctx, doc->text + offset, length, line, column);
+	return f;
+}
+
+/**
+ * @brief  Materialize a value of a lazy document.
+ * @details  The value and everything inside it is parsed into ARGO_VALUE
+ * nodes allocated from the calling thread's context, which is the only
+ * time its text is read in full.  A member of an object gets its name as
+ * well.  Values are remembered, so that materializing the same value again
+ * returns the same node; they are linked to nothing, and neither their
+ * next and prev pointers nor the lists they belong to in the document
+ * are filled in.
+ *
+ * @param v  Handle on the value.
+ * @return  A valid pointer if the operation is completely successful,
+ * NULL if there is any error.
+ */
+ARGO_VALUE *argo_lazy_value(ARGO_LAZY *v){
+	ARGO_LAZY_DOC *doc = v->doc;
+	ARGO_VALUE **slot = argo_lazy_memo_slot(doc, v->offset);
+	ARGO_VALUE *av;
+	FILE *f;
+
+	if(slot == NULL){
+		return NULL;
+	}
+	if(*slot){
+		return *slot;
+	}
+	f = argo_lazy_stream(doc, v->offset, v->length);
+	if(f == NULL){
+		return NULL;
+	}
+	av = argo_read_value(f);
+	fclose(f);
+	if(av == NULL){
+		return NULL;
+	}
+	if(v->name_offset != ARGO_LAZY_NO_NAME){
+		f = argo_lazy_stream(doc, v->name_offset, argo_lazy_skip_scalar(doc, v->name_offset) - v->name_offset);
+		if(f == NULL){
+			return NULL;
+		}
+		if(argo_read_string(&av->name, f)){
+			fclose(f);
+			return NULL;
+		}
+		fclose(f);
+	}
+	doc->memo_used++;
+	*slot = av;
+	return av;
+}
@@ -4,6 +4,25 @@
 #include "argo.h"
 #include "global.h"
 #include "debug.h"
+#include "options.h"
+#include "ndjson.h"
+#include "parallel.h"
+#include "query.h"
+#include "keep.h"
+#include "writer.h"
+#include "binary.h"
+#include "encode.h"
+#include "jcs.h"
+#include "hash.h"
+#include "merkle.h"
+#include "context.h"
+#include "dedup.h"
+#include "files.h"
+#include "serve.h"
+#include "ring.h"
+#include "source.h"
+#include "compress.h"
+#include "head.h"
 
 #ifdef _STRING_H
 #error "Do not #include <string.h>. You will get a ZERO."
@@ -17,6 +36,15 @@
 #error "Do not #include <ctype.h>. You will get a ZERO."
 #endif
 
+/*
+ * Print the help for the options that USAGE does not describe.  USAGE
+ * exits, so this is called on the way out.
+ */
+static void argo_more_usage(void)
+{
+    fprintf(stderr, "%s", ARGO_MORE_USAGE);
+}
+
 int main(int argc, char **argv)
 {
     /**
@@ -26,6 +54,11 @@ int main(int argc, char **argv)
     argo_chars_read = 0;
     argo_next_value = 0;
     ARGO_VALUE *argo_root = NULL;
+    FILE *in = stdin;
+    FILE *out = stdout;
+    ARGO_SOURCE *source = NULL;
+    int format = ARGO_COMPRESS_NONE;
+    long offset;
     int write_error = 0;
     indent_level = 0;
     global_options = 0x00000000;
@@ -35,6 +68,7 @@ int main(int argc, char **argv)
      * USAGE(program_name, return_code) and return EXIT_FAILURE.
      */
     if(validargs(argc, argv)){
+        atexit(argo_more_usage);
         USAGE(*argv, EXIT_FAILURE);
     }
 
@@ -44,9 +78,127 @@ int main(int argc, char **argv)
      * and return EXIT_SUCCESS.
      */
     if(global_options == HELP_OPTION){
+        atexit(argo_more_usage);
         USAGE(*argv, EXIT_SUCCESS);
     }
 
+    /*
+     * The output format is now fixed, so select the writer specialized for it,
+     * or the encoder of the binary format requested instead of JSON.
+     */
+    argo_select_writer(global_options & INDENT_MASK);
+    if(global_options & CBOR_OPTION){
+        argo_writer = argo_write_cbor;
+    }
+    else if(global_options & MSGPACK_OPTION){
+        argo_writer = argo_write_msgpack;
+    }
+    else if(global_options & JCS_OPTION){
+        argo_writer = argo_write_jcs;
+    }
+
+    /*
+     * If the --serve flag is provided, then the program runs until it is
+     * interrupted, answering the requests of clients on a Unix domain socket
+     * with a pool of -j worker threads.  With --load, it is such a client, which
+     * sends the document on standard input over and over and reports the
+     * latency and throughput of the server.
+     */
+    if(global_options & SERVE_OPTION){
+        if(argo_serve_run(argo_socket_path)){
+            exit(EXIT_FAILURE);
+        }
+        else{
+            exit(EXIT_SUCCESS);
+        }
+    }
+    if(global_options & LOAD_OPTION){
+        if(argo_load_run(argo_socket_path, argo_load_requests, stdin, stdout)){
+            exit(EXIT_FAILURE);
+        }
+        else{
+            exit(EXIT_SUCCESS);
+        }
+    }
+
+    /*
+     * If the -H flag is provided, then the output goes into a stream that only
+     * hashes it, and the hashes are printed to standard output when that stream
+     * is closed.  With -n, each record is hashed on its own instead.
+     */
+    if((global_options & HASH_OPTION) && !(global_options & NDJSON_OPTION)){
+        out = argo_hash_open(argo_hash_algorithms, stdout);
+        if(out == NULL){
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /*
+     * If the --dedup flag is provided, then equal values share one copy as the
+     * input is parsed; with -s, what that saved is reported on standard error.
+     */
+    if(global_options & DEDUP_OPTION){
+        if(argo_dedup_enable(argo_ctx)){
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /*
+     * Standard input that is compressed with gzip or zstd is decompressed by a
+     * thread of its own while it is being parsed.  If the --pipeline flag is
+     * provided, then standard input is read ahead by that thread in any case.
+     * Only the first bytes of a pipe tell whether it is compressed, and they
+     * cannot be put back, so a pipe is read through a source in any case.
+     * With -n (unless only some records are output) or files, input is
+     * decompressed where it is read instead, and a snapshot for -B must be
+     * mapped as it is.  Records that are only output in part are read through
+     * a source in any case, so that the line of each one can be told from the
+     * text it holds rather than by reading it again.
+     */
+    if(!(global_options & (FILES_OPTION | DIFF_OPTION | LOAD_BINARY_OPTION))
+       && (!(global_options & NDJSON_OPTION) || argo_head_count || argo_sample_rate)){
+        format = argo_compress_detect(stdin);
+        if(format != ARGO_COMPRESS_NONE || argo_pipeline || (global_options & NDJSON_OPTION)){
+            source = argo_decompress_open(argo_source_open(stdin), &format);
+            if(argo_pipeline || format != ARGO_COMPRESS_NONE){
+                in = argo_ring_open_source(source);
+            }
+            else{
+                in = argo_source_stream(source);
+            }
+            if(in == NULL){
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    /*
+     * Positions in error messages count from where standard input starts,
+     * which need not be the beginning of the file.
+     */
+    if(in == stdin && (offset = ftell(stdin)) > 0){
+        argo_ctx->mark = offset;
+    }
+
+    /*
+     * If the --compress flag is provided, then the output is compressed, and
+     * that is done by a thread of its own that also writes it.  If the --pipeline
+     * flag is provided, then the output is handed to such a thread in any case,
+     * so that I/O overlaps with the work.
+     */
+    if(argo_compress_format != ARGO_COMPRESS_NONE){
+        out = argo_compress_open(out, argo_compress_format, out != stdout);
+        if(out == NULL){
+            exit(EXIT_FAILURE);
+        }
+    }
+    if(argo_compress_format != ARGO_COMPRESS_NONE || (argo_pipeline && !(global_options & VALIDATE_OPTION))){
+        out = argo_ring_open_output(out, out != stdout);
+        if(out == NULL){
+            exit(EXIT_FAILURE);
+        }
+    }
+
     /**
      * If the -v flag is provided, then the program will read data from standard input
      * (stdin) and validate that it is syntactically correct JSON. If so, the program
@@ -55,8 +207,11 @@ int main(int argc, char **argv)
      * standard error (stderr) an error message describing the error that was discovered.
      * No other output is produced.
      */
-    if(global_options == VALIDATE_OPTION){
-        argo_root = argo_read_value(stdin);
+    if((global_options & ~(DEDUP_OPTION | STATISTICS_OPTION)) == VALIDATE_OPTION){
+        argo_root = argo_read_value(in);
+        if(argo_root != NULL && (global_options & STATISTICS_OPTION)){
+            argo_dedup_report(argo_ctx, stderr);
+        }
         if(argo_root == NULL){
             exit(EXIT_FAILURE);
         }
@@ -65,6 +220,164 @@ int main(int argc, char **argv)
         }
     }
 
+    /*
+     * If the --head or --sample flag is provided, then only some elements of the
+     * top-level array, or records with -n, are read and output in canonical form,
+     * one at a time, and input after the last one needed is not read.
+     */
+    if(argo_head_count || argo_sample_rate){
+        if(argo_head_run(in, out) || (out != stdout && fclose(out))){
+            exit(EXIT_FAILURE);
+        }
+        else{
+            exit(EXIT_SUCCESS);
+        }
+    }
+
+    /*
+     * If the -n flag is provided, then the input is newline-delimited JSON:
+     * each line holds one value, which is validated (-v) or canonicalized (-c)
+     * on its own and, in the latter case, output on a line by itself.
+     * The records are processed by a pool of -j worker threads and output
+     * in input order.
+     */
+    if(global_options & NDJSON_OPTION){
+        if(argo_ndjson_run(stdin, out) || (out != stdout && fclose(out))){
+            exit(EXIT_FAILURE);
+        }
+        else{
+            exit(EXIT_SUCCESS);
+        }
+    }
+
+    /*
+     * If files are named after the flags, then each of them is validated or
+     * canonicalized as for -v or -c, by a pool of -j worker threads, instead of
+     * standard input.  The outputs are written to standard output in the order
+     * of the names, or, if the -w flag is provided, each beside its file.
+     */
+    if(global_options & FILES_OPTION){
+        if(argo_files_run(argo_files, argo_num_files, out) || (out != stdout && fclose(out))){
+            exit(EXIT_FAILURE);
+        }
+        else{
+            exit(EXIT_SUCCESS);
+        }
+    }
+
+    /*
+     * If the -j flag is provided without -n, then the whole input is read into
+     * memory and, if it is an array, its elements are parsed by a pool of -j
+     * worker threads.  The result is validated or canonicalized as for -v or -c.
+     */
+    if(global_options & PARALLEL_OPTION){
+        if(argo_parallel_run(in, out) || (out != stdout && fclose(out))){
+            exit(EXIT_FAILURE);
+        }
+        else{
+            exit(EXIT_SUCCESS);
+        }
+    }
+
+    /*
+     * If the -q flag is provided, then only the value addressed by the given
+     * JSON Pointer is read and output in canonical form, pretty-printed if
+     * -c -p is also given (-p must come right after -c, as everywhere, so
+     * -q PTR -c -p or -c -p -q PTR, never -c -q PTR -p).  The rest of the document is skipped without being
+     * parsed, and input after the addressed value is not read at all.
+     */
+    if(global_options & QUERY_OPTION){
+        if(argo_query_run(in, out, argo_query_path) || (out != stdout && fclose(out))){
+            exit(EXIT_FAILURE);
+        }
+        else{
+            exit(EXIT_SUCCESS);
+        }
+    }
+
+    /*
+     * If the --keep flag is provided, then the document is output in canonical
+     * form with only the members and elements on the given paths.  Everything
+     * else is skipped without being parsed.
+     */
+    if(global_options & KEEP_OPTION){
+        if(argo_keep_run(in, out, argo_keep_spec) || (out != stdout && fclose(out))){
+            exit(EXIT_FAILURE);
+        }
+        else{
+            exit(EXIT_SUCCESS);
+        }
+    }
+
+    /*
+     * If the --diff flag is provided, then the documents in the two files, each
+     * JSON text or a snapshot saved with -b, are compared, and the differences
+     * are output as a JSON Patch that turns the first into the second.
+     */
+    if(global_options & DIFF_OPTION){
+        if(argo_diff_run(argo_diff_files[0], argo_diff_files[1], stdout)){
+            exit(EXIT_FAILURE);
+        }
+        else{
+            exit(EXIT_SUCCESS);
+        }
+    }
+
+    /*
+     * If the -b flag is provided, then the input is read and validated as for -v,
+     * and a binary snapshot of it is written to standard output.
+     */
+    if(global_options & SAVE_BINARY_OPTION){
+        argo_root = argo_read_value(in);
+        if(argo_root != NULL && (global_options & STATISTICS_OPTION)){
+            argo_dedup_report(argo_ctx, stderr);
+        }
+        if(argo_root == NULL || argo_save_binary(argo_root, out) || (out != stdout && fclose(out))){
+            exit(EXIT_FAILURE);
+        }
+        else{
+            exit(EXIT_SUCCESS);
+        }
+    }
+
+    /*
+     * If the -B flag is provided, then standard input must be a binary snapshot
+     * saved with -b.  It is loaded without parsing and output in canonical form,
+     * as for -c and -p.
+     */
+    if(global_options & LOAD_BINARY_OPTION){
+        argo_root = argo_load_binary(in);
+        if(argo_root == NULL || argo_write_value(argo_root, out) || (out != stdout && fclose(out))){
+            exit(EXIT_FAILURE);
+        }
+        else{
+            exit(EXIT_SUCCESS);
+        }
+    }
+
+    /*
+     * If --from-cbor or --from-msgpack is provided, then the input is read in that
+     * format instead of JSON, and is then validated (-v) or output (-c, -p) as usual.
+     */
+    if(global_options & (FROM_CBOR_OPTION | FROM_MSGPACK_OPTION)){
+        if(global_options & FROM_CBOR_OPTION){
+            argo_root = argo_read_cbor(in);
+        }
+        else{
+            argo_root = argo_read_msgpack(in);
+        }
+        if(argo_root == NULL){
+            exit(EXIT_FAILURE);
+        }
+        if(global_options & VALIDATE_OPTION){
+            exit(EXIT_SUCCESS);
+        }
+        if(argo_write_value(argo_root, out) || (out != stdout && fclose(out))){
+            exit(EXIT_FAILURE);
+        }
+        exit(EXIT_SUCCESS);
+    }
+
     /*
      * If the -c flag is provided, then the program performs the same function as
      * described for -v, but after validating the input, the program will also output
@@ -73,14 +386,26 @@ int main(int argc, char **argv)
      * for variation have been eliminated.  This is described in more detail below.
      * Unless -p has also been specified, then the produced output contains no whitespace
      * (except within strings that contain whitespace characters).
+     * If -u has also been specified, then input and output are UTF-8, and characters
+     * beyond ASCII are output directly instead of as escape sequences.
+     * If --cbor or --msgpack has also been specified, then the output is in that
+     * format instead of JSON.
+     * If -C is specified instead of -c, then the output is in the canonical form
+     * of RFC 8785, with the members of every object sorted by name.
+     * If -H has also been specified, then only the hashes of the output are printed.
+     * If --dedup has also been specified, then equal values are shared while parsing.
      */
-    if(global_options == CANONICALIZE_OPTION){
-        argo_root = argo_read_value(stdin);
+    if((global_options & ~(UTF8_OPTION | CBOR_OPTION | MSGPACK_OPTION | JCS_OPTION | HASH_OPTION
+                           | DEDUP_OPTION | STATISTICS_OPTION)) == CANONICALIZE_OPTION){
+        argo_root = argo_read_value(in);
+        if(argo_root != NULL && (global_options & STATISTICS_OPTION)){
+            argo_dedup_report(argo_ctx, stderr);
+        }
         if(argo_root == NULL){
             exit(EXIT_FAILURE);
         }
         else{
-            write_error = argo_write_value(argo_root, stdout);
+            write_error = argo_write_value(argo_root, out) || (out != stdout && fclose(out));
             if(write_error){
                 exit(EXIT_FAILURE);
             }
@@ -100,13 +425,17 @@ int main(int argc, char **argv)
      * the same as for a nonnegative integer number in the JSON specification.
      * If -p is provided without any INDENT, then a default value of 4 is used.
      */
-    if((global_options >> 8 << 8) == (CANONICALIZE_OPTION|PRETTY_PRINT_OPTION)){
-        argo_root = argo_read_value(stdin);
+    if(((global_options & ~(UTF8_OPTION | HASH_OPTION | DEDUP_OPTION | STATISTICS_OPTION)) >> 8 << 8)
+       == (CANONICALIZE_OPTION|PRETTY_PRINT_OPTION)){
+        argo_root = argo_read_value(in);
+        if(argo_root != NULL && (global_options & STATISTICS_OPTION)){
+            argo_dedup_report(argo_ctx, stderr);
+        }
         if(argo_root == NULL){
             exit(EXIT_FAILURE);
         }
         else{
-            write_error = argo_write_value(argo_root, stdout);
+            write_error = argo_write_value(argo_root, out) || (out != stdout && fclose(out));
             if(write_error){
                 exit(EXIT_FAILURE);
             }
@@ -0,0 +1,696 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "utils.h"
+#include "context.h"
+#include "binary.h"
+#include "hash.h"
+#include "merkle.h"
+
+static uint64_t argo_merkle_string(uint64_t seed, ARGO_STRING *s){
+	return argo_xxh64(s->content, s->length * sizeof(ARGO_CHAR), seed);
+}
+
+/*
+ * Hash a value, after the values inside it, storing every hash in the table.
+ * The type of the value is the seed, so that values of different types
+ * cannot hash alike merely because their contents do.
+ */
+static int argo_merkle_value(ARGO_MERKLE *m, ARGO_VALUE *v, uint64_t *hash){
+	ARGO_NUMBER *n = &v->content.number;
+	ARGO_VALUE *head, *list_ptr;
+	ARGO_XXH64 x;
+	uint64_t words[2];
+	uint64_t h, child;
+	union { double d; uint64_t u; } bits;
+
+	if(v < m->base || v >= m->base + m->count){
+		fprintf(stderr, "Value is not in the hashed context\n");
+		return -1;
+	}
+	switch(v->type){
+	case ARGO_BASIC_TYPE:
+		words[0] = v->content.basic;
+		h = argo_xxh64(words, sizeof(uint64_t), v->type);
+		break;
+	case ARGO_NUMBER_TYPE:
+		// the same fields as argo_write_number looks at, in the same order
+		if(n->valid_int){
+			words[0] = 1;
+			words[1] = n->int_value;
+			h = argo_xxh64(words, sizeof(words), v->type);
+		}
+		else if(n->valid_float){
+			bits.d = n->float_value;
+			words[0] = 2;
+			words[1] = bits.u;
+			h = argo_xxh64(words, sizeof(words), v->type);
+		}
+		else{
+			h = argo_merkle_string(v->type, &n->string_value);
+		}
+		break;
+	case ARGO_STRING_TYPE:
+		h = argo_merkle_string(v->type, &v->content.string);
+		break;
+	case ARGO_ARRAY_TYPE:
+		argo_xxh64_init(&x, v->type);
+		head = v->content.array.element_list;
+		for(list_ptr = head->next; list_ptr != head; list_ptr = list_ptr->next){
+			if(argo_merkle_value(m, list_ptr, &child)){
+				return -1;
+			}
+			argo_xxh64_update(&x, &child, sizeof(child));
+		}
+		h = argo_xxh64_final(&x);
+		break;
+	case ARGO_OBJECT_TYPE:
+		// members are summed, so that their order makes no difference
+		words[0] = 0;
+		words[1] = 0;
+		head = v->content.object.member_list;
+		for(list_ptr = head->next; list_ptr != head; list_ptr = list_ptr->next){
+			uint64_t member[2];
+			if(argo_merkle_value(m, list_ptr, &member[1])){
+				return -1;
+			}
+			member[0] = argo_merkle_string(0, &list_ptr->name);
+			words[0] += argo_xxh64(member, sizeof(member), ARGO_OBJECT_TYPE);
+			words[1]++;
+		}
+		h = argo_xxh64(words, sizeof(words), v->type);
+		break;
+	default:
+		fprintf(stderr, "Invalid value type (%d) for hash\n", v->type);
+		return -1;
+	}
+	m->hashes[v - m->base] = h;
+	*hash = h;
+	return 0;
+}
+
+/**
+ * @brief  Compute the Merkle hash of a value and of every value inside it.
+ * @details  The value must have been allocated from the current context,
+ * and the hashes remain valid until the context is reset.  They can then be
+ * looked up with argo_merkle_hash.
+ *
+ * @param m  Where to store the table of hashes, which is to be freed with
+ * argo_merkle_free.
+ * @param v  The value to hash.
+ * @return  Zero if the operation is completely successful,
+ * nonzero if there is any error.
+ */
+int argo_merkle_build(ARGO_MERKLE *m, ARGO_VALUE *v){
+	ARGO_CONTEXT *ctx = argo_ctx;
+	uint64_t h;
+
+	m->base = ctx->value_storage;
+	m->count = ctx->next_value;
+	m->hashes = malloc((m->count ? m->count : 1) * sizeof(uint64_t));
+	if(m->hashes == NULL){
+		fprintf(stderr, "Failed to allocate hashes\n");
+		return -1;
+	}
+	if(argo_merkle_value(m, v, &h)){
+		argo_merkle_free(m);
+		return -1;
+	}
+	return 0;
+}
+
+void argo_merkle_free(ARGO_MERKLE *m){
+	free(m->hashes);
+	m->hashes = NULL;
+	m->count = 0;
+}
+
+/*
+ * State of a diff: the two tables of hashes, the JSON Pointer of the
+ * values being compared, and the number of operations output so far.
+ */
+typedef struct argo_diff_state {
+	ARGO_MERKLE *ma;
+	ARGO_MERKLE *mb;
+	ARGO_STRING path;
+	long ops;
+	FILE *out;
+} ARGO_DIFF_STATE;
+
+/*
+ * Append a reference token to the path, escaping '~' and '/' as ~0 and ~1.
+ */
+static int argo_diff_push_name(ARGO_DIFF_STATE *d, ARGO_STRING *name){
+	size_t i;
+	ARGO_CHAR c;
+
+	if(argo_append_char(&d->path, ARGO_FSLASH)){
+		return -1;
+	}
+	for(i = 0; i < name->length; i++){
+		c = name->content[i];
+		if(c == '~' || c == ARGO_FSLASH){
+			if(argo_append_char(&d->path, '~') || argo_append_char(&d->path, c == '~' ? '0' : '1')){
+				return -1;
+			}
+		}
+		else if(argo_append_char(&d->path, c)){
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int argo_diff_push_index(ARGO_DIFF_STATE *d, long index){
+	char digits[24];
+	int n = 0;
+
+	do{
+		digits[n++] = ARGO_DIGIT0 + index % 10;
+		index /= 10;
+	} while(index > 0);
+	if(argo_append_char(&d->path, ARGO_FSLASH)){
+		return -1;
+	}
+	while(n > 0){
+		if(argo_append_char(&d->path, digits[--n])){
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Output one operation on the current path, with a value unless it is
+ * NULL: {"op":"...","path":"...","value":...}, on a line by itself.
+ */
+static int argo_diff_op(ARGO_DIFF_STATE *d, char *op, ARGO_VALUE *v){
+	FILE *out = d->out;
+
+	if(fputs(d->ops ? ",\n{\"op\":\"" : "[\n{\"op\":\"", out) == EOF
+	   || fputs(op, out) == EOF || fputs("\",\"path\":", out) == EOF
+	   || argo_write_string(&d->path, out)){
+		fprintf(stderr, "Error EOF\n");
+		return -1;
+	}
+	if(v != NULL){
+		if(fputs(",\"value\":", out) == EOF || argo_write_value(v, out)){
+			fprintf(stderr, "Error EOF\n");
+			return -1;
+		}
+	}
+	if(fputc(ARGO_RBRACE, out) == EOF){
+		fprintf(stderr, "Error EOF\n");
+		return -1;
+	}
+	d->ops++;
+	return 0;
+}
+
+static int argo_diff_value(ARGO_DIFF_STATE *d, ARGO_VALUE *a, ARGO_VALUE *b);
+
+/*
+ * Number of elements or members in a list.
+ */
+static size_t argo_diff_count(ARGO_VALUE *head){
+	ARGO_VALUE *list_ptr;
+	size_t n = 0;
+	for(list_ptr = head->next; list_ptr != head; list_ptr = list_ptr->next){
+		n++;
+	}
+	return n;
+}
+
+/*
+ * Gather the elements of an array, as they can only be followed forward
+ * through the list (the parser does not keep prev pointers at the end).
+ */
+static ARGO_VALUE **argo_diff_elements(ARGO_VALUE *head, size_t *count){
+	ARGO_VALUE *list_ptr;
+	ARGO_VALUE **elements;
+	size_t n = argo_diff_count(head);
+
+	elements = malloc((n ? n : 1) * sizeof(ARGO_VALUE *));
+	if(elements == NULL){
+		fprintf(stderr, "Failed to allocate elements\n");
+		return NULL;
+	}
+	n = 0;
+	for(list_ptr = head->next; list_ptr != head; list_ptr = list_ptr->next){
+		elements[n++] = list_ptr;
+	}
+	*count = n;
+	return elements;
+}
+
+/*
+ * Elements of two arrays being compared, and the difference between the
+ * index that an element of the first has in the array as patched so far
+ * and its index in the first, as JSON Patch applies operations in order.
+ */
+typedef struct argo_diff_seq {
+	ARGO_VALUE **ea;
+	ARGO_VALUE **eb;
+	long delta;
+} ARGO_DIFF_SEQ;
+
+/*
+ * Entry of the table used to find the elements that occur exactly once
+ * in each of two ranges.
+ */
+typedef struct argo_diff_slot {
+	uint64_t hash;
+	size_t count_a, count_b;
+	size_t pos_a, pos_b;
+} ARGO_DIFF_SLOT;
+
+static int argo_diff_at(ARGO_DIFF_STATE *d, ARGO_DIFF_SEQ *s, size_t i, char *op, ARGO_VALUE *v){
+	size_t saved = d->path.length;
+	if(argo_diff_push_index(d, i + s->delta) || argo_diff_op(d, op, v)){
+		return -1;
+	}
+	d->path.length = saved;
+	return 0;
+}
+
+static int argo_diff_range(ARGO_DIFF_STATE *d, ARGO_DIFF_SEQ *s, size_t a0, size_t a1, size_t b0, size_t b1);
+
+/*
+ * Find the anchors of two ranges: pairs of equal elements that occur only
+ * once in each, and that are in the same order in both (the longest such
+ * run, found by patience sorting).  The ranges between the anchors are
+ * then compared on their own.  Returns 1 if there was no anchor, so that
+ * the elements must be compared in pairs.
+ */
+static int argo_diff_anchors(ARGO_DIFF_STATE *d, ARGO_DIFF_SEQ *s, size_t a0, size_t a1, size_t b0, size_t b1){
+	size_t size = 16, mask, i, j, k, n = 0, len = 0, lo, hi;
+	ARGO_DIFF_SLOT *slots = NULL;
+	size_t *pa = NULL, *pb = NULL, *tails = NULL, *links = NULL;
+	uint64_t h;
+	int ret = -1;
+
+	while(size < 2 * (a1 - a0 + b1 - b0)){
+		size *= 2;
+	}
+	mask = size - 1;
+	slots = calloc(size, sizeof(ARGO_DIFF_SLOT));
+	pa = malloc((a1 - a0) * sizeof(size_t));
+	pb = malloc((a1 - a0) * sizeof(size_t));
+	tails = malloc((a1 - a0) * sizeof(size_t));
+	links = malloc((a1 - a0) * sizeof(size_t));
+	if(slots == NULL || pa == NULL || pb == NULL || tails == NULL || links == NULL){
+		fprintf(stderr, "Failed to allocate elements\n");
+		goto done;
+	}
+
+	for(i = a0; i < a1; i++){
+		h = argo_merkle_hash(d->ma, s->ea[i]);
+		for(k = h & mask; slots[k].count_a + slots[k].count_b > 0 && slots[k].hash != h; k = (k + 1) & mask)
+			;
+		slots[k].hash = h;
+		slots[k].count_a++;
+		slots[k].pos_a = i;
+	}
+	for(j = b0; j < b1; j++){
+		h = argo_merkle_hash(d->mb, s->eb[j]);
+		for(k = h & mask; slots[k].count_a + slots[k].count_b > 0 && slots[k].hash != h; k = (k + 1) & mask)
+			;
+		slots[k].hash = h;
+		slots[k].count_b++;
+		slots[k].pos_b = j;
+	}
+	for(i = a0; i < a1; i++){
+		h = argo_merkle_hash(d->ma, s->ea[i]);
+		for(k = h & mask; slots[k].hash != h; k = (k + 1) & mask)
+			;
+		if(slots[k].count_a == 1 && slots[k].count_b == 1){
+			pa[n] = i;
+			pb[n] = slots[k].pos_b;
+			n++;
+		}
+	}
+	if(n == 0){
+		ret = 1;
+		goto done;
+	}
+
+	// longest increasing run of positions in the second range: tails[l] is
+	// the candidate that ends the best run of length l + 1 found so far
+	for(k = 0; k < n; k++){
+		lo = 0;
+		hi = len;
+		while(lo < hi){
+			size_t mid = (lo + hi) / 2;
+			if(pb[tails[mid]] < pb[k]){
+				lo = mid + 1;
+			}
+			else{
+				hi = mid;
+			}
+		}
+		links[k] = lo > 0 ? tails[lo - 1] : n;
+		tails[lo] = k;
+		if(lo == len){
+			len++;
+		}
+	}
+	// follow the links back, reusing tails to hold the run in order
+	for(k = tails[len - 1], i = len; i > 0; k = links[k]){
+		tails[--i] = k;
+	}
+
+	i = a0;
+	j = b0;
+	for(k = 0; k < len; k++){
+		if(argo_diff_range(d, s, i, pa[tails[k]], j, pb[tails[k]])){
+			goto done;
+		}
+		i = pa[tails[k]] + 1;
+		j = pb[tails[k]] + 1;
+	}
+	ret = argo_diff_range(d, s, i, a1, j, b1);
+
+done:
+	free(slots);
+	free(pa);
+	free(pb);
+	free(tails);
+	free(links);
+	return ret;
+}
+
+/*
+ * Compare a range of the elements of the first array with a range of the
+ * second.  Equal elements at the start and at the end are skipped by their
+ * hashes; what is left is split at its anchors, if it has any, or else its
+ * elements are compared in pairs, and the surplus is removed or added.
+ */
+static int argo_diff_range(ARGO_DIFF_STATE *d, ARGO_DIFF_SEQ *s, size_t a0, size_t a1, size_t b0, size_t b1){
+	size_t saved = d->path.length;
+	int ret;
+
+	while(a0 < a1 && b0 < b1 && argo_merkle_hash(d->ma, s->ea[a0]) == argo_merkle_hash(d->mb, s->eb[b0])){
+		a0++;
+		b0++;
+	}
+	while(a0 < a1 && b0 < b1 && argo_merkle_hash(d->ma, s->ea[a1 - 1]) == argo_merkle_hash(d->mb, s->eb[b1 - 1])){
+		a1--;
+		b1--;
+	}
+	if(a0 == a1 && b0 == b1){
+		return 0;
+	}
+	if(a0 < a1 && b0 < b1){
+		ret = argo_diff_anchors(d, s, a0, a1, b0, b1);
+		if(ret <= 0){
+			return ret;
+		}
+	}
+
+	for(; a0 < a1 && b0 < b1; a0++, b0++){
+		if(argo_diff_push_index(d, a0 + s->delta) || argo_diff_value(d, s->ea[a0], s->eb[b0])){
+			return -1;
+		}
+		d->path.length = saved;
+	}
+	for(; a0 < a1; a0++){
+		if(argo_diff_at(d, s, a0, "remove", NULL)){
+			return -1;
+		}
+		s->delta--;
+	}
+	for(; b0 < b1; b0++){
+		if(argo_diff_at(d, s, a0, "add", s->eb[b0])){
+			return -1;
+		}
+		s->delta++;
+	}
+	return 0;
+}
+
+/*
+ * Compare two arrays element by element, aligning them on the elements
+ * that are equal in both, so that an element inserted or removed does not
+ * make every later element look changed.
+ */
+static int argo_diff_array(ARGO_DIFF_STATE *d, ARGO_VALUE *a, ARGO_VALUE *b){
+	ARGO_DIFF_SEQ s = {NULL, NULL, 0};
+	size_t na, nb;
+	int ret = -1;
+
+	s.ea = argo_diff_elements(a->content.array.element_list, &na);
+	s.eb = argo_diff_elements(b->content.array.element_list, &nb);
+	if(s.ea != NULL && s.eb != NULL){
+		ret = argo_diff_range(d, &s, 0, na, 0, nb);
+	}
+	free(s.ea);
+	free(s.eb);
+	return ret;
+}
+
+static int argo_diff_same_name(ARGO_STRING *s, ARGO_STRING *t){
+	size_t i;
+	if(s->length != t->length){
+		return 0;
+	}
+	for(i = 0; i < s->length; i++){
+		if(s->content[i] != t->content[i]){
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/*
+ * Put the members of an object in an open-addressed table by name.
+ * A JSON Pointer cannot tell members with the same name apart, so no
+ * patch can be made for an object that has them.
+ */
+static int argo_diff_names(ARGO_VALUE *head, ARGO_VALUE **slots, size_t mask){
+	ARGO_VALUE *list_ptr;
+	size_t i;
+
+	for(list_ptr = head->next; list_ptr != head; list_ptr = list_ptr->next){
+		i = argo_merkle_string(0, &list_ptr->name) & mask;
+		while(slots[i] != NULL){
+			if(argo_diff_same_name(&slots[i]->name, &list_ptr->name)){
+				fprintf(stderr, "Duplicate member name cannot be compared\n");
+				return -1;
+			}
+			i = (i + 1) & mask;
+		}
+		slots[i] = list_ptr;
+	}
+	return 0;
+}
+
+/*
+ * Compare two objects member by member.  The members of the second object
+ * are put in an open-addressed table by name, so that each member of the
+ * first finds its counterpart without a scan.  Members found in both are
+ * compared, those only in the first are removed, and those left over in
+ * the second are added, in their order.  Neither object may have two
+ * members with the same name.
+ */
+static int argo_diff_object(ARGO_DIFF_STATE *d, ARGO_VALUE *a, ARGO_VALUE *b){
+	ARGO_VALUE *ha = a->content.object.member_list, *hb = b->content.object.member_list;
+	ARGO_VALUE *list_ptr;
+	ARGO_VALUE **slots, **names;
+	char *matched;
+	size_t na = argo_diff_count(ha), nb = argo_diff_count(hb);
+	size_t size = 16, i, mask;
+	size_t saved = d->path.length;
+	int ret = -1;
+
+	while(size < 2 * nb || size < 2 * na){
+		size *= 2;
+	}
+	mask = size - 1;
+	slots = calloc(size, sizeof(ARGO_VALUE *));
+	names = calloc(size, sizeof(ARGO_VALUE *));
+	matched = calloc(size, 1);
+	if(slots == NULL || names == NULL || matched == NULL){
+		fprintf(stderr, "Failed to allocate members\n");
+		goto done;
+	}
+	if(argo_diff_names(hb, slots, mask) || argo_diff_names(ha, names, mask)){
+		goto done;
+	}
+
+	for(list_ptr = ha->next; list_ptr != ha; list_ptr = list_ptr->next){
+		i = argo_merkle_string(0, &list_ptr->name) & mask;
+		while(slots[i] != NULL && !argo_diff_same_name(&slots[i]->name, &list_ptr->name)){
+			i = (i + 1) & mask;
+		}
+		if(argo_diff_push_name(d, &list_ptr->name)){
+			goto done;
+		}
+		if(slots[i] == NULL){
+			if(argo_diff_op(d, "remove", NULL)){
+				goto done;
+			}
+		}
+		else{
+			matched[i] = 1;
+			if(argo_diff_value(d, list_ptr, slots[i])){
+				goto done;
+			}
+		}
+		d->path.length = saved;
+	}
+
+	for(list_ptr = hb->next; list_ptr != hb; list_ptr = list_ptr->next){
+		i = argo_merkle_string(0, &list_ptr->name) & mask;
+		while(slots[i] != list_ptr){
+			i = (i + 1) & mask;
+		}
+		if(!matched[i]){
+			if(argo_diff_push_name(d, &list_ptr->name) || argo_diff_op(d, "add", list_ptr)){
+				goto done;
+			}
+			d->path.length = saved;
+		}
+	}
+	ret = 0;
+
+done:
+	d->path.length = saved;
+	free(slots);
+	free(names);
+	free(matched);
+	return ret;
+}
+
+/*
+ * Compare two values at the current path, descending only where the
+ * hashes differ.
+ */
+static int argo_diff_value(ARGO_DIFF_STATE *d, ARGO_VALUE *a, ARGO_VALUE *b){
+	if(argo_merkle_hash(d->ma, a) == argo_merkle_hash(d->mb, b)){
+		return 0;
+	}
+	if(a->type == b->type && a->type == ARGO_ARRAY_TYPE){
+		return argo_diff_array(d, a, b);
+	}
+	if(a->type == b->type && a->type == ARGO_OBJECT_TYPE){
+		return argo_diff_object(d, a, b);
+	}
+	return argo_diff_op(d, "replace", b);
+}
+
+/**
+ * @brief  Output the differences between two values, as a JSON Patch
+ * (RFC 6902) that turns the first into the second.
+ * @details  Only the values whose Merkle hashes differ are looked into,
+ * so the time taken depends on the size of the differences rather than
+ * on the size of the values.  The patch is an array with one "add",
+ * "remove" or "replace" operation per line; values in it are written as
+ * by argo_write_value.
+ *
+ * @param a  The first value.
+ * @param ma  Hashes of the first value, from argo_merkle_build.
+ * @param b  The second value.
+ * @param mb  Hashes of the second value.
+ * @param out  Output stream.
+ * @return  Zero if the operation is completely successful,
+ * nonzero if there is any error.
+ */
+int argo_diff(ARGO_VALUE *a, ARGO_MERKLE *ma, ARGO_VALUE *b, ARGO_MERKLE *mb, FILE *out){
+	ARGO_DIFF_STATE d = {ma, mb, {0, 0, NULL}, 0, out};
+	int ret;
+
+	// the bracket is written with the first operation, so that nothing is
+	// output if the values cannot be compared at all
+	ret = argo_diff_value(&d, a, b);
+	free(d.path.content);
+	if(ret){
+		return -1;
+	}
+	if(fputs(d.ops ? "\n]\n" : "[]\n", out) == EOF){
+		fprintf(stderr, "Error EOF\n");
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Read the document in a file into the current context, either by loading
+ * it if it is a snapshot saved with -b or by parsing it, and hash it.
+ */
+static ARGO_VALUE *argo_diff_read(char *file, ARGO_MERKLE *m){
+	char magic[sizeof(ARGO_BIN_MAGIC)];
+	ARGO_VALUE *v;
+	size_t i, n;
+	FILE *f;
+
+	f = fopen(file, "r");
+	if(f == NULL){
+		fprintf(stderr, "Failed to open %s\n", file);
+		return NULL;
+	}
+	n = fread(magic, 1, sizeof(magic), f);
+	for(i = 0; i < n && magic[i] == ARGO_BIN_MAGIC[i]; i++)
+		;
+	if(i == sizeof(magic)){
+		v = argo_load_binary(f);
+	}
+	else if(fseek(f, 0, SEEK_SET)){
+		fprintf(stderr, "Failed to rewind %s\n", file);
+		v = NULL;
+	}
+	else{
+		argo_context_input(argo_ctx, NULL, 0, 0, 0);
+		v = argo_read_value(f);
+	}
+	fclose(f);
+	if(v != NULL && argo_merkle_build(m, v)){
+		return NULL;
+	}
+	return v;
+}
+
+/**
+ * @brief  Output the differences between the documents in two files.
+ * @details  Each document may be JSON text or a snapshot saved with -b.
+ * The first is read into the current context and the second into a
+ * context of its own, and both are hashed before being compared by
+ * argo_diff.
+ *
+ * @param file_a  Name of the file of the first document.
+ * @param file_b  Name of the file of the second document.
+ * @param out  Output stream for the patch.
+ * @return  Zero if the operation is completely successful,
+ * nonzero if there is any error.
+ */
+int argo_diff_run(char *file_a, char *file_b, FILE *out){
+	ARGO_CONTEXT *ctx_a = argo_ctx;
+	ARGO_CONTEXT *ctx_b;
+	ARGO_MERKLE ma = {0}, mb = {0};
+	ARGO_VALUE *a, *b = NULL;
+	int ret = -1;
+
+	a = argo_diff_read(file_a, &ma);
+	if(a == NULL){
+		return -1;
+	}
+	ctx_b = argo_context_create(ctx_a->num_values);
+	if(ctx_b == NULL){
+		goto done;
+	}
+	argo_ctx = ctx_b;
+	b = argo_diff_read(file_b, &mb);
+	argo_ctx = ctx_a;
+	if(b != NULL){
+		ret = argo_diff(a, &ma, b, &mb, out);
+	}
+	argo_context_destroy(ctx_b);
+
+done:
+	argo_merkle_free(&ma);
+	argo_merkle_free(&mb);
+	return ret;
+}
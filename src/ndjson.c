@@ -0,0 +1,338 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "utils.h"
+#include "context.h"
+#include "options.h"
+#include "pool.h"
+#include "ndjson.h"
+#include "hash.h"
+#include "source.h"
+#include "compress.h"
+
+/*
+ * A run of complete lines of input, together with the canonical output
+ * produced for them.
+ */
+typedef struct argo_batch {
+    ARGO_JOB job;                      // Must be first.
+    char *input;                       // Input lines, each terminated by a newline
+    size_t input_length;               // (except possibly the last line of input).
+    int first_line;                    // Line number of the first line.
+    char *output;                      // Output, if canonicalizing.
+    size_t output_length;
+    long records;                      // Number of records in the batch.
+} ARGO_BATCH;
+
+typedef struct argo_splitter {
+    ARGO_POOL *pool;
+    ARGO_SOURCE *source;               // Input, decompressed if need be.
+    size_t bytes_read;
+    int status;
+} ARGO_SPLITTER;
+
+/*
+ * Read the records of one batch, writing each one to "out" if it is not NULL,
+ * or only its hashes if -H was given.
+ * Each record must be a single value on a line by itself; blank lines are skipped.
+ */
+static int argo_ndjson_read_records(ARGO_BATCH *b, FILE *in, FILE *out){
+	ARGO_CONTEXT *ctx = argo_ctx;
+	ARGO_VALUE *v;
+	ARGO_CHAR c;
+	int line;
+
+	while(1){
+		c = fgetc(in);
+		if(c == EOF){
+			return 0;
+		}
+		if(argo_is_whitespace(c)){
+			continue;
+		}
+		// the line of the record is that of its first character
+		argo_position(in);
+		line = ctx->lines_read;
+		if(ungetc(c, in) == EOF){
+			fprintf(stderr,"[%d, %d] Fail to unget. \n", ctx->lines_read, ctx->chars_read);
+			return -1;
+		}
+
+		v = argo_read_value(in);
+		if(v == NULL){
+			return -1;
+		}
+		argo_position(in);
+		if(ctx->lines_read != line){
+			fprintf(stderr, "[%d, %d] Record spans more than one line\n", ctx->lines_read, ctx->chars_read);
+			return -1;
+		}
+
+		c = fgetc(in);
+		while(c != ARGO_LF && c != EOF && argo_is_whitespace(c)){
+			c = fgetc(in);
+		}
+		if(c != ARGO_LF && c != EOF){
+			argo_position(in);
+			fprintf(stderr, "[%d, %d] Expect newline after record but seen (%d)\n", ctx->lines_read, ctx->chars_read, c);
+			return -1;
+		}
+
+		if(out && (global_options & HASH_OPTION)){
+			FILE *sink = argo_hash_open(argo_hash_algorithms, out);
+			if(sink == NULL){
+				return -1;
+			}
+			if(argo_write_value(v, sink)){
+				fclose(sink);
+				return -1;
+			}
+			if(fclose(sink)){
+				return -1;
+			}
+		}
+		else if(out){
+			if(argo_write_value(v, out)){
+				return -1;
+			}
+			if(!(global_options & INDENT_MASK)){
+				if(fputc(ARGO_LF, out) == EOF){
+					fprintf(stderr, "Error EOF\n");
+					return -1;
+				}
+			}
+		}
+		b->records++;
+		argo_context_reset(ctx);
+	}
+}
+
+/*
+ * Job run on a worker: parse (and canonicalize) the records of one batch
+ * into the worker's own context.
+ */
+static int argo_ndjson_run_batch(ARGO_JOB *job){
+	ARGO_BATCH *b = (ARGO_BATCH *) job;
+	ARGO_CONTEXT *ctx = argo_ctx;
+	FILE *out = NULL;
+	int status;
+
+	FILE *in = fmemopen(b->input, b->input_length, "r");
+	if(in == NULL){
+		fprintf(stderr, "Failed to open batch for reading\n");
+		return -1;
+	}
+	if(global_options & CANONICALIZE_OPTION){
+		out = open_memstream(&b->output, &b->output_length);
+		if(out == NULL){
+			fprintf(stderr, "Failed to open batch for writing\n");
+			fclose(in);
+			return -1;
+		}
+	}
+
+	argo_context_input(ctx, b->input, b->input_length, b->first_line, 0);
+	status = argo_ndjson_read_records(b, in, out);
+	argo_context_reset(ctx);
+
+	fclose(in);
+	if(out){
+		fclose(out);
+	}
+	free(b->input);
+	b->input = NULL;
+	return status;
+}
+
+static int argo_ndjson_submit(ARGO_SPLITTER *sp, char *data, size_t length, int first_line){
+	ARGO_BATCH *b = calloc(1, sizeof(ARGO_BATCH));
+	if(b == NULL){
+		fprintf(stderr, "Failed to allocate batch\n");
+		free(data);
+		return -1;
+	}
+	b->job.run = argo_ndjson_run_batch;
+	b->input = data;
+	b->input_length = length;
+	b->first_line = first_line;
+	if(argo_pool_submit(sp->pool, &b->job)){
+		free(data);
+		free(b);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Splitter thread: read the input in large blocks and cut each block
+ * after its last newline.  The complete lines become a batch; the partial
+ * line at the end is carried over into the next block.
+ */
+static void *argo_ndjson_split(void *arg){
+	ARGO_SPLITTER *sp = arg;
+	size_t cap = ARGO_BATCH_SIZE;
+	size_t len = 0;
+	size_t cut, i;
+	ssize_t n;
+	int line = 0, column = 0;
+	int first;
+	char *next;
+	char *buf;
+
+	pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+	buf = malloc(cap);
+	if(buf == NULL){
+		fprintf(stderr, "Failed to allocate input buffer\n");
+		sp->status = -1;
+		argo_pool_close(sp->pool);
+		return NULL;
+	}
+
+	while(1){
+		// only a blocking read may be cancelled, never a wait inside the pool
+		pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+		n = sp->source->read(sp->source, buf + len, cap - len);
+		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+		if(n <= 0){
+			if(n < 0){
+				fprintf(stderr, "Error reading input\n");
+				sp->status = -1;
+				free(buf);
+			}
+			else if(len > 0){
+				sp->status = argo_ndjson_submit(sp, buf, len, line);
+			}
+			else{
+				free(buf);
+			}
+			break;
+		}
+		len += n;
+		sp->bytes_read += n;
+
+		for(cut = len; cut > 0 && buf[cut-1] != ARGO_LF; cut--)
+			;
+		if(cut == 0){
+			// no complete line yet; make room for more of it
+			if(len == cap){
+				cap *= 2;
+				next = realloc(buf, cap);
+				if(next == NULL){
+					fprintf(stderr, "Failed to allocate input buffer\n");
+					sp->status = -1;
+					free(buf);
+					break;
+				}
+				buf = next;
+			}
+			continue;
+		}
+
+		next = malloc(cap);
+		if(next == NULL){
+			fprintf(stderr, "Failed to allocate input buffer\n");
+			sp->status = -1;
+			free(buf);
+			break;
+		}
+		for(i = cut; i < len; i++){
+			next[i-cut] = buf[i];
+		}
+		first = line;
+		argo_position_scan(buf, cut, &line, &column);
+		if(argo_ndjson_submit(sp, buf, cut, first)){
+			sp->status = -1;
+			free(next);
+			break;
+		}
+		buf = next;
+		len -= cut;
+	}
+	argo_pool_close(sp->pool);
+	return NULL;
+}
+
+/**
+ * @brief  Validate or canonicalize newline-delimited JSON.
+ * @details  The input is a sequence of values, one per line.  A splitter
+ * thread cuts the input into batches of complete lines, a pool of worker
+ * threads (argo_num_threads of them) parses each batch into a private
+ * context, and the calling thread writes the results in input order,
+ * one value per line.  If any record is invalid, the output stops after
+ * the last valid record that precedes it.  Input compressed with gzip or
+ * zstd is decompressed by the splitter thread as it is read.
+ *
+ * @param in  Input stream from which records are to be read.
+ * @param out  Output stream to which canonical records are to be written.
+ * @return  Zero if the operation is completely successful,
+ * nonzero if there is any error.
+ */
+int argo_ndjson_run(FILE *in, FILE *out){
+	int threads = argo_num_threads ? argo_num_threads : argo_num_cpus();
+	ARGO_SPLITTER sp = { NULL, NULL, 0, 0 };
+	pthread_t splitter;
+	ARGO_JOB *job;
+	ARGO_BATCH *b;
+	long records = 0;
+	int status = 0;
+	struct timespec start, end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	sp.source = argo_decompress_open(argo_source_open(in), NULL);
+	if(sp.source == NULL){
+		return -1;
+	}
+	sp.pool = argo_pool_create(threads, 4 * threads, NUM_ARGO_VALUES);
+	if(sp.pool == NULL){
+		sp.source->close(sp.source);
+		return -1;
+	}
+	if(pthread_create(&splitter, NULL, argo_ndjson_split, &sp)){
+		fprintf(stderr, "Failed to start splitter thread\n");
+		argo_pool_destroy(sp.pool);
+		sp.source->close(sp.source);
+		return -1;
+	}
+
+	while((job = argo_pool_next(sp.pool)) != NULL){
+		b = (ARGO_BATCH *) job;
+		if(b->output_length && fwrite(b->output, 1, b->output_length, out) != b->output_length){
+			fprintf(stderr, "Error EOF\n");
+			b->job.status = -1;
+		}
+		records += b->records;
+		status = b->job.status;
+		free(b->output);
+		free(b);
+		if(status){
+			argo_pool_abort(sp.pool);
+			pthread_cancel(splitter);
+			break;
+		}
+	}
+	pthread_join(splitter, NULL);
+	argo_pool_destroy(sp.pool);
+	sp.source->close(sp.source);
+	if(status || sp.status){
+		return -1;
+	}
+	if(fflush(out) == EOF){
+		fprintf(stderr, "Error EOF\n");
+		return -1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	if(global_options & STATISTICS_OPTION){
+		double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+		double mb = sp.bytes_read / 1e6;
+		fprintf(stderr, "%ld records, %.1f MB in %.3f s with %d threads (%.0f records/s, %.1f MB/s)\n",
+			records, mb, secs, threads, records / secs, mb / secs);
+	}
+	return 0;
+}
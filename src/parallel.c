@@ -0,0 +1,387 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "utils.h"
+#include "context.h"
+#include "options.h"
+#include "pool.h"
+#include "parallel.h"
+
+/*
+ * A run of consecutive elements of the top-level array, as found by the
+ * structural pre-scan, together with the list of values parsed from it.
+ */
+typedef struct argo_slice {
+    ARGO_JOB job;                      // Must be first.
+    char *data;                        // Text of the elements, separated by commas.
+    size_t length;
+    int line;                          // Position of the text in the input.
+    int column;
+    int only;                          // Nonzero if this is the only slice (may be empty).
+    ARGO_VALUE *first;                 // Parsed elements, linked through next/prev.
+    ARGO_VALUE *last;
+    long count;
+    long *budget;                      // Values that all slices together may still allocate.
+    char *errors;                      // Messages about the text of the slice,
+    size_t errors_length;              // which are not reported.
+} ARGO_SLICE;
+
+/*
+ * Parse the elements of one slice into the calling worker's context and
+ * link them into a list.  The values of every element are charged to the
+ * budget shared by all of the slices, so that the document is held to the
+ * same limit as when it is parsed on a single thread; a slice that fails
+ * uses up the budget, so that the others stop at their next element.
+ */
+static int argo_parallel_read_slice(ARGO_SLICE *sl){
+	ARGO_CONTEXT *ctx = argo_ctx;
+	ARGO_VALUE *v;
+	ARGO_CHAR c;
+	int used;
+
+	FILE *in = fmemopen(sl->data, sl->length, "r");
+	if(in == NULL){
+		fprintf(stderr, "Failed to open slice for reading\n");
+		return -1;
+	}
+	argo_context_input(ctx, sl->data, sl->length, sl->line, sl->column);
+
+	while(1){
+		if(sl->only && sl->count == 0){
+			// an empty array consists of a single slice holding only whitespace
+			do{
+				c = fgetc(in);
+			} while(c != EOF && argo_is_whitespace(c));
+			if(c == EOF){
+				break;
+			}
+			ungetc(c, in);
+		}
+		used = ctx->next_value;
+		v = argo_read_value(in);
+		if(v == NULL || __atomic_sub_fetch(sl->budget, ctx->next_value - used, __ATOMIC_RELAXED) < 0){
+			__atomic_store_n(sl->budget, -1, __ATOMIC_RELAXED);
+			fclose(in);
+			return -1;
+		}
+		if(sl->last){
+			sl->last->next = v;
+		}
+		else{
+			sl->first = v;
+		}
+		v->prev = sl->last;
+		sl->last = v;
+		sl->count++;
+
+		do{
+			c = fgetc(in);
+		} while(c != EOF && argo_is_whitespace(c));
+		if(c == EOF){
+			break;
+		}
+		if(c != ARGO_COMMA){
+			argo_position(in);
+			fprintf(argo_err, "[%d, %d] Expect , but seen (%d)\n", ctx->lines_read, ctx->chars_read, c);
+			__atomic_store_n(sl->budget, -1, __ATOMIC_RELAXED);
+			fclose(in);
+			return -1;
+		}
+	}
+	fclose(in);
+	return 0;
+}
+
+/*
+ * Job run on a worker: parse one slice.  What is wrong with the text is
+ * not reported from here, as the slices run in no particular order and
+ * the first error of the document may not be in this slice; it is
+ * reported by parsing the document again on a single thread.
+ */
+static int argo_parallel_run_slice(ARGO_JOB *job){
+	ARGO_SLICE *sl = (ARGO_SLICE *) job;
+	ARGO_CONTEXT *ctx = argo_ctx;
+	int status;
+
+	ctx->errors = open_memstream(&sl->errors, &sl->errors_length);
+	if(ctx->errors == NULL){
+		fprintf(stderr, "Failed to open slice for error messages\n");
+		return -1;
+	}
+	status = argo_parallel_read_slice(sl);
+	fclose(ctx->errors);
+	ctx->errors = NULL;
+	return status;
+}
+
+static void argo_parallel_free_slice(ARGO_SLICE *sl){
+	free(sl->errors);
+	free(sl);
+}
+
+static ARGO_SLICE *argo_parallel_slice(ARGO_POOL *pool, char *data, size_t length, int line, int column,
+                                       int only, long *budget){
+	ARGO_SLICE *sl = calloc(1, sizeof(ARGO_SLICE));
+	if(sl == NULL){
+		fprintf(stderr, "Failed to allocate slice\n");
+		return NULL;
+	}
+	sl->job.run = argo_parallel_run_slice;
+	sl->data = data;
+	sl->length = length;
+	sl->line = line;
+	sl->column = column;
+	sl->only = only;
+	sl->budget = budget;
+	if(argo_pool_submit(pool, &sl->job)){
+		free(sl);
+		return NULL;
+	}
+	return sl;
+}
+
+/*
+ * Parse a complete document on the calling thread, exactly as
+ * argo_read_value would from the original stream.
+ */
+static ARGO_VALUE *argo_parallel_read_serial(char *buf, size_t length){
+	ARGO_VALUE *v;
+	FILE *in = fmemopen(buf, length, "r");
+	if(in == NULL){
+		fprintf(stderr, "Failed to open input for reading\n");
+		return NULL;
+	}
+	argo_context_input(argo_ctx, buf, length, 0, 0);
+	v = argo_read_value(in);
+	fclose(in);
+	return v;
+}
+
+/**
+ * @brief  Parse a document held in memory, parsing the elements of a
+ * top-level array in parallel.
+ * @details  A structural pre-scan, which only tracks strings and nesting
+ * depth, finds the commas that separate the elements of the top-level
+ * array and cuts the elements into slices of roughly equal size.  The
+ * slices are parsed by the workers of the pool into their own contexts,
+ * and the resulting lists are stitched together, in order, under an array
+ * value allocated from the calling thread's context.  The result is the
+ * same as that of argo_read_value on the same text: together, the slices
+ * may allocate no more values than would have fit in that context.
+ * Documents that are not arrays, or that the pre-scan finds to be
+ * malformed, are simply parsed on the calling thread, so that errors are
+ * reported exactly as argo_read_value reports them.  So are documents in
+ * which a slice fails, once the slices not yet started have been
+ * abandoned, so that only the first error is reported.
+ *
+ * @param pool  Pool whose workers parse the slices; the values they allocate
+ * remain valid until the pool is destroyed.  The slices are all submitted
+ * before any is taken back, so the pool must accept ARGO_MAX_SLICES jobs.
+ * If a slice fails, the pool is aborted, and can then only be destroyed.
+ * @param buf  Text of the document.
+ * @param length  Length of the text.
+ * @return  A valid pointer if the operation is completely successful,
+ * NULL if there is any error.
+ */
+ARGO_VALUE *argo_parallel_read_array(ARGO_POOL *pool, char *buf, size_t length){
+	size_t chunk = length / (8 * pool->num_workers);
+	size_t i = 0, start;
+	size_t scanned = 0;         // the position (line, column) is that of buf + scanned
+	int line = 0, column = 0;
+	int depth = 0;
+	int in_string = 0;
+	int status = 0;
+	int slices = 0;
+	int k;
+	int first_value = argo_ctx->next_value;
+	long budget;
+	char c;
+	ARGO_SLICE *sl;
+	ARGO_JOB *job;
+	ARGO_VALUE *av, *head, *prev;
+
+	if(chunk < ARGO_MIN_SLICE){
+		chunk = ARGO_MIN_SLICE;
+	}
+
+	while(i < length && argo_is_whitespace(buf[i])){
+		i++;
+	}
+	if(i == length || buf[i] != ARGO_LBRACK){
+		return argo_parallel_read_serial(buf, length);
+	}
+
+	// find the closing bracket first, so that nothing is submitted for malformed input
+	for(start = i; i < length; i++){
+		c = buf[i];
+		if(in_string){
+			if(c == ARGO_BSLASH){
+				i++;
+			}
+			else if(c == ARGO_QUOTE){
+				in_string = 0;
+			}
+		}
+		else if(c == ARGO_QUOTE){
+			in_string = 1;
+		}
+		else if(c == ARGO_LBRACK || c == ARGO_LBRACE){
+			depth++;
+		}
+		else if(c == ARGO_RBRACK || c == ARGO_RBRACE){
+			if(--depth == 0){
+				break;
+			}
+		}
+	}
+	if(i >= length){
+		return argo_parallel_read_serial(buf, length);
+	}
+	size_t end = i;
+
+	av = argo_alloc_value();
+	if(av == NULL){
+		return NULL;
+	}
+	head = argo_alloc_value();
+	if(head == NULL){
+		return NULL;
+	}
+	av->type = ARGO_ARRAY_TYPE;
+	av->content.array.element_list = head;
+	head->next = head;
+	head->prev = head;
+	budget = argo_ctx->num_values - argo_ctx->next_value;
+
+	// cut the elements into slices at top-level commas
+	depth = 0;
+	start++;
+	for(i = start; i < end; i++){
+		c = buf[i];
+		if(in_string){
+			if(c == ARGO_BSLASH){
+				i++;
+			}
+			else if(c == ARGO_QUOTE){
+				in_string = 0;
+			}
+		}
+		else if(c == ARGO_QUOTE){
+			in_string = 1;
+		}
+		else if(c == ARGO_LBRACK || c == ARGO_LBRACE){
+			depth++;
+		}
+		else if(c == ARGO_RBRACK || c == ARGO_RBRACE){
+			depth--;
+		}
+		else if(c == ARGO_COMMA && depth == 0 && i - start >= chunk){
+			argo_position_scan(buf + scanned, start - scanned, &line, &column);
+			scanned = start;
+			if(argo_parallel_slice(pool, buf + start, i - start, line, column, 0, &budget) == NULL){
+				status = -1;
+				break;
+			}
+			slices++;
+			start = i + 1;
+		}
+	}
+	if(status == 0){
+		argo_position_scan(buf + scanned, start - scanned, &line, &column);
+		if(argo_parallel_slice(pool, buf + start, end - start, line, column, slices == 0, &budget) == NULL){
+			status = -1;
+		}
+		else{
+			slices++;
+		}
+	}
+
+	// stitch the slices together in order
+	prev = head;
+	for(k = 0; k < slices; k++){
+		sl = (ARGO_SLICE *) argo_pool_next(pool);
+		if(sl->job.status){
+			break;
+		}
+		if(status == 0 && sl->count){
+			prev->next = sl->first;
+			sl->first->prev = prev;
+			prev = sl->last;
+		}
+		argo_parallel_free_slice(sl);
+	}
+	prev->next = head;
+	head->prev = prev;
+
+	if(k < slices){
+		// the slices after the first to fail are of no use
+		argo_pool_abort(pool);
+		argo_pool_wait(pool);
+		for(; k < slices; k++){
+			job = sl->job.next;
+			argo_parallel_free_slice(sl);
+			sl = (ARGO_SLICE *) job;
+		}
+		if(status == 0){
+			argo_ctx->next_value = first_value;
+			return argo_parallel_read_serial(buf, length);
+		}
+	}
+	return status ? NULL : av;
+}
+
+/**
+ * @brief  Validate or canonicalize a document, parsing a top-level array
+ * with argo_num_threads worker threads.
+ *
+ * @param in  Input stream from which JSON is to be read.
+ * @param out  Output stream to which canonical JSON is to be written.
+ * @return  Zero if the operation is completely successful,
+ * nonzero if there is any error.
+ */
+int argo_parallel_run(FILE *in, FILE *out){
+	int threads = argo_num_threads ? argo_num_threads : argo_num_cpus();
+	ARGO_POOL *pool;
+	ARGO_VALUE *v;
+	size_t length;
+	char *buf;
+	int status = 0;
+	struct timespec start, parsed, end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	buf = argo_read_file(in, &length);
+	if(buf == NULL){
+		return -1;
+	}
+	pool = argo_pool_create(threads, ARGO_MAX_SLICES(threads), NUM_ARGO_VALUES);
+	if(pool == NULL){
+		free(buf);
+		return -1;
+	}
+
+	v = argo_parallel_read_array(pool, buf, length);
+	clock_gettime(CLOCK_MONOTONIC, &parsed);
+	if(v == NULL){
+		status = -1;
+	}
+	else if(global_options & CANONICALIZE_OPTION){
+		status = argo_write_value(v, out);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	argo_pool_destroy(pool);
+	free(buf);
+
+	if(status == 0 && (global_options & STATISTICS_OPTION)){
+		double parse_secs = (parsed.tv_sec - start.tv_sec) + (parsed.tv_nsec - start.tv_nsec) / 1e9;
+		double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+		double mb = length / 1e6;
+		fprintf(stderr, "%.1f MB in %.3f s (parse %.3f s, %.1f MB/s) with %d threads\n",
+			mb, secs, parse_secs, mb / parse_secs, threads);
+	}
+	return status;
+}
@@ -0,0 +1,266 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "context.h"
+#include "pool.h"
+
+int argo_num_cpus(void){
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	if(n < 1){
+		return 1;
+	}
+	return (int) n;
+}
+
+static void *argo_pool_worker(void *arg){
+	ARGO_WORKER *w = arg;
+	ARGO_POOL *pool = w->pool;
+	ARGO_JOB *job;
+
+	argo_ctx = w->ctx;
+
+	pthread_mutex_lock(&pool->lock);
+	while(1){
+		while(pool->pending == NULL && pool->detached == NULL && !pool->closed && !pool->aborted){
+			pthread_cond_wait(&pool->work, &pool->lock);
+		}
+		if(pool->aborted || (pool->pending == NULL && pool->detached == NULL)){
+			break;
+		}
+		if(pool->pending){
+			job = pool->pending;
+			pool->pending = job->next;
+		}
+		else{
+			job = pool->detached;
+			pool->detached = job->next;
+			if(pool->detached == NULL){
+				pool->detached_tail = NULL;
+			}
+		}
+		pthread_mutex_unlock(&pool->lock);
+
+		job->status = job->run(job);
+
+		if(job->finish){
+			// the job may be gone once finish returns
+			job->finish(job);
+			pthread_mutex_lock(&pool->lock);
+			continue;
+		}
+		pthread_mutex_lock(&pool->lock);
+		job->done = 1;
+		pthread_cond_broadcast(&pool->finished);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+/**
+ * @brief  Start a pool of worker threads.
+ *
+ * @param num_workers  Number of threads to start.
+ * @param max_jobs  Maximum number of jobs that may be outstanding at once.
+ * @param num_values  Size of the arena of each worker's context.
+ * @return  The new pool, or NULL if it could not be started.
+ */
+ARGO_POOL *argo_pool_create(int num_workers, int max_jobs, int num_values){
+	ARGO_POOL *pool = calloc(1, sizeof(ARGO_POOL));
+	if(pool == NULL){
+		fprintf(stderr, "Failed to allocate worker pool\n");
+		return NULL;
+	}
+	pool->workers = calloc(num_workers, sizeof(ARGO_WORKER));
+	if(pool->workers == NULL){
+		fprintf(stderr, "Failed to allocate worker pool\n");
+		free(pool);
+		return NULL;
+	}
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work, NULL);
+	pthread_cond_init(&pool->finished, NULL);
+	pthread_cond_init(&pool->space, NULL);
+	pool->max_jobs = max_jobs;
+
+	int i;
+	for(i=0; i<num_workers; i++){
+		ARGO_WORKER *w = pool->workers + i;
+		w->pool = pool;
+		w->ctx = argo_context_create(num_values);
+		if(w->ctx == NULL){
+			break;
+		}
+		if(pthread_create(&w->thread, NULL, argo_pool_worker, w)){
+			fprintf(stderr, "Failed to start worker thread\n");
+			argo_context_destroy(w->ctx);
+			break;
+		}
+		pool->num_workers++;
+	}
+	if(pool->num_workers < num_workers){
+		argo_pool_destroy(pool);
+		return NULL;
+	}
+	return pool;
+}
+
+/**
+ * @brief  Queue a job to be run by one of the workers.
+ * @details  Blocks while the maximum number of jobs is outstanding.
+ *
+ * @return  Zero if the job was queued, nonzero if the pool has been aborted.
+ */
+int argo_pool_submit(ARGO_POOL *pool, ARGO_JOB *job){
+	pthread_mutex_lock(&pool->lock);
+	while(pool->in_flight >= pool->max_jobs && !pool->aborted){
+		pthread_cond_wait(&pool->space, &pool->lock);
+	}
+	if(pool->aborted){
+		pthread_mutex_unlock(&pool->lock);
+		return -1;
+	}
+	job->next = NULL;
+	job->status = 0;
+	job->done = 0;
+	if(pool->tail){
+		pool->tail->next = job;
+	}
+	else{
+		pool->head = job;
+	}
+	pool->tail = job;
+	if(pool->pending == NULL){
+		pool->pending = job;
+	}
+	pool->in_flight++;
+	pthread_cond_signal(&pool->work);
+	pthread_cond_broadcast(&pool->finished);
+	pthread_mutex_unlock(&pool->lock);
+	return 0;
+}
+
+/**
+ * @brief  Queue a job to be run by one of the workers, without it being
+ * taken back.
+ * @details  Never blocks.  The "finish" function of the job must be set;
+ * it is called on the worker once the job has been run, in whatever order
+ * jobs complete.  Detached jobs not yet started when the pool is aborted
+ * are never run, and their "finish" function is not called.
+ *
+ * @return  Zero if the job was queued, nonzero if the pool has been aborted.
+ */
+int argo_pool_submit_detached(ARGO_POOL *pool, ARGO_JOB *job){
+	pthread_mutex_lock(&pool->lock);
+	if(pool->aborted){
+		pthread_mutex_unlock(&pool->lock);
+		return -1;
+	}
+	job->next = NULL;
+	job->status = 0;
+	job->done = 0;
+	if(pool->detached_tail){
+		pool->detached_tail->next = job;
+	}
+	else{
+		pool->detached = job;
+	}
+	pool->detached_tail = job;
+	pthread_cond_signal(&pool->work);
+	pthread_mutex_unlock(&pool->lock);
+	return 0;
+}
+
+/**
+ * @brief  Declare that no more jobs will be submitted.
+ */
+void argo_pool_close(ARGO_POOL *pool){
+	pthread_mutex_lock(&pool->lock);
+	pool->closed = 1;
+	pthread_cond_broadcast(&pool->work);
+	pthread_cond_broadcast(&pool->finished);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * @brief  Abandon all jobs that have not been started yet.
+ * @details  Jobs that are already running are allowed to complete, but
+ * argo_pool_submit and argo_pool_next fail from now on.
+ */
+void argo_pool_abort(ARGO_POOL *pool){
+	pthread_mutex_lock(&pool->lock);
+	pool->aborted = 1;
+	pthread_cond_broadcast(&pool->work);
+	pthread_cond_broadcast(&pool->finished);
+	pthread_cond_broadcast(&pool->space);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * @brief  Wait, once the pool has been aborted, for the jobs that were
+ * already running to complete.
+ * @details  Jobs that had not been started never will be.  After this,
+ * the pool does not touch any job that was not taken back, so those jobs
+ * may be freed.
+ */
+void argo_pool_wait(ARGO_POOL *pool){
+	ARGO_JOB *job;
+	pthread_mutex_lock(&pool->lock);
+	for(job = pool->head; job != NULL && job != pool->pending; job = job->next){
+		while(!job->done){
+			pthread_cond_wait(&pool->finished, &pool->lock);
+		}
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * @brief  Take back the oldest submitted job once it has completed.
+ *
+ * @return  The job, or NULL if the pool has been closed and all of its
+ * jobs have been taken back, or if it has been aborted.
+ */
+ARGO_JOB *argo_pool_next(ARGO_POOL *pool){
+	ARGO_JOB *job = NULL;
+	pthread_mutex_lock(&pool->lock);
+	while(!pool->aborted){
+		if(pool->head && pool->head->done){
+			job = pool->head;
+			pool->head = job->next;
+			if(pool->head == NULL){
+				pool->tail = NULL;
+			}
+			pool->in_flight--;
+			pthread_cond_signal(&pool->space);
+			break;
+		}
+		if(pool->head == NULL && pool->closed){
+			break;
+		}
+		pthread_cond_wait(&pool->finished, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return job;
+}
+
+/**
+ * @brief  Stop the workers and release the pool and their contexts.
+ * @details  Values allocated by jobs remain valid until this is called.
+ */
+void argo_pool_destroy(ARGO_POOL *pool){
+	int i;
+	argo_pool_close(pool);
+	for(i=0; i<pool->num_workers; i++){
+		pthread_join(pool->workers[i].thread, NULL);
+		argo_context_destroy(pool->workers[i].ctx);
+	}
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->work);
+	pthread_cond_destroy(&pool->finished);
+	pthread_cond_destroy(&pool->space);
+	free(pool->workers);
+	free(pool);
+}
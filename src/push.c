@@ -0,0 +1,545 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "utils.h"
+#include "context.h"
+#include "options.h"
+#include "push.h"
+
+/**
+ * @brief  Create a push parser.
+ * @details  Values will be allocated from the calling thread's context,
+ * whichever thread later feeds the parser.
+ *
+ * @return  The new parser, or NULL if memory could not be allocated.
+ */
+ARGO_PUSH *argo_push_create(void){
+	ARGO_PUSH *p = calloc(1, sizeof(ARGO_PUSH));
+	if(p == NULL){
+		fprintf(stderr, "Failed to allocate push parser\n");
+		return NULL;
+	}
+	p->ctx = argo_ctx;
+	p->lex = ARGO_LEX_BETWEEN;
+	return p;
+}
+
+void argo_push_destroy(ARGO_PUSH *p){
+	int i;
+	if(p == NULL){
+		return;
+	}
+	for(i=0; i<p->depth; i++){
+		free(p->frames[i].name.content);
+	}
+	free(p->frames);
+	free(p);
+}
+
+static int argo_push_fail(ARGO_PUSH *p){
+	p->failed = 1;
+	return -1;
+}
+
+/*
+ * Bring the position up to the character being read, for an error message.
+ * The fragment is only scanned for newlines when there is an error, or
+ * once all of it has been fed.  As with argo_position, the character being
+ * read is counted on its line even if it is a newline; nothing is read
+ * after an error, so the position need not be right past it.
+ */
+static void argo_push_position(ARGO_PUSH *p){
+	if(p->chunk == NULL){
+		return;
+	}
+	argo_position_scan(p->chunk, p->next - p->chunk, &p->lines_read, &p->chars_read);
+	p->chars_read++;
+	p->chunk = p->next + 1;
+}
+
+/*
+ * A value has been completed: the enclosing array or object now expects
+ * a comma or its closing bracket.
+ */
+static void argo_push_end_value(ARGO_PUSH *p){
+	p->lex = ARGO_LEX_BETWEEN;
+	if(p->depth){
+		p->frames[p->depth-1].state = ARGO_FRAME_NEXT;
+	}
+	else{
+		p->done = 1;
+	}
+}
+
+static int argo_push_open(ARGO_PUSH *p, ARGO_VALUE *av, int is_object){
+	ARGO_FRAME *f;
+	ARGO_VALUE *head = argo_alloc_value();
+	if(head == NULL){
+		return -1;
+	}
+	head->next = head;
+	head->prev = head;
+	if(is_object){
+		av->content.object.member_list = head;
+	}
+	else{
+		av->content.array.element_list = head;
+	}
+
+	if(p->depth == p->max_depth){
+		int max = p->max_depth ? 2 * p->max_depth : 16;
+		f = realloc(p->frames, max * sizeof(ARGO_FRAME));
+		if(f == NULL){
+			argo_push_position(p);
+			fprintf(stderr, "[%d, %d] Failed to allocate parser stack\n", p->lines_read, p->chars_read);
+			return -1;
+		}
+		p->frames = f;
+		p->max_depth = max;
+	}
+	f = p->frames + p->depth++;
+	f->head = head;
+	f->is_object = is_object;
+	f->state = ARGO_FRAME_FIRST;
+	f->name = (ARGO_STRING){0};
+	return 0;
+}
+
+static void argo_push_close(ARGO_PUSH *p){
+	p->depth--;
+	argo_push_end_value(p);
+}
+
+/*
+ * Start a value whose first character is c, linking it into the enclosing
+ * array or object (taking the pending member name, if any).
+ */
+static int argo_push_begin_value(ARGO_PUSH *p, ARGO_CHAR c){
+	ARGO_VALUE *av;
+	ARGO_FRAME *f;
+
+	if(!(c == ARGO_QUOTE || c == ARGO_MINUS || argo_is_digit(c) || argo_maybe_basic(c)
+	     || c == ARGO_LBRACK || c == ARGO_LBRACE)){
+		argo_push_position(p);
+		fprintf(stderr, "[%d, %d] Invalid Token (%d)\n", p->lines_read, p->chars_read, c);
+		return -1;
+	}
+
+	av = argo_alloc_value();
+	if(av == NULL){
+		return -1;
+	}
+	if(p->depth){
+		f = p->frames + p->depth - 1;
+		if(f->is_object){
+			av->name = f->name;
+			f->name = (ARGO_STRING){0};
+		}
+		av->prev = f->head->prev;
+		av->next = f->head;
+		f->head->prev->next = av;
+		f->head->prev = av;
+	}
+	else{
+		p->root = av;
+	}
+
+	if(c == ARGO_QUOTE){
+		av->type = ARGO_STRING_TYPE;
+		p->string = &av->content.string;
+		p->high = 0;
+		p->lex = ARGO_LEX_STRING;
+	}
+	else if(c == ARGO_MINUS || argo_is_digit(c)){
+		av->type = ARGO_NUMBER_TYPE;
+		av->content.number.string_value = (ARGO_STRING){0};
+		if(argo_append_char(&av->content.number.string_value, c)){
+			return -1;
+		}
+		p->value = av;
+		p->num = c == ARGO_MINUS ? ARGO_NUM_SIGN : c == ARGO_DIGIT0 ? ARGO_NUM_ZERO : ARGO_NUM_INT;
+		p->lex = ARGO_LEX_NUMBER;
+	}
+	else if(argo_maybe_basic(c)){
+		av->type = ARGO_BASIC_TYPE;
+		if(c == ARGO_T){
+			p->literal = ARGO_TRUE_TOKEN;
+			av->content.basic = ARGO_TRUE;
+		}
+		else if(c == ARGO_F){
+			p->literal = ARGO_FALSE_TOKEN;
+			av->content.basic = ARGO_FALSE;
+		}
+		else{
+			p->literal = ARGO_NULL_TOKEN;
+			av->content.basic = ARGO_NULL;
+		}
+		p->literal_pos = 1;
+		p->value = av;
+		p->lex = ARGO_LEX_LITERAL;
+	}
+	else if(c == ARGO_LBRACK){
+		av->type = ARGO_ARRAY_TYPE;
+		return argo_push_open(p, av, 0);
+	}
+	else{
+		av->type = ARGO_OBJECT_TYPE;
+		return argo_push_open(p, av, 1);
+	}
+	return 0;
+}
+
+/*
+ * Handle a character that is not part of any token in progress.
+ */
+static int argo_push_between(ARGO_PUSH *p, ARGO_CHAR c){
+	ARGO_FRAME *f;
+
+	if(argo_is_whitespace(c)){
+		return 0;
+	}
+	if(p->depth == 0){
+		if(p->done){
+			argo_push_position(p);
+			fprintf(stderr, "[%d, %d] Unexpected data after value (%d)\n", p->lines_read, p->chars_read, c);
+			return -1;
+		}
+		return argo_push_begin_value(p, c);
+	}
+
+	f = p->frames + p->depth - 1;
+	switch(f->state){
+	case ARGO_FRAME_FIRST:
+		if(c == (f->is_object ? ARGO_RBRACE : ARGO_RBRACK)){
+			argo_push_close(p);
+			return 0;
+		}
+		if(!f->is_object){
+			return argo_push_begin_value(p, c);
+		}
+		// fall through: an object starts with a member name
+	case ARGO_FRAME_NAME:
+		if(c != ARGO_QUOTE){
+			argo_push_position(p);
+			fprintf(stderr, "[%d, %d] Expect member in object but seen (%d)\n", p->lines_read, p->chars_read, c);
+			return -1;
+		}
+		p->string = &f->name;
+		p->high = 0;
+		p->lex = ARGO_LEX_STRING;
+		return 0;
+	case ARGO_FRAME_COLON:
+		if(c != ARGO_COLON){
+			argo_push_position(p);
+			fprintf(stderr, "[%d, %d] Expect : in object but seen (%d)\n", p->lines_read, p->chars_read, c);
+			return -1;
+		}
+		f->state = ARGO_FRAME_VALUE;
+		return 0;
+	case ARGO_FRAME_VALUE:
+		if(c == ARGO_RBRACK || c == ARGO_RBRACE){
+			argo_push_position(p);
+			fprintf(stderr, "[%d, %d] Expect Value but seen (%d)\n", p->lines_read, p->chars_read, c);
+			return -1;
+		}
+		return argo_push_begin_value(p, c);
+	case ARGO_FRAME_NEXT:
+		if(c == ARGO_COMMA){
+			f->state = f->is_object ? ARGO_FRAME_NAME : ARGO_FRAME_VALUE;
+			return 0;
+		}
+		if(c == (f->is_object ? ARGO_RBRACE : ARGO_RBRACK)){
+			argo_push_close(p);
+			return 0;
+		}
+		argo_push_position(p);
+		fprintf(stderr, "[%d, %d] Expect , but seen (%d)\n", p->lines_read, p->chars_read, c);
+		return -1;
+	}
+	return -1;
+}
+
+static int argo_push_string(ARGO_PUSH *p, ARGO_CHAR c){
+	int r;
+
+	// in the -u mode, a multi-byte UTF-8 sequence is a single character
+	if(p->utf8.left || ((global_options & UTF8_OPTION) && c >= 0x80)){
+		r = argo_utf8_step(&p->utf8, c);
+		if(r < 0){
+			argo_push_position(p);
+			fprintf(stderr, "[%d, %d] Invalid UTF-8 (%d) in string\n", p->lines_read, p->chars_read, c);
+			return -1;
+		}
+		if(r == 0){
+			return 0;
+		}
+		c = p->utf8.code;
+		p->high = 0;
+		return argo_append_char(p->string, c);
+	}
+	if(c == ARGO_QUOTE){
+		if(p->depth && p->string == &p->frames[p->depth-1].name){
+			p->frames[p->depth-1].state = ARGO_FRAME_COLON;
+			p->lex = ARGO_LEX_BETWEEN;
+		}
+		else{
+			argo_push_end_value(p);
+		}
+		return 0;
+	}
+	if(argo_is_control(c)){
+		argo_push_position(p);
+		fprintf(stderr, "[%d, %d] Illegal character (%d) in string\n", p->lines_read, p->chars_read, c);
+		return -1;
+	}
+	if(c == ARGO_BSLASH){
+		p->lex = ARGO_LEX_ESCAPE;
+		return 0;
+	}
+	p->high = 0;
+	return argo_append_char(p->string, c);
+}
+
+static int argo_push_escape(ARGO_PUSH *p, ARGO_CHAR c){
+	ARGO_CHAR e;
+	switch(c){
+	case ARGO_QUOTE: e = ARGO_QUOTE; break;
+	case ARGO_BSLASH: e = ARGO_BSLASH; break;
+	case ARGO_FSLASH: e = ARGO_FSLASH; break;
+	case ARGO_B: e = ARGO_BS; break;
+	case ARGO_F: e = ARGO_FF; break;
+	case ARGO_N: e = ARGO_LF; break;
+	case ARGO_R: e = ARGO_CR; break;
+	case ARGO_T: e = ARGO_HT; break;
+	case ARGO_U:
+		p->ucode = 0;
+		p->udigits = 0;
+		p->lex = ARGO_LEX_UNICODE;
+		return 0;
+	default:
+		argo_push_position(p);
+		fprintf(stderr, "[%d, %d] Illegal escape (\\%d) in string\n", p->lines_read, p->chars_read, c);
+		return -1;
+	}
+	p->lex = ARGO_LEX_STRING;
+	p->high = 0;
+	return argo_append_char(p->string, e);
+}
+
+static int argo_push_unicode(ARGO_PUSH *p, ARGO_CHAR c){
+	if(!argo_is_hex(c)){
+		argo_push_position(p);
+		fprintf(stderr, "[%d, %d] Illegal escape (\\%d) in string\n", p->lines_read, p->chars_read, c);
+		return -1;
+	}
+	p->ucode = p->ucode * 16;
+	if(argo_is_digit(c)){
+		p->ucode += c - ARGO_DIGIT0;
+	}
+	else if(c >= 'A' && c <= 'F'){
+		p->ucode += c - 'A' + 10;
+	}
+	else{
+		p->ucode += c - 'a' + 10;
+	}
+	if(++p->udigits == 4){
+		p->lex = ARGO_LEX_STRING;
+		if(argo_append_escape(p->string, p->ucode, p->high)){
+			return -1;
+		}
+		p->high = argo_is_high_surrogate(p->ucode);
+	}
+	return 0;
+}
+
+/*
+ * Handle the next character of a number.  Returns 1 if the character is
+ * not part of the number, which is then complete.
+ */
+static int argo_push_number(ARGO_PUSH *p, ARGO_CHAR c){
+	ARGO_NUM_STATE next;
+	switch(p->num){
+	case ARGO_NUM_SIGN:
+		if(!argo_is_digit(c)){
+			argo_push_position(p);
+			fprintf(stderr, "[%d, %d] Invalid number char (%d)\n", p->lines_read, p->chars_read, c);
+			return -1;
+		}
+		next = c == ARGO_DIGIT0 ? ARGO_NUM_ZERO : ARGO_NUM_INT;
+		break;
+	case ARGO_NUM_ZERO:
+		if(c != ARGO_PERIOD){
+			return 1;
+		}
+		next = ARGO_NUM_FRAC_START;
+		break;
+	case ARGO_NUM_INT:
+	case ARGO_NUM_FRAC:
+		if(argo_is_digit(c)){
+			next = p->num;
+		}
+		else if(c == ARGO_PERIOD && p->num == ARGO_NUM_INT){
+			next = ARGO_NUM_FRAC_START;
+		}
+		else if(argo_is_exponent(c)){
+			next = ARGO_NUM_EXP_START;
+		}
+		else{
+			return 1;
+		}
+		break;
+	case ARGO_NUM_FRAC_START:
+		if(!argo_is_digit(c)){
+			argo_push_position(p);
+			fprintf(stderr, "[%d, %d] Digit expected in number but seen (%d)\n", p->lines_read, p->chars_read, c);
+			return -1;
+		}
+		next = ARGO_NUM_FRAC;
+		break;
+	case ARGO_NUM_EXP_START:
+		if(c == ARGO_PLUS || c == ARGO_MINUS){
+			next = ARGO_NUM_EXP_SIGN;
+			break;
+		}
+		// fall through: the sign is optional
+	case ARGO_NUM_EXP_SIGN:
+		if(!argo_is_digit(c)){
+			argo_push_position(p);
+			fprintf(stderr, "[%d, %d] Digit expected in number but seen (%d)\n", p->lines_read, p->chars_read, c);
+			return -1;
+		}
+		next = ARGO_NUM_EXP;
+		break;
+	case ARGO_NUM_EXP:
+		if(!argo_is_digit(c)){
+			return 1;
+		}
+		next = ARGO_NUM_EXP;
+		break;
+	default:
+		return -1;
+	}
+	p->num = next;
+	return argo_append_char(&p->value->content.number.string_value, c);
+}
+
+static int argo_push_end_number(ARGO_PUSH *p){
+	if(p->num == ARGO_NUM_SIGN || p->num == ARGO_NUM_FRAC_START
+	   || p->num == ARGO_NUM_EXP_START || p->num == ARGO_NUM_EXP_SIGN){
+		argo_push_position(p);
+		fprintf(stderr, "[%d, %d] Digit expected in number but seen (%d)\n", p->lines_read, p->chars_read, EOF);
+		return -1;
+	}
+	argo_number_convert(&p->value->content.number);
+	argo_push_end_value(p);
+	return 0;
+}
+
+static int argo_push_literal(ARGO_PUSH *p, ARGO_CHAR c){
+	if(c != p->literal[p->literal_pos]){
+		argo_push_position(p);
+		fprintf(stderr, "[%d, %d] Invalid Token\n", p->lines_read, p->chars_read);
+		return -1;
+	}
+	if(p->literal[++p->literal_pos] == '\0'){
+		argo_push_end_value(p);
+	}
+	return 0;
+}
+
+static int argo_push_char(ARGO_PUSH *p, ARGO_CHAR c){
+	int r;
+	switch(p->lex){
+	case ARGO_LEX_BETWEEN:
+		return argo_push_between(p, c);
+	case ARGO_LEX_STRING:
+		return argo_push_string(p, c);
+	case ARGO_LEX_ESCAPE:
+		return argo_push_escape(p, c);
+	case ARGO_LEX_UNICODE:
+		return argo_push_unicode(p, c);
+	case ARGO_LEX_NUMBER:
+		r = argo_push_number(p, c);
+		if(r <= 0){
+			return r;
+		}
+		// the number ended just before c, which starts something else
+		if(argo_push_end_number(p)){
+			return -1;
+		}
+		return argo_push_between(p, c);
+	case ARGO_LEX_LITERAL:
+		return argo_push_literal(p, c);
+	}
+	return -1;
+}
+
+/**
+ * @brief  Hand the next fragment of input to a push parser.
+ * @details  The fragment may end anywhere, even in the middle of a token
+ * or an escape sequence; parsing resumes with the next call exactly where
+ * it left off, without looking at earlier fragments again.  In case of an
+ * error, a one-line error message is output to standard error and every
+ * later call fails as well.
+ *
+ * @param p  The parser.
+ * @param buf  The fragment of input.
+ * @param len  The length of the fragment.
+ * @return  Zero if the fragment was consumed without error,
+ * nonzero if there is any error.
+ */
+int argo_feed(ARGO_PUSH *p, const char *buf, size_t len){
+	ARGO_CONTEXT *saved = argo_ctx;
+	const unsigned char *s = (const unsigned char *) buf;
+	const unsigned char *end = s + len;
+	ARGO_CHAR c;
+
+	if(p->failed){
+		return -1;
+	}
+	argo_ctx = p->ctx;
+	p->chunk = buf;
+	for(; s < end; s++){
+		c = *s;
+		p->next = (const char *) s;
+		if(argo_push_char(p, c)){
+			argo_ctx = saved;
+			return argo_push_fail(p);
+		}
+	}
+	argo_position_scan(p->chunk, buf + len - p->chunk, &p->lines_read, &p->chars_read);
+	p->chunk = NULL;
+	argo_ctx = saved;
+	return 0;
+}
+
+/**
+ * @brief  Signal the end of the input to a push parser.
+ *
+ * @param p  The parser.
+ * @return  The top-level value if the input was a complete value,
+ * NULL if there is any error.
+ */
+ARGO_VALUE *argo_finish(ARGO_PUSH *p){
+	if(p->failed){
+		return NULL;
+	}
+	if(p->lex == ARGO_LEX_NUMBER && argo_push_end_number(p)){
+		argo_push_fail(p);
+		return NULL;
+	}
+	if(!p->done){
+		if(p->root == NULL){
+			fprintf(stderr, "JSON Value not found\n");
+		}
+		else{
+			fprintf(stderr, "[%d, %d] Premature end of input\n", p->lines_read, p->chars_read);
+		}
+		argo_push_fail(p);
+		return NULL;
+	}
+	return p->root;
+}
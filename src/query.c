@@ -0,0 +1,312 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "utils.h"
+#include "context.h"
+#include "query.h"
+
+static ARGO_CHAR argo_query_skip_whitespace(FILE *f){
+	ARGO_CHAR c;
+	do{
+		c = fgetc(f);
+	} while(argo_is_whitespace(c));
+	return c;
+}
+
+/*
+ * Split a JSON Pointer (RFC 6901) into its reference tokens, unescaping
+ * ~1 and ~0 in them.  The tokens are stored in a single allocated block,
+ * which is returned and must be freed by the caller.
+ */
+static char **argo_query_tokens(char *path, int *count){
+	int n = 0;
+	int len = 0;
+	char **tokens;
+	char *s, *d;
+
+	if(*path != '\0' && *path != ARGO_FSLASH){
+		fprintf(stderr, "Invalid JSON pointer: %s\n", path);
+		return NULL;
+	}
+	for(s = path; *s; s++){
+		if(*s == ARGO_FSLASH){
+			n++;
+		}
+		len++;
+	}
+	tokens = malloc((n + 1) * sizeof(char *) + len + 1);
+	if(tokens == NULL){
+		fprintf(stderr, "Failed to allocate JSON pointer\n");
+		return NULL;
+	}
+	d = (char *) (tokens + n + 1);
+	n = 0;
+	for(s = path; *s; s++){
+		if(*s == ARGO_FSLASH){
+			if(n){
+				*d++ = '\0';
+			}
+			tokens[n++] = d;
+		}
+		else if(*s == '~'){
+			s++;
+			if(*s == '0'){
+				*d++ = '~';
+			}
+			else if(*s == '1'){
+				*d++ = ARGO_FSLASH;
+			}
+			else{
+				fprintf(stderr, "Invalid JSON pointer: %s\n", path);
+				free(tokens);
+				return NULL;
+			}
+		}
+		else{
+			*d++ = *s;
+		}
+	}
+	*d = '\0';
+	*count = n;
+	return tokens;
+}
+
+/*
+ * Read the rest of a member name, whose opening quote has been read, and
+ * compare it with a reference token.  Escape sequences are decoded only
+ * for as long as the name still matches; a code point beyond ASCII is
+ * compared with its UTF-8 encoding in the token.
+ * Returns 1 if they are equal, 0 if not, and -1 if there is any error.
+ */
+static int argo_query_match_name(FILE *f, char *token){
+	int match = 1;
+	int k;
+	int ucode, digit;
+	int decoded;
+	unsigned char utf8[4];
+	int nbytes;
+	ARGO_CHAR c;
+
+	while((c = fgetc(f)) != ARGO_QUOTE){
+		if(c == EOF){
+			argo_position(f);
+			fprintf(stderr, "[%d, %d] Premature end of input\n", argo_ctx->lines_read, argo_ctx->chars_read);
+			return -1;
+		}
+		if(!match){
+			if(c == ARGO_BSLASH){
+				fgetc(f);
+			}
+			continue;
+		}
+		decoded = 0;
+		if(c == ARGO_BSLASH){
+			c = fgetc(f);
+			switch(c){
+			case ARGO_B: c = ARGO_BS; break;
+			case ARGO_F: c = ARGO_FF; break;
+			case ARGO_N: c = ARGO_LF; break;
+			case ARGO_R: c = ARGO_CR; break;
+			case ARGO_T: c = ARGO_HT; break;
+			case ARGO_QUOTE: case ARGO_BSLASH: case ARGO_FSLASH: break;
+			case ARGO_U:
+				ucode = 0;
+				for(k = 0; k < 4; k++){
+					digit = fgetc(f);
+					if(argo_is_digit(digit)){
+						digit -= '0';
+					}
+					else if(argo_is_hex(digit)){
+						digit = (digit | 0x20) - 'a' + 10;
+					}
+					else{
+						argo_position(f);
+						fprintf(stderr, "[%d, %d] Invalid \\u escape\n", argo_ctx->lines_read, argo_ctx->chars_read);
+						return -1;
+					}
+					ucode = ucode * 16 + digit;
+				}
+				c = ucode;
+				decoded = 1;
+				break;
+			default:
+				argo_position(f);
+				fprintf(stderr, "[%d, %d] Invalid escape\n", argo_ctx->lines_read, argo_ctx->chars_read);
+				return -1;
+			}
+		}
+		if(c < 0x80 || !decoded){
+			// ASCII, or a raw byte of a multi-byte character
+			utf8[0] = c;
+			nbytes = 1;
+		}
+		else if(c < 0x800){
+			utf8[0] = 0xC0 | (c >> 6);
+			utf8[1] = 0x80 | (c & 0x3F);
+			nbytes = 2;
+		}
+		else{
+			utf8[0] = 0xE0 | (c >> 12);
+			utf8[1] = 0x80 | ((c >> 6) & 0x3F);
+			utf8[2] = 0x80 | (c & 0x3F);
+			nbytes = 3;
+		}
+		for(k = 0; k < nbytes && match; k++){
+			if(*token == '\0' || (unsigned char) *token != utf8[k]){
+				match = 0;
+			}
+			token++;
+		}
+	}
+	return match && *token == '\0';
+}
+
+/*
+ * Parse an array index token: a nonnegative decimal number without
+ * leading zeros.  Returns -1 for anything else (including "-", which
+ * refers to the nonexistent element past the end).
+ */
+static long argo_query_index(char *token){
+	long index = 0;
+
+	if(*token == '\0' || (*token == '0' && token[1] != '\0')){
+		return -1;
+	}
+	for(; *token; token++){
+		if(!argo_is_digit(*token) || index > 100000000){
+			return -1;
+		}
+		index = index * 10 + (*token - '0');
+	}
+	return index;
+}
+
+/**
+ * @brief  Read the value of a document addressed by a JSON Pointer.
+ * @details  The document is scanned along the path.  Members and elements
+ * that are not on it are skipped with argo_skip_value, so that no values
+ * are allocated for them and their strings are not decoded, and only the
+ * addressed value is read with argo_read_value.  Nothing after it is read,
+ * so the rest of the document is neither read nor checked.
+ *
+ * @param f  Input stream from which JSON is to be read.
+ * @param path  The JSON Pointer (RFC 6901); the empty string addresses
+ * the whole document.
+ * @return  A valid pointer if the operation is completely successful,
+ * NULL if there is no such value or there is any error.
+ */
+ARGO_VALUE *argo_query_value(FILE *f, char *path){
+	int n, k;
+	int found;
+	long index, i;
+	ARGO_CHAR c;
+	ARGO_VALUE *v = NULL;
+	char **tokens = argo_query_tokens(path, &n);
+
+	if(tokens == NULL){
+		return NULL;
+	}
+	for(k = 0; k < n; k++){
+		found = 0;
+		c = argo_query_skip_whitespace(f);
+		if(c == ARGO_LBRACE){
+			c = argo_query_skip_whitespace(f);
+			while(c != ARGO_RBRACE){
+				if(c != ARGO_QUOTE){
+					argo_position(f);
+					fprintf(stderr, "[%d, %d] Expect member name but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
+					goto done;
+				}
+				found = argo_query_match_name(f, tokens[k]);
+				if(found < 0){
+					goto done;
+				}
+				c = argo_query_skip_whitespace(f);
+				if(c != ARGO_COLON){
+					argo_position(f);
+					fprintf(stderr, "[%d, %d] Expect : in object but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
+					goto done;
+				}
+				if(found){
+					break;
+				}
+				if(argo_skip_value(f)){
+					goto done;
+				}
+				c = argo_query_skip_whitespace(f);
+				if(c == ARGO_COMMA){
+					c = argo_query_skip_whitespace(f);
+				}
+				else if(c != ARGO_RBRACE){
+					argo_position(f);
+					fprintf(stderr, "[%d, %d] Expect , in object but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
+					goto done;
+				}
+			}
+		}
+		else if(c == ARGO_LBRACK){
+			index = argo_query_index(tokens[k]);
+			c = argo_query_skip_whitespace(f);
+			if(c != ARGO_RBRACK){
+				if(ungetc(c, f) == EOF){
+					argo_position(f);
+					fprintf(stderr, "[%d, %d] Fail to unget. \n", argo_ctx->lines_read, argo_ctx->chars_read);
+					goto done;
+				}
+				for(i = 0; ; i++){
+					if(i == index){
+						found = 1;
+						break;
+					}
+					if(argo_skip_value(f)){
+						goto done;
+					}
+					c = argo_query_skip_whitespace(f);
+					if(c == ARGO_RBRACK){
+						break;
+					}
+					if(c != ARGO_COMMA){
+						argo_position(f);
+						fprintf(stderr, "[%d, %d] Expect , in array but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
+						goto done;
+					}
+				}
+			}
+		}
+		else if(c == EOF){
+			argo_position(f);
+			fprintf(stderr, "[%d, %d] Premature end of input\n", argo_ctx->lines_read, argo_ctx->chars_read);
+			goto done;
+		}
+		if(!found){
+			fprintf(stderr, "No value at %s\n", path);
+			goto done;
+		}
+	}
+	v = argo_read_value(f);
+
+ done:
+	free(tokens);
+	return v;
+}
+
+/**
+ * @brief  Output the value of a document addressed by a JSON Pointer,
+ * in canonical form.
+ *
+ * @param in  Input stream from which JSON is to be read.
+ * @param out  Output stream to which canonical JSON is to be written.
+ * @param path  The JSON Pointer.
+ * @return  Zero if the operation is completely successful,
+ * nonzero if there is no such value or there is any error.
+ */
+int argo_query_run(FILE *in, FILE *out, char *path){
+	ARGO_VALUE *v = argo_query_value(in, path);
+	if(v == NULL){
+		return -1;
+	}
+	return argo_write_value(v, out);
+}
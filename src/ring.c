@@ -0,0 +1,406 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdio_ext.h>
+#include <pthread.h>
+#include <errno.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "context.h"
+#include "ring.h"
+
+/*
+ * A ring of buffers between a producer and a consumer, one of which is the
+ * I/O thread.  The producer fills buffers[produce] and the consumer drains
+ * buffers[consume]; each index is private to its side, and only the count
+ * of full buffers, which decides who may touch which buffer, is shared.
+ */
+typedef struct argo_ring_buffer {
+	char *data;
+	size_t length;                     // Bytes of data in a full buffer.
+} ARGO_RING_BUFFER;
+
+typedef struct argo_ring {
+	pthread_mutex_t lock;
+	pthread_cond_t filled;             // Signalled when a buffer becomes full.
+	pthread_cond_t emptied;            // Signalled when a buffer has been drained.
+	ARGO_RING_BUFFER buffers[ARGO_RING_BUFFERS];
+	int count;                         // Full buffers, not yet drained.
+	int produce;                       // Buffer being filled,
+	int consume;                       // and buffer being drained.
+	size_t offset;                     // Bytes consumed (input) or produced (output) of that buffer.
+	int eof;                           // No more buffers will be filled.
+	int closed;                        // The stream has been closed.
+	int error;                         // Reading or writing failed.
+	int refs;                          // Input: the stream and the reader thread.
+	ARGO_SOURCE *source;               // Where input comes from,
+	FILE *out;                         // or where output goes,
+	int close_out;                     // and whether it is to be closed at the end.
+	pthread_t thread;
+} ARGO_RING;
+
+static void argo_ring_copy(char *to, const char *from, size_t n){
+	size_t i;
+
+	for(i = 0; i < n; i++){
+		to[i] = from[i];
+	}
+}
+
+static void argo_ring_free(ARGO_RING *r){
+	int i;
+
+	for(i = 0; i < ARGO_RING_BUFFERS; i++){
+		free(r->buffers[i].data);
+	}
+	if(r->source != NULL){
+		r->source->close(r->source);
+	}
+	pthread_mutex_destroy(&r->lock);
+	pthread_cond_destroy(&r->filled);
+	pthread_cond_destroy(&r->emptied);
+	free(r);
+}
+
+static ARGO_RING *argo_ring_create(void){
+	ARGO_RING *r = calloc(1, sizeof(ARGO_RING));
+	int i;
+
+	if(r == NULL){
+		fprintf(stderr, "Failed to allocate ring\n");
+		return NULL;
+	}
+	pthread_mutex_init(&r->lock, NULL);
+	pthread_cond_init(&r->filled, NULL);
+	pthread_cond_init(&r->emptied, NULL);
+	for(i = 0; i < ARGO_RING_BUFFERS; i++){
+		r->buffers[i].data = malloc(ARGO_RING_BUFFER_SIZE);
+		if(r->buffers[i].data == NULL){
+			fprintf(stderr, "Failed to allocate ring\n");
+			argo_ring_free(r);
+			return NULL;
+		}
+	}
+	return r;
+}
+
+/*
+ * Drop one reference to an input ring, whose lock is held, and free it
+ * once neither the stream nor the reader thread uses it any more.
+ */
+static void argo_ring_release(ARGO_RING *r){
+	int last = --r->refs == 0;
+
+	pthread_mutex_unlock(&r->lock);
+	if(last){
+		argo_ring_free(r);
+	}
+}
+
+/*
+ * Reader thread: fill buffers from the source until it is exhausted or
+ * the stream is closed.  The thread is detached, since it may be blocked
+ * reading a pipe or terminal when the stream is closed; whichever of the
+ * two finishes last frees the ring.
+ */
+static void *argo_ring_read(void *arg){
+	ARGO_RING *r = arg;
+	ARGO_RING_BUFFER *b;
+	ssize_t n;
+
+	pthread_mutex_lock(&r->lock);
+	while(!r->closed){
+		if(r->count == ARGO_RING_BUFFERS){
+			pthread_cond_wait(&r->emptied, &r->lock);
+			continue;
+		}
+		b = &r->buffers[r->produce];
+		pthread_mutex_unlock(&r->lock);
+		n = r->source->read(r->source, b->data, ARGO_RING_BUFFER_SIZE);
+		pthread_mutex_lock(&r->lock);
+		if(n <= 0){
+			if(n < 0){
+				fprintf(stderr, "Error reading input\n");
+				r->error = 1;
+			}
+			break;
+		}
+		b->length = n;
+		r->produce = (r->produce + 1) % ARGO_RING_BUFFERS;
+		r->count++;
+		pthread_cond_signal(&r->filled);
+	}
+	r->eof = 1;
+	pthread_cond_signal(&r->filled);
+	argo_ring_release(r);
+	return NULL;
+}
+
+static ssize_t argo_ring_input_read(void *cookie, char *buf, size_t size){
+	ARGO_RING *r = cookie;
+	ARGO_CONTEXT *ctx = argo_ctx;
+	ARGO_RING_BUFFER *b;
+	size_t n;
+
+	// as for argo_source_stream, the position follows the buffer of the stream
+	argo_position_advance(ctx, ctx->text_length);
+	ctx->text_length = 0;
+	pthread_mutex_lock(&r->lock);
+	while(r->count == 0 && !r->eof){
+		pthread_cond_wait(&r->filled, &r->lock);
+	}
+	if(r->count == 0){
+		n = r->error;
+		pthread_mutex_unlock(&r->lock);
+		return n ? -1 : 0;
+	}
+	pthread_mutex_unlock(&r->lock);
+
+	b = &r->buffers[r->consume];
+	n = b->length - r->offset;
+	if(n > size){
+		n = size;
+	}
+	argo_ring_copy(buf, b->data + r->offset, n);
+	ctx->text = buf;
+	ctx->text_length = n;
+	r->offset += n;
+	if(r->offset == b->length){
+		r->offset = 0;
+		r->consume = (r->consume + 1) % ARGO_RING_BUFFERS;
+		pthread_mutex_lock(&r->lock);
+		r->count--;
+		pthread_cond_signal(&r->emptied);
+		pthread_mutex_unlock(&r->lock);
+	}
+	return n;
+}
+
+static int argo_ring_input_seek(void *cookie, off64_t *offset, int whence){
+	if(whence != SEEK_CUR || *offset != 0){
+		errno = ESPIPE;
+		return -1;
+	}
+	*offset = argo_ctx->mark + argo_ctx->text_length;
+	return 0;
+}
+
+static int argo_ring_input_close(void *cookie){
+	ARGO_RING *r = cookie;
+
+	pthread_mutex_lock(&r->lock);
+	r->closed = 1;
+	pthread_cond_signal(&r->emptied);
+	argo_ring_release(r);
+	return 0;
+}
+
+/**
+ * @brief  Open a stream whose input is read ahead from a source by a
+ * reader thread.
+ * @details  Up to ARGO_RING_BUFFERS buffers of ARGO_RING_BUFFER_SIZE bytes
+ * are read ahead of the parser.  The stream must be used by one thread
+ * only, so that it can do without locking.  Closing it stops the reader
+ * thread, which then closes the source.  An error reading the source is
+ * reported on standard error, and is seen as an error of the stream once
+ * everything read before it has been consumed.
+ *
+ * @param source  The source, which is closed if the stream cannot be opened.
+ * @return  The stream, or NULL if there is any error.
+ */
+FILE *argo_ring_open_source(ARGO_SOURCE *source){
+	cookie_io_functions_t io = {argo_ring_input_read, NULL, argo_ring_input_seek, argo_ring_input_close};
+	pthread_attr_t attr;
+	ARGO_RING *r;
+	FILE *f;
+
+	if(source == NULL){
+		return NULL;
+	}
+	r = argo_ring_create();
+	if(r == NULL){
+		source->close(source);
+		return NULL;
+	}
+	r->source = source;
+	r->refs = 2;
+	f = fopencookie(r, "r", io);
+	if(f == NULL){
+		fprintf(stderr, "Failed to open input\n");
+		argo_ring_free(r);
+		return NULL;
+	}
+	__fsetlocking(f, FSETLOCKING_BYCALLER);
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	if(pthread_create(&r->thread, &attr, argo_ring_read, r)){
+		fprintf(stderr, "Failed to create reader thread\n");
+		pthread_attr_destroy(&attr);
+		r->refs = 1;
+		fclose(f);
+		return NULL;
+	}
+	pthread_attr_destroy(&attr);
+	return f;
+}
+
+/**
+ * @brief  Open a stream that reads ahead of the parser from the file
+ * descriptor of another stream, as argo_ring_open_source does.
+ *
+ * @param in  The input stream, from which nothing must have been read yet.
+ * It is not closed with the stream returned.
+ * @return  The stream, or NULL if there is any error.
+ */
+FILE *argo_ring_open_input(FILE *in){
+	return argo_ring_open_source(argo_source_open(in));
+}
+
+/*
+ * Writer thread: drain full buffers to the output stream until the ring is
+ * closed and empty.  After an error, buffers are still drained, without
+ * being written, so that the producer never waits for one forever.
+ */
+static void *argo_ring_write(void *arg){
+	ARGO_RING *r = arg;
+	ARGO_RING_BUFFER *b;
+	int failed = 0;
+
+	pthread_mutex_lock(&r->lock);
+	while(1){
+		while(r->count == 0 && !r->closed){
+			pthread_cond_wait(&r->filled, &r->lock);
+		}
+		if(r->count == 0){
+			break;
+		}
+		pthread_mutex_unlock(&r->lock);
+		b = &r->buffers[r->consume];
+		if(!failed && fwrite(b->data, 1, b->length, r->out) != b->length){
+			fprintf(stderr, "Error writing output\n");
+			failed = 1;
+		}
+		r->consume = (r->consume + 1) % ARGO_RING_BUFFERS;
+		pthread_mutex_lock(&r->lock);
+		r->error |= failed;
+		r->count--;
+		pthread_cond_signal(&r->emptied);
+	}
+	pthread_mutex_unlock(&r->lock);
+	return NULL;
+}
+
+/*
+ * Hand the buffer being filled to the writer thread, and wait for the next
+ * one to be free.  Returns -1 if writing has failed.
+ */
+static int argo_ring_hand_over(ARGO_RING *r){
+	int error;
+
+	pthread_mutex_lock(&r->lock);
+	r->buffers[r->produce].length = r->offset;
+	r->produce = (r->produce + 1) % ARGO_RING_BUFFERS;
+	r->offset = 0;
+	r->count++;
+	pthread_cond_signal(&r->filled);
+	while(r->count == ARGO_RING_BUFFERS){
+		pthread_cond_wait(&r->emptied, &r->lock);
+	}
+	error = r->error;
+	pthread_mutex_unlock(&r->lock);
+	return error ? -1 : 0;
+}
+
+static ssize_t argo_ring_output_write(void *cookie, const char *buf, size_t size){
+	ARGO_RING *r = cookie;
+	size_t done = 0;
+	size_t n;
+
+	while(done < size){
+		if(r->offset == ARGO_RING_BUFFER_SIZE && argo_ring_hand_over(r)){
+			return -1;
+		}
+		n = ARGO_RING_BUFFER_SIZE - r->offset;
+		if(n > size - done){
+			n = size - done;
+		}
+		argo_ring_copy(r->buffers[r->produce].data + r->offset, buf + done, n);
+		r->offset += n;
+		done += n;
+	}
+	return size;
+}
+
+static int argo_ring_output_close(void *cookie){
+	ARGO_RING *r = cookie;
+	int status = 0;
+
+	if(r->offset > 0 && argo_ring_hand_over(r)){
+		status = -1;
+	}
+	pthread_mutex_lock(&r->lock);
+	r->closed = 1;
+	pthread_cond_signal(&r->filled);
+	pthread_mutex_unlock(&r->lock);
+	pthread_join(r->thread, NULL);
+	if(r->error){
+		status = -1;
+	}
+	if(r->close_out ? fclose(r->out) == EOF : fflush(r->out) == EOF){
+		status = -1;
+	}
+	argo_ring_free(r);
+	return status ? EOF : 0;
+}
+
+/**
+ * @brief  Open a stream whose output is written to another stream by a
+ * writer thread.
+ * @details  What is written to the stream is collected in buffers of
+ * ARGO_RING_BUFFER_SIZE bytes, each of which is written to "out" as a
+ * whole once full, while up to ARGO_RING_BUFFERS - 1 more are filled.
+ * The stream must be used by one thread only, and "out" must not be used
+ * by any other thread while it is open.  Closing it waits until everything
+ * has been written, then flushes "out", or closes it if "close_out" is
+ * nonzero; fclose fails if any of that fails.
+ *
+ * @param out  The output stream.
+ * @param close_out  Nonzero if "out" is to be closed with the stream.
+ * @return  The stream, or NULL if there is any error.
+ */
+FILE *argo_ring_open_output(FILE *out, int close_out){
+	cookie_io_functions_t io = {NULL, argo_ring_output_write, NULL, argo_ring_output_close};
+	ARGO_RING *r;
+	FILE *f;
+
+	if(out == NULL){
+		return NULL;
+	}
+	r = argo_ring_create();
+	if(r == NULL){
+		return NULL;
+	}
+	r->out = out;
+	r->close_out = close_out;
+	if(pthread_create(&r->thread, NULL, argo_ring_write, r)){
+		fprintf(stderr, "Failed to create writer thread\n");
+		argo_ring_free(r);
+		return NULL;
+	}
+	f = fopencookie(r, "w", io);
+	if(f == NULL){
+		fprintf(stderr, "Failed to open output\n");
+		pthread_mutex_lock(&r->lock);
+		r->closed = 1;
+		pthread_cond_signal(&r->filled);
+		pthread_mutex_unlock(&r->lock);
+		pthread_join(r->thread, NULL);
+		argo_ring_free(r);
+		return NULL;
+	}
+	__fsetlocking(f, FSETLOCKING_BYCALLER);
+	return f;
+}
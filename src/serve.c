@@ -0,0 +1,1053 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdio_ext.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "utils.h"
+#include "context.h"
+#include "options.h"
+#include "writer.h"
+#include "pool.h"
+#include "serve.h"
+
+#define ARGO_SERVE_BACKLOG 128
+#define ARGO_SERVE_READ_SIZE (1 << 16)
+#define ARGO_SERVE_MAX_EVENTS 64
+
+/*
+ * Output of requests that failed, when there is no message of their own.
+ */
+static char argo_serve_invalid[] = "Invalid document";
+static char argo_serve_bad_request[] = "Bad request";
+
+/*
+ * Indent of the request being written by the calling worker, for the
+ * indents that have no writer of their own.
+ */
+static __thread int argo_serve_indent;
+
+ARGO_DEFINE_WRITER(argo_serve_write_pretty, argo_serve_write_array_pretty, argo_serve_write_object_pretty,
+                   argo_serve_indent)
+
+/*
+ * Bucket of a latency: the first ARGO_LATENCY_SUB buckets hold one
+ * nanosecond each, and every later run of ARGO_LATENCY_SUB buckets spans
+ * twice the range of the run before it.
+ */
+static int argo_latency_bucket(long ns){
+	int e = 0;
+
+	if(ns < ARGO_LATENCY_SUB){
+		return ns < 0 ? 0 : ns;
+	}
+	while((ns >> e) >= 2 * ARGO_LATENCY_SUB){
+		e++;
+	}
+	return (e + 1) * ARGO_LATENCY_SUB + (int) (ns >> e) - ARGO_LATENCY_SUB;
+}
+
+/*
+ * Middle of the range of latencies in a bucket.
+ */
+static long argo_latency_value(int b){
+	int e;
+
+	if(b < ARGO_LATENCY_SUB){
+		return b;
+	}
+	e = b / ARGO_LATENCY_SUB - 1;
+	return ((long) (b % ARGO_LATENCY_SUB + ARGO_LATENCY_SUB) << e) + ((1L << e) >> 1);
+}
+
+void argo_latency_add(ARGO_LATENCY *l, long ns){
+	int b = argo_latency_bucket(ns);
+
+	l->counts[b < ARGO_LATENCY_BUCKETS ? b : ARGO_LATENCY_BUCKETS - 1]++;
+	l->total++;
+	l->sum += ns;
+	if(ns > l->max){
+		l->max = ns;
+	}
+}
+
+void argo_latency_merge(ARGO_LATENCY *l, ARGO_LATENCY *other){
+	int i;
+
+	for(i = 0; i < ARGO_LATENCY_BUCKETS; i++){
+		l->counts[i] += other->counts[i];
+	}
+	l->total += other->total;
+	l->sum += other->sum;
+	if(other->max > l->max){
+		l->max = other->max;
+	}
+}
+
+/**
+ * @brief  Estimate a percentile of the latencies recorded in a histogram.
+ *
+ * @param l  The histogram.
+ * @param p  The fraction of latencies that are to be at most the result,
+ * between 0 and 1.
+ * @return  The latency, in nanoseconds, to within 1/ARGO_LATENCY_SUB of its
+ * value, but never more than the largest recorded; 0 if there are none.
+ */
+long argo_latency_percentile(ARGO_LATENCY *l, double p){
+	long target = (long) (p * l->total + 0.999999);
+	long seen = 0;
+	long v;
+	int i;
+
+	if(target < 1){
+		target = 1;
+	}
+	if(target >= l->total){
+		return l->max;
+	}
+	for(i = 0; i < ARGO_LATENCY_BUCKETS; i++){
+		seen += l->counts[i];
+		if(seen >= target){
+			v = argo_latency_value(i);
+			return v < l->max ? v : l->max;
+		}
+	}
+	return l->max;
+}
+
+static long argo_serve_elapsed(struct timespec *start, struct timespec *end){
+	return (end->tv_sec - start->tv_sec) * 1000000000L + (end->tv_nsec - start->tv_nsec);
+}
+
+static void argo_serve_copy(char *to, char *from, size_t n){
+	size_t i;
+
+	for(i = 0; i < n; i++){
+		to[i] = from[i];
+	}
+}
+
+static void argo_serve_header(unsigned char *h, int first, int second, size_t length){
+	h[0] = first;
+	h[1] = second;
+	h[2] = 0;
+	h[3] = 0;
+	h[4] = length >> 24;
+	h[5] = length >> 16;
+	h[6] = length >> 8;
+	h[7] = length;
+}
+
+static size_t argo_serve_length(unsigned char *h){
+	return ((size_t) h[4] << 24) | ((size_t) h[5] << 16) | ((size_t) h[6] << 8) | h[7];
+}
+
+struct argo_server;
+struct argo_connection;
+
+/*
+ * A request, which is parsed on a worker and answered from the event loop.
+ */
+typedef struct argo_request {
+    ARGO_JOB job;                      // Must be first.
+    struct argo_request *next;         // Next request on the same connection.
+    struct argo_request *done_next;    // Next request in the list of completed ones.
+    struct argo_connection *conn;
+    struct argo_server *server;
+    int op;
+    int indent;
+    char *payload;
+    size_t length;
+    char *output;                      // Output, or error message.
+    size_t output_length;
+    int result;                        // ARGO_SERVE_* status.
+    int done;                          // Nonzero once it may be answered.
+    struct timespec received;          // When the whole request had been read.
+} ARGO_REQUEST;
+
+typedef struct argo_connection {
+    int fd;                            // Socket, or -1 once it has been closed.
+    char *in;                          // Bytes received and not yet made into requests,
+    size_t in_start;                   // from in_start
+    size_t in_length;                  // up to in_length.
+    size_t in_capacity;
+    char *out;                         // Responses not yet sent, likewise.
+    size_t out_start;
+    size_t out_length;
+    size_t out_capacity;
+    ARGO_REQUEST *head;                // Requests not yet answered, in order of arrival.
+    ARGO_REQUEST *tail;
+    int pending;                       // Number of them.
+    int closing;                       // No more requests are to be made.
+    int eof;                           // Nothing more is to be read.
+    int events;                        // Events registered with epoll.
+    int queued;                        // Nonzero while in a list of connections to flush,
+    struct argo_connection *flush_next; // whose next element this is.
+} ARGO_CONNECTION;
+
+typedef struct argo_server {
+    int epoll_fd;
+    int listen_fd;
+    int event_fd;                      // Written by workers when requests complete.
+    int signal_fd;                     // Readable on SIGINT or SIGTERM.
+    ARGO_POOL *pool;
+    ARGO_CONNECTION **conns;           // Connection of each socket, by descriptor.
+    int num_conns;                     // Size of conns.
+    pthread_mutex_t lock;
+    ARGO_REQUEST *done;                // Requests completed by workers, not yet handled.
+    ARGO_LATENCY latency;
+    long requests;
+    long failed;
+    struct timespec start;
+} ARGO_SERVER;
+
+/*
+ * Job run on a worker: parse the document of a request into the worker's
+ * own context, and produce its output unless only validating.
+ */
+static int argo_serve_run_request(ARGO_JOB *job){
+	ARGO_REQUEST *r = (ARGO_REQUEST *) job;
+	ARGO_CONTEXT *ctx = argo_ctx;
+	ARGO_VALUE *v = NULL;
+	ARGO_WRITER writer;
+	char *errors = NULL;
+	size_t errors_length = 0;
+	FILE *f;
+
+	// what is wrong with the document goes back to the client, not to our stderr
+	ctx->errors = open_memstream(&errors, &errors_length);
+	argo_context_input(ctx, r->payload, r->length, 0, 0);
+	if(ctx->errors != NULL && r->length > 0 && (f = fmemopen(r->payload, r->length, "r")) != NULL){
+		// the stream is private to this worker: spare fgetc the lock on every character
+		__fsetlocking(f, FSETLOCKING_BYCALLER);
+		v = argo_read_value(f);
+		fclose(f);
+	}
+	if(v == NULL){
+		r->result = ARGO_SERVE_INVALID;
+	}
+	else if(r->op != ARGO_SERVE_VALIDATE){
+		switch(r->op == ARGO_SERVE_PRETTY ? r->indent : 0){
+		case 0:
+			writer = argo_write_minified;
+			break;
+		case 2:
+			writer = argo_write_pretty2;
+			break;
+		case 4:
+			writer = argo_write_pretty4;
+			break;
+		default:
+			argo_serve_indent = r->indent;
+			writer = argo_serve_write_pretty;
+			break;
+		}
+		f = open_memstream(&r->output, &r->output_length);
+		if(f != NULL){
+			__fsetlocking(f, FSETLOCKING_BYCALLER);
+		}
+		// pretty-printed output ends with a newline, as from argo_write_value
+		if(f == NULL || writer(v, f) || (writer != argo_write_minified && fputc(ARGO_LF, f) == EOF)){
+			r->result = ARGO_SERVE_INVALID;
+		}
+		if(f != NULL){
+			fclose(f);
+		}
+	}
+	argo_context_reset(ctx);
+	if(ctx->errors != NULL){
+		fclose(ctx->errors);
+		ctx->errors = NULL;
+	}
+	if(r->result == ARGO_SERVE_INVALID){
+		free(r->output);
+		r->output = errors;
+		r->output_length = errors_length;
+	}
+	else{
+		free(errors);
+	}
+	free(r->payload);
+	r->payload = NULL;
+	return 0;
+}
+
+/*
+ * Called on the worker once a request has been run: hand it back to the
+ * event loop.
+ */
+static void argo_serve_finish_request(ARGO_JOB *job){
+	ARGO_REQUEST *r = (ARGO_REQUEST *) job;
+	ARGO_SERVER *s = r->server;
+	uint64_t one = 1;
+
+	pthread_mutex_lock(&s->lock);
+	r->done_next = s->done;
+	s->done = r;
+	pthread_mutex_unlock(&s->lock);
+	if(write(s->event_fd, &one, sizeof(one)) != sizeof(one)){
+		fprintf(stderr, "Failed to signal completion\n");
+	}
+}
+
+static int argo_serve_reserve(char **buf, size_t *capacity, size_t needed){
+	size_t cap = *capacity ? *capacity : ARGO_SERVE_READ_SIZE;
+	char *next;
+
+	if(needed <= *capacity){
+		return 0;
+	}
+	while(cap < needed){
+		cap *= 2;
+	}
+	next = realloc(*buf, cap);
+	if(next == NULL){
+		fprintf(stderr, "Failed to allocate connection buffer\n");
+		return -1;
+	}
+	*buf = next;
+	*capacity = cap;
+	return 0;
+}
+
+static void argo_serve_free_conn(ARGO_CONNECTION *c){
+	free(c->in);
+	free(c->out);
+	free(c);
+}
+
+/*
+ * Close the socket of a connection.  The connection itself is freed once
+ * none of its requests are outstanding on the workers.
+ */
+static void argo_serve_close(ARGO_SERVER *s, ARGO_CONNECTION *c){
+	if(c->fd >= 0){
+		epoll_ctl(s->epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+		close(c->fd);
+		s->conns[c->fd] = NULL;
+		c->fd = -1;
+	}
+	c->closing = 1;
+	if(c->pending == 0){
+		argo_serve_free_conn(c);
+	}
+}
+
+/*
+ * Register with epoll the events that a connection is now waiting for:
+ * more requests, as long as not too many are outstanding, and room to
+ * send the responses not yet sent.
+ */
+static void argo_serve_update(ARGO_SERVER *s, ARGO_CONNECTION *c){
+	struct epoll_event ev = {0};
+	int events = 0;
+
+	if(!c->closing && !c->eof && c->pending < ARGO_SERVE_MAX_PENDING){
+		events |= EPOLLIN;
+	}
+	if(c->out_length > c->out_start){
+		events |= EPOLLOUT;
+	}
+	if(events != c->events){
+		ev.events = events;
+		ev.data.fd = c->fd;
+		epoll_ctl(s->epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+		c->events = events;
+	}
+}
+
+/*
+ * Send as much of the responses of a connection as the socket will take.
+ */
+static int argo_serve_send(ARGO_CONNECTION *c){
+	ssize_t n;
+
+	while(c->out_start < c->out_length){
+		n = send(c->fd, c->out + c->out_start, c->out_length - c->out_start, MSG_NOSIGNAL);
+		if(n < 0){
+			if(errno == EINTR){
+				continue;
+			}
+			if(errno == EAGAIN || errno == EWOULDBLOCK){
+				return 0;
+			}
+			return -1;
+		}
+		c->out_start += n;
+	}
+	c->out_start = 0;
+	c->out_length = 0;
+	return 0;
+}
+
+/*
+ * Output of a stats request: the latency metrics of the server so far.
+ */
+static void argo_serve_stats(ARGO_SERVER *s, ARGO_REQUEST *r){
+	struct timespec now;
+	double secs;
+	FILE *f = open_memstream(&r->output, &r->output_length);
+
+	if(f == NULL){
+		r->result = ARGO_SERVE_BAD_REQUEST;
+		return;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	secs = argo_serve_elapsed(&s->start, &now) / 1e9;
+	fprintf(f, "{\"requests\":%ld,\"failed\":%ld,\"uptime\":%.3f,\"mean_us\":%.1f,"
+		"\"p50_us\":%.1f,\"p90_us\":%.1f,\"p99_us\":%.1f,\"max_us\":%.1f}",
+		s->requests, s->failed, secs, s->latency.total ? s->latency.sum / s->latency.total / 1e3 : 0.0,
+		argo_latency_percentile(&s->latency, 0.5) / 1e3, argo_latency_percentile(&s->latency, 0.9) / 1e3,
+		argo_latency_percentile(&s->latency, 0.99) / 1e3, s->latency.max / 1e3);
+	fclose(f);
+}
+
+static int argo_serve_frames(ARGO_SERVER *s, ARGO_CONNECTION *c);
+
+/*
+ * Answer the requests of a connection that have completed, in order, and
+ * send what can be sent.  The latency of each request runs from when it
+ * was read to when its response is ready to be sent.
+ */
+static void argo_serve_flush(ARGO_SERVER *s, ARGO_CONNECTION *c){
+	struct timespec now;
+	ARGO_REQUEST *r;
+	char *output;
+	size_t length;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	do{
+		while((r = c->head) != NULL && r->done){
+			if(r->op == ARGO_SERVE_STATS){
+				argo_serve_stats(s, r);
+			}
+			else{
+				argo_latency_add(&s->latency, argo_serve_elapsed(&r->received, &now));
+				s->requests++;
+				if(r->result != ARGO_SERVE_OK){
+					s->failed++;
+				}
+			}
+			output = r->output;
+			length = r->output_length;
+			if(r->result == ARGO_SERVE_INVALID && length == 0){
+				output = argo_serve_invalid;
+				length = sizeof(argo_serve_invalid) - 1;
+			}
+			else if(r->result == ARGO_SERVE_BAD_REQUEST){
+				output = argo_serve_bad_request;
+				length = sizeof(argo_serve_bad_request) - 1;
+			}
+			if(c->fd >= 0 && argo_serve_reserve(&c->out, &c->out_capacity,
+			                                    c->out_length + ARGO_SERVE_HEADER_SIZE + length) == 0){
+				argo_serve_header((unsigned char *) c->out + c->out_length, r->result, 0, length);
+				argo_serve_copy(c->out + c->out_length + ARGO_SERVE_HEADER_SIZE, output, length);
+				c->out_length += ARGO_SERVE_HEADER_SIZE + length;
+			}
+			c->head = r->next;
+			if(c->head == NULL){
+				c->tail = NULL;
+			}
+			c->pending--;
+			free(r->output);
+			free(r->payload);
+			free(r);
+		}
+		if(c->fd < 0){
+			if(c->pending == 0){
+				argo_serve_free_conn(c);
+			}
+			return;
+		}
+		// frames already received may have been held back while too many
+		// requests were outstanding, and no more input may come to wake us
+		if(argo_serve_frames(s, c)){
+			argo_serve_close(s, c);
+			return;
+		}
+	} while(c->head != NULL && c->head->done);
+	if(argo_serve_send(c)){
+		argo_serve_close(s, c);
+		return;
+	}
+	if((c->closing || c->eof) && c->pending == 0 && c->out_length == 0){
+		argo_serve_close(s, c);
+		return;
+	}
+	argo_serve_update(s, c);
+}
+
+/*
+ * Make a request of the next frame of a connection and queue it, on the
+ * workers unless it can be answered at once.
+ */
+static int argo_serve_request(ARGO_SERVER *s, ARGO_CONNECTION *c, unsigned char *h, char *payload, size_t length){
+	ARGO_REQUEST *r = calloc(1, sizeof(ARGO_REQUEST));
+
+	if(r == NULL){
+		fprintf(stderr, "Failed to allocate request\n");
+		return -1;
+	}
+	r->conn = c;
+	r->server = s;
+	r->op = h[0];
+	r->indent = h[1];
+	clock_gettime(CLOCK_MONOTONIC, &r->received);
+	if(c->tail){
+		c->tail->next = r;
+	}
+	else{
+		c->head = r;
+	}
+	c->tail = r;
+	c->pending++;
+
+	if(r->op != ARGO_SERVE_VALIDATE && r->op != ARGO_SERVE_CANONICALIZE
+	   && r->op != ARGO_SERVE_PRETTY && r->op != ARGO_SERVE_STATS){
+		r->result = ARGO_SERVE_BAD_REQUEST;
+	}
+	if(r->result != ARGO_SERVE_OK || r->op == ARGO_SERVE_STATS){
+		r->done = 1;
+		return 0;
+	}
+	if(length > 0){
+		r->payload = malloc(length);
+		if(r->payload == NULL){
+			fprintf(stderr, "Failed to allocate request\n");
+			r->result = ARGO_SERVE_BAD_REQUEST;
+			r->done = 1;
+			return 0;
+		}
+		argo_serve_copy(r->payload, payload, length);
+	}
+	r->length = length;
+	r->job.run = argo_serve_run_request;
+	r->job.finish = argo_serve_finish_request;
+	if(argo_pool_submit_detached(s->pool, &r->job)){
+		r->result = ARGO_SERVE_BAD_REQUEST;
+		r->done = 1;
+	}
+	return 0;
+}
+
+/*
+ * Make requests of the complete frames received on a connection, as long
+ * as not too many are outstanding.  A frame whose payload is too large is
+ * answered as a bad request, after which the connection is closed, as the
+ * rest of its input cannot be made sense of.
+ */
+static int argo_serve_frames(ARGO_SERVER *s, ARGO_CONNECTION *c){
+	unsigned char *h;
+	size_t length, left;
+
+	while(!c->closing && c->pending < ARGO_SERVE_MAX_PENDING
+	      && c->in_length - c->in_start >= ARGO_SERVE_HEADER_SIZE){
+		h = (unsigned char *) c->in + c->in_start;
+		length = argo_serve_length(h);
+		if(length > ARGO_SERVE_MAX_PAYLOAD){
+			h[0] = 0;
+			if(argo_serve_request(s, c, h, NULL, 0)){
+				return -1;
+			}
+			c->closing = 1;
+			c->in_start = c->in_length = 0;
+			break;
+		}
+		if(c->in_length - c->in_start < ARGO_SERVE_HEADER_SIZE + length){
+			break;
+		}
+		if(argo_serve_request(s, c, h, (char *) h + ARGO_SERVE_HEADER_SIZE, length)){
+			return -1;
+		}
+		c->in_start += ARGO_SERVE_HEADER_SIZE + length;
+	}
+	// move what is left of the input to the front of the buffer
+	left = c->in_length - c->in_start;
+	if(c->in_start > 0){
+		argo_serve_copy(c->in, c->in + c->in_start, left);
+		c->in_start = 0;
+		c->in_length = left;
+	}
+	return 0;
+}
+
+/*
+ * Read what a connection has sent, and make requests of it.
+ */
+static void argo_serve_receive(ARGO_SERVER *s, ARGO_CONNECTION *c){
+	size_t needed;
+	ssize_t n;
+
+	while(!c->closing && !c->eof && c->pending < ARGO_SERVE_MAX_PENDING){
+		needed = c->in_length + ARGO_SERVE_READ_SIZE;
+		if(c->in_length >= ARGO_SERVE_HEADER_SIZE){
+			// room for the whole of the frame that has been started
+			size_t frame = ARGO_SERVE_HEADER_SIZE + argo_serve_length((unsigned char *) c->in);
+			if(frame <= ARGO_SERVE_HEADER_SIZE + ARGO_SERVE_MAX_PAYLOAD && frame > needed){
+				needed = frame;
+			}
+		}
+		if(argo_serve_reserve(&c->in, &c->in_capacity, needed)){
+			argo_serve_close(s, c);
+			return;
+		}
+		n = read(c->fd, c->in + c->in_length, c->in_capacity - c->in_length);
+		if(n < 0){
+			if(errno == EINTR){
+				continue;
+			}
+			if(errno == EAGAIN || errno == EWOULDBLOCK){
+				break;
+			}
+			argo_serve_close(s, c);
+			return;
+		}
+		if(n == 0){
+			c->eof = 1;
+			break;
+		}
+		c->in_length += n;
+		if(argo_serve_frames(s, c)){
+			argo_serve_close(s, c);
+			return;
+		}
+	}
+	argo_serve_flush(s, c);
+}
+
+static void argo_serve_accept(ARGO_SERVER *s){
+	struct epoll_event ev = {0};
+	ARGO_CONNECTION **conns;
+	ARGO_CONNECTION *c;
+	int fd, n;
+
+	while((fd = accept4(s->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0){
+		if(fd >= s->num_conns){
+			n = s->num_conns ? s->num_conns : 64;
+			while(n <= fd){
+				n *= 2;
+			}
+			conns = realloc(s->conns, n * sizeof(ARGO_CONNECTION *));
+			if(conns == NULL){
+				fprintf(stderr, "Failed to allocate connection\n");
+				close(fd);
+				continue;
+			}
+			for(; s->num_conns < n; s->num_conns++){
+				conns[s->num_conns] = NULL;
+			}
+			s->conns = conns;
+		}
+		c = calloc(1, sizeof(ARGO_CONNECTION));
+		if(c == NULL){
+			fprintf(stderr, "Failed to allocate connection\n");
+			close(fd);
+			continue;
+		}
+		c->fd = fd;
+		c->events = EPOLLIN;
+		ev.events = EPOLLIN;
+		ev.data.fd = fd;
+		if(epoll_ctl(s->epoll_fd, EPOLL_CTL_ADD, fd, &ev)){
+			close(fd);
+			free(c);
+			continue;
+		}
+		s->conns[fd] = c;
+	}
+}
+
+/*
+ * Answer the requests that the workers have completed since last time.
+ */
+static void argo_serve_completed(ARGO_SERVER *s){
+	ARGO_CONNECTION *flush = NULL, *c;
+	ARGO_REQUEST *r;
+	uint64_t n;
+
+	if(read(s->event_fd, &n, sizeof(n)) < 0 && errno != EAGAIN){
+		fprintf(stderr, "Failed to read completions\n");
+	}
+	pthread_mutex_lock(&s->lock);
+	r = s->done;
+	s->done = NULL;
+	pthread_mutex_unlock(&s->lock);
+	// flushing a connection may free its requests, and the connection, so
+	// find out which connections to flush before flushing any of them
+	for(; r != NULL; r = r->done_next){
+		r->done = 1;
+		if(!r->conn->queued){
+			r->conn->queued = 1;
+			r->conn->flush_next = flush;
+			flush = r->conn;
+		}
+	}
+	while(flush != NULL){
+		c = flush;
+		flush = c->flush_next;
+		c->queued = 0;
+		argo_serve_flush(s, c);
+	}
+}
+
+static int argo_serve_listen(ARGO_SERVER *s, char *path){
+	struct sockaddr_un addr = {0};
+	struct stat st;
+	size_t i;
+
+	for(i = 0; path[i] != '\0'; i++){
+		if(i + 1 >= sizeof(addr.sun_path)){
+			fprintf(stderr, "%s: Socket path too long\n", path);
+			return -1;
+		}
+		addr.sun_path[i] = path[i];
+	}
+	addr.sun_family = AF_UNIX;
+	// a socket left behind by a server that is gone is replaced
+	if(stat(path, &st) == 0 && S_ISSOCK(st.st_mode)){
+		unlink(path);
+	}
+	s->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if(s->listen_fd < 0 || bind(s->listen_fd, (struct sockaddr *) &addr, sizeof(addr))
+	   || listen(s->listen_fd, ARGO_SERVE_BACKLOG)){
+		fprintf(stderr, "%s: Cannot listen on socket\n", path);
+		return -1;
+	}
+	return 0;
+}
+
+static int argo_serve_watch(ARGO_SERVER *s, int fd){
+	struct epoll_event ev = {0};
+
+	ev.events = EPOLLIN;
+	ev.data.fd = fd;
+	if(epoll_ctl(s->epoll_fd, EPOLL_CTL_ADD, fd, &ev)){
+		fprintf(stderr, "Failed to watch descriptor\n");
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief  Serve requests on a Unix domain socket until SIGINT or SIGTERM.
+ * @details  A single thread runs an epoll loop that accepts connections,
+ * reads their frames and sends back the responses; the documents are parsed
+ * and written by a pool of worker threads (argo_num_threads of them), each
+ * into its own context, whose arena is reused from one request to the next.
+ * The latency of every request is recorded; it can be asked for with a
+ * stats request and, with -s, is reported on standard error on shutdown,
+ * when the socket is also removed.
+ *
+ * @param path  Path at which the socket is created.
+ * @return  Zero if the server was shut down by a signal, nonzero if it
+ * could not be started.
+ */
+int argo_serve_run(char *path){
+	int threads = argo_num_threads ? argo_num_threads : argo_num_cpus();
+	struct epoll_event events[ARGO_SERVE_MAX_EVENTS];
+	ARGO_SERVER *s = calloc(1, sizeof(ARGO_SERVER));
+	ARGO_CONNECTION *c;
+	sigset_t signals;
+	struct timespec end;
+	int status = -1;
+	int running = 1;
+	int i, n, fd;
+
+	if(s == NULL){
+		fprintf(stderr, "Failed to allocate server\n");
+		return -1;
+	}
+	s->epoll_fd = s->listen_fd = s->event_fd = s->signal_fd = -1;
+	pthread_mutex_init(&s->lock, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &s->start);
+
+	// blocked before the workers start, so that only the event loop sees them
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+	s->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	s->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	s->signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+	if(s->epoll_fd < 0 || s->event_fd < 0 || s->signal_fd < 0){
+		fprintf(stderr, "Failed to set up event loop\n");
+		goto out;
+	}
+	if(argo_serve_listen(s, path)){
+		goto out;
+	}
+	if(argo_serve_watch(s, s->listen_fd) || argo_serve_watch(s, s->event_fd) || argo_serve_watch(s, s->signal_fd)){
+		goto out;
+	}
+	s->pool = argo_pool_create(threads, threads, NUM_ARGO_VALUES);
+	if(s->pool == NULL){
+		goto out;
+	}
+
+	while(running){
+		n = epoll_wait(s->epoll_fd, events, ARGO_SERVE_MAX_EVENTS, -1);
+		if(n < 0){
+			if(errno == EINTR){
+				continue;
+			}
+			fprintf(stderr, "Error waiting for events\n");
+			break;
+		}
+		for(i = 0; i < n; i++){
+			fd = events[i].data.fd;
+			if(fd == s->listen_fd){
+				argo_serve_accept(s);
+			}
+			else if(fd == s->event_fd){
+				argo_serve_completed(s);
+			}
+			else if(fd == s->signal_fd){
+				running = 0;
+			}
+			else if(fd < s->num_conns && (c = s->conns[fd]) != NULL){
+				if(events[i].events & (EPOLLERR | EPOLLHUP) && !(events[i].events & EPOLLIN)){
+					argo_serve_close(s, c);
+				}
+				else if(events[i].events & EPOLLIN){
+					argo_serve_receive(s, c);
+				}
+				else{
+					argo_serve_flush(s, c);
+				}
+			}
+		}
+	}
+	status = 0;
+	unlink(path);
+
+	// let the workers finish what they were given, then answer nothing more
+	argo_pool_destroy(s->pool);
+	s->pool = NULL;
+	argo_serve_completed(s);
+	for(fd = 0; fd < s->num_conns; fd++){
+		if((c = s->conns[fd]) != NULL){
+			argo_serve_close(s, c);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	if(global_options & STATISTICS_OPTION){
+		double secs = argo_serve_elapsed(&s->start, &end) / 1e9;
+		fprintf(stderr, "%ld requests (%ld failed) in %.3f s with %d threads (%.0f requests/s), "
+			"latency p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us\n",
+			s->requests, s->failed, secs, threads, s->requests / secs,
+			argo_latency_percentile(&s->latency, 0.5) / 1e3, argo_latency_percentile(&s->latency, 0.9) / 1e3,
+			argo_latency_percentile(&s->latency, 0.99) / 1e3, s->latency.max / 1e3);
+	}
+
+out:
+	if(s->pool != NULL){
+		argo_pool_destroy(s->pool);
+	}
+	if(s->listen_fd >= 0){
+		close(s->listen_fd);
+	}
+	if(s->event_fd >= 0){
+		close(s->event_fd);
+	}
+	if(s->signal_fd >= 0){
+		close(s->signal_fd);
+	}
+	if(s->epoll_fd >= 0){
+		close(s->epoll_fd);
+	}
+	pthread_mutex_destroy(&s->lock);
+	free(s->conns);
+	free(s);
+	return status;
+}
+
+/*
+ * One connection of the load generator, with the requests it is to send
+ * and the latencies it has seen.
+ */
+typedef struct argo_load {
+    pthread_t thread;
+    char *path;
+    char *frame;                       // The request, header included,
+    size_t frame_length;               // which is sent again and again.
+    long requests;
+    long failed;
+    int status;                        // Nonzero if the connection failed.
+    ARGO_LATENCY latency;
+} ARGO_LOAD;
+
+static int argo_load_connect(char *path){
+	struct sockaddr_un addr = {0};
+	size_t i;
+	int fd;
+
+	for(i = 0; path[i] != '\0' && i + 1 < sizeof(addr.sun_path); i++){
+		addr.sun_path[i] = path[i];
+	}
+	addr.sun_family = AF_UNIX;
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if(fd < 0 || connect(fd, (struct sockaddr *) &addr, sizeof(addr))){
+		fprintf(stderr, "%s: Cannot connect to socket\n", path);
+		if(fd >= 0){
+			close(fd);
+		}
+		return -1;
+	}
+	return fd;
+}
+
+static int argo_load_io(int fd, char *buf, size_t n, int writing){
+	ssize_t r;
+
+	while(n > 0){
+		r = writing ? send(fd, buf, n, MSG_NOSIGNAL) : read(fd, buf, n);
+		if(r < 0 && errno == EINTR){
+			continue;
+		}
+		if(r <= 0){
+			return -1;
+		}
+		buf += r;
+		n -= r;
+	}
+	return 0;
+}
+
+/*
+ * Thread of one connection: send each request once the response to the
+ * one before has been read in full, timing every round trip.
+ */
+static void *argo_load_connection(void *arg){
+	ARGO_LOAD *l = arg;
+	unsigned char header[ARGO_SERVE_HEADER_SIZE];
+	struct timespec start, end;
+	char *buf = NULL;
+	size_t cap = 0, length;
+	long i;
+	int fd = argo_load_connect(l->path);
+
+	if(fd < 0){
+		l->status = -1;
+		return NULL;
+	}
+	for(i = 0; i < l->requests; i++){
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		if(argo_load_io(fd, l->frame, l->frame_length, 1)
+		   || argo_load_io(fd, (char *) header, ARGO_SERVE_HEADER_SIZE, 0)){
+			fprintf(stderr, "Connection to server lost\n");
+			l->status = -1;
+			break;
+		}
+		length = argo_serve_length(header);
+		if(argo_serve_reserve(&buf, &cap, length) || argo_load_io(fd, buf, length, 0)){
+			fprintf(stderr, "Connection to server lost\n");
+			l->status = -1;
+			break;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		argo_latency_add(&l->latency, argo_serve_elapsed(&start, &end));
+		if(header[0] != ARGO_SERVE_OK){
+			l->failed++;
+		}
+	}
+	free(buf);
+	close(fd);
+	return NULL;
+}
+
+/**
+ * @brief  Measure the latency and throughput of a server started with --serve.
+ * @details  The document read from "in" is sent to the server the given
+ * number of times, to be validated (-v), canonicalized (-c) or pretty
+ * printed (-p), over argo_num_threads connections, each of which waits for
+ * one response before sending the next request.  The round trips are timed
+ * and a summary is written to "out".
+ *
+ * @param path  Path of the socket of the server.
+ * @param requests  Number of requests to send in all.
+ * @param in  Stream from which the document is read.
+ * @param out  Stream to which the summary is written.
+ * @return  Zero if every request succeeded, nonzero otherwise.
+ */
+int argo_load_run(char *path, long requests, FILE *in, FILE *out){
+	int conns = argo_num_threads ? argo_num_threads : argo_num_cpus();
+	ARGO_LATENCY *latency = calloc(1, sizeof(ARGO_LATENCY));
+	ARGO_LOAD *loads = calloc(conns, sizeof(ARGO_LOAD));
+	struct timespec start, end;
+	long failed = 0;
+	int status = 0;
+	size_t length = 0;
+	char *doc, *frame;
+	double secs;
+	int op, i;
+
+	doc = argo_read_file(in, &length);
+	frame = doc != NULL ? malloc(ARGO_SERVE_HEADER_SIZE + length) : NULL;
+	if(latency == NULL || loads == NULL || frame == NULL){
+		fprintf(stderr, "Failed to set up load\n");
+		free(latency);
+		free(loads);
+		free(doc);
+		return -1;
+	}
+	if(global_options & PRETTY_PRINT_OPTION){
+		op = ARGO_SERVE_PRETTY;
+	}
+	else if(global_options & CANONICALIZE_OPTION){
+		op = ARGO_SERVE_CANONICALIZE;
+	}
+	else{
+		op = ARGO_SERVE_VALIDATE;
+	}
+	argo_serve_header((unsigned char *) frame, op, global_options & INDENT_MASK, length);
+	argo_serve_copy(frame + ARGO_SERVE_HEADER_SIZE, doc, length);
+	free(doc);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(i = 0; i < conns; i++){
+		loads[i].path = path;
+		loads[i].frame = frame;
+		loads[i].frame_length = ARGO_SERVE_HEADER_SIZE + length;
+		loads[i].requests = requests / conns + (i < requests % conns);
+		if(pthread_create(&loads[i].thread, NULL, argo_load_connection, loads + i)){
+			fprintf(stderr, "Failed to start connection thread\n");
+			conns = i;
+			status = -1;
+			break;
+		}
+	}
+	for(i = 0; i < conns; i++){
+		pthread_join(loads[i].thread, NULL);
+		argo_latency_merge(latency, &loads[i].latency);
+		failed += loads[i].failed;
+		status |= loads[i].status;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	secs = argo_serve_elapsed(&start, &end) / 1e9;
+	fprintf(out, "%ld requests (%ld failed) over %d connections in %.3f s (%.0f requests/s), "
+		"latency p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us\n",
+		latency->total, failed, conns, secs, latency->total / secs,
+		argo_latency_percentile(latency, 0.5) / 1e3, argo_latency_percentile(latency, 0.9) / 1e3,
+		argo_latency_percentile(latency, 0.99) / 1e3, latency->max / 1e3);
+	free(frame);
+	free(loads);
+	free(latency);
+	return status || failed ? -1 : 0;
+}
@@ -0,0 +1,252 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdio_ext.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "context.h"
+#include "source.h"
+
+/*
+ * Source reading a file descriptor directly, bypassing the buffer of any
+ * stream it belongs to.
+ */
+typedef struct argo_fd_source {
+	ARGO_SOURCE source;                // Must be first.
+	int fd;
+	int own_fd;                        // Nonzero if the descriptor is closed with the source.
+} ARGO_FD_SOURCE;
+
+/*
+ * Source reading a buffer, which it owns.
+ */
+typedef struct argo_memory_source {
+	ARGO_SOURCE source;                // Must be first.
+	char *data;
+	size_t offset;                     // Bytes of data already read.
+} ARGO_MEMORY_SOURCE;
+
+static ssize_t argo_fd_source_read(ARGO_SOURCE *source, char *buf, size_t size){
+	ARGO_FD_SOURCE *fs = (ARGO_FD_SOURCE *) source;
+	ssize_t n;
+
+	do{
+		n = read(fs->fd, buf, size);
+	} while(n < 0 && errno == EINTR);
+	return n;
+}
+
+static void argo_fd_source_close(ARGO_SOURCE *source){
+	ARGO_FD_SOURCE *fs = (ARGO_FD_SOURCE *) source;
+
+	if(fs->own_fd){
+		close(fs->fd);
+	}
+	free(fs);
+}
+
+static ARGO_SOURCE *argo_fd_source(int fd, int own_fd){
+	ARGO_FD_SOURCE *fs = malloc(sizeof(ARGO_FD_SOURCE));
+	struct stat st;
+
+	if(fs == NULL){
+		fprintf(stderr, "Failed to allocate input source\n");
+		return NULL;
+	}
+	fs->source.read = argo_fd_source_read;
+	fs->source.close = argo_fd_source_close;
+	fs->source.size = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) ? st.st_size : 0;
+	fs->fd = fd;
+	fs->own_fd = own_fd;
+	return &fs->source;
+}
+
+/*
+ * Source reading a stream that has no file descriptor, such as a string
+ * opened with fmemopen.
+ */
+typedef struct argo_stream_source {
+	ARGO_SOURCE source;                // Must be first.
+	FILE *in;
+} ARGO_STREAM_SOURCE;
+
+static ssize_t argo_stream_source_read(ARGO_SOURCE *source, char *buf, size_t size){
+	ARGO_STREAM_SOURCE *ss = (ARGO_STREAM_SOURCE *) source;
+	size_t n = fread(buf, 1, size, ss->in);
+
+	return ferror(ss->in) ? -1 : (ssize_t) n;
+}
+
+static void argo_stream_source_close(ARGO_SOURCE *source){
+	free(source);
+}
+
+/**
+ * @brief  Make a source of a stream, read through its file descriptor if
+ * it has one, so that input arriving slowly through a pipe is handed out
+ * as soon as it arrives.
+ * @details  Nothing must have been read from a stream with a descriptor
+ * yet, as whatever it has buffered would be skipped.  Neither the stream
+ * nor its descriptor is closed with the source.
+ *
+ * @param in  The input stream.
+ * @return  The source, or NULL if there is any error.
+ */
+ARGO_SOURCE *argo_source_open(FILE *in){
+	ARGO_STREAM_SOURCE *ss;
+
+	if(in == NULL){
+		return NULL;
+	}
+	if(fileno(in) >= 0){
+		return argo_fd_source(fileno(in), 0);
+	}
+	ss = malloc(sizeof(ARGO_STREAM_SOURCE));
+	if(ss == NULL){
+		fprintf(stderr, "Failed to allocate input source\n");
+		return NULL;
+	}
+	ss->source.read = argo_stream_source_read;
+	ss->source.close = argo_stream_source_close;
+	ss->source.size = 0;
+	ss->in = in;
+	return &ss->source;
+}
+
+/**
+ * @brief  Make a source of a file, read synchronously.
+ *
+ * @param path  Name of the file.
+ * @return  The source, or NULL if the file cannot be opened, in which case
+ * that is reported on standard error.
+ */
+ARGO_SOURCE *argo_source_path(char *path){
+	ARGO_SOURCE *source;
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+	if(fd < 0){
+		fprintf(stderr, "%s: Cannot open for reading\n", path);
+		return NULL;
+	}
+	source = argo_fd_source(fd, 1);
+	if(source == NULL){
+		close(fd);
+	}
+	return source;
+}
+
+static ssize_t argo_memory_source_read(ARGO_SOURCE *source, char *buf, size_t size){
+	ARGO_MEMORY_SOURCE *ms = (ARGO_MEMORY_SOURCE *) source;
+	size_t n = source->size - ms->offset;
+	size_t i;
+
+	if(n > size){
+		n = size;
+	}
+	for(i = 0; i < n; i++){
+		buf[i] = ms->data[ms->offset + i];
+	}
+	ms->offset += n;
+	return n;
+}
+
+static void argo_memory_source_close(ARGO_SOURCE *source){
+	ARGO_MEMORY_SOURCE *ms = (ARGO_MEMORY_SOURCE *) source;
+
+	free(ms->data);
+	free(ms);
+}
+
+/**
+ * @brief  Make a source of a buffer already filled with the input.
+ *
+ * @param data  The buffer, allocated with malloc, which is freed with the
+ * source (or right away, if the source cannot be made).
+ * @param length  Number of bytes of input in the buffer.
+ * @return  The source, or NULL if there is any error.
+ */
+ARGO_SOURCE *argo_source_memory(char *data, size_t length){
+	ARGO_MEMORY_SOURCE *ms = malloc(sizeof(ARGO_MEMORY_SOURCE));
+
+	if(ms == NULL){
+		fprintf(stderr, "Failed to allocate input source\n");
+		free(data);
+		return NULL;
+	}
+	ms->source.read = argo_memory_source_read;
+	ms->source.close = argo_memory_source_close;
+	ms->source.size = length;
+	ms->data = data;
+	ms->offset = 0;
+	return &ms->source;
+}
+
+/*
+ * The position of the context reading the stream advances over what is left
+ * of the last buffer, while it is still there, and then holds the new one.
+ */
+static ssize_t argo_source_stream_read(void *cookie, char *buf, size_t size){
+	ARGO_SOURCE *source = cookie;
+	ARGO_CONTEXT *ctx = argo_ctx;
+	ssize_t n;
+
+	argo_position_advance(ctx, ctx->text_length);
+	n = source->read(source, buf, size);
+	if(n < 0){
+		fprintf(stderr, "Error reading input\n");
+	}
+	ctx->text = buf;
+	ctx->text_length = n > 0 ? n : 0;
+	return n;
+}
+
+/*
+ * The stream cannot seek, but tells how far it has been read, so that
+ * argo_position can use ftell.
+ */
+static int argo_source_stream_seek(void *cookie, off64_t *offset, int whence){
+	if(whence != SEEK_CUR || *offset != 0){
+		errno = ESPIPE;
+		return -1;
+	}
+	*offset = argo_ctx->mark + argo_ctx->text_length;
+	return 0;
+}
+
+static int argo_source_stream_close(void *cookie){
+	ARGO_SOURCE *source = cookie;
+
+	source->close(source);
+	return 0;
+}
+
+/**
+ * @brief  Open a stream that reads a source on the calling thread.
+ * @details  The stream must be used by one thread only, so that it can do
+ * without locking.  Closing it closes the source.
+ *
+ * @param source  The source, which is closed if the stream cannot be opened.
+ * @return  The stream, or NULL if there is any error.
+ */
+FILE *argo_source_stream(ARGO_SOURCE *source){
+	cookie_io_functions_t io = {argo_source_stream_read, NULL, argo_source_stream_seek, argo_source_stream_close};
+	FILE *f;
+
+	if(source == NULL){
+		return NULL;
+	}
+	f = fopencookie(source, "r", io);
+	if(f == NULL){
+		fprintf(stderr, "Failed to open input\n");
+		source->close(source);
+		return NULL;
+	}
+	__fsetlocking(f, FSETLOCKING_BYCALLER);
+	return f;
+}
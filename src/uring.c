@@ -0,0 +1,163 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "uring.h"
+
+#ifdef ARGO_HAVE_URING
+
+/**
+ * @brief  Set up an io_uring.
+ *
+ * @param u  The ring to set up.
+ * @param entries  Size of the submission queue, a power of two; the
+ * completion queue is twice as large.
+ * @return  Zero on success, nonzero if io_uring is not available, in which
+ * case nothing is reported, so that the caller can quietly fall back.
+ */
+int argo_uring_init(ARGO_URING *u, unsigned entries){
+	struct io_uring_params p = {0};
+	char *sq, *cq;
+	int fd;
+
+	fd = syscall(__NR_io_uring_setup, entries, &p);
+	if(fd < 0){
+		return -1;
+	}
+	u->fd = fd;
+	u->entries = p.sq_entries;
+	u->sq_map_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	u->cq_map_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	u->sqes_map_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	if(p.features & IORING_FEAT_SINGLE_MMAP){
+		if(u->cq_map_size > u->sq_map_size){
+			u->sq_map_size = u->cq_map_size;
+		}
+		u->cq_map_size = u->sq_map_size;
+	}
+
+	u->sq_map = mmap(NULL, u->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	                 fd, IORING_OFF_SQ_RING);
+	if(u->sq_map == MAP_FAILED){
+		close(fd);
+		return -1;
+	}
+	if(p.features & IORING_FEAT_SINGLE_MMAP){
+		u->cq_map = u->sq_map;
+	}
+	else{
+		u->cq_map = mmap(NULL, u->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		                 fd, IORING_OFF_CQ_RING);
+		if(u->cq_map == MAP_FAILED){
+			munmap(u->sq_map, u->sq_map_size);
+			close(fd);
+			return -1;
+		}
+	}
+	u->sqes = mmap(NULL, u->sqes_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	               fd, IORING_OFF_SQES);
+	if(u->sqes == MAP_FAILED){
+		if(u->cq_map != u->sq_map){
+			munmap(u->cq_map, u->cq_map_size);
+		}
+		munmap(u->sq_map, u->sq_map_size);
+		close(fd);
+		return -1;
+	}
+
+	sq = u->sq_map;
+	cq = u->cq_map;
+	u->sq_head = (unsigned *) (sq + p.sq_off.head);
+	u->sq_tail = (unsigned *) (sq + p.sq_off.tail);
+	u->sq_mask = (unsigned *) (sq + p.sq_off.ring_mask);
+	u->sq_array = (unsigned *) (sq + p.sq_off.array);
+	u->sq_next = *u->sq_tail;
+	u->cq_head = (unsigned *) (cq + p.cq_off.head);
+	u->cq_tail = (unsigned *) (cq + p.cq_off.tail);
+	u->cq_mask = (unsigned *) (cq + p.cq_off.ring_mask);
+	u->cqes = (struct io_uring_cqe *) (cq + p.cq_off.cqes);
+	return 0;
+}
+
+/**
+ * @brief  Get an entry of the submission queue, cleared, for a request.
+ * @details  The request is not seen by the kernel until argo_uring_submit
+ * is called.
+ *
+ * @param u  The ring.
+ * @param user_data  Value identifying the request in its completion.
+ * @return  The entry, or NULL if the queue is full.
+ */
+struct io_uring_sqe *argo_uring_sqe(ARGO_URING *u, uint64_t user_data){
+	unsigned head = __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+	struct io_uring_sqe *sqe;
+	unsigned i;
+
+	if(u->sq_next - head >= u->entries){
+		return NULL;
+	}
+	i = u->sq_next & *u->sq_mask;
+	sqe = &u->sqes[i];
+	*sqe = (struct io_uring_sqe) {0};
+	sqe->user_data = user_data;
+	u->sq_array[i] = i;
+	u->sq_next++;
+	return sqe;
+}
+
+/**
+ * @brief  Submit the requests queued since the last call, and wait until
+ * at least "wait" completions are available.
+ *
+ * @return  Zero on success, nonzero if the kernel refused the requests.
+ */
+int argo_uring_submit(ARGO_URING *u, unsigned wait){
+	unsigned pending = u->sq_next - *u->sq_tail;
+	int n;
+
+	__atomic_store_n(u->sq_tail, u->sq_next, __ATOMIC_RELEASE);
+	do{
+		n = syscall(__NR_io_uring_enter, u->fd, pending, wait, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+	} while(n < 0 && errno == EINTR);
+	if(n < 0){
+		fprintf(stderr, "Failed to submit I/O requests\n");
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief  Look at the oldest completion, if any, without waiting.
+ * @details  Once handled, it must be released with argo_uring_seen.
+ *
+ * @return  The completion, or NULL if there is none yet.
+ */
+struct io_uring_cqe *argo_uring_cqe(ARGO_URING *u){
+	unsigned head = *u->cq_head;
+
+	if(head == __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE)){
+		return NULL;
+	}
+	return &u->cqes[head & *u->cq_mask];
+}
+
+void argo_uring_seen(ARGO_URING *u){
+	__atomic_store_n(u->cq_head, *u->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+void argo_uring_exit(ARGO_URING *u){
+	munmap(u->sqes, u->sqes_map_size);
+	if(u->cq_map != u->sq_map){
+		munmap(u->cq_map, u->cq_map_size);
+	}
+	munmap(u->sq_map, u->sq_map_size);
+	close(u->fd);
+}
+
+#endif
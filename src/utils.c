@@ -1,10 +1,16 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 
 #include "argo.h"
 #include "global.h"
 #include "debug.h"
 #include "utils.h"
+#include "context.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 int compare_string(char *str1, char *str2){
 	int len1=0, len2=0;
@@ -61,33 +67,162 @@ int string_to_int(char *str){
 	return sum;
 }
 
+/*
+ * Convert a decimal fraction such as "0.05" or "1" to a double.
+ * Returns -1 if the string is not made of digits with at most one point
+ * among them.
+ */
+double string_to_fraction(char *str){
+	double value = 0, scale = 1;
+	int point = 0, digits = 0;
+	char *s;
+	for(s=str; *s; s++){
+		if(*s == '.' && !point){
+			point = 1;
+		}
+		else if(*s >= '0' && *s <= '9'){
+			if(point){
+				scale /= 10;
+				value += (*s - '0') * scale;
+			}
+			else{
+				value = value * 10 + (*s - '0');
+			}
+			digits++;
+		}
+		else{
+			return -1;
+		}
+	}
+	return digits ? value : -1;
+}
+
+char *argo_read_file(FILE *f, size_t *length){
+	size_t cap = 1 << 16;
+	size_t len = 0;
+	size_t n;
+	char *buf = malloc(cap);
+	char *next;
+	if(buf == NULL){
+		fprintf(argo_err, "Failed to allocate input buffer\n");
+		return NULL;
+	}
+	while((n = fread(buf + len, 1, cap - len, f)) > 0){
+		len += n;
+		if(len == cap){
+			cap *= 2;
+			next = realloc(buf, cap);
+			if(next == NULL){
+				fprintf(argo_err, "Failed to allocate input buffer\n");
+				free(buf);
+				return NULL;
+			}
+			buf = next;
+		}
+	}
+	if(ferror(f)){
+		fprintf(argo_err, "Error reading input\n");
+		free(buf);
+		return NULL;
+	}
+	*length = len;
+	return buf;
+}
+
 // argo read helper functions
+/**
+ * @brief  Feed one byte of a UTF-8 sequence to a decoder.
+ * @details  The decoder must have been zeroed before the first byte of
+ * the sequence, which must not be ASCII.  Overlong encodings, surrogates
+ * and code points beyond U+10FFFF are rejected.
+ *
+ * @param d  The decoder.
+ * @param c  The byte (EOF is rejected as well).
+ * @return  One when the code point is complete, in d->code, zero if more
+ * bytes are needed, and -1 if the sequence is not valid UTF-8.
+ */
+int argo_utf8_step(ARGO_UTF8 *d, ARGO_CHAR c){
+	if(d->left == 0){
+		if(c >= 0xC2 && c <= 0xDF){
+			d->code = c & 0x1F;
+			d->left = 1;
+			d->min = 0x80;
+		}
+		else if(c >= 0xE0 && c <= 0xEF){
+			d->code = c & 0x0F;
+			d->left = 2;
+			d->min = 0x800;
+		}
+		else if(c >= 0xF0 && c <= 0xF4){
+			d->code = c & 0x07;
+			d->left = 3;
+			d->min = 0x10000;
+		}
+		else{
+			return -1;
+		}
+		return 0;
+	}
+	if(c < 0 || (c & 0xC0) != 0x80){
+		return -1;
+	}
+	d->code = (d->code << 6) | (c & 0x3F);
+	if(--d->left){
+		return 0;
+	}
+	if(d->code < d->min || d->code > 0x10FFFF || argo_is_high_surrogate(d->code) || argo_is_low_surrogate(d->code)){
+		return -1;
+	}
+	return 1;
+}
+
+/**
+ * @brief  Append the code point of a \u escape to a string.
+ * @details  A low surrogate that immediately follows a high surrogate,
+ * each written as a \u escape, completes a surrogate pair: the two are
+ * replaced by the single code point they encode.  Unpaired surrogates are
+ * kept as they are.
+ *
+ * @param s  The string.
+ * @param ucode  The code point of the escape.
+ * @param after_high  Nonzero if the last character appended to the string
+ * was a high surrogate from the escape just before this one.
+ * @return  Zero if the operation is completely successful,
+ * nonzero if there is any error.
+ */
+int argo_append_escape(ARGO_STRING *s, ARGO_CHAR ucode, int after_high){
+	ARGO_CHAR *last;
+
+	if(after_high && argo_is_low_surrogate(ucode)){
+		last = &s->content[s->length - 1];
+		*last = 0x10000 + ((*last - 0xD800) << 10) + (ucode - 0xDC00);
+		return 0;
+	}
+	return argo_append_char(s, ucode);
+}
+
 int argo_read_array(ARGO_ARRAY *a, FILE *f){
 
 	ARGO_CHAR c = fgetc(f);
-	argo_chars_read++;
 
 	if(c != ARGO_LBRACK){
-		fprintf(stderr, "[%d, %d] Expect '[' in array but seen (%d)\n", argo_lines_read, argo_chars_read, c);
+		argo_position(f);
+		fprintf(argo_err, "[%d, %d] Expect '[' in array but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
 		return -1;
 	}
 
 
 	c = fgetc(f);
-	argo_chars_read++;
 
 	ARGO_VALUE *prev_value = NULL;
 	ARGO_VALUE *new_value = NULL;
 
-	ARGO_VALUE *head = argo_value_storage + argo_next_value;
-	argo_next_value++;
-
-	head->type = ARGO_NO_TYPE;
+	ARGO_VALUE *head = argo_alloc_value();
+	if(head == NULL){
+		return -1;
+	}
 	head->next = head;
 	head->prev = head;
-	head->name.capacity = 0;
-	head->name.length = 0;
-	head->name.content = NULL;
 
 	a->element_list = head;
 
@@ -97,24 +232,21 @@ int argo_read_array(ARGO_ARRAY *a, FILE *f){
 
 	while(c != EOF){
 		if(argo_is_whitespace(c)){
-			if(c == ARGO_LF){
-                argo_lines_read++;
-                argo_chars_read = 0;
-            }
 			c = fgetc(f);
-			argo_chars_read++;
 			continue;
 		}
 		else if(c == ARGO_RBRACK){
 			if(has_comma){
-				fprintf(stderr, "[%d, %d] Expect Value but seen (%d)\n", argo_lines_read, argo_chars_read, c);
+				argo_position(f);
+				fprintf(argo_err, "[%d, %d] Expect Value but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
 				return -1;
 			}
 			return 0;
 		}
 		else if(c == ARGO_COMMA){
 			if(prev_value == head || has_comma){
-				fprintf(stderr, "[%d, %d] Expect Value but seen (%d)\n", argo_lines_read, argo_chars_read, c);
+				argo_position(f);
+				fprintf(argo_err, "[%d, %d] Expect Value but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
 				return -1;
 			}
 			else{
@@ -137,14 +269,15 @@ int argo_read_array(ARGO_ARRAY *a, FILE *f){
 		}
 		else{
 			if(!(prev_value == head || has_comma)){
-				fprintf(stderr, "[%d, %d] Expect , but seen (%d)\n", argo_lines_read, argo_chars_read, c);
+				argo_position(f);
+				fprintf(argo_err, "[%d, %d] Expect , but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
 				return -1;
 			}
 			if(ungetc(c,f) == EOF){
-				fprintf(stderr,"[%d, %d] Fail to unget. \n", argo_lines_read, argo_chars_read);
+				argo_position(f);
+				fprintf(argo_err,"[%d, %d] Fail to unget. \n", argo_ctx->lines_read, argo_ctx->chars_read);
                 return -1;
             }
-            argo_chars_read--;
 			new_value = argo_read_value(f);
 			if(new_value == NULL){
 				return -1;
@@ -161,36 +294,33 @@ int argo_read_array(ARGO_ARRAY *a, FILE *f){
 			}
 		}
 		c = fgetc(f);
-		argo_chars_read++;
 
 	}
 
-	fprintf(stderr, "[%d, %d] Expect ']' in array but seen (%d)\n", argo_lines_read, argo_chars_read, c);
+	argo_position(f);
+	fprintf(argo_err, "[%d, %d] Expect ']' in array but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
 	return -1;
 }
 
 int argo_read_object(ARGO_OBJECT *o, FILE *f){
 
 	ARGO_CHAR c = fgetc(f);
-	argo_chars_read++;
 
 	if(c != ARGO_LBRACE){
-		fprintf(stderr, "[%d, %d] Expect '{' in object but seen (%d)\n", argo_lines_read, argo_chars_read, c);
+		argo_position(f);
+		fprintf(argo_err, "[%d, %d] Expect '{' in object but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
 		return -1;
 	}
 
 
 	c = fgetc(f);
-	argo_chars_read++;
 
-	ARGO_VALUE *head = argo_value_storage + argo_next_value;
-	argo_next_value++;
-	head->type = ARGO_NO_TYPE;
+	ARGO_VALUE *head = argo_alloc_value();
+	if(head == NULL){
+		return -1;
+	}
 	head->next = head;
 	head->prev = head;
-	head->name.capacity = 0;
-	head->name.length = 0;
-	head->name.content = NULL;
 
 	o->member_list = head;
 
@@ -201,21 +331,18 @@ int argo_read_object(ARGO_OBJECT *o, FILE *f){
 
 	while(c != EOF){
 		if(argo_is_whitespace(c)){
-			if(c == ARGO_LF){
-                argo_lines_read++;
-                argo_chars_read = 0;
-            }
 			c = fgetc(f);
-			argo_chars_read++;
 			continue;
 		}
 		else if(c == ARGO_RBRACE){
 			if(has_comma){
-				fprintf(stderr, "[%d, %d] Expect member in object but seen (%d)\n", argo_lines_read, argo_chars_read, c);
+				argo_position(f);
+				fprintf(argo_err, "[%d, %d] Expect member in object but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
 				return -1;
 			}
 			if(has_name){
-				fprintf(stderr, "[%d, %d] Expect : in object but seen (%d)\n", argo_lines_read, argo_chars_read, c);
+				argo_position(f);
+				fprintf(argo_err, "[%d, %d] Expect : in object but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
 				return -1;
 			}
 			head->name.capacity = 0;
@@ -227,15 +354,16 @@ int argo_read_object(ARGO_OBJECT *o, FILE *f){
 
 		else if(c == ARGO_QUOTE){
 			if(!(has_comma||prev_value == head)){
-				fprintf(stderr,"[%d, %d] Expect , in object but seen (%d)\n", argo_lines_read, argo_chars_read, c);
+				argo_position(f);
+				fprintf(argo_err,"[%d, %d] Expect , in object but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
 	             return -1;
 			}
 			else if(!has_name){
 				if(ungetc(c,f) == EOF){
-					fprintf(stderr,"[%d, %d] Fail to unget. \n", argo_lines_read, argo_chars_read);
+					argo_position(f);
+					fprintf(argo_err,"[%d, %d] Fail to unget. \n", argo_ctx->lines_read, argo_ctx->chars_read);
 	                return -1;
 	            }
-	            argo_chars_read--;
 				if(argo_read_string(&(head->name), f)){
 					return -1;
 				}
@@ -243,7 +371,8 @@ int argo_read_object(ARGO_OBJECT *o, FILE *f){
 				has_comma = 0;
 			}
 			else{
-				fprintf(stderr, "[%d, %d] Expect : in object but seen (%d)\n", argo_lines_read, argo_chars_read, c);
+				argo_position(f);
+				fprintf(argo_err, "[%d, %d] Expect : in object but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
 				return -1;
 			}
 		}
@@ -271,13 +400,15 @@ int argo_read_object(ARGO_OBJECT *o, FILE *f){
 				}
 			}
 			else{
-				fprintf(stderr, "[%d, %d] Expect name in object but seen (%d)\n", argo_lines_read, argo_chars_read, c);
+				argo_position(f);
+				fprintf(argo_err, "[%d, %d] Expect name in object but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
 				return -1;
 			}
 		}
 		else if(c == ARGO_COMMA){
 			if(prev_value == head || has_comma){
-				fprintf(stderr, "[%d, %d] Expect member in object but seen (%d)\n", argo_lines_read, argo_chars_read, c);
+				argo_position(f);
+				fprintf(argo_err, "[%d, %d] Expect member in object but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
 				return -1;
 			}
 			else{
@@ -285,125 +416,405 @@ int argo_read_object(ARGO_OBJECT *o, FILE *f){
 			}
 		}
 		else{
-			fprintf(stderr, "[%d, %d] Invalid object (%d)\n", argo_lines_read, argo_chars_read, c);
+			argo_position(f);
+			fprintf(argo_err, "[%d, %d] Invalid object (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
 			return -1;
 		}
 
 		c = fgetc(f);
-		argo_chars_read++;
 
 	}
 
-	fprintf(stderr, "[%d, %d] Expect '}' in object but seen (%d)\n", argo_lines_read, argo_chars_read, c);
+	argo_position(f);
+	fprintf(argo_err, "[%d, %d] Expect '}' in object but seen (%d)\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
 	return -1;
 }
 
 int argo_read_basic(ARGO_BASIC *b, FILE *f){
 	ARGO_CHAR c = fgetc(f);
-	argo_chars_read++;
 	if(c == 't'){
 		c = fgetc(f);
-		argo_chars_read++;
 		if(c == 'r'){
 			c = fgetc(f);
-			argo_chars_read++;
 			if(c == 'u'){
 				c = fgetc(f);
-				argo_chars_read++;
 				if(c == 'e'){
 					*b = ARGO_TRUE;
 					return 0;
 				}
 				else{
-					fprintf(stderr, "[%d, %d] Invalid Token\n", argo_lines_read, argo_chars_read);
+					argo_position(f);
+					fprintf(argo_err, "[%d, %d] Invalid Token\n", argo_ctx->lines_read, argo_ctx->chars_read);
 					return -1;
 				}
 			}
 			else{
-				fprintf(stderr, "[%d, %d] Invalid Token\n", argo_lines_read, argo_chars_read);
+				argo_position(f);
+				fprintf(argo_err, "[%d, %d] Invalid Token\n", argo_ctx->lines_read, argo_ctx->chars_read);
 				return -1;
 			}
 		}
 		else{
-			fprintf(stderr, "[%d, %d] Invalid Token\n", argo_lines_read, argo_chars_read);
+			argo_position(f);
+			fprintf(argo_err, "[%d, %d] Invalid Token\n", argo_ctx->lines_read, argo_ctx->chars_read);
 			return -1;
 		}
 	}
 	else if(c == 'f'){
 		c = fgetc(f);
-		argo_chars_read++;
 		if(c == 'a'){
 			c = fgetc(f);
-			argo_chars_read++;
 			if(c == 'l'){
 				c = fgetc(f);
-				argo_chars_read++;
 				if(c == 's'){
 					c = fgetc(f);
-					argo_chars_read++;
 					if(c == 'e'){
 						*b = ARGO_FALSE;
 						return 0;
 					}
 					else{
-						fprintf(stderr, "[%d, %d] Invalid Token\n", argo_lines_read, argo_chars_read);
+						argo_position(f);
+						fprintf(argo_err, "[%d, %d] Invalid Token\n", argo_ctx->lines_read, argo_ctx->chars_read);
 						return -1;
 					}
 				}
 				else{
-					fprintf(stderr, "[%d, %d] Invalid Token\n", argo_lines_read, argo_chars_read);
+					argo_position(f);
+					fprintf(argo_err, "[%d, %d] Invalid Token\n", argo_ctx->lines_read, argo_ctx->chars_read);
 					return -1;
 				}
 			}
 			else{
-				fprintf(stderr, "[%d, %d] Invalid Token\n", argo_lines_read, argo_chars_read);
+				argo_position(f);
+				fprintf(argo_err, "[%d, %d] Invalid Token\n", argo_ctx->lines_read, argo_ctx->chars_read);
 				return -1;
 			}
 		}
 		else{
-			fprintf(stderr, "[%d, %d] Invalid Token\n", argo_lines_read, argo_chars_read);
+			argo_position(f);
+			fprintf(argo_err, "[%d, %d] Invalid Token\n", argo_ctx->lines_read, argo_ctx->chars_read);
 			return -1;
 		}
 	}
 	else if(c == 'n'){
 		c = fgetc(f);
-		argo_chars_read++;
 		if(c == 'u'){
 			c = fgetc(f);
-			argo_chars_read++;
 			if(c == 'l'){
 				c = fgetc(f);
-				argo_chars_read++;
 				if(c == 'l'){
 					*b = ARGO_NULL;
 					return 0;
 				}
 				else{
-					fprintf(stderr, "[%d, %d] Invalid Token\n", argo_lines_read, argo_chars_read);
+					argo_position(f);
+					fprintf(argo_err, "[%d, %d] Invalid Token\n", argo_ctx->lines_read, argo_ctx->chars_read);
 					return -1;
 				}
 			}
 			else{
-				fprintf(stderr, "[%d, %d] Invalid Token\n", argo_lines_read, argo_chars_read);
+				argo_position(f);
+				fprintf(argo_err, "[%d, %d] Invalid Token\n", argo_ctx->lines_read, argo_ctx->chars_read);
 				return -1;
 			}
 		}
 		else{
-			fprintf(stderr, "[%d, %d] Invalid Token\n", argo_lines_read, argo_chars_read);
+			argo_position(f);
+			fprintf(argo_err, "[%d, %d] Invalid Token\n", argo_ctx->lines_read, argo_ctx->chars_read);
 			return -1;
 		}
 	}
 	else{
-		fprintf(stderr, "[%d, %d] Invalid Token\n", argo_lines_read, argo_chars_read);
+		argo_position(f);
+		fprintf(argo_err, "[%d, %d] Invalid Token\n", argo_ctx->lines_read, argo_ctx->chars_read);
 		return -1;
 	}
 }
 
 
+/*
+ * Read one character for argo_skip_value.  The stream is only ever read by
+ * the calling thread, so the unlocked variant of getc is used to keep
+ * skipping as fast as scanning.
+ */
+#define argo_skip_getc(f, c) ((c) = getc_unlocked(f))
+
+/*
+ * Check the character after a backslash in a string being skipped, and
+ * skip the four hex digits of a \u escape, accepting the same escapes as
+ * argo_read_string.
+ */
+static int argo_skip_escape(FILE *f){
+	ARGO_CHAR c;
+	int k;
+
+	argo_skip_getc(f, c);
+	if(c == ARGO_U){
+		for(k = 0; k < 4; k++){
+			argo_skip_getc(f, c);
+			if(!argo_is_hex(c)){
+				break;
+			}
+		}
+		if(k == 4){
+			return 0;
+		}
+	}
+	else if(c == ARGO_QUOTE || c == ARGO_BSLASH || c == ARGO_FSLASH || c == ARGO_B
+	        || c == ARGO_F || c == ARGO_N || c == ARGO_R || c == ARGO_T){
+		return 0;
+	}
+	argo_position(f);
+	fprintf(argo_err, "[%d, %d] Illegal escape (\\%d) in string\n", argo_ctx->lines_read, argo_ctx->chars_read, c);
+	return -1;
+}
+
+/**
+ * @brief  Skip over the next value of the input.
+ * @details  Leading whitespace and the value are read and discarded without
+ * allocating values or decoding strings.  The value is only checked for
+ * properly terminated strings with valid escapes, and for brackets and
+ * braces that are balanced and each closed by its own kind; numbers,
+ * literals and the placement of commas and colons are not checked.
+ * The kind of each open bracket or brace is kept as one bit per level of
+ * nesting, up to ARGO_SKIP_MAX_DEPTH levels, more than the arena could
+ * hold values for.  Nothing after the value is read.
+ *
+ * @param f  Input stream from which JSON is to be read.
+ * @return  Zero if the operation is completely successful,
+ * nonzero if there is any error.
+ */
+int argo_skip_value(FILE *f){
+	ARGO_CONTEXT *ctx = argo_ctx;
+	uint64_t braces[ARGO_SKIP_MAX_DEPTH / 64];     // bit set if the level was opened by {
+	uint64_t bit;
+	int depth = 0;
+	ARGO_CHAR c;
+
+	do{
+		argo_skip_getc(f, c);
+	} while(argo_is_whitespace(c));
+
+	while(c != EOF){
+		if(c == ARGO_QUOTE){
+			do{
+				argo_skip_getc(f, c);
+				if(c == ARGO_BSLASH){
+					if(argo_skip_escape(f)){
+						return -1;
+					}
+					c = 0;
+				}
+			} while(c != ARGO_QUOTE && c != EOF);
+			if(c == EOF){
+				break;
+			}
+		}
+		else if(c == ARGO_LBRACK || c == ARGO_LBRACE){
+			if(depth == ARGO_SKIP_MAX_DEPTH){
+				argo_position(f);
+				fprintf(argo_err, "[%d, %d] Nesting too deep\n", ctx->lines_read, ctx->chars_read);
+				return -1;
+			}
+			bit = (uint64_t) 1 << (depth % 64);
+			if(c == ARGO_LBRACE){
+				braces[depth / 64] |= bit;
+			}
+			else{
+				braces[depth / 64] &= ~bit;
+			}
+			depth++;
+		}
+		else if(c == ARGO_RBRACK || c == ARGO_RBRACE){
+			if(depth == 0){
+				argo_position(f);
+				fprintf(argo_err, "[%d, %d] Expect value but seen (%d)\n", ctx->lines_read, ctx->chars_read, c);
+				return -1;
+			}
+			depth--;
+			if(((braces[depth / 64] >> (depth % 64)) & 1) != (c == ARGO_RBRACE)){
+				argo_position(f);
+				fprintf(argo_err, "[%d, %d] Expect %c but seen (%d)\n", ctx->lines_read, ctx->chars_read,
+				        c == ARGO_RBRACE ? ARGO_RBRACK : ARGO_RBRACE, c);
+				return -1;
+			}
+		}
+		else if(depth == 0){
+			// a number or literal at the top level ends at the first delimiter
+			if(c == ARGO_COMMA || c == ARGO_COLON){
+				argo_position(f);
+				fprintf(argo_err, "[%d, %d] Expect value but seen (%d)\n", ctx->lines_read, ctx->chars_read, c);
+				return -1;
+			}
+			do{
+				argo_skip_getc(f, c);
+			} while(c != EOF && !argo_is_whitespace(c) && c != ARGO_COMMA && c != ARGO_COLON
+				&& c != ARGO_RBRACK && c != ARGO_RBRACE);
+			if(c != EOF){
+				if(ungetc(c, f) == EOF){
+					argo_position(f);
+					fprintf(argo_err,"[%d, %d] Fail to unget. \n", ctx->lines_read, ctx->chars_read);
+					return -1;
+				}
+			}
+			return 0;
+		}
+		if(depth == 0){
+			return 0;
+		}
+		argo_skip_getc(f, c);
+	}
+	argo_position(f);
+	fprintf(argo_err, "[%d, %d] Premature end of input\n", ctx->lines_read, ctx->chars_read);
+	return -1;
+}
+
+
 // argo write helper functions
+
+/*
+ * Escape sequences of the characters below 0x60 that cannot appear
+ * directly in a string literal; the others have empty entries.
+ */
+static const char argo_escapes[0x60][8] = {
+	"\\u0000", "\\u0001", "\\u0002", "\\u0003", "\\u0004", "\\u0005", "\\u0006", "\\u0007",
+	"\\b",     "\\t",     "\\n",     "\\u000b", "\\f",     "\\r",     "\\u000e", "\\u000f",
+	"\\u0010", "\\u0011", "\\u0012", "\\u0013", "\\u0014", "\\u0015", "\\u0016", "\\u0017",
+	"\\u0018", "\\u0019", "\\u001a", "\\u001b", "\\u001c", "\\u001d", "\\u001e", "\\u001f",
+	[ARGO_QUOTE] = "\\\"",
+	[ARGO_BSLASH] = "\\\\"
+};
+
+static const char argo_hex_digits[] = "0123456789abcdef";
+
+/**
+ * @brief  Find the run of characters at the start of a string that can be
+ * written as they are, and convert them to bytes.
+ * @details  These are the characters from 0x20 to max, other than the
+ * quote and the backslash.  Where SSE2 is available, sixteen characters
+ * are checked and converted at a time; the rest are done one by one.
+ *
+ * @param str  The characters.
+ * @param len  How many of them to look at, at most.
+ * @param out  Where to store the bytes of the run.
+ * @param max  The largest character that is written as a single byte:
+ * 0xff, or 0x7f when the output is UTF-8.
+ * @return  The length of the run.
+ */
+size_t argo_plain_run(ARGO_CHAR *str, size_t len, char *out, ARGO_CHAR max){
+	size_t i = 0;
+	ARGO_CHAR c;
+
+#ifdef __SSE2__
+	const __m128i space = _mm_set1_epi32(' ');
+	const __m128i top = _mm_set1_epi32(max);
+	const __m128i quote = _mm_set1_epi32(ARGO_QUOTE);
+	const __m128i bslash = _mm_set1_epi32(ARGO_BSLASH);
+	__m128i v[4], bad;
+	int k;
+
+	for(; i + 16 <= len; i += 16){
+		bad = _mm_setzero_si128();
+		for(k = 0; k < 4; k++){
+			v[k] = _mm_loadu_si128((const __m128i *) (str + i + 4 * k));
+			bad = _mm_or_si128(bad, _mm_cmpgt_epi32(space, v[k]));
+			bad = _mm_or_si128(bad, _mm_cmpgt_epi32(v[k], top));
+			bad = _mm_or_si128(bad, _mm_cmpeq_epi32(v[k], quote));
+			bad = _mm_or_si128(bad, _mm_cmpeq_epi32(v[k], bslash));
+		}
+		if(_mm_movemask_epi8(bad)){
+			break;
+		}
+		// every character fits in a byte, so saturation leaves them unchanged
+		_mm_storeu_si128((__m128i *) (out + i),
+			_mm_packus_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3])));
+	}
+#endif
+	for(; i < len; i++){
+		c = str[i];
+		if(c < ' ' || c > max || c == ARGO_QUOTE || c == ARGO_BSLASH){
+			break;
+		}
+		out[i] = c;
+	}
+	return i;
+}
+
+/**
+ * @brief  Produce the escape sequence of a character that cannot be
+ * written as it is.
+ *
+ * @param c  The character.
+ * @param out  Where to store the sequence, which takes at most twelve
+ * bytes: a character beyond U+FFFF is written as a surrogate pair.
+ * @return  The length of the sequence, or -1 if the character cannot
+ * be represented.
+ */
+int argo_escape_char(ARGO_CHAR c, char *out){
+	const char *esc;
+	int n;
+
+	if(c >= 0 && c < 0x60 && argo_escapes[c][0]){
+		for(esc = argo_escapes[c], n = 0; esc[n]; n++){
+			out[n] = esc[n];
+		}
+		return n;
+	}
+	if(c > 0xffff && c <= 0x10ffff){
+		c -= 0x10000;
+		n = argo_escape_char(0xD800 + (c >> 10), out);
+		return n + argo_escape_char(0xDC00 + (c & 0x3ff), out + n);
+	}
+	if(c >= 0x80 && c <= 0xffff){
+		out[0] = ARGO_BSLASH;
+		out[1] = ARGO_U;
+		out[2] = argo_hex_digits[(c >> 12) & 0xf];
+		out[3] = argo_hex_digits[(c >> 8) & 0xf];
+		out[4] = argo_hex_digits[(c >> 4) & 0xf];
+		out[5] = argo_hex_digits[c & 0xf];
+		return 6;
+	}
+	return -1;
+}
+
+/**
+ * @brief  Encode a character beyond ASCII in UTF-8, for the -u mode.
+ * @details  Surrogates, which UTF-8 cannot represent, are written as
+ * escape sequences instead.
+ *
+ * @param c  The character.
+ * @param out  Where to store the encoding, which takes at most six bytes.
+ * @return  The length of the encoding, or -1 if the character cannot
+ * be represented.
+ */
+int argo_utf8_char(ARGO_CHAR c, char *out){
+	if(c < 0x80 || argo_is_high_surrogate(c) || argo_is_low_surrogate(c)){
+		return argo_escape_char(c, out);
+	}
+	if(c < 0x800){
+		out[0] = 0xC0 | (c >> 6);
+		out[1] = 0x80 | (c & 0x3F);
+		return 2;
+	}
+	if(c < 0x10000){
+		out[0] = 0xE0 | (c >> 12);
+		out[1] = 0x80 | ((c >> 6) & 0x3F);
+		out[2] = 0x80 | (c & 0x3F);
+		return 3;
+	}
+	if(c <= 0x10FFFF){
+		out[0] = 0xF0 | (c >> 18);
+		out[1] = 0x80 | ((c >> 12) & 0x3F);
+		out[2] = 0x80 | ((c >> 6) & 0x3F);
+		out[3] = 0x80 | (c & 0x3F);
+		return 4;
+	}
+	return -1;
+}
+
 int write_hex_to_file(int num, FILE *f){
 	if(num < 0){
-		fprintf(stderr, "Invalid Hex\n");
+		fprintf(argo_err, "Invalid Hex\n");
 		return -1;
 	}
 
@@ -417,7 +828,7 @@ int write_hex_to_file(int num, FILE *f){
 		// put digit char
         if((digit)>=0 && (digit)<10){
 			if(fputc(digit+ARGO_DIGIT0,f) == EOF){
-				fprintf(stderr, "Error EOF\n");
+				fprintf(argo_err, "Error EOF\n");
 				return -1;
 			}
 		}
@@ -425,12 +836,12 @@ int write_hex_to_file(int num, FILE *f){
 		// put hex a b c d e f char
 		else if((digit)>=10 && (digit)<16){
 			if(fputc((digit-15)+ARGO_F,f) == EOF){
-				fprintf(stderr, "Error EOF\n");
+				fprintf(argo_err, "Error EOF\n");
 				return -1;
 			}
 		}
 		else{
-			fprintf(stderr, "Invalid Hex\n");
+			fprintf(argo_err, "Invalid Hex\n");
 			return -1;
 		}
     }
@@ -441,7 +852,7 @@ int write_hex_to_file(int num, FILE *f){
 int write_long_to_file(long num, FILE *f){
 	if(num < 0){
 		if(fputc(ARGO_MINUS,f) == EOF){
-			fprintf(stderr, "Error EOF\n");
+			fprintf(argo_err, "Error EOF\n");
 			return -1;
 		}
 		num = -num;
@@ -456,29 +867,175 @@ int write_long_to_file(long num, FILE *f){
 
 	if((num%10)>=0 && (num%10)<10){
 		if(fputc((num%10)+ARGO_DIGIT0,f) == EOF){
-			fprintf(stderr, "Error EOF\n");
+			fprintf(argo_err, "Error EOF\n");
 			return -1;
 		}
 	}
 	else{
-		fprintf(stderr, "Invalid integer to write\n");
+		fprintf(argo_err, "Invalid integer to write\n");
 		return -1;
 	}
 	return 0;
 }
 
+/**
+ * @brief  Compute the values of a number from its text.
+ * @details  The text must already have been checked to be a JSON number.
+ * Both argo_read_number and the push parser convert numbers here, so that
+ * they produce identical values.  The integer value is only valid if there
+ * is no fraction or exponent part.
+ *
+ * @param n  The number, whose string_value holds its text.
+ */
+void argo_number_convert(ARGO_NUMBER *n){
+	ARGO_CHAR *s = n->string_value.content;
+	size_t len = n->string_value.length;
+	size_t i = 0;
+	int neg_flag = 0, dec_flag = 0, exp_flag = 0, exp_neg = 0;
+	double frac_num = 0;
+	long int_sum = 0;
+	double float_sum = 0;
+	int exp_sum = 0;
+	int k;
+	ARGO_CHAR c;
+
+	if(s[i] == ARGO_MINUS){
+		neg_flag = 1;
+		i++;
+	}
+	if(s[i] == ARGO_DIGIT0 && i + 1 == len){
+		n->int_value = 0;
+		n->float_value = neg_flag? -0.0 : 0.0;
+		n->valid_string = argo_number_text_kind(&n->string_value, neg_flag, 0);
+		n->valid_int = 1;
+		n->valid_float = 1;
+		return;
+	}
+
+	for(; i < len; i++){
+		c = s[i];
+		if(argo_is_digit(c)){
+			if(exp_flag){
+				exp_sum = (exp_sum*10)+(c-ARGO_DIGIT0);
+			}
+			else if(dec_flag){
+				frac_num = c-ARGO_DIGIT0;
+				for(k=0; k<dec_flag; k++){
+					frac_num = frac_num/10.0;
+				}
+				float_sum = float_sum+frac_num;
+				dec_flag++;
+			}
+			else{
+				int_sum = (int_sum*10) + (c-ARGO_DIGIT0);
+				float_sum = (float_sum*10) + (c-ARGO_DIGIT0);
+			}
+		}
+		else if(c == ARGO_PERIOD){
+			int_sum = 0;
+			dec_flag = 1;
+		}
+		else if(argo_is_exponent(c)){
+			int_sum = 0;
+			exp_flag = 1;
+		}
+		else if(c == ARGO_MINUS){
+			exp_neg = 1;
+		}
+	}
+
+	if(neg_flag){
+		int_sum = -int_sum;
+		float_sum = -float_sum;
+	}
+	if(exp_flag){
+		for(k=0; k<exp_sum; k++){
+			if(exp_neg){
+				float_sum = float_sum/10.0;
+			}
+			else{
+				float_sum = float_sum*10.0;
+			}
+		}
+	}
+
+	n->int_value = int_sum;
+	n->float_value = float_sum;
+	n->valid_string = argo_number_text_kind(&n->string_value, neg_flag, exp_flag || dec_flag);
+	n->valid_int = !(exp_flag || dec_flag);
+	n->valid_float = 1;
+}
+
+/**
+ * @brief  Determine what the text of a number that has just been read
+ * is good for.
+ * @details  The text is canonical if it is an integer literal that
+ * write_long_to_file would reproduce from the value: one without a
+ * fraction or exponent part, that is not -0 (whose value is written as 0),
+ * and that has few enough digits for the value to fit in a long.
+ * JSON syntax already rules out leading zeros and a plus sign.
+ *
+ * @param sv  Text of the number.
+ * @param neg_flag  Nonzero if the number has a minus sign.
+ * @param frac_or_exp  Nonzero if the number has a fraction or exponent part.
+ * @return  ARGO_CANONICAL_TEXT if the text is canonical, else 1.
+ */
+char argo_number_text_kind(ARGO_STRING *sv, int neg_flag, int frac_or_exp){
+	size_t digits = sv->length - (neg_flag != 0);
+
+	if(frac_or_exp || digits > ARGO_CANONICAL_DIGITS){
+		return 1;
+	}
+	if(neg_flag && digits == 1 && sv->content[1] == ARGO_DIGIT0){
+		return 1;
+	}
+	return ARGO_CANONICAL_TEXT;
+}
+
+/**
+ * @brief  Write out the text of a number as it was read.
+ * @details  Only meant for text that argo_number_text_kind found to be
+ * canonical, which is short and pure ASCII; longer text is still written
+ * correctly, a buffer at a time, so that nothing here depends on every
+ * producer of ARGO_CANONICAL_TEXT having checked the length.
+ *
+ * @param sv  Text of the number.
+ * @param f  Output stream.
+ * @return  Zero if the operation is completely successful,
+ * nonzero if there is any error.
+ */
+int argo_write_number_text(ARGO_STRING *sv, FILE *f){
+	char buf[ARGO_CANONICAL_DIGITS + 1];
+	size_t done, i, n;
+
+	for(done = 0; done < sv->length; done += n){
+		n = sv->length - done;
+		if(n > sizeof(buf)){
+			n = sizeof(buf);
+		}
+		for(i = 0; i < n; i++){
+			buf[i] = (char) sv->content[done + i];
+		}
+		if(fwrite(buf, 1, n, f) != n){
+			fprintf(argo_err, "Error EOF\n");
+			return -1;
+		}
+	}
+	return 0;
+}
+
 int write_double_to_file(double num, FILE *f){
 	if(num == 0){
 		if(fputc(ARGO_DIGIT0,f) == EOF){
-			fprintf(stderr, "Error EOF\n");
+			fprintf(argo_err, "Error EOF\n");
 			return -1;
 		}
 		if(fputc(ARGO_PERIOD,f) == EOF){
-			fprintf(stderr, "Error EOF\n");
+			fprintf(argo_err, "Error EOF\n");
 			return -1;
 		}
 		if(fputc(ARGO_DIGIT0,f) == EOF){
-			fprintf(stderr, "Error EOF\n");
+			fprintf(argo_err, "Error EOF\n");
 			return -1;
 		}
 		return 0;
@@ -486,7 +1043,7 @@ int write_double_to_file(double num, FILE *f){
 
 	if(num < 0){
 		if(fputc(ARGO_MINUS,f) == EOF){
-			fprintf(stderr, "Error EOF\n");
+			fprintf(argo_err, "Error EOF\n");
 			return -1;
 		}
 		num = -num;
@@ -508,17 +1065,17 @@ int write_double_to_file(double num, FILE *f){
 	}
 
 	if(num >= 1 || num < 0.1 || exp > 1023 || exp < -1022){
-		fprintf(stderr, "Invalid float number to write\n");
+		fprintf(argo_err, "Invalid float number to write\n");
 		return -1;
 	}
 
 	//0.
 	if(fputc(ARGO_DIGIT0,f) == EOF){
-		fprintf(stderr, "Error EOF\n");
+		fprintf(argo_err, "Error EOF\n");
 		return -1;
 	}
 	if(fputc(ARGO_PERIOD,f) == EOF){
-		fprintf(stderr, "Error EOF\n");
+		fprintf(argo_err, "Error EOF\n");
 		return -1;
 	}
 
@@ -529,7 +1086,7 @@ int write_double_to_file(double num, FILE *f){
 		r = (int) num;
 		num = num - r;
 		if(fputc(r+ARGO_DIGIT0,f) == EOF){
-			fprintf(stderr, "Error EOF\n");
+			fprintf(argo_err, "Error EOF\n");
 			return -1;
 		}
 		if(num == 0){
@@ -539,7 +1096,7 @@ int write_double_to_file(double num, FILE *f){
 
 	if(exp != 0){
 		if(fputc(ARGO_E,f) == EOF){
-			fprintf(stderr, "Error EOF\n");
+			fprintf(argo_err, "Error EOF\n");
 			return -1;
 		}
 		if(write_long_to_file(exp, f)){
@@ -553,14 +1110,14 @@ int write_double_to_file(double num, FILE *f){
 int argo_write_basic(char *str, FILE *f){
 
     if( str==NULL || f==NULL ){
-    	fprintf(stderr, "Invalid argument(s) for write basic\n");
+    	fprintf(argo_err, "Invalid argument(s) for write basic\n");
         return -1;
     }
 
     char *s;
     for(s=str; *s; s++){
     	if(fputc(*s, f) == EOF){
-    		fprintf(stderr, "Error EOF\n");
+    		fprintf(argo_err, "Error EOF\n");
 	        return -1;
 	    }
     }
@@ -568,161 +1125,67 @@ int argo_write_basic(char *str, FILE *f){
    return 0;
 }
 
-int argo_write_array(ARGO_ARRAY *a, FILE *f){
-
-    if( a==NULL || f==NULL ){
-    	fprintf(stderr, "Invalid argument(s) for write array\n");
-        return -1;
-    }
-
-    int p = global_options & 0x000000FF;
-    int i;
-
-    // head
-    ARGO_VALUE *list_ptr = a->element_list;
-    // first element
-    list_ptr = list_ptr->next;
-
-    // put '['
-    if(fputc(ARGO_LBRACK, f) == EOF){
-    	fprintf(stderr, "Error EOF\n");
-        return -1;
-    }
-
-    indent_level++;
-
-    // if empty, then indent level decreased by 1
-    if(list_ptr->type == ARGO_NO_TYPE){
-    	indent_level--;
-    }
-
-    if(p){
-        if(fputc(ARGO_LF, f) == EOF){
-        	fprintf(stderr, "Error EOF\n");
+/**
+ * @brief  Write a basic value, number or string.
+ *
+ * @param v  The value.
+ * @param f  Output stream to which JSON is to be written.
+ * @return  Zero if the operation is completely successful,
+ * nonzero if there is any error.
+ */
+int argo_write_scalar(ARGO_VALUE *v, FILE *f){
+    if(v->type == ARGO_BASIC_TYPE){
+        char *token = v->content.basic == ARGO_TRUE ? ARGO_TRUE_TOKEN
+            : v->content.basic == ARGO_FALSE ? ARGO_FALSE_TOKEN : ARGO_NULL_TOKEN;
+        if(argo_write_basic(token, f)){
+            fprintf(argo_err, "Error in write basic\n");
             return -1;
         }
-        for(i=0; i<(p*indent_level); i++){
-            if(fputc(ARGO_SPACE, f) == EOF){
-            	fprintf(stderr, "Error EOF\n");
-                return -1;
-            }
-        }
+        return 0;
     }
-
-    // iterate through the circular linked list
-    while(list_ptr->type){
-        if(argo_write_value(list_ptr, f)){
+    if(v->type == ARGO_NUMBER_TYPE){
+        if(argo_write_number(&v->content.number, f)){
+            fprintf(argo_err, "Error in write number\n");
             return -1;
         }
-        if(list_ptr->next->type){
-            if(fputc(ARGO_COMMA, f) == EOF){
-            	fprintf(stderr, "Error EOF\n");
-                return -1;
-            }
-        }
-        else{
-            indent_level--;
-        }
-        if(p){
-            if(fputc(ARGO_LF, f) == EOF){
-            	fprintf(stderr, "Error EOF\n");
-                return -1;
-            }
-            for(i=0; i<(p*indent_level); i++){
-                if(fputc(ARGO_SPACE, f) == EOF){
-                	fprintf(stderr, "Error EOF\n");
-                    return -1;
-                }
-            }
-        }
-        list_ptr = list_ptr->next;
+        return 0;
     }
-    if(fputc(ARGO_RBRACK, f) == EOF){
-    	fprintf(stderr, "Error EOF\n");
-        return -1;
+    if(v->type == ARGO_STRING_TYPE){
+        if(argo_write_string(&v->content.string, f)){
+            fprintf(argo_err, "Error in write string\n");
+            return -1;
+        }
+        return 0;
     }
-
-    return 0;
+    fprintf(argo_err, "Error no type to write\n");
+    return -1;
 }
 
-int argo_write_object(ARGO_OBJECT *o, FILE *f){
-
-    if( o==NULL || f==NULL ){
-    	fprintf(stderr, "Invalid argument(s) for write object\n");
-        return -1;
-    }
-
-    int p = global_options & 0x000000FF;
+/**
+ * @brief  Make sure that the indent buffer of the calling thread's context
+ * holds a newline followed by at least len - 1 spaces.
+ * @details  The buffer is used by the pretty-printing writers to start a
+ * new line with a single write; it is grown as deeper levels are reached.
+ *
+ * @param len  Length needed.
+ * @return  Zero if the operation is completely successful,
+ * nonzero if there is any error.
+ */
+int argo_grow_indent(int len){
+    ARGO_CONTEXT *ctx = argo_ctx;
+    int size = 2 * len > 256 ? 2 * len : 256;
+    char *buf = realloc(ctx->indent, size);
     int i;
 
-    ARGO_VALUE *list_ptr = o->member_list;
-
-    list_ptr = list_ptr->next;
-    if(fputc(ARGO_LBRACE, f) == EOF){
-    	fprintf(stderr, "Error EOF\n");
+    if(buf == NULL){
+        fprintf(argo_err, "Failed to allocate indent\n");
         return -1;
     }
-    indent_level++;
-    // if empty, then indent level decreased by 1
-    if(list_ptr->type == ARGO_NO_TYPE){
-    	indent_level--;
+    buf[0] = ARGO_LF;
+    for(i = 1; i < size; i++){
+        buf[i] = ARGO_SPACE;
     }
-    if(p){
-        if(fputc(ARGO_LF, f) == EOF){
-        	fprintf(stderr, "Error EOF\n");
-            return -1;
-        }
-        for(i=0; i<(p*indent_level); i++){
-            if(fputc(ARGO_SPACE, f) == EOF){
-            	fprintf(stderr, "Error EOF\n");
-                return -1;
-            }
-        }
-    }
-    while(list_ptr->type){
-        if(argo_write_string(&(list_ptr->name), f)){
-            return -1;
-        }
-        if(fputc(ARGO_COLON, f) == EOF){
-        	fprintf(stderr, "Error EOF\n");
-            return -1;
-        }
-        if(p){
-            if(fputc(ARGO_SPACE, f) == EOF){
-            	fprintf(stderr, "Error EOF\n");
-                return -1;
-            }
-        }
-        if(argo_write_value(list_ptr, f)){
-            return -1;
-        }
-        if(list_ptr->next->type){
-            if(fputc(ARGO_COMMA, f) == EOF){
-            	fprintf(stderr, "Error EOF\n");
-                return -1;
-            }
-        }
-        else{
-            indent_level--;
-        }
-        if(p){
-            if(fputc(ARGO_LF, f) == EOF){
-            	fprintf(stderr, "Error EOF\n");
-                return -1;
-            }
-            for(i=0; i<(p*indent_level); i++){
-                if(fputc(ARGO_SPACE, f) == EOF){
-                	fprintf(stderr, "Error EOF\n");
-                    return -1;
-                }
-            }
-        }
-        list_ptr = list_ptr->next;
-    }
-    if(fputc(ARGO_RBRACE, f) == EOF){
-    	fprintf(stderr, "Error EOF\n");
-        return -1;
-    }
-
+    ctx->indent = buf;
+    ctx->indent_size = size;
     return 0;
 }
@@ -4,6 +4,26 @@
 #include "global.h"
 #include "debug.h"
 #include "utils.h"
+#include "options.h"
+#include "hash.h"
+#include "files.h"
+#include "compress.h"
+
+int argo_num_threads = 1;
+char *argo_query_path = NULL;
+char *argo_keep_spec = NULL;
+int argo_hash_algorithms = ARGO_HASH_XXH64 | ARGO_HASH_SHA256;
+char *argo_diff_files[2] = {NULL, NULL};
+char **argo_files = NULL;
+int argo_num_files = 0;
+char *argo_socket_path = NULL;
+long argo_load_requests = 0;
+int argo_pipeline = 0;
+int argo_io_mode = ARGO_IO_AUTO;
+int argo_compress_format = ARGO_COMPRESS_NONE;
+long argo_head_count = 0;
+double argo_sample_rate = 0;
+
 /**
  * @brief Validates command line arguments passed to the program.
  * @details This function will validate all the arguments passed to the
@@ -33,11 +53,56 @@ int validargs(int argc, char **argv) {
         return -1;
     }
 
+    global_options=0x00000000;
+    argo_num_threads = 1;
+    argo_query_path = NULL;
+    argo_keep_spec = NULL;
+    argo_hash_algorithms = ARGO_HASH_XXH64 | ARGO_HASH_SHA256;
+    argo_diff_files[0] = NULL;
+    argo_diff_files[1] = NULL;
+    argo_socket_path = NULL;
+    argo_load_requests = 0;
+    argo_pipeline = 0;
+    argo_io_mode = ARGO_IO_AUTO;
+    argo_compress_format = ARGO_COMPRESS_NONE;
+    argo_head_count = 0;
+    argo_sample_rate = 0;
+    free(argo_files);
+    argo_files = malloc(argc * sizeof(char *));
+    argo_num_files = 0;
+    if(argo_files == NULL){
+        return -1;
+    }
+
     char **ap = argv;       // argument pointer that points to the current argument
     ap++;       // first argument
 
     char *H_FLAG = "-h", *V_FLAG = "-v", *C_FLAG = "-c", *P_FLAG = "-p";    // pre-defined strings for flags
+    char *N_FLAG = "-n", *J_FLAG = "-j", *S_FLAG = "-s", *Q_FLAG = "-q";
+    char *KEEP_FLAG = "--keep", *U_FLAG = "-u", *b_FLAG = "-b", *B_FLAG = "-B";
+    char *CBOR_FLAG = "--cbor", *MSGPACK_FLAG = "--msgpack";
+    char *FROM_CBOR_FLAG = "--from-cbor", *FROM_MSGPACK_FLAG = "--from-msgpack";
+    char *JCS_FLAG = "-C", *HASH_FLAG = "-H";
+    char *XXH64_NAME = "xxh64", *SHA256_NAME = "sha256";
+    char *DIFF_FLAG = "--diff", *DEDUP_FLAG = "--dedup", *W_FLAG = "-w";
+    char *SERVE_FLAG = "--serve", *LOAD_FLAG = "--load", *PIPELINE_FLAG = "--pipeline";
+    char *IO_FLAG = "--io", *SYNC_NAME = "sync", *URING_NAME = "uring";
+    char *COMPRESS_FLAG = "--compress", *GZIP_NAME = "gzip", *ZSTD_NAME = "zstd";
+    char *HEAD_FLAG = "--head", *SAMPLE_FLAG = "--sample";
     int v_exist = 0, c_exist = 0, p_exist = 0;      // boolean to record if v, c, p, flags has been provided
+    int n_exist = 0, j_exist = 0, s_exist = 0;      // boolean to record if n, j, s flags has been provided
+    int q_exist = 0, keep_exist = 0, u_exist = 0;       // boolean to record if q, keep, u flags has been provided
+    int b_exist = 0, B_exist = 0;       // boolean to record if b, B flags has been provided
+    int cbor_exist = 0, msgpack_exist = 0;      // boolean to record if cbor, msgpack flags has been provided
+    int from_exist = 0;     // boolean to record if from-cbor or from-msgpack flag has been provided
+    int hash_exist = 0;     // boolean to record if H flag has been provided
+    int diff_exist = 0;     // boolean to record if diff flag has been provided
+    int dedup_exist = 0;        // boolean to record if dedup flag has been provided
+    int w_exist = 0;        // boolean to record if w flag has been provided
+    int serve_exist = 0, load_exist = 0;        // boolean to record if serve, load flags has been provided
+    int io_exist = 0;       // boolean to record if io flag has been provided
+    int compress_exist = 0;     // boolean to record if compress flag has been provided
+    int head_exist = 0, sample_exist = 0;       // boolean to record if head, sample flags has been provided
 
     int num = 0;        // num of indentation for p flag
     int i = 1;      // argument index
@@ -48,11 +113,112 @@ int validargs(int argc, char **argv) {
      */
     while(i < argc){
 
+        /**
+         * the argument after q flag is its JSON pointer, whatever it looks like.
+         */
+        if(compare_string(previous, Q_FLAG) && argo_query_path == NULL){
+            argo_query_path = *ap;
+        }
+
+        /**
+         * the argument after keep flag is its projection, whatever it looks like.
+         */
+        else if(compare_string(previous, KEEP_FLAG) && argo_keep_spec == NULL){
+            argo_keep_spec = *ap;
+        }
+
+        /**
+         * the two arguments after diff flag are the files to compare, whatever they look like.
+         */
+        else if(diff_exist && argo_diff_files[1] == NULL){
+            argo_diff_files[argo_diff_files[0] != NULL] = *ap;
+        }
+
+        /**
+         * the argument after serve or load flag is the path of the socket, whatever it looks like.
+         */
+        else if((serve_exist || load_exist) && argo_socket_path == NULL){
+            argo_socket_path = *ap;
+        }
+
+        /**
+         * the argument after the socket of load flag is the number of requests.
+         */
+        else if(load_exist && argo_load_requests == 0){
+            if(!is_digit_string(*ap) || string_to_int(*ap) == 0){
+                global_options=0x00000000;
+                return -1;
+            }
+            argo_load_requests = string_to_int(*ap);
+        }
+
+        /**
+         * the argument after io flag names the way files are read.
+         */
+        else if(compare_string(previous, IO_FLAG)){
+            if(compare_string(*ap, SYNC_NAME)){
+                argo_io_mode = ARGO_IO_SYNC;
+            }
+            else if(compare_string(*ap, URING_NAME)){
+                argo_io_mode = ARGO_IO_URING;
+            }
+            else{
+                global_options=0x00000000;
+                return -1;
+            }
+        }
+
+        /**
+         * the argument after compress flag names the format of the output.
+         */
+        else if(compare_string(previous, COMPRESS_FLAG)){
+            if(compare_string(*ap, GZIP_NAME)){
+                argo_compress_format = ARGO_COMPRESS_GZIP;
+            }
+            else if(compare_string(*ap, ZSTD_NAME)){
+                argo_compress_format = ARGO_COMPRESS_ZSTD;
+            }
+            else{
+                global_options=0x00000000;
+                return -1;
+            }
+        }
+
+        /**
+         * the argument after head flag is the number of elements to output.
+         */
+        else if(compare_string(previous, HEAD_FLAG)){
+            if(!is_digit_string(*ap) || string_to_int(*ap) <= 0){
+                global_options=0x00000000;
+                return -1;
+            }
+            argo_head_count = string_to_int(*ap);
+        }
+
+        /**
+         * the argument after sample flag is the fraction of elements to output.
+         */
+        else if(compare_string(previous, SAMPLE_FLAG)){
+            argo_sample_rate = string_to_fraction(*ap);
+            if(argo_sample_rate <= 0 || argo_sample_rate > 1){
+                global_options=0x00000000;
+                return -1;
+            }
+        }
+
+        /**
+         * the argument after H flag may name the one hash to print.
+         */
+        else if(compare_string(previous, HASH_FLAG)
+                && (compare_string(*ap, XXH64_NAME) || compare_string(*ap, SHA256_NAME))){
+            argo_hash_algorithms = compare_string(*ap, XXH64_NAME) ? ARGO_HASH_XXH64 : ARGO_HASH_SHA256;
+        }
+
         /**
          * h flag, if provided, need to be the first argument.
          * set global_options to 0x80000000.
          */
-        if(compare_string(*ap, H_FLAG)){
+        else if(compare_string(*ap, H_FLAG)){
             if(i == 1){
                 global_options=0x80000000;
                 return 0;
@@ -66,11 +232,11 @@ int validargs(int argc, char **argv) {
          * set global_options to 0x40000000.
          */
         else if(compare_string(*ap, V_FLAG)){
-            if(v_exist || c_exist){
+            if(v_exist || c_exist || q_exist || keep_exist){
                 global_options=0x00000000;
                 return -1;
             }
-            global_options=0x40000000;
+            global_options |= VALIDATE_OPTION;
             v_exist = 1;
         }
 
@@ -83,10 +249,138 @@ int validargs(int argc, char **argv) {
                 global_options=0x00000000;
                 return -1;
             }
-            global_options=0x20000000;
+            global_options |= CANONICALIZE_OPTION;
+            c_exist = 1;
+        }
+
+        /**
+         * C flag is c flag with the canonical form of RFC 8785, so the same rules apply.
+         * it implies UTF-8 input and output.
+         */
+        else if(compare_string(*ap, JCS_FLAG)){
+            if(v_exist || c_exist){
+                global_options=0x00000000;
+                return -1;
+            }
+            global_options |= CANONICALIZE_OPTION | JCS_OPTION | UTF8_OPTION;
             c_exist = 1;
         }
 
+        /**
+         * H flag selects hashes of the output and may be given only once.
+         */
+        else if(compare_string(*ap, HASH_FLAG)){
+            if(hash_exist){
+                global_options=0x00000000;
+                return -1;
+            }
+            global_options |= HASH_OPTION;
+            hash_exist = 1;
+        }
+
+        /**
+         * diff flag may be given only once and must be followed by two files.
+         */
+        else if(compare_string(*ap, DIFF_FLAG)){
+            if(diff_exist){
+                global_options=0x00000000;
+                return -1;
+            }
+            global_options |= DIFF_OPTION;
+            diff_exist = 1;
+        }
+
+        /**
+         * serve and load flags may be given only once, and not together.
+         */
+        else if(compare_string(*ap, SERVE_FLAG) || compare_string(*ap, LOAD_FLAG)){
+            if(serve_exist || load_exist){
+                global_options=0x00000000;
+                return -1;
+            }
+            if(compare_string(*ap, SERVE_FLAG)){
+                global_options |= SERVE_OPTION;
+                serve_exist = 1;
+            }
+            else{
+                global_options |= LOAD_OPTION;
+                load_exist = 1;
+            }
+        }
+
+        /**
+         * pipeline flag may be given only once.
+         */
+        else if(compare_string(*ap, PIPELINE_FLAG)){
+            if(argo_pipeline){
+                global_options=0x00000000;
+                return -1;
+            }
+            argo_pipeline = 1;
+        }
+
+        /**
+         * io flag may be given only once and must be followed by sync or uring.
+         */
+        else if(compare_string(*ap, IO_FLAG)){
+            if(io_exist){
+                global_options=0x00000000;
+                return -1;
+            }
+            io_exist = 1;
+        }
+
+        /**
+         * compress flag may be given only once and must be followed by gzip or zstd.
+         */
+        else if(compare_string(*ap, COMPRESS_FLAG)){
+            if(compress_exist){
+                global_options=0x00000000;
+                return -1;
+            }
+            compress_exist = 1;
+        }
+
+        /**
+         * head and sample flags may each be given only once.
+         */
+        else if(compare_string(*ap, HEAD_FLAG) || compare_string(*ap, SAMPLE_FLAG)){
+            if(compare_string(*ap, HEAD_FLAG) ? head_exist : sample_exist){
+                global_options=0x00000000;
+                return -1;
+            }
+            if(compare_string(*ap, HEAD_FLAG)){
+                head_exist = 1;
+            }
+            else{
+                sample_exist = 1;
+            }
+        }
+
+        /**
+         * w flag writes the output of each file beside it and may be given only once.
+         */
+        else if(compare_string(*ap, W_FLAG)){
+            if(w_exist){
+                global_options=0x00000000;
+                return -1;
+            }
+            global_options |= CANON_FILES_OPTION;
+            w_exist = 1;
+        }
+
+        /**
+         * dedup flag may be given only once.
+         */
+        else if(compare_string(*ap, DEDUP_FLAG)){
+            if(dedup_exist){
+                global_options=0x00000000;
+                return -1;
+            }
+            global_options |= DEDUP_OPTION;
+            dedup_exist = 1;
+        }
+
         /**
          * p flag can only appear after c flag.
          * p flag is not allowed when another v or p flag exist.
@@ -101,27 +395,175 @@ int validargs(int argc, char **argv) {
                 global_options=0x00000000;
                 return -1;
             }
-            global_options=0x30000004;
+            global_options |= PRETTY_PRINT_OPTION | 4;
             p_exist = 1;
         }
 
+        /**
+         * n flag selects newline-delimited input and may be given only once.
+         */
+        else if(compare_string(*ap, N_FLAG)){
+            if(n_exist){
+                global_options=0x00000000;
+                return -1;
+            }
+            global_options |= NDJSON_OPTION;
+            n_exist = 1;
+        }
+
+        /**
+         * s flag requests statistics and may be given only once.
+         */
+        else if(compare_string(*ap, S_FLAG)){
+            if(s_exist){
+                global_options=0x00000000;
+                return -1;
+            }
+            global_options |= STATISTICS_OPTION;
+            s_exist = 1;
+        }
+
+        /**
+         * u flag selects UTF-8 output and may be given only once.
+         */
+        else if(compare_string(*ap, U_FLAG)){
+            if(u_exist){
+                global_options=0x00000000;
+                return -1;
+            }
+            global_options |= UTF8_OPTION;
+            u_exist = 1;
+        }
+
+        /**
+         * b flag selects snapshot output and may be given only once.
+         */
+        else if(compare_string(*ap, b_FLAG)){
+            if(b_exist){
+                global_options=0x00000000;
+                return -1;
+            }
+            global_options |= SAVE_BINARY_OPTION;
+            b_exist = 1;
+        }
+
+        /**
+         * B flag selects snapshot input and may be given only once.
+         */
+        else if(compare_string(*ap, B_FLAG)){
+            if(B_exist){
+                global_options=0x00000000;
+                return -1;
+            }
+            global_options |= LOAD_BINARY_OPTION;
+            B_exist = 1;
+        }
+
+        /**
+         * cbor and msgpack flags select the output format; only one may be given.
+         * their strings are UTF-8, so they imply UTF-8 input and output.
+         */
+        else if(compare_string(*ap, CBOR_FLAG) || compare_string(*ap, MSGPACK_FLAG)){
+            if(cbor_exist || msgpack_exist){
+                global_options=0x00000000;
+                return -1;
+            }
+            global_options |= UTF8_OPTION;
+            if(compare_string(*ap, CBOR_FLAG)){
+                global_options |= CBOR_OPTION;
+                cbor_exist = 1;
+            }
+            else{
+                global_options |= MSGPACK_OPTION;
+                msgpack_exist = 1;
+            }
+        }
+
+        /**
+         * from-cbor and from-msgpack flags select the input format; only one may be given.
+         */
+        else if(compare_string(*ap, FROM_CBOR_FLAG) || compare_string(*ap, FROM_MSGPACK_FLAG)){
+            if(from_exist){
+                global_options=0x00000000;
+                return -1;
+            }
+            global_options |= compare_string(*ap, FROM_CBOR_FLAG) ? FROM_CBOR_OPTION : FROM_MSGPACK_OPTION;
+            from_exist = 1;
+        }
+
+        /**
+         * q flag may be given only once and must be followed by a JSON pointer.
+         * it cannot be combined with v flag.
+         */
+        else if(compare_string(*ap, Q_FLAG)){
+            if(q_exist || v_exist || keep_exist){
+                global_options=0x00000000;
+                return -1;
+            }
+            global_options |= QUERY_OPTION;
+            q_exist = 1;
+        }
+
+        /**
+         * keep flag may be given only once and must be followed by a projection.
+         * it cannot be combined with v or q flag.
+         */
+        else if(compare_string(*ap, KEEP_FLAG)){
+            if(keep_exist || v_exist || q_exist){
+                global_options=0x00000000;
+                return -1;
+            }
+            global_options |= KEEP_OPTION;
+            keep_exist = 1;
+        }
+
+        /**
+         * j flag may be given only once and must be followed by a thread count.
+         */
+        else if(compare_string(*ap, J_FLAG)){
+            if(j_exist){
+                global_options=0x00000000;
+                return -1;
+            }
+            j_exist = 1;
+        }
+
         /**
          * digit string can only contain positive digit char. (positive integer only)
          * max indentation is 255 (0xFF).
-         * digit string can only appear after p flag.
-         * set global options to 0x300000xx (bitwise or with num).
+         * digit string can only appear after p or j flag.
+         * after p, set the least-significant byte of global options to num.
+         * after j, num is the number of threads (at most 1024, 0 for one per CPU).
          */
         else if(is_digit_string(*ap)){
-            if(!compare_string(previous, P_FLAG)){
-                global_options=0x00000000;
-                return -1;
+            if(compare_string(previous, J_FLAG)){
+                num = string_to_int(*ap);
+                if(num>1024){
+                    global_options=0x00000000;
+                    return -1;
+                }
+                argo_num_threads = num;
+            }
+            else if(compare_string(previous, P_FLAG)){
+                num = string_to_int(*ap);
+                if(num>255){
+                    global_options=0x00000000;
+                    return -1;
+                }
+                global_options = (global_options & ~INDENT_MASK) | num;
             }
-            num = string_to_int(*ap);
-            if(num>255){
+            else{
                 global_options=0x00000000;
                 return -1;
             }
-            global_options = 0x30000000 | num;
+        }
+
+        /**
+         * any other argument that is not a flag names a file to process.
+         */
+        else if(**ap != '-' && **ap != '\0'){
+            argo_files[argo_num_files++] = *ap;
+            global_options |= FILES_OPTION;
         }
         else{
             global_options=0x00000000;
@@ -137,6 +579,153 @@ int validargs(int argc, char **argv) {
         i++;
     }
 
+    /**
+     * j flag needs its thread count.
+     * n and j flags need one of v or c, except with serve or load flag;
+     * s flag needs n, j, dedup, serve or files.
+     * without n or files, j selects parallel parsing of a top-level array.
+     * files need v or c flag and only go with p, j, s, u and w flags; w flag
+     * needs files and c flag; io flag needs its way of reading, and files.
+     * q and keep flags need their argument, cannot be combined with n or j,
+     * and imply canonical output.  u flag needs canonical output or a snapshot.
+     * b flag cannot be combined with any other flag but u; B flag needs c flag
+     * and cannot be combined with any other flag but p and u.
+     * cbor and msgpack flags need canonical output, without p or n flag.
+     * from-cbor and from-msgpack flags need v or c flag, and only go with p and u
+     * flags and the output format flags.
+     * H flag needs canonical output.
+     * diff flag needs its two files, and cannot be combined with any other flag but u.
+     * serve flag needs its socket and only goes with j, u and s flags; load flag
+     * needs its socket and number of requests, v or c flag, and only goes with
+     * p and j flags.
+     * dedup flag needs v, c or b flag, and cannot be combined with n, j, q, keep, B,
+     * from-cbor, from-msgpack or diff flag.
+     * pipeline flag needs v flag, canonical output or a snapshot, and reads standard
+     * input, so it cannot be combined with B, diff, serve or load flag or files, nor
+     * with n flag, which reads ahead already.
+     * compress flag needs its format, and canonical output or a snapshot on
+     * standard output, so it cannot be combined with H, w, diff or serve flag.
+     * head and sample flags need their argument and c flag, go with p, u, n, C,
+     * pipeline and compress flags only, and read one value after another, so
+     * they cannot be combined with j flag.
+     */
+    if(compare_string(previous, J_FLAG)){
+        global_options=0x00000000;
+        return -1;
+    }
+    if((n_exist || j_exist) && !(v_exist || c_exist || serve_exist || load_exist)){
+        global_options=0x00000000;
+        return -1;
+    }
+    if(s_exist && !(n_exist || j_exist || dedup_exist || serve_exist || argo_num_files)){
+        global_options=0x00000000;
+        return -1;
+    }
+    if(j_exist && !n_exist && !argo_num_files && !serve_exist && !load_exist){
+        global_options |= PARALLEL_OPTION;
+    }
+    if(q_exist){
+        if(argo_query_path == NULL || n_exist || j_exist){
+            global_options=0x00000000;
+            return -1;
+        }
+        global_options |= CANONICALIZE_OPTION;
+    }
+    if(keep_exist){
+        if(argo_keep_spec == NULL || n_exist || j_exist){
+            global_options=0x00000000;
+            return -1;
+        }
+        global_options |= CANONICALIZE_OPTION;
+    }
+    if(b_exist && (global_options & ~(SAVE_BINARY_OPTION | UTF8_OPTION | DEDUP_OPTION | STATISTICS_OPTION))){
+        global_options=0x00000000;
+        return -1;
+    }
+    if(B_exist && (!c_exist || (global_options & ~(LOAD_BINARY_OPTION | CANONICALIZE_OPTION
+                                                  | PRETTY_PRINT_OPTION | UTF8_OPTION | INDENT_MASK
+                                                  | CBOR_OPTION | MSGPACK_OPTION | HASH_OPTION)))){
+        global_options=0x00000000;
+        return -1;
+    }
+    if(u_exist && !(global_options & (CANONICALIZE_OPTION | SAVE_BINARY_OPTION | DIFF_OPTION | SERVE_OPTION))){
+        global_options=0x00000000;
+        return -1;
+    }
+    if((cbor_exist || msgpack_exist) && (!(global_options & CANONICALIZE_OPTION) || p_exist || n_exist
+                                         || (global_options & JCS_OPTION))){
+        global_options=0x00000000;
+        return -1;
+    }
+    if(from_exist && (!(v_exist || c_exist) || n_exist || j_exist || s_exist || q_exist || keep_exist
+                      || b_exist || B_exist)){
+        global_options=0x00000000;
+        return -1;
+    }
+    if(hash_exist && !(global_options & CANONICALIZE_OPTION)){
+        global_options=0x00000000;
+        return -1;
+    }
+    if(diff_exist && (argo_diff_files[1] == NULL || (global_options & ~(DIFF_OPTION | UTF8_OPTION)))){
+        global_options=0x00000000;
+        return -1;
+    }
+
+    if(dedup_exist && (!(v_exist || c_exist || b_exist) || n_exist || j_exist || q_exist || keep_exist
+                       || B_exist || from_exist || diff_exist)){
+        global_options=0x00000000;
+        return -1;
+    }
+
+    if(argo_num_files && (!(v_exist || c_exist) || n_exist || q_exist || keep_exist || b_exist || B_exist
+                          || cbor_exist || msgpack_exist || from_exist || hash_exist || diff_exist || dedup_exist)){
+        global_options=0x00000000;
+        return -1;
+    }
+    if(w_exist && !(argo_num_files && c_exist)){
+        global_options=0x00000000;
+        return -1;
+    }
+    if(io_exist && (argo_io_mode == ARGO_IO_AUTO || !argo_num_files)){
+        global_options=0x00000000;
+        return -1;
+    }
+
+    if(serve_exist && (argo_socket_path == NULL
+                       || (global_options & ~(SERVE_OPTION | UTF8_OPTION | STATISTICS_OPTION)))){
+        global_options=0x00000000;
+        return -1;
+    }
+    if(load_exist && (argo_load_requests == 0 || !(v_exist || c_exist)
+                      || (global_options & ~(LOAD_OPTION | VALIDATE_OPTION | CANONICALIZE_OPTION
+                                             | PRETTY_PRINT_OPTION | INDENT_MASK)))){
+        global_options=0x00000000;
+        return -1;
+    }
+
+    if(compress_exist && (argo_compress_format == ARGO_COMPRESS_NONE
+                          || !(global_options & (CANONICALIZE_OPTION | SAVE_BINARY_OPTION))
+                          || (global_options & (HASH_OPTION | CANON_FILES_OPTION | DIFF_OPTION
+                                                | SERVE_OPTION | LOAD_OPTION)))){
+        global_options=0x00000000;
+        return -1;
+    }
+
+    if((head_exist || sample_exist)
+       && ((head_exist && argo_head_count == 0) || (sample_exist && argo_sample_rate == 0) || !c_exist
+           || (global_options & ~(CANONICALIZE_OPTION | PRETTY_PRINT_OPTION | INDENT_MASK | UTF8_OPTION
+                                  | NDJSON_OPTION | JCS_OPTION)) || j_exist)){
+        global_options=0x00000000;
+        return -1;
+    }
+
+    if(argo_pipeline && (!(global_options & (VALIDATE_OPTION | CANONICALIZE_OPTION | SAVE_BINARY_OPTION))
+                         || (global_options & (NDJSON_OPTION | LOAD_BINARY_OPTION | DIFF_OPTION
+                                               | SERVE_OPTION | LOAD_OPTION | FILES_OPTION)))){
+        global_options=0x00000000;
+        return -1;
+    }
+
     //abort();
     /**
      * return 0 if no error occur.
@@ -0,0 +1,55 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "argo.h"
+#include "global.h"
+#include "debug.h"
+#include "utils.h"
+#include "context.h"
+#include "options.h"
+#include "writer.h"
+
+/*
+ * Minified output.
+ */
+ARGO_DEFINE_WRITER(argo_write_minified, argo_write_array, argo_write_object, 0)
+
+/*
+ * Pretty-printed output with the common indents, which are known at
+ * compile time.
+ */
+ARGO_DEFINE_WRITER(argo_write_pretty2, argo_write_array_pretty2, argo_write_object_pretty2, 2)
+ARGO_DEFINE_WRITER(argo_write_pretty4, argo_write_array_pretty4, argo_write_object_pretty4, 4)
+
+/*
+ * Output in whatever format global_options calls for, found out at run time.
+ */
+ARGO_DEFINE_WRITER(argo_write_pretty, argo_write_array_pretty, argo_write_object_pretty,
+                   global_options & INDENT_MASK)
+
+ARGO_WRITER argo_writer = argo_write_pretty;
+
+/**
+ * @brief  Select the writer for a given indent, and make it the one used
+ * by argo_write_value.
+ *
+ * @param indent  Number of spaces per indent level, zero for minified output.
+ * @return  The writer selected.
+ */
+ARGO_WRITER argo_select_writer(int indent){
+    switch(indent){
+    case 0:
+        argo_writer = argo_write_minified;
+        break;
+    case 2:
+        argo_writer = argo_write_pretty2;
+        break;
+    case 4:
+        argo_writer = argo_write_pretty4;
+        break;
+    default:
+        argo_writer = argo_write_pretty;
+        break;
+    }
+    return argo_writer;
+}
@@ -1,8 +1,29 @@
 #include <criterion/criterion.h>
 #include <criterion/logging.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include "argo.h"
 #include "global.h"
+#include "options.h"
+#include "push.h"
+#include "context.h"
+#include "lazy.h"
+#include "writer.h"
+#include "utils.h"
+#include "binary.h"
+#include "encode.h"
+#include "jcs.h"
+#include "hash.h"
+#include "merkle.h"
+#include "dedup.h"
+#include "files.h"
+#include "serve.h"
+#include "ring.h"
+#include "source.h"
+#include "compress.h"
+#include "head.h"
 
 static char *progname = "bin/argo";
 
@@ -93,3 +114,1060 @@ Test(basecode_suite, argo_basic_test) {
     cr_assert_eq(return_code, EXIT_SUCCESS,
                  "Program output did not match reference output.");
 }
+
+Test(basecode_suite, validargs_ndjson_test) {
+    char *argv[] = {progname, "-c", "-n", "-j", "8", NULL};
+    int argc = (sizeof(argv) / sizeof(char *)) - 1;
+    int ret = validargs(argc, argv);
+    int exp_ret = 0;
+    int opt = global_options;
+    int exp_opt = CANONICALIZE_OPTION | NDJSON_OPTION;
+    cr_assert_eq(ret, exp_ret, "Invalid return for validargs.  Got: %d | Expected: %d",
+		 ret, exp_ret);
+    cr_assert_eq(opt, exp_opt, "Invalid options settings.  Got: 0x%x | Expected: 0x%x",
+		 opt, exp_opt);
+    cr_assert_eq(argo_num_threads, 8, "Invalid thread count.  Got: %d | Expected: %d",
+		 argo_num_threads, 8);
+}
+
+Test(basecode_suite, argo_ndjson_test) {
+    char *cmd = "bin/argo -c -n -j 4 < rsrc/records.ndjson > test_output/records_-c_-n.json";
+    char *cmp = "cmp test_output/records_-c_-n.json tests/rsrc/records_-c_-n.json";
+
+    int return_code = WEXITSTATUS(system(cmd));
+    cr_assert_eq(return_code, EXIT_SUCCESS,
+                 "Program exited with 0x%x instead of EXIT_SUCCESS",
+		 return_code);
+    return_code = WEXITSTATUS(system(cmp));
+    cr_assert_eq(return_code, EXIT_SUCCESS,
+                 "Program output did not match reference output.");
+}
+
+Test(basecode_suite, argo_parallel_array_test) {
+    char *cmd = "bin/argo -c -j 4 < rsrc/array.json > test_output/array_-c_-j.json";
+    char *ref = "bin/argo -c < rsrc/array.json > test_output/array_-c.json";
+    char *cmp = "cmp test_output/array_-c_-j.json test_output/array_-c.json";
+
+    int return_code = WEXITSTATUS(system(cmd));
+    cr_assert_eq(return_code, EXIT_SUCCESS,
+                 "Program exited with 0x%x instead of EXIT_SUCCESS",
+		 return_code);
+    return_code = WEXITSTATUS(system(ref));
+    cr_assert_eq(return_code, EXIT_SUCCESS,
+                 "Program exited with 0x%x instead of EXIT_SUCCESS",
+		 return_code);
+    return_code = WEXITSTATUS(system(cmp));
+    cr_assert_eq(return_code, EXIT_SUCCESS,
+                 "Parallel output did not match serial output.");
+}
+
+Test(basecode_suite, argo_query_test) {
+    char *cmd = "bin/argo -q /dependencies/@types~1bson/requires < rsrc/package-lock.json > test_output/package-lock_-q.json";
+    char *cmp = "cmp test_output/package-lock_-q.json tests/rsrc/package-lock_-q.json";
+
+    int return_code = WEXITSTATUS(system(cmd));
+    cr_assert_eq(return_code, EXIT_SUCCESS,
+                 "Program exited with 0x%x instead of EXIT_SUCCESS",
+		 return_code);
+    return_code = WEXITSTATUS(system(cmp));
+    cr_assert_eq(return_code, EXIT_SUCCESS,
+                 "Program output did not match reference output.");
+}
+
+Test(basecode_suite, argo_keep_test) {
+    char *cmd = "bin/argo --keep name,dependencies.@types/bson.requires < rsrc/package-lock.json > test_output/package-lock_--keep.json";
+    char *cmp = "cmp test_output/package-lock_--keep.json tests/rsrc/package-lock_--keep.json";
+
+    int return_code = WEXITSTATUS(system(cmd));
+    cr_assert_eq(return_code, EXIT_SUCCESS,
+                 "Program exited with 0x%x instead of EXIT_SUCCESS",
+		 return_code);
+    return_code = WEXITSTATUS(system(cmp));
+    cr_assert_eq(return_code, EXIT_SUCCESS,
+                 "Program output did not match reference output.");
+}
+
+Test(basecode_suite, argo_utf8_test) {
+    char *cmd = "bin/argo -c -u < rsrc/unicode.json > test_output/unicode_-c_-u.json";
+    char *cmp = "cmp test_output/unicode_-c_-u.json tests/rsrc/unicode_-c_-u.json";
+
+    int return_code = WEXITSTATUS(system(cmd));
+    cr_assert_eq(return_code, EXIT_SUCCESS,
+                 "Program exited with 0x%x instead of EXIT_SUCCESS",
+		 return_code);
+    return_code = WEXITSTATUS(system(cmp));
+    cr_assert_eq(return_code, EXIT_SUCCESS,
+                 "Program output did not match reference output.");
+}
+
+Test(basecode_suite, argo_push_fragments_test) {
+    char *doc = "{\"a\": [1, 0.25, -3e2, \"x\\u0041\\n\"], \"b\" : true, \"c\": {}}";
+    char *exp = "{\"a\":[1,0.25,-0.3e3,\"xA\\n\"],\"b\":true,\"c\":{}}";
+    char *out = NULL;
+    size_t len = 0;
+    char *s;
+
+    global_options = CANONICALIZE_OPTION;
+    ARGO_PUSH *p = argo_push_create();
+    cr_assert_not_null(p, "Failed to create push parser");
+    // feed the document one byte at a time, splitting every token
+    for(s = doc; *s; s++) {
+        cr_assert_eq(argo_feed(p, s, 1), 0, "argo_feed failed at offset %ld", (long)(s - doc));
+    }
+    ARGO_VALUE *v = argo_finish(p);
+    cr_assert_not_null(v, "argo_finish returned NULL");
+    FILE *f = open_memstream(&out, &len);
+    cr_assert_eq(argo_write_value(v, f), 0, "argo_write_value failed");
+    fclose(f);
+    cr_assert_str_eq(out, exp, "Got: %s | Expected: %s", out, exp);
+    argo_push_destroy(p);
+    free(out);
+}
+
+Test(basecode_suite, argo_push_truncated_test) {
+    char *doc = "[1, {\"a\": \"unterminated";
+    ARGO_PUSH *p = argo_push_create();
+    cr_assert_eq(argo_feed(p, doc, 10), 0, "argo_feed failed on a valid prefix");
+    cr_assert_eq(argo_feed(p, doc + 10, 13), 0, "argo_feed failed on a valid prefix");
+    cr_assert_null(argo_finish(p), "argo_finish accepted truncated input");
+    argo_push_destroy(p);
+}
+
+Test(basecode_suite, argo_lazy_lookup_test) {
+    char doc[] = "{\"skip\": [[1, 2], {\"x\": \"]}\"}],\n \"n\\u0061me\": [true, {\"k\": -1.5e1}, null]}";
+    char *exp = "{\"k\":-0.15e2}";
+    char *out = NULL;
+    size_t len = 0;
+    ARGO_LAZY root, member, element;
+
+    global_options = CANONICALIZE_OPTION;
+    ARGO_LAZY_DOC *d = argo_lazy_open(doc, strlen(doc));
+    cr_assert_not_null(d, "argo_lazy_open failed");
+    cr_assert_eq(argo_lazy_root(d, &root), 0, "argo_lazy_root failed");
+    cr_assert_eq(argo_lazy_get(&root, "missing", &member), 1, "Found a missing member");
+    cr_assert_eq(argo_lazy_get(&root, "name", &member), 0, "Member not found");
+    cr_assert_eq(argo_lazy_at(&member, 3, &element), 1, "Found a missing element");
+    cr_assert_eq(argo_lazy_at(&member, 1, &element), 0, "Element not found");
+
+    int used = argo_ctx->next_value;
+    ARGO_VALUE *v = argo_lazy_value(&element);
+    cr_assert_not_null(v, "argo_lazy_value returned NULL");
+    // only the element itself is materialized: the object, its sentinel and one member
+    cr_assert_eq(argo_ctx->next_value - used, 3, "Materialized %d values", argo_ctx->next_value - used);
+    cr_assert_eq(argo_lazy_value(&element), v, "Value was materialized twice");
+    FILE *f = open_memstream(&out, &len);
+    cr_assert_eq(argo_write_value(v, f), 0, "argo_write_value failed");
+    fclose(f);
+    cr_assert_str_eq(out, exp, "Got: %s | Expected: %s", out, exp);
+    argo_lazy_close(d);
+    free(out);
+}
+
+Test(basecode_suite, argo_write_string_test) {
+    // long enough to span several output chunks, with escapes at every offset mod 16
+    ARGO_CHAR content[3000];
+    char exp[3000 * 6 + 3];
+    char *out = NULL;
+    size_t len = 0, n = 0;
+    int i;
+
+    exp[n++] = '"';
+    for(i = 0; i < 3000; i++) {
+        if(i % 17 == 5) {
+            content[i] = '"';
+            n += sprintf(exp + n, "\\\"");
+        }
+        else if(i % 23 == 7) {
+            content[i] = 0x263a;
+            n += sprintf(exp + n, "\\u263a");
+        }
+        else if(i % 29 == 3) {
+            content[i] = '\n';
+            n += sprintf(exp + n, "\\n");
+        }
+        else {
+            content[i] = 0xa0 + i % 0x5f;
+            exp[n++] = content[i];
+        }
+    }
+    exp[n++] = '"';
+    exp[n] = '\0';
+    ARGO_STRING s = {3000, 3000, content};
+    FILE *f = open_memstream(&out, &len);
+    cr_assert_eq(argo_write_string(&s, f), 0, "argo_write_string failed");
+    fclose(f);
+    cr_assert_eq(len, n, "Wrote %ld bytes instead of %ld", (long)len, (long)n);
+    cr_assert_str_eq(out, exp, "Output differs");
+    free(out);
+}
+
+Test(basecode_suite, argo_select_writer_test) {
+    char *in = "{\"a\":[1,[],{\"b\":[true,{}]}],\"c\":{\"d\":\"e\"}}";
+    int indents[] = {0, 2, 3, 4};
+    char *exp = NULL, *out = NULL;
+    size_t len = 0;
+    int i;
+
+    FILE *f = fmemopen(in, strlen(in), "r");
+    ARGO_VALUE *v = argo_read_value(f);
+    fclose(f);
+    cr_assert_not_null(v, "argo_read_value returned NULL");
+    for(i = 0; i < 4; i++) {
+        // the writer specialized for an indent must agree with the general one
+        global_options = CANONICALIZE_OPTION | PRETTY_PRINT_OPTION | indents[i];
+        f = open_memstream(&exp, &len);
+        cr_assert_eq(argo_write_pretty(v, f), 0, "argo_write_pretty failed");
+        fclose(f);
+        f = open_memstream(&out, &len);
+        cr_assert_eq(argo_select_writer(indents[i])(v, f), 0, "Selected writer failed");
+        fclose(f);
+        cr_assert_str_eq(out, exp, "Indent %d: got: %s | Expected: %s", indents[i], out, exp);
+        free(exp);
+        free(out);
+    }
+    argo_writer = argo_write_pretty;
+}
+
+Test(basecode_suite, argo_number_passthrough_test) {
+    char *in = "[0,-0,42,-17,123456789012345678,1234567890123456789,2.5,1e2]";
+    char kinds[] = {ARGO_CANONICAL_TEXT, 1, ARGO_CANONICAL_TEXT, ARGO_CANONICAL_TEXT,
+                    ARGO_CANONICAL_TEXT, 1, 1, 1};
+    char *exp = "[0,0,42,-17,123456789012345678,1234567890123456789,0.25e1,0.1e3]";
+    char *out = NULL;
+    size_t len = 0;
+    int i = 0;
+
+    global_options = CANONICALIZE_OPTION;
+    FILE *f = fmemopen(in, strlen(in), "r");
+    ARGO_VALUE *v = argo_read_value(f);
+    fclose(f);
+    cr_assert_not_null(v, "argo_read_value returned NULL");
+    ARGO_VALUE *head = v->content.array.element_list;
+    for(ARGO_VALUE *e = head->next; e != head; e = e->next, i++)
+        cr_assert_eq(e->content.number.valid_string, kinds[i], "Element %d: kind %d", i, e->content.number.valid_string);
+    f = open_memstream(&out, &len);
+    cr_assert_eq(argo_write_value(v, f), 0, "argo_write_value failed");
+    fclose(f);
+    cr_assert_str_eq(out, exp, "Got: %s | Expected: %s", out, exp);
+    free(out);
+}
+
+Test(basecode_suite, argo_binary_test) {
+    char *in = "{\"a\":[1,-2.5e3,\"x\\u263ay\",true,null,[],{}],\"\":{\"b\":false}}";
+    char *exp = "{\"a\":[1,-0.25e4,\"x\\u263ay\",true,null,[],{}],\"\":{\"b\":false}}";
+    char *out = NULL;
+    size_t len = 0;
+
+    global_options = CANONICALIZE_OPTION;
+    FILE *f = fmemopen(in, strlen(in), "r");
+    ARGO_VALUE *v = argo_read_value(f);
+    fclose(f);
+    cr_assert_not_null(v, "argo_read_value returned NULL");
+    FILE *snap = tmpfile();
+    cr_assert_eq(argo_save_binary(v, snap), 0, "argo_save_binary failed");
+    fflush(snap);
+    int used = argo_ctx->next_value;
+    ARGO_VALUE *w = argo_load_binary(snap);
+    cr_assert_not_null(w, "argo_load_binary returned NULL");
+    cr_assert_eq(argo_ctx->next_value - used, used, "Loaded %d values instead of %d", argo_ctx->next_value - used, used);
+    f = open_memstream(&out, &len);
+    cr_assert_eq(argo_write_value(w, f), 0, "argo_write_value failed");
+    fclose(f);
+    cr_assert_str_eq(out, exp, "Got: %s | Expected: %s", out, exp);
+    free(out);
+    // the strings of the loaded values are in the mapping and must not be freed
+    argo_context_reset(argo_ctx);
+    fclose(snap);
+}
+
+Test(basecode_suite, argo_encode_test) {
+    char *in = "{\"a\":[1,-300,2.5,true,null],\"bc\":\"x\"}";
+    unsigned char cbor[] = {0xA2, 0x61, 'a', 0x85, 0x01, 0x39, 0x01, 0x2B, 0xF9, 0x41, 0x00,
+                            0xF5, 0xF6, 0x62, 'b', 'c', 0x61, 'x'};
+    unsigned char msgpack[] = {0x82, 0xA1, 'a', 0x95, 0x01, 0xD1, 0xFE, 0xD4, 0xCA, 0x40, 0x20,
+                               0x00, 0x00, 0xC3, 0xC0, 0xA2, 'b', 'c', 0xA1, 'x'};
+    char *out = NULL;
+    size_t len = 0;
+    size_t i;
+
+    global_options = CANONICALIZE_OPTION | CBOR_OPTION;
+    FILE *f = fmemopen(in, strlen(in), "r");
+    ARGO_VALUE *v = argo_read_value(f);
+    fclose(f);
+    cr_assert_not_null(v, "argo_read_value returned NULL");
+    f = open_memstream(&out, &len);
+    cr_assert_eq(argo_write_cbor(v, f), 0, "argo_write_cbor failed");
+    fclose(f);
+    cr_assert_eq(len, sizeof(cbor), "CBOR is %ld bytes instead of %ld", (long)len, (long)sizeof(cbor));
+    for(i = 0; i < len; i++)
+        cr_assert_eq((unsigned char)out[i], cbor[i], "CBOR byte %ld is %02x", (long)i, (unsigned char)out[i]);
+    free(out);
+    f = open_memstream(&out, &len);
+    cr_assert_eq(argo_write_msgpack(v, f), 0, "argo_write_msgpack failed");
+    fclose(f);
+    cr_assert_eq(len, sizeof(msgpack), "MessagePack is %ld bytes instead of %ld", (long)len, (long)sizeof(msgpack));
+    for(i = 0; i < len; i++)
+        cr_assert_eq((unsigned char)out[i], msgpack[i], "MessagePack byte %ld is %02x", (long)i, (unsigned char)out[i]);
+    free(out);
+}
+
+Test(basecode_suite, argo_decode_test) {
+    // an indefinite-length array holding a chunked string, an indefinite-length
+    // map, a tagged integer and a half-precision float
+    unsigned char cbor[] = {0x9F, 0x7F, 0x62, 'a', 'b', 0x61, 'c', 0xFF, 0xBF, 0x61, 'k', 0xF6, 0xFF,
+                            0xC1, 0x1A, 0x00, 0x01, 0x00, 0x00, 0xF9, 0xC1, 0x00, 0xFF};
+    unsigned char msgpack[] = {0x82, 0xA1, 'a', 0x95, 0x01, 0xD1, 0xFE, 0xD4, 0xCA, 0x40, 0x20,
+                               0x00, 0x00, 0xC3, 0xC0, 0xA2, 'b', 'c', 0xA1, 'x'};
+    char *cbor_exp = "[\"abc\",{\"k\":null},65536,-0.25e1]";
+    char *msgpack_exp = "{\"a\":[1,-300,0.25e1,true,null],\"bc\":\"x\"}";
+    char *out = NULL;
+    size_t len = 0;
+
+    global_options = CANONICALIZE_OPTION;
+    FILE *f = fmemopen(cbor, sizeof(cbor), "r");
+    ARGO_VALUE *v = argo_read_cbor(f);
+    fclose(f);
+    cr_assert_not_null(v, "argo_read_cbor returned NULL");
+    f = open_memstream(&out, &len);
+    cr_assert_eq(argo_write_value(v, f), 0, "argo_write_value failed");
+    fclose(f);
+    cr_assert_str_eq(out, cbor_exp, "Got: %s | Expected: %s", out, cbor_exp);
+    free(out);
+    f = fmemopen(msgpack, sizeof(msgpack), "r");
+    v = argo_read_msgpack(f);
+    fclose(f);
+    cr_assert_not_null(v, "argo_read_msgpack returned NULL");
+    f = open_memstream(&out, &len);
+    cr_assert_eq(argo_write_value(v, f), 0, "argo_write_value failed");
+    fclose(f);
+    cr_assert_str_eq(out, msgpack_exp, "Got: %s | Expected: %s", out, msgpack_exp);
+    free(out);
+}
+
+Test(basecode_suite, argo_jcs_test) {
+    // members out of order, including one beyond U+FFFF, which sorts before U+E000
+    // in UTF-16 order, and numbers in forms that ECMAScript writes differently
+    char *s = "{\"b\":[1.50,1E21,0.0000001,-0,5e-324,123456789012345678],"
+              "\"\\ue000\":1,\"\\ud83d\\ude00\":2,\"a\":{\"y\":\"\\u00e9\\u001f\",\"x\":0.1e1}}";
+    char *exp = "{\"a\":{\"x\":1,\"y\":\"\xc3\xa9\\u001f\"},"
+                "\"b\":[1.5,1e+21,1e-7,0,5e-324,123456789012345680],"
+                "\"\xf0\x9f\x98\x80\":2,\"\xee\x80\x80\":1}";
+    char *out = NULL;
+    size_t len = 0;
+
+    global_options = CANONICALIZE_OPTION | JCS_OPTION | UTF8_OPTION;
+    FILE *f = fmemopen(s, strlen(s), "r");
+    ARGO_VALUE *v = argo_read_value(f);
+    fclose(f);
+    cr_assert_not_null(v, "argo_read_value returned NULL");
+    f = open_memstream(&out, &len);
+    cr_assert_eq(argo_write_jcs(v, f), 0, "argo_write_jcs failed");
+    fclose(f);
+    cr_assert_str_eq(out, exp, "Got: %s | Expected: %s", out, exp);
+    free(out);
+}
+
+Test(basecode_suite, argo_hash_test) {
+    // the hashes of the canonical output, written through a hash sink, must be
+    // those of the output itself: xxHash64 and SHA-256 of "[1,{\"a\":true}]"
+    char *s = "[ 1, { \"a\" : true } ]";
+    char *exp = "4df6e4abc618d600 4ae3a86bd481a709310bbbf5762761c64e22dc99c4a57094b2f6cd5668d3ad27\n";
+    char *out = NULL;
+    size_t len = 0;
+    ARGO_XXH64 x;
+
+    argo_xxh64_init(&x, 0);
+    argo_xxh64_update(&x, "abc", 3);
+    cr_assert_eq(argo_xxh64_final(&x), 0x44BC2CF5AD770999ULL, "Wrong xxHash64 of \"abc\"");
+
+    global_options = CANONICALIZE_OPTION | HASH_OPTION;
+    argo_select_writer(0);
+    FILE *f = fmemopen(s, strlen(s), "r");
+    ARGO_VALUE *v = argo_read_value(f);
+    fclose(f);
+    cr_assert_not_null(v, "argo_read_value returned NULL");
+    FILE *o = open_memstream(&out, &len);
+    f = argo_hash_open(ARGO_HASH_XXH64 | ARGO_HASH_SHA256, o);
+    cr_assert_not_null(f, "argo_hash_open returned NULL");
+    cr_assert_eq(argo_write_value(v, f), 0, "argo_write_value failed");
+    cr_assert_eq(fclose(f), 0, "Closing the hash sink failed");
+    fclose(o);
+    cr_assert_str_eq(out, exp, "Got: %s | Expected: %s", out, exp);
+    free(out);
+}
+
+Test(basecode_suite, argo_diff_test) {
+    // members in another order are not a difference, an element inserted into
+    // an array is added without disturbing the elements after it, and '/' in a
+    // member name is escaped in the path
+    char *sa = "{\"a\":[1,2,3,4],\"b\":{\"x\":1,\"y/z\":true},\"c\":null}";
+    char *sb = "{\"b\":{\"y/z\":false,\"x\":1},\"a\":[1,2,5,3,4],\"d\":[]}";
+    char *exp = "[\n{\"op\":\"add\",\"path\":\"/a/2\",\"value\":5},\n"
+                "{\"op\":\"replace\",\"path\":\"/b/y~1z\",\"value\":false},\n"
+                "{\"op\":\"remove\",\"path\":\"/c\"},\n"
+                "{\"op\":\"add\",\"path\":\"/d\",\"value\":[]}\n]\n";
+    ARGO_MERKLE ma, mb;
+    ARGO_CONTEXT *main_ctx = argo_ctx;
+    char *out = NULL;
+    size_t len = 0;
+
+    global_options = CANONICALIZE_OPTION;
+    argo_select_writer(0);
+    FILE *f = fmemopen(sa, strlen(sa), "r");
+    ARGO_VALUE *a = argo_read_value(f);
+    fclose(f);
+    cr_assert_not_null(a, "argo_read_value returned NULL");
+    cr_assert_eq(argo_merkle_build(&ma, a), 0, "argo_merkle_build failed");
+    argo_ctx = argo_context_create(100);
+    cr_assert_not_null(argo_ctx, "argo_context_create returned NULL");
+    f = fmemopen(sb, strlen(sb), "r");
+    ARGO_VALUE *b = argo_read_value(f);
+    fclose(f);
+    cr_assert_not_null(b, "argo_read_value returned NULL");
+    cr_assert_eq(argo_merkle_build(&mb, b), 0, "argo_merkle_build failed");
+    cr_assert_neq(argo_merkle_hash(&ma, a), argo_merkle_hash(&mb, b), "Different documents hash alike");
+    f = open_memstream(&out, &len);
+    cr_assert_eq(argo_diff(a, &ma, b, &mb, f), 0, "argo_diff failed");
+    fclose(f);
+    cr_assert_str_eq(out, exp, "Got: %s | Expected: %s", out, exp);
+    free(out);
+    argo_merkle_free(&ma);
+    argo_merkle_free(&mb);
+    argo_context_destroy(argo_ctx);
+    argo_ctx = main_ctx;
+}
+
+Test(basecode_suite, argo_dedup_test) {
+    // the two equal objects share one list of members, whose slots are given
+    // back, and the names and strings repeated share their characters
+    char *s = "[{\"dev\":true,\"requires\":{\"a\":\"^1.0\"}},{\"dev\":true,\"requires\":{\"a\":\"^1.0\"}},\"a\"]";
+    ARGO_CONTEXT *main_ctx = argo_ctx;
+    char *out = NULL;
+    size_t len = 0;
+
+    global_options = CANONICALIZE_OPTION | DEDUP_OPTION;
+    argo_select_writer(0);
+    argo_ctx = argo_context_create(100);
+    cr_assert_not_null(argo_ctx, "argo_context_create returned NULL");
+    cr_assert_eq(argo_dedup_enable(argo_ctx), 0, "argo_dedup_enable failed");
+    FILE *f = fmemopen(s, strlen(s), "r");
+    ARGO_VALUE *v = argo_read_value(f);
+    fclose(f);
+    cr_assert_not_null(v, "argo_read_value returned NULL");
+    ARGO_VALUE *first = v->content.array.element_list->next;
+    ARGO_VALUE *second = first->next;
+    cr_assert_eq(first->content.object.member_list, second->content.object.member_list,
+                 "Equal objects do not share their members");
+    cr_assert_eq(second->next->content.string.content, first->content.object.member_list->next->next->content.object.member_list->next->name.content,
+                 "Equal name and string do not share their characters");
+    cr_assert_eq(argo_ctx->dedup->values_saved, 5, "Got %ld slots given back", argo_ctx->dedup->values_saved);
+    cr_assert_eq(argo_ctx->next_value, 10, "Got %d slots in use", argo_ctx->next_value);
+    f = open_memstream(&out, &len);
+    cr_assert_eq(argo_write_value(v, f), 0, "argo_write_value failed");
+    fclose(f);
+    cr_assert_str_eq(out, s, "Got: %s | Expected: %s", out, s);
+    free(out);
+    argo_context_destroy(argo_ctx);
+    argo_ctx = main_ctx;
+}
+
+Test(basecode_suite, argo_files_test) {
+    // the outputs come in the order of the names, one per line, whichever
+    // worker finishes first, and the list names files as well
+    char *files[] = {"test_output/files_a.json", "@test_output/files.list"};
+    char *exp = "{\"a\":[1,2]}\n\"b\"\n";
+    char *out = NULL;
+    size_t len = 0;
+
+    FILE *f = fopen(files[0], "w");
+    cr_assert_not_null(f, "Cannot create %s", files[0]);
+    fputs("{ \"a\" : [ 1, 2 ] }", f);
+    fclose(f);
+    f = fopen("test_output/files_b.json", "w");
+    cr_assert_not_null(f, "Cannot create test_output/files_b.json");
+    fputs(" \"b\" ", f);
+    fclose(f);
+    f = fopen("test_output/files.list", "w");
+    cr_assert_not_null(f, "Cannot create test_output/files.list");
+    fputs("test_output/files_b.json\n\n", f);
+    fclose(f);
+
+    global_options = CANONICALIZE_OPTION | FILES_OPTION;
+    argo_num_threads = 2;
+    argo_select_writer(0);
+    FILE *o = open_memstream(&out, &len);
+    int ret = argo_files_run(files, 2, o);
+    fclose(o);
+    argo_num_threads = 1;
+    cr_assert_eq(ret, 0, "argo_files_run failed");
+    cr_assert_str_eq(out, exp, "Got: %s | Expected: %s", out, exp);
+    free(out);
+}
+
+Test(basecode_suite, argo_latency_test) {
+    // percentiles are known to within 1/ARGO_LATENCY_SUB, whichever
+    // histogram the latencies were recorded in
+    static ARGO_LATENCY a, b;
+    long i, p;
+
+    for(i = 1; i <= 1000000; i++){
+        argo_latency_add(i % 2 ? &a : &b, i);
+    }
+    argo_latency_merge(&a, &b);
+    cr_assert_eq(a.total, 1000000, "Got %ld latencies", a.total);
+    cr_assert_eq(a.max, 1000000, "Got maximum %ld", a.max);
+    p = argo_latency_percentile(&a, 0.5);
+    cr_assert(p > 500000 - 500000 / ARGO_LATENCY_SUB && p < 500000 + 500000 / ARGO_LATENCY_SUB,
+              "Got p50 %ld", p);
+    p = argo_latency_percentile(&a, 0.99);
+    cr_assert(p > 990000 - 990000 / ARGO_LATENCY_SUB && p <= 1000000, "Got p99 %ld", p);
+    cr_assert_eq(argo_latency_percentile(&a, 1.0), 1000000, "p100 is not the maximum");
+    cr_assert_eq(argo_latency_percentile(&b, 0.0), 2, "Got p0 %ld", argo_latency_percentile(&b, 0.0));
+}
+
+Test(basecode_suite, argo_ring_test) {
+    // a document longer than all the buffers of a ring together goes
+    // through the reader and the writer thread unchanged
+    int n = ARGO_RING_BUFFERS * ARGO_RING_BUFFER_SIZE / 4 + 1000;
+    char *out = NULL;
+    size_t len = 0;
+    int i;
+
+    FILE *f = fopen("test_output/ring.json", "w");
+    cr_assert_not_null(f, "Cannot create test_output/ring.json");
+    fputs("[ \"", f);
+    for(i = 0; i < n; i++){
+        fputs("abcd", f);
+    }
+    fputs("\" , true ]", f);
+    fclose(f);
+
+    global_options = CANONICALIZE_OPTION;
+    argo_select_writer(0);
+    f = fopen("test_output/ring.json", "r");
+    cr_assert_not_null(f, "Cannot open test_output/ring.json");
+    FILE *in = argo_ring_open_input(f);
+    cr_assert_not_null(in, "argo_ring_open_input failed");
+    ARGO_VALUE *v = argo_read_value(in);
+    cr_assert_not_null(v, "argo_read_value returned NULL");
+    cr_assert_eq(fgetc(in), EOF, "Input was left over");
+    fclose(in);
+    fclose(f);
+
+    FILE *m = open_memstream(&out, &len);
+    FILE *o = argo_ring_open_output(m, 0);
+    cr_assert_not_null(o, "argo_ring_open_output failed");
+    cr_assert_eq(argo_write_value(v, o), 0, "argo_write_value failed");
+    cr_assert_eq(fclose(o), 0, "Closing the output failed");
+    fclose(m);
+    cr_assert_eq(len, 4 * (size_t) n + 9, "Got %lu bytes", len);
+    cr_assert(out[0] == '[' && out[1] == '"' && out[len-7] == '"' && out[len-6] == ','
+              && out[len-1] == ']', "Got wrong output");
+    for(i = 0; i < n; i++){
+        if(out[2 + 4 * i] != 'a' || out[5 + 4 * i] != 'd'){
+            break;
+        }
+    }
+    cr_assert_eq(i, n, "Output differs at character %d", 2 + 4 * i);
+    free(out);
+    argo_context_reset(argo_ctx);
+}
+
+Test(basecode_suite, argo_files_load_test) {
+    // more files than are loaded at a time, one of them larger than the
+    // buffer used when the size is not known and one missing, still come
+    // out in the order of their names, however they were read
+    int num = ARGO_LOAD_FILES + 36, big = ARGO_LOAD_BUFFER_SIZE + 100;
+    char *files[ARGO_LOAD_FILES + 36];
+    char names[ARGO_LOAD_FILES + 36][32];
+    char *out = NULL;
+    size_t len = 0, pos = 0;
+    int i, j;
+
+    for(i = 0; i < num; i++){
+        snprintf(names[i], sizeof(names[i]), "test_output/load_%d.json", i);
+        files[i] = names[i];
+        if(i == 7){
+            continue;
+        }
+        FILE *f = fopen(names[i], "w");
+        cr_assert_not_null(f, "Cannot create %s", names[i]);
+        if(i == 40){
+            fputc('"', f);
+            for(j = 0; j < big; j++){
+                fputc('x', f);
+            }
+            fputc('"', f);
+        }
+        else{
+            fprintf(f, " %d ", i);
+        }
+        fclose(f);
+    }
+    remove(names[7]);
+
+    global_options = CANONICALIZE_OPTION | FILES_OPTION;
+    argo_select_writer(0);
+    FILE *o = open_memstream(&out, &len);
+    int ret = argo_files_run(files, num, o);
+    fclose(o);
+    cr_assert_neq(ret, 0, "The missing file was not reported");
+    for(i = 0; i < num; i++){
+        char exp[32];
+        if(i == 7){
+            continue;
+        }
+        if(i == 40){
+            cr_assert(pos + big + 3 <= len && out[pos] == '"' && out[pos + big] == 'x'
+                      && out[pos + big + 1] == '"', "Large file came out wrong");
+            pos += big + 3;
+            continue;
+        }
+        snprintf(exp, sizeof(exp), "%d\n", i);
+        for(j = 0; exp[j] != '\0'; j++){
+            cr_assert(pos < len && out[pos++] == exp[j], "Output of %s is wrong", names[i]);
+        }
+    }
+    cr_assert_eq(pos, len, "Got %lu bytes, expected %lu", len, pos);
+    free(out);
+}
+
+#ifdef ARGO_HAVE_ZLIB
+Test(basecode_suite, argo_compress_test) {
+    // output compressed with gzip, twice over into one file, reads back as
+    // the two documents, and input that is not compressed passes through
+    char *doc = "{\"a\":[1,2,3],\"b\":\"xyz\"}";
+    char *path = "test_output/compress.json.gz";
+    int format = -1, i;
+
+    FILE *f = fopen(path, "w");
+    cr_assert_not_null(f, "Cannot create %s", path);
+    for(i = 0; i < 2; i++){
+        FILE *z = argo_compress_open(f, ARGO_COMPRESS_GZIP, 0);
+        cr_assert_not_null(z, "argo_compress_open failed");
+        fputs(doc, z);
+        cr_assert_eq(fclose(z), 0, "Closing the compressed stream failed");
+    }
+    fclose(f);
+
+    f = fopen(path, "r");
+    cr_assert_eq(argo_compress_detect(f), ARGO_COMPRESS_GZIP, "gzip was not detected");
+    fclose(f);
+    FILE *in = argo_source_stream(argo_decompress_open(argo_source_path(path), &format));
+    cr_assert_not_null(in, "Cannot open %s", path);
+    cr_assert_eq(format, ARGO_COMPRESS_GZIP, "Got format %d", format);
+    for(i = 0; i < 2; i++){
+        char *out = NULL;
+        size_t len = 0;
+        global_options = CANONICALIZE_OPTION;
+        argo_select_writer(0);
+        ARGO_VALUE *v = argo_read_value(in);
+        cr_assert_not_null(v, "Document %d was not read", i);
+        FILE *o = open_memstream(&out, &len);
+        argo_write_value(v, o);
+        fclose(o);
+        cr_assert_str_eq(out, doc, "Got: %s | Expected: %s", out, doc);
+        free(out);
+    }
+    cr_assert_eq(fgetc(in), EOF, "Input was left over");
+    fclose(in);
+
+    FILE *m = fmemopen(doc, 23, "r");
+    ARGO_SOURCE *s = argo_decompress_open(argo_source_open(m), &format);
+    char buf[32];
+    cr_assert_eq(format, ARGO_COMPRESS_NONE, "Got format %d", format);
+    cr_assert_eq(s->read(s, buf, 2), 2, "Short read");
+    cr_assert_eq(s->read(s, buf + 2, sizeof(buf) - 2), 21, "Wrong length");
+    cr_assert(buf[0] == '{' && buf[2] == 'a' && buf[22] == '}', "Input was changed");
+    cr_assert_eq(s->read(s, buf, sizeof(buf)), 0, "Read past the end");
+    s->close(s);
+    fclose(m);
+    argo_context_reset(argo_ctx);
+}
+#endif
+
+Test(basecode_suite, argo_head_test, .timeout = 5) {
+    char doc[] = "[1, {\"a\": [2, 3]}, \"x\", garbage";
+    char *out = NULL;
+    size_t len = 0;
+    ARGO_HEAD h;
+    int i, kept = 0;
+
+    argo_head_init(&h, -1, 0.25, 42);
+    for(i = 0; i < 100000; i++){
+        kept += argo_head_keep(&h);
+    }
+    cr_assert(kept > 24000 && kept < 26000, "Kept %d of 100000 at rate 0.25", kept);
+    argo_head_init(&h, 3, 0, 42);
+    for(i = 0, kept = 0; i < 10; i++){
+        kept += argo_head_keep(&h);
+    }
+    cr_assert_eq(kept, 3, "Kept %d with a limit of 3", kept);
+
+    FILE *in = fmemopen(doc, sizeof(doc) - 1, "r");
+    FILE *o = open_memstream(&out, &len);
+    global_options = CANONICALIZE_OPTION;
+    argo_select_writer(0);
+    argo_head_count = 2;
+    cr_assert_eq(argo_head_run(in, o), 0, "The first elements were not output");
+    argo_head_count = 0;
+    fclose(o);
+    cr_assert_str_eq(out, "[1,{\"a\":[2,3]}]", "Got: %s", out);
+    cr_assert_eq(fgetc(in), ',', "Input after the last element was read");
+    free(out);
+    fclose(in);
+    argo_context_reset(argo_ctx);
+}
+
+Test(basecode_suite, argo_position_test, .timeout = 5) {
+    char doc[] = "[1,\n  2,\n  x]";
+    char text[300];
+    int i, k, line, column, l, c;
+
+    for(i = 0; i < (int) sizeof(text); i++){
+        text[i] = (i * 7) % 23 == 0 ? '\n' : 'a';
+    }
+    for(k = 0; k < (int) sizeof(text); k += 13){
+        line = 1;
+        column = 5;
+        l = 1;
+        c = 5;
+        argo_position_scan(text, k, &line, &column);
+        for(i = 0; i < k; i++){
+            c = text[i] == '\n' ? 0 : c + 1;
+            l += text[i] == '\n';
+        }
+        cr_assert(line == l && column == c, "After %d bytes: [%d, %d] but expected [%d, %d]",
+                  k, line, column, l, c);
+    }
+
+    FILE *f = fmemopen(doc, sizeof(doc) - 1, "r");
+    argo_context_input(argo_ctx, doc, sizeof(doc) - 1, 0, 0);
+    cr_assert_null(argo_read_value(f), "Invalid document was accepted");
+    cr_assert(argo_ctx->lines_read == 2 && argo_ctx->chars_read == 3, "Error reported at [%d, %d]",
+              argo_ctx->lines_read, argo_ctx->chars_read);
+    fclose(f);
+
+    // an error after a number starting with 0 is at the character that
+    // follows it, as after any other number
+    char *after_zero[] = {"[0 1]", "[1 2]", "[00]", "{\"a\":0 1}"};
+    int columns[] = {4, 4, 3, 8};
+    for(k = 0; k < 4; k++){
+        f = fmemopen(after_zero[k], strlen(after_zero[k]), "r");
+        argo_context_input(argo_ctx, after_zero[k], strlen(after_zero[k]), 0, 0);
+        cr_assert_null(argo_read_value(f), "%s was accepted", after_zero[k]);
+        cr_assert(argo_ctx->lines_read == 0 && argo_ctx->chars_read == columns[k],
+                  "%s: error reported at [%d, %d] instead of [0, %d]", after_zero[k],
+                  argo_ctx->lines_read, argo_ctx->chars_read, columns[k]);
+        fclose(f);
+    }
+    argo_context_input(argo_ctx, NULL, 0, 0, 0);
+    argo_context_reset(argo_ctx);
+}
+
+Test(basecode_suite, argo_number_text_long_test) {
+    char *exp = "-1234567890123456789012345678901234567890";
+    ARGO_CHAR text[64];
+    ARGO_NUMBER n = {0};
+    char *out = NULL;
+    size_t len = 0;
+    int i;
+
+    for(i = 0; exp[i]; i++)
+        text[i] = exp[i];
+    n.string_value.content = text;
+    n.string_value.length = i;
+    n.string_value.capacity = i;
+    // text longer than any canonical integer, flagged as canonical anyway
+    n.valid_string = ARGO_CANONICAL_TEXT;
+    FILE *f = open_memstream(&out, &len);
+    cr_assert_eq(argo_write_number(&n, f), 0, "argo_write_number failed");
+    fclose(f);
+    cr_assert_str_eq(out, exp, "Got: %s | Expected: %s", out, exp);
+    free(out);
+}
+
+Test(basecode_suite, argo_binary_corrupt_test) {
+    char *in = "[\"1234567890123456789012345678901234567890\",7]";
+    char *cmd = "bin/argo -B -c < test_output/corrupt.bin > test_output/corrupt_-B_-c.json";
+    char *exp = "[\"1234567890123456789012345678901234567890\",7]";
+    char out[128] = {0};
+
+    global_options = CANONICALIZE_OPTION;
+    FILE *f = fmemopen(in, strlen(in), "r");
+    ARGO_VALUE *v = argo_read_value(f);
+    fclose(f);
+    cr_assert_not_null(v, "argo_read_value returned NULL");
+    FILE *snap = fopen("test_output/corrupt.bin", "w+");
+    cr_assert_eq(argo_save_binary(v, snap), 0, "argo_save_binary failed");
+    // point the number at the 40 characters of the string and mark them canonical
+    ARGO_BIN_NODE nodes[3];
+    fseek(snap, sizeof(ARGO_BIN_HEADER), SEEK_SET);
+    cr_assert_eq(fread(nodes, sizeof(ARGO_BIN_NODE), 3, snap), 3, "Snapshot too short");
+    nodes[2].valid_string = ARGO_CANONICAL_TEXT;
+    nodes[2].text_offset = nodes[1].text_offset;
+    nodes[2].text_length = nodes[1].text_length;
+    fseek(snap, sizeof(ARGO_BIN_HEADER), SEEK_SET);
+    fwrite(nodes, sizeof(ARGO_BIN_NODE), 3, snap);
+    fclose(snap);
+    argo_context_reset(argo_ctx);
+
+    int return_code = WEXITSTATUS(system(cmd));
+    cr_assert_eq(return_code, EXIT_SUCCESS,
+                 "Program exited with 0x%x instead of EXIT_SUCCESS",
+		 return_code);
+    f = fopen("test_output/corrupt_-B_-c.json", "r");
+    cr_assert_not_null(fgets(out, sizeof(out), f), "No output");
+    fclose(f);
+    cr_assert_str_eq(out, exp, "Got: %s | Expected: %s", out, exp);
+}
+
+Test(basecode_suite, argo_parallel_limit_test) {
+    char *gen = "awk 'BEGIN { printf \"[\"; for(i = 0; i < 150000; i++) printf \"%s1\", i ? \",\" : \"\"; print \"]\" }'"
+                " > test_output/limit.json";
+    char *ser = "bin/argo -c < test_output/limit.json > /dev/null 2> test_output/limit_-c.err";
+    char *par = "bin/argo -c -j 4 < test_output/limit.json > /dev/null 2> test_output/limit_-c_-j.err";
+    char *cmp = "cmp test_output/limit_-c.err test_output/limit_-c_-j.err";
+
+    int return_code = WEXITSTATUS(system(gen));
+    cr_assert_eq(return_code, EXIT_SUCCESS, "Failed to generate input");
+    return_code = WEXITSTATUS(system(ser));
+    cr_assert_eq(return_code, EXIT_FAILURE,
+                 "Program exited with 0x%x instead of EXIT_FAILURE",
+		 return_code);
+    return_code = WEXITSTATUS(system(par));
+    cr_assert_eq(return_code, EXIT_FAILURE,
+                 "Program exited with 0x%x instead of EXIT_FAILURE",
+		 return_code);
+    return_code = WEXITSTATUS(system(cmp));
+    cr_assert_eq(return_code, EXIT_SUCCESS,
+                 "Parallel errors did not match serial errors.");
+}
+
+Test(basecode_suite, argo_serve_error_test, .timeout = 10) {
+    // the client of an invalid document gets the parser's messages,
+    // and the server's own stderr gets nothing
+    char *cmd = "rm -f test_output/serve.sock; bin/argo --serve test_output/serve.sock -j 1"
+                " 2> test_output/serve.err & echo $! > test_output/serve.pid";
+    char *stop = "kill $(cat test_output/serve.pid)";
+    char *exp = "[0, 4] Expect , but seen (49)\n[0, 4] Invalid array. \n";
+    unsigned char frame[] = {'c', 0, 0, 0, 0, 0, 0, 5, '[', '0', ' ', '1', ']'};
+    unsigned char header[ARGO_SERVE_HEADER_SIZE];
+    char out[128] = {0};
+    struct sockaddr_un addr = {0};
+    size_t len = 0;
+    ssize_t n;
+    int fd, i;
+
+    cr_assert_eq(system(cmd), 0, "Failed to start server");
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, "test_output/serve.sock");
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    for(i = 0; i < 100 && connect(fd, (struct sockaddr *) &addr, sizeof(addr)); i++)
+        usleep(50000);
+    cr_assert(i < 100, "Cannot connect to server");
+    cr_assert_eq(write(fd, frame, sizeof(frame)), sizeof(frame), "Cannot send request");
+    cr_assert_eq(read(fd, header, sizeof(header)), sizeof(header), "No response");
+    cr_assert_eq(header[0], ARGO_SERVE_INVALID, "Got status %d", header[0]);
+    len = header[7] | header[6] << 8;
+    while(strlen(out) < len && (n = read(fd, out + strlen(out), len - strlen(out))) > 0)
+        ;
+    close(fd);
+    system(stop);
+    cr_assert_str_eq(out, exp, "Got: %s | Expected: %s", out, exp);
+    FILE *f = fopen("test_output/serve.err", "r");
+    cr_assert_not_null(f, "No server stderr");
+    cr_assert_eq(fgetc(f), EOF, "Server wrote to its stderr");
+    fclose(f);
+}
+
+Test(basecode_suite, argo_encode_utf8_test) {
+    // --cbor implies -u, so an escaped U+00E9 becomes valid UTF-8,
+    // and a lone surrogate is refused rather than replaced
+    char *argv[] = {progname, "-c", "--cbor", NULL};
+    char *in = "[\"caf\\u00e9\"]";
+    char *bad = "[\"a\\ud800b\"]";
+    unsigned char cbor[] = {0x81, 0x65, 'c', 'a', 'f', 0xC3, 0xA9};
+    char *out = NULL;
+    size_t len = 0;
+    size_t i;
+
+    cr_assert_eq(validargs(3, argv), 0, "validargs failed");
+    cr_assert_eq(global_options, CANONICALIZE_OPTION | CBOR_OPTION | UTF8_OPTION,
+                 "Invalid options settings.  Got: 0x%x", global_options);
+    FILE *f = fmemopen(in, strlen(in), "r");
+    ARGO_VALUE *v = argo_read_value(f);
+    fclose(f);
+    cr_assert_not_null(v, "argo_read_value returned NULL");
+    f = open_memstream(&out, &len);
+    cr_assert_eq(argo_write_cbor(v, f), 0, "argo_write_cbor failed");
+    fclose(f);
+    cr_assert_eq(len, sizeof(cbor), "CBOR is %ld bytes instead of %ld", (long)len, (long)sizeof(cbor));
+    for(i = 0; i < len; i++)
+        cr_assert_eq((unsigned char)out[i], cbor[i], "CBOR byte %ld is %02x", (long)i, (unsigned char)out[i]);
+    free(out);
+
+    f = fmemopen(bad, strlen(bad), "r");
+    v = argo_read_value(f);
+    fclose(f);
+    cr_assert_not_null(v, "argo_read_value returned NULL");
+    f = open_memstream(&out, &len);
+    cr_assert_neq(argo_write_msgpack(v, f), 0, "Lone surrogate was encoded");
+    fclose(f);
+    free(out);
+    argo_context_reset(argo_ctx);
+}
+
+Test(basecode_suite, help_more_test) {
+    // every option beyond those of USAGE has its own line in the help
+    char *flags[] = {"-n", "-j", "-s", "-q", "--keep", "-u", "-b", "-B", "--cbor", "--msgpack", "--from-cbor", "--from-msgpack", "-C", "-H", "--diff", "--dedup", "FILE...", "-w", "--serve", "--load", "--pipeline", "--io", "--compress", "--head", "--sample", NULL};
+    char cmd[128];
+    int i;
+
+    for(i = 0; flags[i] != NULL; i++){
+        snprintf(cmd, sizeof(cmd), "bin/argo -h 2>&1 | grep -q -E '^   %s( |$)'", flags[i]);
+        cr_assert_eq(WEXITSTATUS(system(cmd)), EXIT_SUCCESS, "No help for %s", flags[i]);
+    }
+}
+
+Test(basecode_suite, argo_diff_duplicate_test) {
+    // a patch cannot address one of two members with the same name,
+    // so such objects are refused rather than patched wrongly
+    char *sa = "{\"a\":1,\"a\":2}";
+    char *sb = "{\"a\":2}";
+    ARGO_MERKLE ma, mb;
+    ARGO_CONTEXT *main_ctx = argo_ctx;
+    char *out = NULL;
+    size_t len = 0;
+
+    global_options = CANONICALIZE_OPTION;
+    argo_select_writer(0);
+    FILE *f = fmemopen(sa, strlen(sa), "r");
+    ARGO_VALUE *a = argo_read_value(f);
+    fclose(f);
+    cr_assert_not_null(a, "argo_read_value returned NULL");
+    cr_assert_eq(argo_merkle_build(&ma, a), 0, "argo_merkle_build failed");
+    argo_ctx = argo_context_create(100);
+    cr_assert_not_null(argo_ctx, "argo_context_create returned NULL");
+    f = fmemopen(sb, strlen(sb), "r");
+    ARGO_VALUE *b = argo_read_value(f);
+    fclose(f);
+    cr_assert_not_null(b, "argo_read_value returned NULL");
+    cr_assert_eq(argo_merkle_build(&mb, b), 0, "argo_merkle_build failed");
+    f = open_memstream(&out, &len);
+    cr_assert_neq(argo_diff(a, &ma, b, &mb, f), 0, "Duplicate member names were diffed");
+    cr_assert_neq(argo_diff(b, &mb, a, &ma, f), 0, "Duplicate member names were diffed");
+    fclose(f);
+    cr_assert_eq(len, 0, "Got output: %s", out);
+    free(out);
+    argo_merkle_free(&ma);
+    argo_merkle_free(&mb);
+    argo_context_destroy(argo_ctx);
+    argo_ctx = main_ctx;
+    argo_context_reset(argo_ctx);
+}
+
+Test(basecode_suite, argo_query_skipped_test) {
+    // subtrees skipped on the way to the pointer must still be well formed
+    char *bad[] = {"{\"x\":[1,}, \"c\":1}", "{\"x\":{\"y\":1]], \"c\":1}",
+                   "{\"x\":\"\\\\q\", \"c\":1}", "{\"x\":\"\\\\u12g4\", \"c\":1}", NULL};
+    char cmd[200];
+
+    for(int i = 0; bad[i] != NULL; i++) {
+        snprintf(cmd, sizeof(cmd), "printf '%s' | bin/argo -q /c > /dev/null 2>&1", bad[i]);
+        int return_code = WEXITSTATUS(system(cmd));
+        cr_assert_eq(return_code, EXIT_FAILURE,
+                     "Malformed skipped subtree was accepted: %s", bad[i]);
+    }
+    int return_code = WEXITSTATUS(system("printf '{\"x\":[{\"y\":\"\\\\u00e9\\\\\"\"}], \"c\":1}' | bin/argo -q /c | grep -q -x 1"));
+    cr_assert_eq(return_code, EXIT_SUCCESS,
+                 "Well formed skipped subtree was refused");
+}
+
+Test(basecode_suite, argo_keep_skipped_test) {
+    // members pruned from the projection must still be well formed
+    char *cmd = "printf '{\"x\":[1,}, \"c\":1}' | bin/argo --keep c > /dev/null 2>&1";
+
+    int return_code = WEXITSTATUS(system(cmd));
+    cr_assert_eq(return_code, EXIT_FAILURE,
+                 "Malformed pruned member was accepted");
+}
+
+Test(basecode_suite, argo_keep_scalar_test) {
+    // a value that a path cannot go into is kept whole, at any depth
+    char *specs[] = {"c.x", "a.b.c", "d[*].x", "a[*]", NULL};
+    char *outs[] = {"{\"c\":1}", "{\"a\":{\"b\":1}}", "{\"d\":[1,{\"x\":2}]}", "{\"a\":{\"b\":1}}"};
+    char cmd[200];
+
+    for(int i = 0; specs[i] != NULL; i++) {
+        snprintf(cmd, sizeof(cmd), "printf '{\"a\":{\"b\":1},\"c\":1,\"d\":[1,{\"x\":2,\"y\":3}]}' | bin/argo --keep '%s' | grep -q -x -F '%s'",
+                 specs[i], outs[i]);
+        int return_code = WEXITSTATUS(system(cmd));
+        cr_assert_eq(return_code, EXIT_SUCCESS,
+                     "Wrong projection for %s", specs[i]);
+    }
+}
+
+Test(basecode_suite, argo_serve_write_error_test, .timeout = 10) {
+    // a document that parses but cannot be written also gets its
+    // messages back, from the writer this time
+    char *cmd = "rm -f test_output/serve_write.sock; bin/argo --serve test_output/serve_write.sock -j 1"
+                " 2> test_output/serve_write.err & echo $! > test_output/serve_write.pid";
+    char *stop = "kill $(cat test_output/serve_write.pid)";
+    char *exp = "Invalid float number to write\nError in write number\nError in write array\n";
+    unsigned char frame[] = {'c', 0, 0, 0, 0, 0, 0, 7, '[', '1', 'e', '4', '0', '0', ']'};
+    unsigned char header[ARGO_SERVE_HEADER_SIZE];
+    char out[128] = {0};
+    struct sockaddr_un addr = {0};
+    size_t len = 0;
+    ssize_t n;
+    int fd, i;
+
+    cr_assert_eq(system(cmd), 0, "Failed to start server");
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, "test_output/serve_write.sock");
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    for(i = 0; i < 100 && connect(fd, (struct sockaddr *) &addr, sizeof(addr)); i++)
+        usleep(50000);
+    cr_assert(i < 100, "Cannot connect to server");
+    cr_assert_eq(write(fd, frame, sizeof(frame)), sizeof(frame), "Cannot send request");
+    cr_assert_eq(read(fd, header, sizeof(header)), sizeof(header), "No response");
+    cr_assert_eq(header[0], ARGO_SERVE_INVALID, "Got status %d", header[0]);
+    len = header[7] | header[6] << 8;
+    while(strlen(out) < len && (n = read(fd, out + strlen(out), len - strlen(out))) > 0)
+        ;
+    close(fd);
+    system(stop);
+    cr_assert_str_eq(out, exp, "Got: %s | Expected: %s", out, exp);
+    FILE *f = fopen("test_output/serve_write.err", "r");
+    cr_assert_not_null(f, "No server stderr");
+    cr_assert_eq(fgetc(f), EOF, "Server wrote to its stderr");
+    fclose(f);
+}
+
+Test(basecode_suite, argo_parallel_truncated_test) {
+    // input that ends early is reported at its end, past a final newline,
+    // however it is read
+    char *cmds[] = {"printf '[1,2\\n' | bin/argo -c 2> test_output/truncated_-c.err",
+                    "printf '[1,2\\n' | bin/argo -c -j 2 2> test_output/truncated_-c_-j.err",
+                    "printf '[1,2\\n' > test_output/truncated.json; bin/argo -c < test_output/truncated.json"
+                    " 2> test_output/truncated_file.err", NULL};
+    char *exp = "[1, 0] Expect ']' in array but seen (-1)\n[1, 0] Invalid array. \n";
+    char *errs[] = {"test_output/truncated_-c.err", "test_output/truncated_-c_-j.err",
+                    "test_output/truncated_file.err"};
+    char out[128];
+    size_t len;
+
+    for(int i = 0; cmds[i] != NULL; i++) {
+        int return_code = WEXITSTATUS(system(cmds[i]));
+        cr_assert_eq(return_code, EXIT_FAILURE,
+                     "Program exited with 0x%x instead of EXIT_FAILURE",
+                     return_code);
+        FILE *f = fopen(errs[i], "r");
+        cr_assert_not_null(f, "No stderr from %s", cmds[i]);
+        len = fread(out, 1, sizeof(out) - 1, f);
+        out[len] = '\0';
+        fclose(f);
+        cr_assert_str_eq(out, exp, "%s: got %s | Expected: %s", cmds[i], out, exp);
+    }
+}